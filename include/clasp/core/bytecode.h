@@ -355,7 +355,7 @@ class VMFrameDynEnv_O : public DynEnv_O {
   LISP_CLASS(core, CorePkg, VMFrameDynEnv_O, "VMFrameDynEnv", DynEnv_O);
 
 public:
-  VMFrameDynEnv_O(T_O** a_old_sp, T_O** a_old_fp) : old_sp(a_old_sp), old_fp(a_old_fp) {}
+  VMFrameDynEnv_O(T_O** a_old_sp, T_O** a_old_fp, T_O** a_old_rp) : old_sp(a_old_sp), old_fp(a_old_fp), old_rp(a_old_rp) {}
   // Slightly sketchy: We use the destructor to reset the stack pointer,
   // so that C++ unwinds are also affected by this dynenv.
   // This means VMFrames must be stack allocated.
@@ -363,11 +363,13 @@ public:
     VirtualMachine& vm = my_thread->_VM;
     vm._stackPointer = this->old_sp;
     vm._framePointer = this->old_fp;
+    vm._recordPointer = this->old_rp;
   }
 
 public:
   T_O** old_sp;
   T_O** old_fp;
+  T_O** old_rp;
 
 public:
   virtual SearchStatus search() const { return Continue; }
@@ -484,6 +484,7 @@ public:
   void emit_parse_key_args(size_t max_count, size_t key_count, size_t key_start, size_t indx, bool aokp) const;
   void emit_bind(size_t count, size_t offset) const;
   void emit_call(size_t argcount) const;
+  void emit_ref_ref(LexicalVarInfo_sp info1, LexicalVarInfo_sp info2, bool callp) const;
   void emit_mv_call() const;
   void emit_special_bind(Symbol_sp sym) const;
   void emit_unbind(size_t count) const;
@@ -690,6 +691,36 @@ public:
   virtual size_t resize();
 };
 
+// Used for the ref-ref superinstructions, which push two local
+// variables. If either variable ends up in a cell, the superinstruction
+// can't be used, and we emit the separate instructions instead.
+FORWARD(RefRefFixup);
+class RefRefFixup_O : public Fixup_O {
+  LISP_CLASS(comp, CompPkg, RefRefFixup_O, "RefRefFixup", Fixup_O);
+
+public:
+  LexicalInfo_sp _lex1;
+  LexicalInfo_sp _lex2;
+  uint8_t _opcode;
+
+public:
+  RefRefFixup_O() : Fixup_O() {}
+  RefRefFixup_O(LexicalInfo_sp lex1, LexicalInfo_sp lex2, uint8_t opcode)
+      : Fixup_O(3), _lex1(lex1), _lex2(lex2), _opcode(opcode) {}
+  CL_LISPIFY_NAME(RefRefFixup/make)
+  CL_DEF_CLASS_METHOD
+  static RefRefFixup_sp make(LexicalInfo_sp lex1, LexicalInfo_sp lex2, uint8_t opcode) {
+    return gctools::GC<RefRefFixup_O>::allocate<gctools::RuntimeStage>(lex1, lex2, opcode);
+  }
+
+public:
+  LexicalInfo_sp lex1() { return this->_lex1; }
+  LexicalInfo_sp lex2() { return this->_lex2; }
+  uint8_t opcode() { return this->_opcode; }
+  virtual void emit(size_t position, SimpleVector_byte8_t_sp code);
+  virtual size_t resize();
+};
+
 FORWARD(EncageFixup);
 class EncageFixup_O : public LexFixup_O {
   LISP_CLASS(comp, CompPkg, EncageFixup_O, "EncageFixup", LexFixup_O);
@@ -358,7 +358,8 @@ public:
   // Size of this function in bytes - used for debugging
   unsigned int _BytecodeSize;
   BytecodeTrampolineFunction _Trampoline;
-  // How many times this function has been called.
+  // How many times this function has been called, plus how many
+  // loop iterations it has run (see vm_back_edge in bytecode.cc).
   // Tracked to get data about what functions should be optimized.
   // uint16 is "small" so this will roll over eventually, but we
   // will probably compile it before that point.
@@ -388,9 +389,10 @@ public:
   T_sp end() const;
   CL_LISPIFY_NAME(BytecodeSimpleFun/call-count)
   CL_DEFMETHOD Fixnum callCount() const { return this->_CallCount.load(std::memory_order_relaxed); }
-  inline void countCall() {
+  // Returns the new count.
+  inline uint16_t countCall() {
     // We use this instead of ++ to get a weak memory ordering.
-    this->_CallCount.fetch_add(1, std::memory_order_relaxed);
+    return this->_CallCount.fetch_add(1, std::memory_order_relaxed) + 1;
   }
   // Used in loadltv.cc since functions may be named after they are made.
   void set_trampoline(Pointer_sp trampoline);
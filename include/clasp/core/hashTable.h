@@ -38,10 +38,12 @@ THE SOFTWARE.
 namespace core {
 double maybeFixRehashThreshold(double rt);
 #define DEFAULT_REHASH_THRESHOLD 0.7
+/*! Number of control bytes examined together when probing a table that caches hashes */
+#define HASH_TABLE_GROUP_WIDTH 16
 
 T_sp cl__make_hash_table(T_sp test, Fixnum_sp size, Number_sp rehash_size, Real_sp orehash_threshold,
                          Symbol_sp weakness = nil<T_O>(), T_sp debug = nil<T_O>(), T_sp thread_safe = nil<T_O>(),
-                         T_sp hashf = nil<T_O>());
+                         T_sp hashf = nil<T_O>(), T_sp cache_hashes = kw::_sym_default);
 
 size_t next_hash_table_id();
 
@@ -59,7 +61,7 @@ public:
 FORWARD(HashTable);
 class HashTable_O : public HashTableBase_O {
   friend T_sp cl__make_hash_table(T_sp test, Fixnum_sp size, Number_sp rehash_size, Real_sp orehash_threshold, Symbol_sp weakness,
-                                  T_sp debug, T_sp thread_safe, T_sp hashf);
+                                  T_sp debug, T_sp thread_safe, T_sp hashf, T_sp cache_hashes);
   friend class HashTableReadLock;
   friend class HashTableWriteLock;
   LISP_CLASS(core, ClPkg, HashTable_O, "HashTable", HashTableBase_O);
@@ -72,7 +74,8 @@ class HashTable_O : public HashTableBase_O {
 #ifdef DEBUG_REHASH_COUNT
         _HashTableId(next_hash_table_id()), _RehashCount(0), _InitialSize(0),
 #endif
-        _RehashSize(nil<Number_O>()), _RehashThreshold(maybeFixRehashThreshold(0.7)), _HashTableCount(0)
+        _RehashSize(nil<Number_O>()), _RehashThreshold(maybeFixRehashThreshold(0.7)), _Control(nil<SimpleVector_byte8_t_O>()),
+        _Hashes(nil<SimpleVector_byte64_t_O>()), _HashTableCount(0)
 #ifdef DEBUG_HASH_TABLE_DEBUG
         ,
         _Debug(false), _History(nil<T_O>())
@@ -96,12 +99,21 @@ public: // instance variables here
   Number_sp _RehashSize;
   double _RehashThreshold;
   gctools::Vec0<KeyValuePair> _Table;
+  /*! If the table caches hashes, _Control has a control byte for every slot of _Table
+      (followed by HASH_TABLE_GROUP_WIDTH bytes mirroring the first slots, so that a group
+      can be loaded at any index without wrapping) and _Hashes has the full hash of every key.
+      Both are NIL otherwise. _Table stays authoritative for iteration. */
+  SimpleVector_byte8_t_sp _Control;
+  SimpleVector_byte64_t_sp _Hashes;
   size_t _HashTableCount;
 #ifdef DEBUG_HASH_TABLE_DEBUG
   bool _Debug;
   std::atomic<T_sp> _History;
 #endif
 #ifdef CLASP_THREADS
+  /*! Odd while a writer is modifying the table; gethash on a thread-safe table reads
+      without locking and retries if this changed during its search. */
+  std::atomic<size_t> _Sequence{0};
   mutable mp::SharedMutex_sp _Mutex;
 #endif
 public:
@@ -118,11 +130,21 @@ public:
   static void sxhash_equalp(HashGenerator& running_hash, T_sp obj);
   void setupThreadSafeHashTable();
   void setupDebug();
+  void setupHashCache();
 
 private:
   void setup(uint sz, Number_sp rehashSize, double rehashThreshold);
   uint resizeEmptyTable_no_lock(size_t sz);
   uint calculateHashTableCount() const;
+  void resetHashCache_no_lock();
+  void setControl_no_lock(size_t slot, uint8_t control);
+  KeyValuePair* searchCached_no_read_lock(T_sp key, cl_index index, uint64_t hash);
+#ifdef CLASP_THREADS
+  /*! Search for the key with the given hash without locking. Return false if a writer
+      got in the way, otherwise set VALUE and FOUND and return true. */
+  bool gethash_optimistic(T_sp key, uint64_t hash, T_sp& value, bool& found) const;
+#endif
+  size_t findFreeCached_no_read_lock(cl_index index) const;
 
 public:
   List_sp hash_table_bucket(size_t index);
@@ -141,6 +163,8 @@ public:
   //    void set_thread_safe(bool thread_safe);
 public: // Functions here
   virtual bool is_eq_hashtable() const { return false; }
+  /*! True if the table keeps a control byte and the full hash of each key alongside _Table */
+  bool cachesHashes() const { return this->_Control.notnilp(); };
   virtual bool equalp(T_sp other) const override;
 
   /*! See CLHS */
@@ -160,7 +184,7 @@ public: // Functions here
   List_sp bucketsFind_no_lock(T_sp key) const;
   /*! I'm not sure I need this and bucketsFind */
   virtual KeyValuePair* searchTable_no_read_lock(T_sp key, cl_index index);
-  KeyValuePair* tableRef_no_read_lock(T_sp key, cl_index index);
+  KeyValuePair* tableRef_no_read_lock(T_sp key, cl_index index, const HashGenerator& hg);
   //    List_sp findAssoc_no_lock(gc::Fixnum index, T_sp searchKey) const;
 
   T_sp hash_table_average_search_length();
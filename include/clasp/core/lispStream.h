@@ -104,6 +104,12 @@ template <> struct gctools::GCInfo<core::PosixFileStream_O> {
   static GCInfo_policy constexpr Policy = normal;
 };
 
+template <> struct gctools::GCInfo<core::MmapFileStream_O> {
+  static bool constexpr NeedsInitialization = false;
+  static bool constexpr NeedsFinalization = true;
+  static GCInfo_policy constexpr Policy = normal;
+};
+
 template <> struct gctools::GCInfo<core::CFileStream_O> {
   static bool constexpr NeedsInitialization = false;
   static bool constexpr NeedsFinalization = true;
@@ -173,7 +179,8 @@ typedef enum {
   CLASP_STREAM_LITTLE_ENDIAN = 128,
   CLASP_STREAM_C_STREAM = 256,
   CLASP_STREAM_MIGHT_SEEK = 512,
-  CLASP_STREAM_CLOSE_COMPONENTS = 1024
+  CLASP_STREAM_CLOSE_COMPONENTS = 1024,
+  CLASP_STREAM_MMAP = 2048
 } StreamFlagsEnum;
 
 typedef enum : claspCharacter {
@@ -934,6 +941,7 @@ public: // Functions here
   void unread_char(claspCharacter c) override;
 
   claspCharacter write_char(claspCharacter c) override;
+  void write_string(String_sp data, cl_index start, cl_index end) override;
 
   cl_index read_sequence(T_sp data, cl_index start, cl_index n) override;
   void write_sequence(T_sp data, cl_index start, cl_index n) override;
@@ -954,9 +962,23 @@ class PosixFileStream_O : public FileStream_O {
 
 public:
   int _file_descriptor;
+  // One of _IONBF, _IOLBF or _IOFBF, as for CFileStream_O::set_buffering_mode.
+  // The buffers are allocated on first use and hold _buffer_size bytes.
+  int _buffering;
+  size_t _buffer_size;
+  unsigned char* _input_buffer;
+  size_t _input_pos;
+  size_t _input_end;
+  unsigned char* _output_buffer;
+  size_t _output_fill;
 
 public:
-  PosixFileStream_O(){};
+  PosixFileStream_O()
+      : _buffering(_IONBF), _buffer_size(BUFSIZ), _input_buffer(NULL), _input_pos(0), _input_end(0), _output_buffer(NULL),
+        _output_fill(0){};
+  virtual ~PosixFileStream_O();
+
+  void fixupInternalsForSnapshotSaveLoad(snapshotSaveLoad::Fixup* fixup);
 
   static PosixFileStream_sp make(T_sp fname, int fd, StreamDirection smm, gctools::Fixnum byte_size = 8,
                                  int flags = CLASP_STREAM_DEFAULT_FORMAT, T_sp external_format = nil<T_O>(),
@@ -983,6 +1005,59 @@ public:
   T_sp set_position(T_sp pos) override;
 
   int file_descriptor(StreamDirection direction) const override;
+
+  void set_buffering_mode(T_sp mode);
+
+private:
+  gctools::Fixnum read_fd(unsigned char* c, cl_index n);
+  gctools::Fixnum write_fd(unsigned char* c, cl_index n);
+  void flush_output_buffer();
+  void drop_input_buffer();
+  void free_buffers();
+};
+
+// An input file stream that reads from a read-only mapping of the whole
+// file, so reading and repositioning are pointer arithmetic.
+class MmapFileStream_O : public FileStream_O {
+  LISP_CLASS(core, CorePkg, MmapFileStream_O, "mmap-file-stream", FileStream_O);
+
+public:
+  int _file_descriptor;
+  unsigned char* _map;
+  size_t _size;
+  size_t _position;
+
+public:
+  MmapFileStream_O() : _file_descriptor(-1), _map(NULL), _size(0), _position(0){};
+  virtual ~MmapFileStream_O();
+
+  void fixupInternalsForSnapshotSaveLoad(snapshotSaveLoad::Fixup* fixup);
+
+  static MmapFileStream_sp make(T_sp fname, int fd, gctools::Fixnum byte_size = 8, int flags = CLASP_STREAM_DEFAULT_FORMAT,
+                                T_sp external_format = nil<T_O>());
+
+  virtual bool has_file_position() const override;
+
+  T_sp close(T_sp abort) override;
+
+  cl_index read_byte8(unsigned char* c, cl_index n) override;
+  cl_index write_byte8(unsigned char* c, cl_index n) override;
+
+  ListenResult listen() override;
+  void clear_input() override;
+
+  bool interactive_p() const override;
+
+  T_sp length() override;
+  T_sp position() override;
+  T_sp set_position(T_sp pos) override;
+
+  int file_descriptor(StreamDirection direction) const override;
+
+  Array_sp copyOctets();
+
+private:
+  void unmap();
 };
 
 class CFileStream_O : public FileStream_O {
@@ -35,6 +35,7 @@ FORWARD(Mutex);
 FORWARD(SharedMutex);
 FORWARD(RecursiveMutex);
 FORWARD(ConditionVariable);
+FORWARD(ConcurrentQueue);
 }; // namespace mp
 
 namespace mp {
@@ -327,3 +328,72 @@ public:
 };
 void mp__interrupt_process(Process_sp process, core::T_sp func);
 }; // namespace mp
+
+template <> struct gctools::GCInfo<mp::ConcurrentQueue_O> {
+  static bool constexpr NeedsInitialization = false;
+  static bool constexpr NeedsFinalization = false;
+  static GCInfo_policy constexpr Policy = normal;
+};
+
+namespace mp {
+
+/*! A lock-free multi-producer/multi-consumer FIFO queue.
+    An unbounded queue is a Michael-Scott linked list of conses: the car of
+    each cons holds an object and the cdr links to the next one, and _Head
+    points to a dummy cons whose successors are the queued objects.
+    A bounded queue is Vyukov's ring buffer: _Cells is a simple-vector of
+    conses whose car is the cell's sequence number and whose cdr holds the
+    object. Both only ever touch the atomic car and cdr of conses, so the
+    collector sees every queued object.
+    Threads only take _WaitMutex to sleep when the queue is empty; producers
+    only take it when _Waiters says that somebody is sleeping. */
+FORWARD(ConcurrentQueue);
+class ConcurrentQueue_O : public core::CxxObject_O {
+  LISP_CLASS(mp, MpPkg, ConcurrentQueue_O, "ConcurrentQueue", core::CxxObject_O);
+
+public:
+  static ConcurrentQueue_sp make_concurrent_queue(core::T_sp name, core::T_sp capacity);
+
+public:
+  core::T_sp _Name;
+  core::T_sp _Cells; // NIL for unbounded queues
+  size_t _Mask;
+  std::atomic<size_t> _EnqueuePos;
+  std::atomic<size_t> _DequeuePos;
+  std::atomic<core::T_sp> _Head;
+  std::atomic<core::T_sp> _Tail;
+  std::atomic<size_t> _Waiters;
+  dont_expose<Mutex> _WaitMutex;
+  dont_expose<ConditionVariable> _NotEmpty;
+  ConcurrentQueue_O(core::T_sp name, core::T_sp cells, size_t mask)
+      : _Name(name), _Cells(cells), _Mask(mask), _EnqueuePos(0), _DequeuePos(0), _Head(nil<core::T_O>()),
+        _Tail(nil<core::T_O>()), _Waiters(0){};
+
+  bool boundedp() const { return this->_Cells.notnilp(); }
+  size_t capacity() const { return this->_Mask + 1; }
+  /*! Enqueue OBJECT; return false if the queue is bounded and full. */
+  bool try_enqueue(core::T_sp object);
+  /*! Enqueue the objects of LIST in order, stopping if a bounded queue fills
+      up. Return the number of objects enqueued. */
+  size_t try_enqueue_list(core::List_sp list);
+  /*! Dequeue an object into OBJECT; return false if the queue is empty. */
+  bool try_dequeue(core::T_sp& object);
+  /*! Dequeue up to MAX objects and return them as a list, or NIL if the
+      queue is empty. */
+  core::List_sp try_dequeue_list(size_t max);
+  /*! Dequeue up to MAX objects, waiting up to TIMEOUT seconds (forever if
+      TIMEOUT is NIL) for the queue to become non-empty. */
+  core::List_sp dequeue_list(size_t max, core::T_sp timeout);
+  size_t count() const;
+  void wake_waiters(size_t enqueued);
+  string __repr__() const override;
+
+  virtual void fixupInternalsForSnapshotSaveLoad(snapshotSaveLoad::Fixup* fixup) {
+    if (snapshotSaveLoad::operation(fixup) == snapshotSaveLoad::LoadOp) {
+      new (&this->_WaitMutex._value) Mutex();
+      new (&this->_NotEmpty._value) ConditionVariable();
+      this->_Waiters.store(0);
+    }
+  }
+};
+}; // namespace mp
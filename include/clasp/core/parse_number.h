@@ -0,0 +1,43 @@
+#pragma once
+/*
+    File: parse_number.h
+*/
+
+/*
+Copyright (c) 2014, Christian E. Schafmeister
+
+CLASP is free software; you can redistribute it and/or
+modify it under the terms of the GNU Library General Public
+License as published by the Free Software Foundation; either
+version 2 of the License, or (at your option) any later version.
+
+See directory 'clasp/licenses' for full details.
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+/* -^- */
+
+#include <clasp/core/object.h>
+
+namespace core {
+
+/*! Interpret the characters [start,end) as an integer, ratio or float
+   with the syntax of CLHS 2.3.1. Integers and ratios are read in
+   READ_BASE; floats without an exponent marker, or with E, are made in
+   FLOAT_FORMAT (normally the value of *read-default-float-format*).
+   Return unbound if the characters aren't a number, or are a ratio
+   with a zero denominator.
+   Char is Fixnum (reader token characters with their traits in the
+   high bits), claspChar or claspCharacter. */
+template <typename Char> T_sp parse_number(const Char* start, const Char* end, int read_base, T_sp float_format);
+
+}; // namespace core
@@ -51,18 +51,22 @@ public: // instance variables here
   typedef typename gctools::WeakKeyHashTable::value_type value_type;
   typedef typename gctools::WeakKeyHashTable::KeyBucketsType KeyBucketsType;
   typedef typename gctools::WeakKeyHashTable::ValueBucketsType ValueBucketsType;
-  typedef typename gctools::WeakKeyHashTable::KeyBucketsAllocatorType KeyBucketsAllocatorType;
-  typedef typename gctools::WeakKeyHashTable::ValueBucketsAllocatorType ValueBucketsAllocatorType;
   typedef gctools::WeakKeyHashTable HashTableType;
 
 public: // Fields
   HashTableType _HashTable;
 
 public:
-  WeakKeyHashTable_O(size_t sz, Number_sp rehashSize, double rehashThreshold) : _HashTable(sz, rehashSize, rehashThreshold){};
+  WeakKeyHashTable_O(size_t sz, Number_sp rehashSize, double rehashThreshold,
+                     gctools::WeakHashTableTest test = gctools::WeakHashTableTest::eq,
+                     gctools::WeakHashTableWeakness weakness = gctools::WeakHashTableWeakness::key)
+      : _HashTable(sz, rehashSize, rehashThreshold, test, weakness){};
   WeakKeyHashTable_O();
   void initialize() override;
 
+  static WeakKeyHashTable_sp create(size_t sz, Number_sp rehashSize, double rehashThreshold, gctools::WeakHashTableTest test,
+                                    gctools::WeakHashTableWeakness weakness);
+
 public:
   size_t hashTableCount() const override { return this->_HashTable.tableSize(); };
   cl_index size() const { return this->hashTableCount(); };
@@ -73,10 +77,9 @@ public:
   bool fullp();
 
   void describe(T_sp stream) override;
-  virtual T_sp hashTableTest() const { return cl::_sym_eq; };
-  bool keyTest(T_sp entryKey, T_sp searchKey) const;
-
-  gc::Fixnum sxhashKey(T_sp key, gc::Fixnum bound, bool willAddKey) const;
+  virtual T_sp hashTableTest() const;
+  /*! Return :KEY, :VALUE, :KEY-AND-VALUE or :KEY-OR-VALUE */
+  Symbol_sp hashTableWeakness() const;
 
   void maphashLowLevel(std::function<void(T_sp, T_sp)> const& fn);
   void maphash(T_sp functionDesig) override;
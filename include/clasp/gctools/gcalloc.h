@@ -1123,7 +1123,7 @@ public:
   static gctools::tagged_pointer<container_type> allocate(Header_s::BadgeStampWtagMtag the_header, size_type num, const void* = 0) {
     size_t size = sizeof_container_with_header<container_type>(num);
 #if defined(USE_BOEHM)
-    Header_s* base = do_boehm_weak_allocation(the_header, size);
+    Header_s* base = do_boehm_weak_allocation(the_header, size, std::is_same<StrongWeakLinkType, StrongLinks>::value);
     container_pointer myAddress = (container_pointer)HeaderPtrToWeakPtr(base);
     if (!myAddress)
       throw_hard_error("Out of memory in allocate");
@@ -1156,7 +1156,8 @@ public:
   static gctools::tagged_pointer<container_type> snapshot_save_load_allocate(snapshotSaveLoad::snapshot_save_load_init_s* init) {
     size_t size = (init->_clientEnd - init->_clientStart) + SizeofWeakHeader();
 #if defined(USE_BOEHM)
-    Header_s* base = do_boehm_weak_allocation(init->_headStart->_badge_stamp_wtag_mtag, size);
+    Header_s* base = do_boehm_weak_allocation(init->_headStart->_badge_stamp_wtag_mtag, size,
+                                              std::is_same<StrongWeakLinkType, StrongLinks>::value);
 #ifdef DEBUG_GUARD
     // Copy the source from the image save/load memory.
     base->_source = init->_headStart->_source;
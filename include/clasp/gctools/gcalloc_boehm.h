@@ -6,6 +6,8 @@
 #define ALIGNED_GC_MALLOC_ATOMIC(sz) MAYBE_MONITOR_ALLOC(GC_MALLOC_ATOMIC(sz), sz)
 #define ALIGNED_GC_MALLOC_UNCOLLECTABLE(sz) MAYBE_MONITOR_ALLOC(GC_MALLOC_UNCOLLECTABLE(sz), sz)
 #define ALIGNED_GC_MALLOC_KIND(stmp, sz, knd, kndaddr) MAYBE_MONITOR_ALLOC(GC_malloc_kind_global(sz, knd), sz)
+#define ALIGNED_GC_MALLOC_KIND_CACHED(cache, stmp, sz, knd, kndaddr)                                                               \
+  MAYBE_MONITOR_ALLOC(gctools::boehm_cached_malloc_kind(cache, sz, knd), sz)
 #define ALIGNED_GC_MALLOC_STRONG_WEAK_KIND(sz, knd) MAYBE_MONITOR_ALLOC(GC_malloc_kind_global(sz, knd), sz)
 #define ALIGNED_GC_MALLOC_ATOMIC_KIND(stmp, sz, knd, kndaddr)                                                                      \
   MAYBE_MONITOR_ALLOC(                                                                                                             \
@@ -22,12 +24,39 @@
 #endif
 
 namespace gctools {
+#ifdef USE_BOEHM
+/*! Allocate an object of the given kind from the thread's allocation cache.
+    The free list for the kind and size is refilled with a batch of objects
+    when it runs dry. Pointer-free objects (batches of them aren't cleared),
+    kinds and sizes the cache doesn't cover, and threads without a cache
+    use the global allocator. */
+inline void* boehm_cached_malloc_kind(BoehmAllocationCache* cache, size_t size, uintptr_t kind) {
+  // startupBoehm turns on all interior pointers so Boehm adds an extra byte to every object
+  size_t granules = (size + 1 + GC_GRANULE_BYTES - 1) / GC_GRANULE_BYTES;
+  if (!cache || kind == GC_I_PTRFREE || kind >= BoehmAllocationCache::Kinds || granules > BoehmAllocationCache::Granules)
+    return GC_malloc_kind_global(size, kind);
+  void** freeList = &cache->_FreeLists[kind][granules];
+  void* obj = *freeList;
+  if (!obj) {
+    GC_generic_malloc_many(granules * GC_GRANULE_BYTES, (int)kind, freeList);
+    obj = *freeList;
+    // Out of memory - let the global allocator deal with it
+    if (!obj)
+      return GC_malloc_kind_global(size, kind);
+  }
+  *freeList = GC_NEXT(obj);
+  // The objects in a batch are cleared except for the link
+  GC_NEXT(obj) = NULL;
+  return obj;
+}
+#endif
+
 #ifdef USE_BOEHM
 template <typename Stage, typename Cons, typename... ARGS> inline Cons* do_boehm_cons_allocation(size_t size, ARGS&&... args) {
   RAIIAllocationStage<Stage> stage(my_thread_low_level);
 #ifdef USE_PRECISE_GC
-  ConsHeader_s* header = reinterpret_cast<ConsHeader_s*>(
-      ALIGNED_GC_MALLOC_KIND(STAMP_UNSHIFT_WTAG(STAMPWTAG_CONS), size, global_cons_kind, &global_cons_kind)); // wasMTAG
+  ConsHeader_s* header = reinterpret_cast<ConsHeader_s*>(ALIGNED_GC_MALLOC_KIND_CACHED(
+      stage.allocationCache(), STAMP_UNSHIFT_WTAG(STAMPWTAG_CONS), size, global_cons_kind, &global_cons_kind)); // wasMTAG
 #ifdef DEBUG_BOEHMPRECISE_ALLOC
   printf("%s:%d:%s cons = %p\n", __FILE__, __LINE__, __FUNCTION__, cons);
 #endif
@@ -69,14 +98,18 @@ inline Header_s* do_boehm_atomic_allocation(const Header_s::StampWtagMtag& the_h
 #endif
 
 #ifdef USE_BOEHM
-inline Header_s* do_boehm_weak_allocation(const Header_s::StampWtagMtag& the_header, size_t size) {
+// Weak objects are allocated pointer-free so that only their disappearing links refer
+// to what they hold. Strong buckets (scan == true) must be scanned like any other object.
+inline Header_s* do_boehm_weak_allocation(const Header_s::StampWtagMtag& the_header, size_t size, bool scan = false) {
   RAII_DISABLE_INTERRUPTS();
   size_t true_size = size;
 #ifdef USE_PRECISE_GC
-  Header_s* header = reinterpret_cast<Header_s*>(ALIGNED_GC_MALLOC_ATOMIC(true_size));
+  Header_s* header =
+      reinterpret_cast<Header_s*>(scan ? ALIGNED_GC_MALLOC(true_size) : ALIGNED_GC_MALLOC_ATOMIC(true_size));
 //   Header_s* header = reinterpret_cast<Header_s*>(ALIGNED_GC_MALLOC_STRONG_WEAK_KIND_ATOMIC(true_size,global_strong_weak_kind));
 #else
-  Header_s* header = reinterpret_cast<Header_s*>(ALIGNED_GC_MALLOC_ATOMIC(true_size));
+  Header_s* header =
+      reinterpret_cast<Header_s*>(scan ? ALIGNED_GC_MALLOC(true_size) : ALIGNED_GC_MALLOC_ATOMIC(true_size));
 #endif
   my_thread_low_level->_Allocations.registerWeakAllocation(the_header._value, true_size);
 #ifdef DEBUG_GUARD
@@ -102,7 +135,8 @@ inline Header_s* do_boehm_general_allocation(const Header_s::StampWtagMtag& the_
   auto stamp = the_header.stamp();
   auto& kind = global_stamp_layout[stamp].boehm._kind;
   GCTOOLS_ASSERT(kind != KIND_UNDEFINED);
-  Header_s* header = reinterpret_cast<Header_s*>(ALIGNED_GC_MALLOC_KIND(stamp, true_size, kind, &kind));
+  Header_s* header =
+      reinterpret_cast<Header_s*>(ALIGNED_GC_MALLOC_KIND_CACHED(stage.allocationCache(), stamp, true_size, kind, &kind));
 #ifdef DEBUG_BOEHMPRECISE_ALLOC
   printf("%s:%d:%s header = %p\n", __FILE__, __LINE__, __FUNCTION__, header);
 #endif
@@ -147,6 +147,8 @@ template <class T, class U> struct BucketsBase : public WeakObject {
   virtual ~BucketsBase(){};
 
   T& operator[](size_t idx) { return this->bucket[idx]; };
+  /*! Store into a bucket - weak buckets override this to maintain their links */
+  virtual void set(size_t idx, const T& val) { this->bucket[idx] = val; };
   typedef T value_type;
   typedef gctools::tagged_pointer<BucketsBase<U, T>> dependent_type;
   dependent_type dependent;                    /* the dependent object */
@@ -196,7 +198,7 @@ template <class T, class U> struct Buckets<T, U, WeakLinks> : public BucketsBase
   virtual ~Buckets() {
 #ifdef USE_BOEHM
     for (size_t i(0), iEnd(this->length()); i < iEnd; ++i) {
-      if (!unboundOrDeletedOrSplatted(this->bucket[i])) {
+      if (this->bucket[i].objectp()) {
         //		    printf("%s:%d Buckets dtor idx: %zu unregister disappearing link @%p\n", __FILE__, __LINE__, i,
         //&this->bucket[i].rawRef_());
         int result = GC_unregister_disappearing_link(reinterpret_cast<void**>(&this->bucket[i].rawRef_()));
@@ -211,15 +213,13 @@ template <class T, class U> struct Buckets<T, U, WeakLinks> : public BucketsBase
 #endif
   }
 
+  // Immediates and the unbound/deleted/no-key/same-as-key markers can be stored too;
+  // they are never collected, so only general and cons objects get a disappearing link.
   void set(size_t idx, const value_type& val) {
-    if (!(val.objectp() || val.deletedp() || val.unboundp())) {
-      printf("%s:%d Only  objectp() objects can be added to Mapping - tried to add %p\n", __FILE__, __LINE__, val.raw_());
-      abort();
-    }
 #if defined(USE_BOEHM)
     //	    printf("%s:%d ---- Buckets set idx: %zu   this->bucket[idx] = %p\n", __FILE__, __LINE__, idx, this->bucket[idx].raw_()
     //);
-    if (!unboundOrDeletedOrSplatted(this->bucket[idx])) {
+    if (this->bucket[idx].objectp()) {
       auto& rawRef = this->bucket[idx].rawRef_();
       void** linkAddress = reinterpret_cast<void**>(&rawRef);
       int result = GC_unregister_disappearing_link(linkAddress); // reinterpret_cast<void**>(&this->bucket[idx].rawRef_()));
@@ -227,7 +227,6 @@ template <class T, class U> struct Buckets<T, U, WeakLinks> : public BucketsBase
         throw_hard_error("The link was not registered as a disappearing link!");
     }
     this->bucket[idx] = val;
-    GCTOOLS_ASSERT(val.objectp());
     // We need the base of the object that we want a weak pointer to...
     // general, cons and later weak objects have different header sizes
     void* base = NULL;
@@ -266,6 +265,16 @@ typedef gctools::smart_ptr<core::T_O> BucketValueType;
 typedef gctools::Buckets<BucketValueType, BucketValueType, gctools::WeakLinks> WeakBucketsObjectType;
 typedef gctools::Buckets<BucketValueType, BucketValueType, gctools::StrongLinks> StrongBucketsObjectType;
 
+/*! The equality test used by a WeakKeyHashTable. */
+enum class WeakHashTableTest : unsigned int { eq, eql, equal, equalp };
+
+/*! Which half of each entry a WeakKeyHashTable holds weakly.
+    An entry is dropped as soon as the collector splats either of its weak halves.
+    Boehm only gives us disappearing links, so :key-or-value (keep the entry while
+    either half is reachable) cannot be expressed - both halves of such a table are
+    held strongly and its entries are only removed by REMHASH and CLRHASH. */
+enum class WeakHashTableWeakness : unsigned int { key, value, key_and_value, key_or_value };
+
 class WeakKeyHashTable {
   friend class core::WeakKeyHashTable_O;
 
@@ -274,43 +283,62 @@ public:
 
 public:
   typedef BucketValueType value_type;
-  typedef WeakBucketsObjectType KeyBucketsType;
-  typedef StrongBucketsObjectType ValueBucketsType;
+  // Each half of the table is a weak or a strong Buckets depending on the weakness
+  typedef BucketsBase<value_type, value_type> BucketsType;
+  typedef BucketsType KeyBucketsType;
+  typedef BucketsType ValueBucketsType;
 
 public:
   typedef WeakKeyHashTable MyType;
 
 public:
-  typedef gctools::GCBucketAllocator<KeyBucketsType> KeyBucketsAllocatorType;
-  typedef gctools::GCBucketAllocator<ValueBucketsType> ValueBucketsAllocatorType;
+  typedef gctools::GCBucketAllocator<WeakBucketsObjectType> WeakBucketsAllocatorType;
+  typedef gctools::GCBucketAllocator<StrongBucketsObjectType> StrongBucketsAllocatorType;
 
 public:
   size_t _Length;
   core::Number_sp _RehashSize;
   double _RehashThreshold;
+  WeakHashTableTest _Test;
+  WeakHashTableWeakness _Weakness;
   gctools::tagged_pointer<KeyBucketsType> _Keys;     // hash buckets for keys
   gctools::tagged_pointer<ValueBucketsType> _Values; // hash buckets for values
 #ifdef CLASP_THREADS
+  // Odd while a writer holds the write lock - see gethash_optimistic
+  mutable std::atomic<size_t> _Sequence{0};
   mutable mp::SharedMutex_sp _Mutex;
 #endif
 public:
-  WeakKeyHashTable(size_t length, core::Number_sp rehashSize, double rehashThreshold)
-      : _Length(length), _RehashSize(rehashSize), _RehashThreshold(rehashThreshold){};
+  WeakKeyHashTable(size_t length, core::Number_sp rehashSize, double rehashThreshold,
+                   WeakHashTableTest test = WeakHashTableTest::eq, WeakHashTableWeakness weakness = WeakHashTableWeakness::key)
+      : _Length(length), _RehashSize(rehashSize), _RehashThreshold(rehashThreshold), _Test(test), _Weakness(weakness){};
   void initialize();
 
 public:
-  static uint sxhashKey(const value_type& key);
+  bool weakKeysp() const {
+    return this->_Weakness == WeakHashTableWeakness::key || this->_Weakness == WeakHashTableWeakness::key_and_value;
+  }
+  bool weakValuesp() const {
+    return this->_Weakness == WeakHashTableWeakness::value || this->_Weakness == WeakHashTableWeakness::key_and_value;
+  }
+
+  /*! Hash a key the way the table's test requires - never depends on the key's address */
+  uint64_t sxhashKey(core::T_sp key) const;
+  bool keyTest(core::T_sp entryKey, core::T_sp searchKey) const;
 
   /*! Return 0 if there is no more room in the sequence of entries for the key
           Return 1 if the element is found or an unbound or deleted entry is found.
           Return the entry index in (b)
+      If reclaim is true, entries that the collector has splatted are turned into
+      deleted entries as they are passed, otherwise the buckets are not written.
+      Must not be called under safeRun - it takes it itself around the bucket reads.
         */
-  static size_t find_no_lock(gctools::tagged_pointer<KeyBucketsType> keys, const value_type& key, size_t& b
-#ifdef DEBUG_FIND
-                             ,
-                             bool debugFind = false, stringstream* reportP = NULL
-#endif
-  );
+  size_t find_no_lock(gctools::tagged_pointer<KeyBucketsType> keys, gctools::tagged_pointer<ValueBucketsType> values,
+                      core::T_sp key, uint64_t hash, size_t& b, bool reclaim) const;
+
+  /*! Look up a key without taking the lock. Return false if a writer got in the way,
+      in which case the caller must retry or take the read lock. */
+  bool gethash_optimistic(core::T_sp key, uint64_t hash, core::T_sp& value, bool& found) const;
 
 public:
   void setupThreadSafeHashTable();
@@ -360,9 +388,8 @@ public:
     return result;
   }
 
-  int rehash_not_safe(const value_type& key, size_t& key_bucket);
-  int rehash(const value_type& key, size_t& key_bucket);
-  int trySet(core::T_sp tkey, core::T_sp value);
+  void rehash();
+  int trySet(core::T_sp tkey, core::T_sp value, uint64_t hash);
 
   string dump(const string& prefix);
 
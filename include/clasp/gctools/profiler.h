@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Support shared by the sampling profilers in heapProfiler.cc and cpuProfiler.cc.
+
+namespace gctools {
+
+struct ThreadLocalStateLowLevel;
+
+// Hashes the sampled stacks that key the profile tables.
+struct ProfileKeyHash {
+  size_t operator()(const std::vector<uintptr_t>& key) const {
+    size_t hash = 14695981039346656037ULL;
+    for (uintptr_t word : key)
+      hash = (hash ^ word) * 1099511628211ULL;
+    return hash;
+  }
+};
+
+// Store up to DEPTH pcs of the current thread's bytecode VM stack in PCS,
+// innermost first, and return how many were stored. Only reads memory, so it
+// can be called from a signal handler.
+size_t profile_bytecode_pcs(uintptr_t* pcs, size_t depth);
+
+// Names the frames of sampled stacks, caching the names of the addresses it
+// has seen. Symbolizing allocates and looks at Lisp objects, so it's only done
+// when a profile is written, never while sampling.
+class ProfileSymbolizer {
+  std::unordered_map<uintptr_t, std::pair<std::string, bool>> _NativeNames;
+  std::unordered_map<uintptr_t, std::string> _BytecodeNames;
+
+public:
+  // Fill FRAMES with the names of a sample's frames, innermost first. NATIVE
+  // holds return addresses; each bytecode_call frame among them is named by
+  // the next bytecode pc instead, since that's the function it was running.
+  // If ADDRESSES is given, the address or pc each frame was named from is
+  // pushed onto it.
+  void frames(const uintptr_t* native, size_t num_native, const uintptr_t* bytecode, size_t num_bytecode,
+              std::vector<std::string>& frames, std::vector<uintptr_t>* addresses = nullptr);
+};
+
+// Replace the characters that delimit folded stacks.
+std::string profile_clean_name(const std::string& name);
+
+// Every thread with a ThreadLocalStateLowLevel is registered with the CPU
+// profiler, which signals the ones that are using the CPU.
+void cpuProfileRegisterThread(ThreadLocalStateLowLevel* thread);
+void cpuProfileDeregisterThread(ThreadLocalStateLowLevel* thread);
+
+}; // namespace gctools
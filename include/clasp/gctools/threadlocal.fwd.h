@@ -9,6 +9,7 @@ extern "C" void HitAllocationSizeThreshold();
 extern "C" void HitAllocationNumberThreshold();
 
 extern void monitorAllocation(stamp_t k, size_t sz);
+extern void heapProfileSample(stamp_t stamp, size_t size, int64_t& countdown);
 extern void count_allocation(const stamp_t k);
 
 #ifdef DEBUG_MONITOR_ALLOCATIONS
@@ -32,21 +33,26 @@ struct GlobalAllocationProfiler {
   std::atomic<int64_t> _AllocationNumberCounter;
   std::atomic<int64_t> _HitAllocationNumberCounter;
   std::atomic<int64_t> _HitAllocationSizeCounter;
+  // Bytes this thread can allocate before the heap profiler is next consulted - see heapProfiler.cc
+  int64_t _HeapProfileCountdown;
 #ifdef DEBUG_MONITOR_ALLOCATIONS
   MonitorAllocations _Monitor;
 #endif
 
   GlobalAllocationProfiler()
       : _AllocationSizeThreshold(1024 * 1024), _AllocationNumberThreshold(16386), _HitAllocationNumberCounter(0),
-        _HitAllocationSizeCounter(0){};
+        _HitAllocationSizeCounter(0), _HeapProfileCountdown(0){};
   GlobalAllocationProfiler(size_t size, size_t number)
       : _AllocationSizeThreshold(size), _AllocationNumberThreshold(number), _HitAllocationNumberCounter(0),
-        _HitAllocationSizeCounter(0){};
+        _HitAllocationSizeCounter(0), _HeapProfileCountdown(0){};
 
   inline void registerAllocation(stamp_t stamp, size_t size) {
     this->_BytesAllocated += size;
     this->_AllocationSizeCounter += size;
     this->_AllocationNumberCounter++;
+    this->_HeapProfileCountdown -= size;
+    if (this->_HeapProfileCountdown < 0)
+      heapProfileSample(stamp, size, this->_HeapProfileCountdown);
 #ifdef DEBUG_MEMORY_PROFILE
     if (this->_AllocationSizeCounter >= this->_AllocationSizeThreshold) {
       HitAllocationSizeThreshold();
@@ -85,10 +91,26 @@ struct GlobalAllocationProfiler {
   };
 };
 
+#ifdef USE_BOEHM
+// Per-thread free lists of conses and small objects, indexed by Boehm kind and
+// size in granules. They are refilled a batch at a time by GC_generic_malloc_many
+// so that consing threads don't take the allocation lock for every object.
+// The cache itself is allocated uncollectable so that the collector scans it and
+// keeps the objects on its free lists alive.
+struct BoehmAllocationCache {
+  static const size_t Kinds = 16;
+  static const size_t Granules = 16;
+  void* _FreeLists[Kinds][Granules + 1];
+};
+#endif
+
 struct ThreadLocalStateLowLevel {
   void* _StackTop;
   int _DisableInterrupts;
   GlobalAllocationProfiler _Allocations;
+#ifdef USE_BOEHM
+  BoehmAllocationCache* _AllocationCache;
+#endif
   // Time unwinds
   std::chrono::time_point<std::chrono::high_resolution_clock> _start_unwind;
   std::chrono::duration<size_t, std::nano> _unwind_time;
@@ -148,12 +170,19 @@ template <> struct RAIIAllocationStage<RuntimeStage> {
   void registerAllocation(uintptr_t ustamp, size_t size) {
     this->_threadLocalStateLowLevel->_Allocations.registerAllocation(ustamp, size);
   }
+#ifdef USE_BOEHM
+  BoehmAllocationCache* allocationCache() const { return this->_threadLocalStateLowLevel->_AllocationCache; }
+#endif
 };
 
 template <> struct RAIIAllocationStage<SnapshotLoadStage> {
 
   RAIIAllocationStage(ThreadLocalStateLowLevel* t){};
   void registerAllocation(uintptr_t ustamp, size_t size){};
+#ifdef USE_BOEHM
+  // Threads loading a snapshot have no thread local state so they use the global allocator
+  BoehmAllocationCache* allocationCache() const { return NULL; }
+#endif
 };
 
 }; // namespace gctools
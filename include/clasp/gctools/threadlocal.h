@@ -117,6 +117,12 @@ struct VirtualMachine {
   // only used by debugger
   // has to be initialized because bytecode_call reads it
   core::T_O** _framePointer = NULL;
+  // Special bindings and block/tagbody entries made by bytecode are
+  // recorded on a separate stack; see bytecode.cc.
+  static constexpr size_t MaxRecordWords = 65536;
+  core::T_O** _recordBottom;
+  core::T_O** _recordTop;
+  core::T_O** _recordPointer;
 #ifdef DEBUG_VIRTUAL_MACHINE
   core::T_O* _data;
   core::T_O* _data1;
@@ -126,6 +132,21 @@ struct VirtualMachine {
 #endif
   core::T_O** _literals;
   unsigned char* _pc;
+  // Monomorphic inline caches for bytecode call sites, direct mapped by
+  // the address of the call instruction; see vm_call_cached in bytecode.cc.
+  // Like the rest of the thread local state these are scanned
+  // conservatively by the GC, so the cached objects are kept alive and
+  // their addresses can't be reused while they're in the cache.
+  struct CallCacheEntry {
+    unsigned char* _site;  // the call instruction
+    core::T_O* _callee;    // what was called, e.g. a function cell
+    core::T_O* _function;  // the bytecode function that ended up called
+    core::T_O* _simpleFun; // and its BytecodeSimpleFun
+    unsigned char* _entry; // where to start, after the argument count check
+    size_t _nargs;
+  };
+  static constexpr size_t CallCacheSize = 256;
+  CallCacheEntry _callCache[CallCacheSize] = {};
 
   void error();
 
@@ -166,17 +187,19 @@ struct VirtualMachine {
   // Allocate a general object on the stack.
   template <class LispClass> struct Alloc {
     static inline size_t size() { return gc::sizeof_with_header<LispClass>(); }
+    // The number of stack slots the object takes up.
+    static inline size_t words() { return (size() + sizeof(core::T_O*) - 1) / sizeof(core::T_O*); }
 
     template <typename... ARGS> static inline gctools::smart_ptr<LispClass> alloc(core::T_O**& stackPointer, ARGS&&... args) {
       core::T_O** start = stackPointer + 1;
-      stackPointer += size();
+      stackPointer += words();
       LispClass* obj = gc::InitializeObject<LispClass>::go(start, std::forward<ARGS>(args)...);
       LispClass* tobj = gc::tag_general<LispClass*>(obj);
       gctools::smart_ptr<LispClass> robj((gctools::Tagged)tobj);
       return robj;
     }
 
-    static inline void dealloc(core::T_O**& stackPointer) { stackPointer -= size(); }
+    static inline void dealloc(core::T_O**& stackPointer) { stackPointer -= words(); }
   };
 
   // Allocate a cons.
@@ -185,13 +208,15 @@ struct VirtualMachine {
   // have a complete definition of Cons_O or even DoRegister, making things
   // rather more difficult.o
   template <> struct Alloc<core::Cons_O> {
+    // Stack conses aren't heap allocations, so they aren't registered.
     template <class ConsType> static inline size_t size() {
-      return gc::ConsSizeCalculator<gc::RuntimeStage, ConsType, gc::DoRegister>::value();
+      return gc::ConsSizeCalculator<gc::RuntimeStage, ConsType, gc::DontRegister>::value();
     }
+    static inline size_t words() { return (size<core::Cons_O>() + sizeof(core::T_O*) - 1) / sizeof(core::T_O*); }
 
     template <typename... ARGS> static inline core::Cons_sp alloc(core::T_O**& stackPointer, ARGS&&... args) {
       core::T_O** start = stackPointer + 1;
-      stackPointer += size<core::Cons_O>();
+      stackPointer += words();
       core::Cons_O* obj = gc::InitializeObject<core::Cons_O>::go(start, std::forward<ARGS>(args)...);
       core::Cons_O* tobj = gc::tag_cons<core::Cons_O*>(obj);
       core::Cons_sp robj((gctools::Tagged)tobj);
@@ -198,8 +198,399 @@ void vm_record_playback(void* value, const char* name) {
 #define VM_RECORD_PLAYBACK(value, name)
 #endif
 
+// Set to 1 to count the instructions executed by bytecode_vm, for
+// benchmarking the dispatch loop. See core:vm-instruction-count.
+#define VM_COUNT_INSTRUCTIONS 0
+
+#if VM_COUNT_INSTRUCTIONS == 1
+static std::atomic<size_t> global_vm_instruction_count = 0;
+#define VM_COUNT_INSTRUCTION() global_vm_instruction_count.fetch_add(1, std::memory_order_relaxed)
+
+CL_DOCSTRING(R"dx(Return the number of bytecode instructions executed so far, and reset the count if RESET is true.)dx");
+DOCGROUP(clasp);
+CL_LAMBDA(&optional reset);
+CL_DEFUN size_t core__vm_instruction_count(bool reset) {
+  if (reset)
+    return global_vm_instruction_count.exchange(0, std::memory_order_relaxed);
+  return global_vm_instruction_count.load(std::memory_order_relaxed);
+}
+#else
+#define VM_COUNT_INSTRUCTION()
+#endif
+
+// Autocompilation. Each bytecode function counts its calls and loop
+// iterations (backward jumps), and when the count reaches this threshold
+// the function is passed to *autocompile-hook*. The count is 16 bits
+// and wraps around, so the hook may see a function again later.
+static std::atomic<uint16_t> global_bytecode_compile_threshold = 65535;
+
+CL_DOCSTRING(R"dx(Return the number of calls and loop iterations after which a bytecode function is autocompiled.)dx");
+DOCGROUP(clasp);
+CL_DEFUN Fixnum core__bytecode_compile_threshold() {
+  return global_bytecode_compile_threshold.load(std::memory_order_relaxed);
+}
+
+CL_LISPIFY_NAME("core:bytecode-compile-threshold");
+CL_DOCSTRING(R"dx(Set the number of calls and loop iterations after which a bytecode function is autocompiled.)dx");
+DOCGROUP(clasp);
+CL_DEFUN_SETF Fixnum core__setf_bytecode_compile_threshold(Fixnum threshold) {
+  if (threshold < 1 || threshold > 65535)
+    TYPE_ERROR(make_fixnum(threshold), Cons_O::createList(cl::_sym_Integer_O, make_fixnum(1), make_fixnum(65535)));
+  global_bytecode_compile_threshold.store(threshold, std::memory_order_relaxed);
+  return threshold;
+}
+
+// Count a call or loop iteration of FUN, and pass it to the autocompile
+// hook if that makes it hot enough.
+static void bytecode_autocompile(BytecodeSimpleFun_sp fun) {
+  if (fun->entryPoint() != fun) // already replaced by native code
+    return;
+  if (comp::_sym_STARautocompile_hookSTAR->boundP() && comp::_sym_STARautocompile_hookSTAR->symbolValue().notnilp()) {
+    T_sp nat = eval::funcall(comp::_sym_STARautocompile_hookSTAR->symbolValue(), fun, nil<T_O>());
+    // The usual hook just queues the function and returns it, and
+    // compiles and installs it asynchronously later, so only install
+    // something if we actually got something else. That way we don't
+    // undo a compilation that finished in the meantime.
+    if (nat != fun)
+      fun->setSimpleFun(gc::As_assert<SimpleFun_sp>(nat));
+  }
+}
+
+static inline void bytecode_count_call(BytecodeSimpleFun_sp fun) {
+  if (fun->countCall() == global_bytecode_compile_threshold.load(std::memory_order_relaxed)) [[unlikely]]
+    bytecode_autocompile(fun);
+}
+
+// With threaded dispatch, each instruction handler ends by jumping
+// straight to the handler for the next instruction through a table
+// indexed by opcode, instead of going back around the switch. This gives
+// the branch predictor a separate indirect jump per handler to learn.
+// The table is generated into virtualMachine.h, and each handler has a
+// label op_<opcode> for it. The switch is still used for the first
+// instruction of each bytecode_vm activation and remains the fallback on
+// compilers without labels-as-values, and when debugging the VM, since
+// the per-instruction checks at the top of the loop would be skipped.
+#if defined(__GNUC__) && !defined(DEBUG_VIRTUAL_MACHINE) && DEBUG_VM_RECORD_PLAYBACK == 0
+#define VM_THREADED_DISPATCH 1
+#else
+#define VM_THREADED_DISPATCH 0
+#endif
+
+#if VM_THREADED_DISPATCH
+#define VM_CASE(op)                                                                                                                \
+  case op:                                                                                                                         \
+    op_##op:
+#define VM_NEXT()                                                                                                                  \
+  do {                                                                                                                             \
+    VM_COUNT_INSTRUCTION();                                                                                                        \
+    goto *dispatch_table[*pc];                                                                                                     \
+  } while (0)
+#else
+#define VM_CASE(op) case op:
+#define VM_NEXT() break
+#endif
+
+struct VMLanding;
 static unsigned char* long_dispatch(VirtualMachine&, unsigned char*, MultipleValues& multipleValues, T_O**, T_O**, Closure_O*,
-                                    core::T_O**, core::T_O**, size_t, core::T_O**, uint8_t);
+                                    core::T_O**, core::T_O**, size_t, core::T_O**, VMLanding*, uint8_t);
+
+// Primitive instructions (add, car, etc.) try a fast path on their
+// arguments, which stores the result and returns true, or returns false
+// if the general case is needed. (We can't use a null result for that,
+// as it's a valid object, the fixnum zero.) In the general case we call
+// the function in the instruction's function cell, just as a
+// called-fdefinition/call-receive-one sequence would, including pushing
+// the PC for backtraces.
+static inline T_O* vm_call_primitive(VirtualMachine& vm, unsigned char* pc, core::T_O**& sp, T_O* fcell, size_t nargs) {
+  T_sp tfunc((gctools::Tagged)fcell);
+  Function_sp func = gc::As_assert<Function_sp>(tfunc);
+  T_O** args = vm.stackref(sp, nargs - 1);
+  vm.push(sp, (T_O*)pc);
+  vm._pc = pc;
+  vm._stackPointer = sp;
+  T_sp res = func->apply_raw(nargs, args);
+  vm.drop(sp, nargs + 1);
+  return res.raw_();
+}
+
+template <typename Fast>
+static inline void vm_primitive1(VirtualMachine& vm, unsigned char* pc, core::T_O**& sp, T_O* fcell, Fast fast) {
+  T_O* res;
+  if (fast(*vm.stackref(sp, 0), res))
+    vm.drop(sp, 1);
+  else
+    res = vm_call_primitive(vm, pc, sp, fcell, 1);
+  vm.push(sp, res);
+}
+
+template <typename Fast>
+static inline void vm_primitive2(VirtualMachine& vm, unsigned char* pc, core::T_O**& sp, T_O* fcell, Fast fast) {
+  T_O* res;
+  if (fast(*vm.stackref(sp, 1), *vm.stackref(sp, 0), res))
+    vm.drop(sp, 2);
+  else
+    res = vm_call_primitive(vm, pc, sp, fcell, 2);
+  vm.push(sp, res);
+}
+
+static inline T_O* vm_boolean(bool b) { return b ? _lisp->_true().raw_() : nil<T_O>().raw_(); }
+
+static inline bool vm_fast_add(T_O* x, T_O* y, T_O*& res) {
+  T_sp tx((gctools::Tagged)x), ty((gctools::Tagged)y);
+  if (tx.fixnump() && ty.fixnump()) {
+    // Can't overflow a gc::Fixnum, but may be out of fixnum range.
+    gc::Fixnum r = tx.unsafe_fixnum() + ty.unsafe_fixnum();
+    if (r >= gc::most_negative_fixnum && r <= gc::most_positive_fixnum) {
+      res = make_fixnum(r).raw_();
+      return true;
+    }
+  }
+  return false;
+}
+
+static inline bool vm_fast_sub(T_O* x, T_O* y, T_O*& res) {
+  T_sp tx((gctools::Tagged)x), ty((gctools::Tagged)y);
+  if (tx.fixnump() && ty.fixnump()) {
+    gc::Fixnum r = tx.unsafe_fixnum() - ty.unsafe_fixnum();
+    if (r >= gc::most_negative_fixnum && r <= gc::most_positive_fixnum) {
+      res = make_fixnum(r).raw_();
+      return true;
+    }
+  }
+  return false;
+}
+
+#define VM_FAST_COMPARE(name, op)                                                                                                  \
+  static inline bool name(T_O* x, T_O* y, T_O*& res) {                                                                             \
+    T_sp tx((gctools::Tagged)x), ty((gctools::Tagged)y);                                                                           \
+    if (tx.fixnump() && ty.fixnump()) {                                                                                            \
+      res = vm_boolean(tx.unsafe_fixnum() op ty.unsafe_fixnum());                                                                  \
+      return true;                                                                                                                 \
+    }                                                                                                                              \
+    return false;                                                                                                                  \
+  }
+VM_FAST_COMPARE(vm_fast_lt, <)
+VM_FAST_COMPARE(vm_fast_le, <=)
+VM_FAST_COMPARE(vm_fast_gt, >)
+VM_FAST_COMPARE(vm_fast_ge, >=)
+VM_FAST_COMPARE(vm_fast_num_eq, ==)
+#undef VM_FAST_COMPARE
+
+static inline bool vm_fast_car(T_O* x, T_O*& res) {
+  T_sp tx((gctools::Tagged)x);
+  if (tx.consp())
+    res = tx.unsafe_cons()->car().raw_();
+  else if (tx.nilp())
+    res = x;
+  else
+    return false;
+  return true;
+}
+
+static inline bool vm_fast_cdr(T_O* x, T_O*& res) {
+  T_sp tx((gctools::Tagged)x);
+  if (tx.consp())
+    res = tx.unsafe_cons()->cdr().raw_();
+  else if (tx.nilp())
+    res = x;
+  else
+    return false;
+  return true;
+}
+
+// Used for both svref and two-argument aref, as they agree on
+// simple vectors.
+static inline bool vm_fast_svref(T_O* v, T_O* i, T_O*& res) {
+  T_sp tv((gctools::Tagged)v), ti((gctools::Tagged)i);
+  if (gc::IsA<SimpleVector_sp>(tv) && ti.fixnump()) {
+    SimpleVector_sp vec = gc::As_unsafe<SimpleVector_sp>(tv);
+    gc::Fixnum index = ti.unsafe_fixnum();
+    if (index >= 0 && (size_t)index < vec->length()) {
+      res = (*vec)[index].raw_();
+      return true;
+    }
+  }
+  return false;
+}
+
+// Called on backward jumps, i.e. loop iterations, which count towards
+// autocompilation just like calls, so that a function that is called
+// once but loops for a long time is compiled too. The running frame
+// stays in bytecode; the native code is used from the next call on.
+static inline void vm_back_edge(VirtualMachine& vm, unsigned char* pc, core::T_O**& sp, Closure_O* closure) {
+  SimpleFun_sp ep = closure->entryPoint();
+  if (!gc::IsA<BytecodeSimpleFun_sp>(ep))
+    return;
+  BytecodeSimpleFun_sp fun = gc::As_unsafe<BytecodeSimpleFun_sp>(ep);
+  // A closure keeps its bytecode simple fun when that is compiled, only
+  // the simple fun's entry point changes, so check that like
+  // vm_direct_entry does. Otherwise a long running loop would queue the
+  // function again every time its count wraps around.
+  if (fun->entryPoint() != fun)
+    return;
+  if (fun->countCall() == global_bytecode_compile_threshold.load(std::memory_order_relaxed)) [[unlikely]] {
+    // The hook is Lisp code, so set up the VM as for a call.
+    vm.push(sp, (T_O*)pc);
+    vm._pc = pc;
+    vm._stackPointer = sp;
+    bytecode_autocompile(fun);
+    vm.drop(sp, 1);
+  }
+}
+
+// Inline caching for calls. If a call site calls a bytecode function
+// whose only parameters are as many required parameters as are passed,
+// we remember that function in the VM's call cache. Later calls from
+// the site to the same function then go straight to bytecode_call at the
+// PC after the function's argument count check, skipping that check as
+// well as the function cell and entry point indirections.
+// An entry is validated every time it's used by checking that the callee
+// (usually a function cell) still holds the same function, and that the
+// function has not been replaced by native code, so redefinition or
+// autocompilation just cause a cache miss.
+static unsigned char* vm_direct_entry(T_O* function, size_t nargs) {
+  T_sp tfunction((gctools::Tagged)function);
+  SimpleFun_sp ep = gc::As_assert<Function_sp>(tfunction)->entryPoint();
+  if (!gc::IsA<BytecodeSimpleFun_sp>(ep))
+    return nullptr;
+  BytecodeSimpleFun_sp bep = gc::As_unsafe<BytecodeSimpleFun_sp>(ep);
+  if (bep->entryPoint() != bep) // replaced by native code
+    return nullptr;
+  Array_sp bytecode = gc::As_assert<Array_sp>(bep->code()->bytecode());
+  unsigned char* entry = (unsigned char*)bytecode->rowMajorAddressOfElement_(bep->entryPcN());
+  // See compile_with_lambda_list for how these checks are generated.
+  if (nargs > 0 && entry[0] == vm_check_arg_count_EQ && entry[1] == nargs)
+    return entry + 2;
+  else if (nargs == 0 && entry[0] == vm_check_arg_count_LE && entry[1] == 0)
+    return entry + 2;
+  return nullptr;
+}
+
+static inline T_O* vm_call_target(T_O* callee) {
+  T_sp tcallee((gctools::Tagged)callee);
+  if (gc::IsA<FunctionCell_sp>(tcallee))
+    return gc::As_unsafe<FunctionCell_sp>(tcallee)->real_function().raw_();
+  return callee;
+}
+
+// Call CALLEE with NARGS arguments at ARGS, from the call instruction at PC.
+// As with apply_raw, the caller must have set up the VM state first.
+static inline gctools::return_type vm_call_cached(VirtualMachine& vm, unsigned char* pc, T_O* callee, size_t nargs,
+                                                  T_O** args) {
+  VirtualMachine::CallCacheEntry& entry = vm._callCache[(uintptr_t)pc % VirtualMachine::CallCacheSize];
+  if (entry._site == pc && entry._callee == callee && entry._nargs == nargs) [[likely]] {
+    // If the callee was the function itself, it still is; otherwise it's a cell.
+    T_O* function = (callee == entry._function) ? callee : vm_call_target(callee);
+    if (function == entry._function) {
+      T_sp tfunction((gctools::Tagged)function);
+      SimpleFun_sp ep = gc::As_unsafe<Function_sp>(tfunction)->entryPoint();
+      if (ep.raw_() == entry._simpleFun && ep->entryPoint() == ep)
+        return bytecode_call(entry._entry, function, nargs, args);
+    }
+  }
+  // Miss. Call normally, filling the cache if we can.
+  T_O* function = vm_call_target(callee);
+  unsigned char* direct = vm_direct_entry(function, nargs);
+  if (direct) {
+    T_sp tfunction((gctools::Tagged)function);
+    entry._site = pc;
+    entry._callee = callee;
+    entry._function = function;
+    entry._simpleFun = gc::As_unsafe<Function_sp>(tfunction)->entryPoint().raw_();
+    entry._entry = direct;
+    entry._nargs = nargs;
+    return bytecode_call(direct, function, nargs, args);
+  }
+  T_sp tcallee((gctools::Tagged)callee);
+  return gc::As_assert<Function_sp>(tcallee)->apply_raw(nargs, args);
+}
+
+// Special bindings and BLOCK/TAGBODY entries don't get C++ frames of
+// their own. Instead each is a record pushed on the VM's record stack and
+// linked into the dynamic environment: a binding is a BindingDynEnv
+// followed by its cons, and an entry is the cons for its TagbodyDynEnv
+// followed by the VM stack pointer to resume at. (The TagbodyDynEnv itself
+// is still on the heap, because the compiler only makes entries for blocks
+// and tagbodies that closures exit from, and a closure can outlive the
+// entry.) The records can't go on the VM stack, as the compiler leaves
+// values there across bindings, e.g. for a LET that binds lexicals too.
+// Nonlocal exits to any entry in a function activation go to that
+// activation's VMLanding, which bytecode_vm sets up the first time it
+// executes an entry or binding. The "frame" of an entry's dynenv is the
+// end of its record, which is how C++ unwinding (see sjlj_unwind) finds
+// the entry.
+struct VMLanding {
+  jmp_buf target;
+  // The dynamic environment when the landing was set up. Everything
+  // pushed on top of this belongs to the activation.
+  T_sp dynenvs;
+  VMLanding(T_sp a_dynenvs) : dynenvs(a_dynenvs) {}
+  // Undo the activation's dynamic environment back to the entry with the
+  // given frame, as sjlj_unwind_proceed would have, and return true. If
+  // the entry isn't ours, undo all of it and return false.
+  bool unwind(void* frame) {
+    ThreadLocalState* thread = my_thread;
+    for (T_sp iter = thread->dynEnvStackGet(); iter != this->dynenvs; iter = CONS_CDR(iter)) {
+      DynEnv_sp diter = gc::As_unsafe<DynEnv_sp>(CONS_CAR(iter));
+      thread->dynEnvStackSet(iter);
+      if (gc::IsA<TagbodyDynEnv_sp>(diter) && gc::As_unsafe<TagbodyDynEnv_sp>(diter)->frame == frame)
+        return true;
+      diter->proceed();
+    }
+    thread->dynEnvStackSet(this->dynenvs);
+    return false;
+  }
+};
+
+static inline void vm_check_records(VirtualMachine& vm, size_t nwords) {
+  if (vm._recordPointer + nwords > vm._recordTop) [[unlikely]]
+    SIMPLE_ERROR("Bytecode special bindings and block/tagbody entries are nested too deeply");
+}
+
+static inline void vm_push_entry(VirtualMachine& vm, T_O** sp, T_O** fp, size_t n, VMLanding* landing) {
+  size_t nwords = VirtualMachine::Alloc<Cons_O>::words() + 1;
+  vm_check_records(vm, nwords);
+  T_O** end = vm._recordPointer + nwords;
+  TagbodyDynEnv_sp env = TagbodyDynEnv_O::create(end, &landing->target);
+  vm.setreg(fp, n, env.raw_());
+  ThreadLocalState* thread = my_thread;
+  Cons_sp link = VirtualMachine::Alloc<Cons_O>::alloc(vm._recordPointer, env, thread->dynEnvStackGet());
+  *(++vm._recordPointer) = (T_O*)sp;
+  thread->dynEnvStackSet(link);
+}
+
+static inline void vm_pop_entry(VirtualMachine& vm) {
+  ThreadLocalState* thread = my_thread;
+  thread->dynEnvStackSet(CONS_CDR(thread->dynEnvStackGet()));
+  vm._recordPointer -= VirtualMachine::Alloc<Cons_O>::words() + 1;
+}
+
+// Return to the entry whose record ends at FRAME, returning the stack
+// pointer to continue with.
+static inline T_O** vm_land(VirtualMachine& vm, void* frame) {
+  vm._recordPointer = (T_O**)frame;
+  return (T_O**)(*vm._recordPointer);
+}
+
+static inline void vm_push_binding(VirtualMachine& vm, VariableCell_sp cell, T_sp value) {
+  vm_check_records(vm, VirtualMachine::Alloc<BindingDynEnv_O>::words() + VirtualMachine::Alloc<Cons_O>::words());
+  T_sp old = cell->bind(value);
+  BindingDynEnv_sp env = VirtualMachine::Alloc<BindingDynEnv_O>::alloc(vm._recordPointer, cell, old);
+  ThreadLocalState* thread = my_thread;
+  thread->dynEnvStackSet(VirtualMachine::Alloc<Cons_O>::alloc(vm._recordPointer, env, thread->dynEnvStackGet()));
+}
+
+static inline void vm_pop_binding(VirtualMachine& vm) {
+  ThreadLocalState* thread = my_thread;
+  T_sp link = thread->dynEnvStackGet();
+  BindingDynEnv_sp env = gc::As_assert<BindingDynEnv_sp>(CONS_CAR(link));
+  env->cell->unbind(env->old);
+  thread->dynEnvStackSet(CONS_CDR(link));
+  vm._recordPointer -= VirtualMachine::Alloc<BindingDynEnv_O>::words() + VirtualMachine::Alloc<Cons_O>::words();
+}
+
+static gctools::return_type bytecode_vm_landing(VirtualMachine& vm, T_O** literals, T_O** closed, Closure_O* closure,
+                                                core::T_O** fp, size_t lcc_nargs, core::T_O** lcc_args);
 
 SYMBOL_EXPORT_SC_(KeywordPkg, name);
 #ifdef DEBUG_VIRTUAL_MACHINE
@@ -209,7 +600,8 @@ gctools::return_type
 bytecode_vm(VirtualMachine& vm, T_O** literals, T_O** closed, Closure_O* closure,
             core::T_O** fp, // frame pointer
             core::T_O** sp, // stack pointer
-            size_t lcc_nargs, core::T_O** lcc_args) {
+            size_t lcc_nargs, core::T_O** lcc_args,
+            VMLanding* landing) { // NULL until the first entry or binding
   ASSERT(literals == NULL || (uintptr_t)literals > 65536);
   ASSERT((((uintptr_t)literals) & 0x7) == 0); // must be aligned
   ASSERT((((uintptr_t)closure) & 0x7) == 0);  // must be aligned
@@ -228,7 +620,15 @@ bytecode_vm(VirtualMachine& vm, T_O** literals, T_O** closed, Closure_O* closure
 #endif
   MultipleValues& multipleValues = core::lisp_multipleValues();
   unsigned char* pc = vm._pc;
+#if VM_THREADED_DISPATCH
+  static void* const dispatch_table[256] = {
+#define VM_DISPATCH_TABLE
+#include <virtualMachine.h>
+#undef VM_DISPATCH_TABLE
+  };
+#endif
   while (1) {
+    VM_COUNT_INSTRUCTION();
     VM_PC_CHECK(vm, pc, bytecode_start, bytecode_end);
 #if DEBUG_VM_RECORD_PLAYBACK == 1
     global_counter++;
@@ -245,30 +645,30 @@ bytecode_vm(VirtualMachine& vm, T_O** literals, T_O** closed, Closure_O* closure
     }
 #endif
     switch (*pc) {
-    case vm_ref: {
+    VM_CASE(vm_ref) {
       uint8_t n = *(++pc);
       DBG_VM1("ref %" PRIu8 "\n", n);
       vm.push(sp, *(vm.reg(fp, n)));
       pc++;
-      break;
+      VM_NEXT();
     }
-    case vm_const: {
+    VM_CASE(vm_const) {
       uint8_t n = *(++pc);
       DBG_VM1("const %" PRIu8 "\n", n);
       T_O* value = literals[n];
       vm.push(sp, value);
       VM_RECORD_PLAYBACK(value, "const");
       pc++;
-      break;
+      VM_NEXT();
     }
-    case vm_closure: {
+    VM_CASE(vm_closure) {
       uint8_t n = *(++pc);
       DBG_VM("closure %" PRIu8 "\n", n);
       vm.push(sp, closed[n]);
       pc++;
-      break;
+      VM_NEXT();
     }
-    case vm_call: {
+    VM_CASE(vm_call) {
       uint8_t nargs = *(++pc);
       DBG_VM1("call %" PRIu8 "\n", nargs);
       T_sp tfunc((gctools::Tagged)(*(vm.stackref(sp, nargs))));
@@ -277,13 +677,13 @@ bytecode_vm(VirtualMachine& vm, T_O** literals, T_O** closed, Closure_O* closure
       vm.push(sp, (T_O*)pc);
       vm._pc = pc;
       vm._stackPointer = sp;
-      T_mv res = func->apply_raw(nargs, args);
+      T_mv res = vm_call_cached(vm, pc, func.raw_(), nargs, args);
       multipleValues.setN(res.raw_(), res.number_of_values());
       vm.drop(sp, nargs + 2);
       pc++;
-      break;
+      VM_NEXT();
     }
-    case vm_call_receive_one: {
+    VM_CASE(vm_call_receive_one) {
       uint8_t nargs = *(++pc);
       DBG_VM1("call-receive-one %" PRIu8 "\n", nargs);
       T_sp tfunc((gctools::Tagged)(*(vm.stackref(sp, nargs))));
@@ -301,14 +701,14 @@ bytecode_vm(VirtualMachine& vm, T_O** literals, T_O** closed, Closure_O* closure
       vm.push(sp, (T_O*)pc);
       vm._pc = pc;
       vm._stackPointer = sp;
-      T_sp res = func->apply_raw(nargs, args);
+      T_sp res = vm_call_cached(vm, pc, func.raw_(), nargs, args);
       vm.drop(sp, nargs + 2);
       vm.push(sp, res.raw_());
       VM_RECORD_PLAYBACK(res.raw_(), "vm_call_receive_one");
       pc++;
-      break;
+      VM_NEXT();
     }
-    case vm_call_receive_fixed: {
+    VM_CASE(vm_call_receive_fixed) {
       uint8_t nargs = *(++pc);
       uint8_t nvals = *(++pc);
       DBG_VM("call-receive-fixed %" PRIu8 " %" PRIu8 "\n", nargs, nvals);
@@ -318,7 +718,7 @@ bytecode_vm(VirtualMachine& vm, T_O** literals, T_O** closed, Closure_O* closure
       vm.push(sp, (T_O*)pc);
       vm._pc = pc;
       vm._stackPointer = sp;
-      T_mv res = func->apply_raw(nargs, args);
+      T_mv res = vm_call_cached(vm, pc, func.raw_(), nargs, args);
       vm.drop(sp, nargs + 2);
       if (nvals != 0) {
         vm.push(sp, res.raw_()); // primary
@@ -327,40 +727,40 @@ bytecode_vm(VirtualMachine& vm, T_O** literals, T_O** closed, Closure_O* closure
           vm.push(sp, multipleValues.valueGet(i, svalues).raw_());
       }
       pc++;
-      break;
+      VM_NEXT();
     }
-    case vm_bind: {
+    VM_CASE(vm_bind) {
       uint8_t nelems = *(++pc);
       uint8_t base = *(++pc);
       DBG_VM1("bind %" PRIu8 " %" PRIu8 "\n", nelems, base);
       vm.copytoreg(fp, vm.stackref(sp, nelems - 1), nelems, base);
       vm.drop(sp, nelems);
       pc++;
-      break;
+      VM_NEXT();
     }
-    case vm_set: {
+    VM_CASE(vm_set) {
       uint8_t n = *(++pc);
       DBG_VM("set %" PRIu8 "\n", n);
       vm.setreg(fp, n, vm.pop(sp));
       pc++;
-      break;
+      VM_NEXT();
     }
-    case vm_make_cell: {
+    VM_CASE(vm_make_cell) {
       DBG_VM1("make-cell\n");
       T_sp car((gctools::Tagged)(vm.pop(sp)));
       T_sp cdr((gctools::Tagged)nil<T_O>().raw_());
       vm.push(sp, Cons_O::create(car, cdr).raw_());
       pc++;
-      break;
+      VM_NEXT();
     }
-    case vm_cell_ref: {
+    VM_CASE(vm_cell_ref) {
       DBG_VM1("cell-ref\n");
       T_sp cons((gctools::Tagged)vm.pop(sp));
       vm.push(sp, cons.unsafe_cons()->car().raw_());
       pc++;
-      break;
+      VM_NEXT();
     }
-    case vm_cell_set: {
+    VM_CASE(vm_cell_set) {
       DBG_VM("cell-set\n");
       T_sp cons((gctools::Tagged)vm.pop(sp));
       Cons_sp ccons = gc::As_assert<Cons_sp>(cons);
@@ -368,9 +768,9 @@ bytecode_vm(VirtualMachine& vm, T_O** literals, T_O** closed, Closure_O* closure
       T_sp tval((gctools::Tagged)val);
       ccons->rplaca(tval);
       pc++;
-      break;
+      VM_NEXT();
     }
-    case vm_make_closure: {
+    VM_CASE(vm_make_closure) {
       uint8_t c = *(++pc);
       DBG_VM("make-closure %" PRIu8 "\n", c);
       T_sp fn_sp((gctools::Tagged)literals[c]);
@@ -383,9 +783,9 @@ bytecode_vm(VirtualMachine& vm, T_O** literals, T_O** closed, Closure_O* closure
       vm.drop(sp, nclosed);
       vm.push(sp, closure.raw_());
       pc++;
-      break;
+      VM_NEXT();
     }
-    case vm_make_uninitialized_closure: {
+    VM_CASE(vm_make_uninitialized_closure) {
       uint8_t c = *(++pc);
       DBG_VM("make-uninitialized-closure %" PRIu8 "\n", c);
       T_sp fn_sp((gctools::Tagged)literals[c]);
@@ -395,9 +795,9 @@ bytecode_vm(VirtualMachine& vm, T_O** literals, T_O** closed, Closure_O* closure
       Closure_sp closure = Closure_O::make_bytecode_closure(fn, nclosed);
       vm.push(sp, closure.raw_());
       pc++;
-      break;
+      VM_NEXT();
     }
-    case vm_initialize_closure: {
+    VM_CASE(vm_initialize_closure) {
       uint8_t c = *(++pc);
       DBG_VM("initialize-closure %" PRIu8 "\n", c);
       T_sp tclosure((gctools::Tagged)(*(vm.reg(fp, c))));
@@ -410,23 +810,23 @@ bytecode_vm(VirtualMachine& vm, T_O** literals, T_O** closed, Closure_O* closure
       vm.copyto(sp, nclosed, (T_O**)(closure->_Slots.data()));
       vm.drop(sp, nclosed);
       pc++;
-      break;
+      VM_NEXT();
     }
-    case vm_return: {
+    VM_CASE(vm_return) {
       DBG_VM1("return\n");
       // since the stack pointer is a local variable we don't need to
       // adjust it.
       size_t nvalues = multipleValues.getSize();
       return gctools::return_type(multipleValues.valueGet(0, nvalues).raw_(), nvalues);
     }
-    case vm_bind_required_args: {
+    VM_CASE(vm_bind_required_args) {
       uint8_t nargs = *(++pc);
       DBG_VM("bind-required-args %" PRIu8 "\n", nargs);
       vm.copytoreg(fp, lcc_args, nargs, 0);
       pc++;
-      break;
+      VM_NEXT();
     }
-    case vm_bind_optional_args: {
+    VM_CASE(vm_bind_optional_args) {
       uint8_t nreq = *(++pc);
       uint8_t nopt = *(++pc);
       DBG_VM("bind-optional-args %" PRIu8 " %" PRIu8 "\n", nreq, nopt);
@@ -439,9 +839,9 @@ bytecode_vm(VirtualMachine& vm, T_O** literals, T_O** closed, Closure_O* closure
         vm.fillreg(fp, unbound<T_O>().raw_(), nreq + nopt - lcc_nargs, lcc_nargs);
       }
       pc++;
-      break;
+      VM_NEXT();
     }
-    case vm_listify_rest_args: {
+    VM_CASE(vm_listify_rest_args) {
       uint8_t start = *(++pc);
       DBG_VM("listify-rest-args %" PRIu8 "\n", start);
       ql::list rest;
@@ -451,9 +851,9 @@ bytecode_vm(VirtualMachine& vm, T_O** literals, T_O** closed, Closure_O* closure
       }
       vm.setreg(fp, start, rest.cons().raw_());
       pc++;
-      break;
+      VM_NEXT();
     }
-    case vm_vaslistify_rest_args: {
+    VM_CASE(vm_vaslistify_rest_args) {
       //
       // This pushes two vaslist structures (each two words that look like fixnums)
       // onto the stack.  the theVaslist_backup is used by vaslist_rewind
@@ -463,9 +863,9 @@ bytecode_vm(VirtualMachine& vm, T_O** literals, T_O** closed, Closure_O* closure
       auto theVaslist = vm.alloca_vaslist2(sp, lcc_args + start, lcc_nargs - start);
       vm.setreg(fp, start, theVaslist);
       pc++;
-      break;
+      VM_NEXT();
     }
-    case vm_parse_key_args: {
+    VM_CASE(vm_parse_key_args) {
       uint8_t more_start = *(++pc);
       uint8_t key_count_info = *(++pc);
       uint8_t key_literal_start = *(++pc);
@@ -516,58 +916,70 @@ bytecode_vm(VirtualMachine& vm, T_O** literals, T_O** closed, Closure_O* closure
         throwUnrecognizedKeywordArgumentError(tclosure, unknown_keys);
       }
       pc++;
-      break;
+      VM_NEXT();
     }
-    case vm_jump_8: {
+    VM_CASE(vm_jump_8) {
       int8_t rel = *(pc + 1);
       DBG_VM1("jump %" PRId8 "\n", rel);
+      if (rel < 0)
+        vm_back_edge(vm, pc, sp, closure);
       pc += rel;
-      break;
+      VM_NEXT();
     }
-    case vm_jump_16: {
+    VM_CASE(vm_jump_16) {
       int16_t rel = read_s16(pc + 1);
       DBG_VM("jump %" PRId16 "\n", rel);
+      if (rel < 0)
+        vm_back_edge(vm, pc, sp, closure);
       pc += rel;
-      break;
+      VM_NEXT();
     }
-    case vm_jump_24: {
+    VM_CASE(vm_jump_24) {
       int32_t rel = read_label(pc, 3);
       DBG_VM("jump %" PRId32 "\n", rel);
+      if (rel < 0)
+        vm_back_edge(vm, pc, sp, closure);
       pc += rel;
-      break;
+      VM_NEXT();
     }
-    case vm_jump_if_8: {
+    VM_CASE(vm_jump_if_8) {
       int8_t rel = *(pc + 1);
       DBG_VM1("jump-if %" PRId8 "\n", rel);
       T_sp tval((gctools::Tagged)vm.pop(sp));
       VM_RECORD_PLAYBACK(tval.raw_(), "vm_jump_if_8");
-      if (tval.notnilp())
+      if (tval.notnilp()) {
+        if (rel < 0)
+          vm_back_edge(vm, pc, sp, closure);
         pc += rel;
-      else
+      } else
         pc += 2;
-      break;
+      VM_NEXT();
     }
-    case vm_jump_if_16: {
+    VM_CASE(vm_jump_if_16) {
       int16_t rel = read_s16(pc + 1);
       DBG_VM("jump-if %" PRId16 "\n", rel);
       T_sp tval((gctools::Tagged)vm.pop(sp));
-      if (tval.notnilp())
+      if (tval.notnilp()) {
+        if (rel < 0)
+          vm_back_edge(vm, pc, sp, closure);
         pc += rel;
-      else
+      } else
         pc += 3;
-      break;
+      VM_NEXT();
     }
-    case vm_jump_if_24: {
+    VM_CASE(vm_jump_if_24) {
       int32_t rel = read_label(pc, 3);
       DBG_VM("jump-if %" PRId32 "\n", rel);
       T_sp tval((gctools::Tagged)vm.pop(sp));
-      if (tval.notnilp())
+      if (tval.notnilp()) {
+        if (rel < 0)
+          vm_back_edge(vm, pc, sp, closure);
         pc += rel;
-      else
+      } else
         pc += 4;
-      break;
+      VM_NEXT();
     }
-    case vm_jump_if_supplied_8: {
+    VM_CASE(vm_jump_if_supplied_8) {
       uint8_t slot = *(pc + 1);
       int32_t rel = *(pc + 2);
       DBG_VM("jump-if-supplied %" PRIu8 " %" PRId8 "\n", slot, rel);
@@ -576,9 +988,9 @@ bytecode_vm(VirtualMachine& vm, T_O** literals, T_O** closed, Closure_O* closure
         pc += 3;
       else
         pc += rel;
-      break;
+      VM_NEXT();
     }
-    case vm_jump_if_supplied_16: {
+    VM_CASE(vm_jump_if_supplied_16) {
       uint8_t slot = *(++pc);
       int16_t rel = read_s16(pc + 1);
       DBG_VM("jump-if-supplied %" PRIu8 " %" PRId16 "\n", slot, rel);
@@ -587,9 +999,9 @@ bytecode_vm(VirtualMachine& vm, T_O** literals, T_O** closed, Closure_O* closure
         pc += 4;
       else
         pc += rel - 1;
-      break;
+      VM_NEXT();
     }
-    case vm_check_arg_count_LE: {
+    VM_CASE(vm_check_arg_count_LE) {
       uint8_t max_nargs = *(++pc);
       DBG_VM("check-arg-count<= %" PRIu8 "\n", max_nargs);
       if (lcc_nargs > max_nargs) {
@@ -597,9 +1009,9 @@ bytecode_vm(VirtualMachine& vm, T_O** literals, T_O** closed, Closure_O* closure
         throwTooManyArgumentsError(tclosure, lcc_nargs, max_nargs);
       }
       pc++;
-      break;
+      VM_NEXT();
     }
-    case vm_check_arg_count_GE: {
+    VM_CASE(vm_check_arg_count_GE) {
       uint8_t min_nargs = *(++pc);
       DBG_VM("check-arg-count>= %" PRIu8 "\n", min_nargs);
       if (lcc_nargs < min_nargs) {
@@ -607,9 +1019,9 @@ bytecode_vm(VirtualMachine& vm, T_O** literals, T_O** closed, Closure_O* closure
         throwTooFewArgumentsError(tclosure, lcc_nargs, min_nargs);
       }
       pc++;
-      break;
+      VM_NEXT();
     }
-    case vm_check_arg_count_EQ: {
+    VM_CASE(vm_check_arg_count_EQ) {
       uint8_t req_nargs = *(++pc);
       DBG_VM1("check-arg-count= %" PRIu8 "\n", req_nargs);
       if (lcc_nargs != req_nargs) {
@@ -617,9 +1029,9 @@ bytecode_vm(VirtualMachine& vm, T_O** literals, T_O** closed, Closure_O* closure
         wrongNumberOfArguments(tclosure, lcc_nargs, req_nargs);
       }
       pc++;
-      break;
+      VM_NEXT();
     }
-    case vm_push_values: {
+    VM_CASE(vm_push_values) {
       // TODO: Direct copy?
       DBG_VM("push-values\n");
       size_t nvalues = multipleValues.getSize();
@@ -629,9 +1041,9 @@ bytecode_vm(VirtualMachine& vm, T_O** literals, T_O** closed, Closure_O* closure
       // We could skip tagging this, but that's error-prone.
       vm.push(sp, make_fixnum(nvalues).raw_());
       pc++;
-      break;
+      VM_NEXT();
     }
-    case vm_append_values: {
+    VM_CASE(vm_append_values) {
       DBG_VM("append-values\n");
       T_sp texisting_values((gctools::Tagged)vm.pop(sp));
       size_t existing_values = texisting_values.unsafe_fixnum();
@@ -642,9 +1054,9 @@ bytecode_vm(VirtualMachine& vm, T_O** literals, T_O** closed, Closure_O* closure
         vm.push(sp, multipleValues.valueGet(i, nvalues).raw_());
       vm.push(sp, make_fixnum(nvalues + existing_values).raw_());
       pc++;
-      break;
+      VM_NEXT();
     }
-    case vm_pop_values: {
+    VM_CASE(vm_pop_values) {
       DBG_VM("pop-values\n");
       T_sp texisting_values((gctools::Tagged)vm.pop(sp));
       size_t existing_values = texisting_values.unsafe_fixnum();
@@ -653,9 +1065,9 @@ bytecode_vm(VirtualMachine& vm, T_O** literals, T_O** closed, Closure_O* closure
       multipleValues.setSize(existing_values);
       vm.drop(sp, existing_values);
       pc++;
-      break;
+      VM_NEXT();
     }
-    case vm_mv_call: {
+    VM_CASE(vm_mv_call) {
       DBG_VM("mv-call\n");
       T_sp tnargs((gctools::Tagged)vm.pop(sp));
       size_t nargs = tnargs.unsafe_fixnum();
@@ -670,9 +1082,9 @@ bytecode_vm(VirtualMachine& vm, T_O** literals, T_O** closed, Closure_O* closure
       vm.drop(sp, nargs + 1 + 1); // 1 each for func, pc
       multipleValues.setN(res.raw_(), res.number_of_values());
       pc++;
-      break;
+      VM_NEXT();
     }
-    case vm_mv_call_receive_one: {
+    VM_CASE(vm_mv_call_receive_one) {
       DBG_VM("mv-call-receive-one\n");
       T_sp tnargs((gctools::Tagged)vm.pop(sp));
       size_t nargs = tnargs.unsafe_fixnum();
@@ -688,9 +1100,9 @@ bytecode_vm(VirtualMachine& vm, T_O** literals, T_O** closed, Closure_O* closure
       multipleValues.set1(res);
       vm.push(sp, res.raw_());
       pc++;
-      break;
+      VM_NEXT();
     }
-    case vm_mv_call_receive_fixed: {
+    VM_CASE(vm_mv_call_receive_fixed) {
       uint8_t nvals = *(++pc);
       DBG_VM("mv-call-receive-fixed %" PRIu8 "\n", nvals);
       T_sp tnargs((gctools::Tagged)vm.pop(sp));
@@ -710,49 +1122,35 @@ bytecode_vm(VirtualMachine& vm, T_O** literals, T_O** closed, Closure_O* closure
           vm.push(sp, multipleValues.valueGet(i, svalues).raw_());
       }
       pc++;
-      break;
+      VM_NEXT();
     }
-    case vm_save_sp: {
+    VM_CASE(vm_save_sp) {
       uint8_t n = *(++pc);
       DBG_VM("save sp %" PRIu8 "\n", n);
       vm.savesp(fp, sp, n);
       pc++;
-      break;
+      VM_NEXT();
     }
-    case vm_restore_sp: {
+    VM_CASE(vm_restore_sp) {
       uint8_t n = *(++pc);
       DBG_VM("restore sp %" PRIu8 "\n", n);
       vm.restoresp(fp, sp, n);
       pc++;
-      break;
+      VM_NEXT();
     }
-    case vm_entry: {
+    VM_CASE(vm_entry) {
       uint8_t n = *(++pc);
       DBG_VM("entry %" PRIu8 "\n", n);
-      pc++;
-      jmp_buf target;
-      void* frame = __builtin_frame_address(0);
-      vm._pc = pc;
-      TagbodyDynEnv_sp env = TagbodyDynEnv_O::create(frame, &target);
-      vm.setreg(fp, n, env.raw_());
-      gctools::StackAllocate<Cons_O> sa_ec(env, my_thread->dynEnvStackGet());
-      DynEnvPusher dep(my_thread, sa_ec.asSmartPtr());
-      setjmp(target);
-    again:
-      try {
-        bytecode_vm(vm, literals, closed, closure, fp, sp, lcc_nargs, lcc_args);
-        sp = vm._stackPointer;
-        pc = vm._pc;
-      } catch (Unwind& uw) {
-        if (uw.getFrame() == frame) {
-          my_thread->dynEnvStackGet() = sa_ec.asSmartPtr();
-          goto again;
-        } else
-          throw;
+      if (!landing) {
+        vm._pc = pc - 1;
+        vm._stackPointer = sp;
+        return bytecode_vm_landing(vm, literals, closed, closure, fp, lcc_nargs, lcc_args);
       }
-      break;
+      vm_push_entry(vm, sp, fp, n, landing);
+      pc++;
+      VM_NEXT();
     }
-    case vm_exit_8: {
+    VM_CASE(vm_exit_8) {
       int8_t rel = *(pc + 1);
       DBG_VM("exit %" PRId8 "\n", rel);
       vm._pc = pc + rel;
@@ -760,7 +1158,7 @@ bytecode_vm(VirtualMachine& vm, T_O** literals, T_O** closed, Closure_O* closure
       TagbodyDynEnv_sp tde = gc::As_assert<TagbodyDynEnv_sp>(ttde);
       sjlj_unwind(tde, 1);
     }
-    case vm_exit_16: {
+    VM_CASE(vm_exit_16) {
       int16_t rel = read_s16(pc + 1);
       DBG_VM("exit %" PRId16 "\n", rel);
       vm._pc = pc + rel;
@@ -768,7 +1166,7 @@ bytecode_vm(VirtualMachine& vm, T_O** literals, T_O** closed, Closure_O* closure
       TagbodyDynEnv_sp tde = gc::As_assert<TagbodyDynEnv_sp>(ttde);
       sjlj_unwind(tde, 1);
     }
-    case vm_exit_24: {
+    VM_CASE(vm_exit_24) {
       int32_t rel = read_label(pc, 3);
       DBG_VM("exit %" PRId32 "\n", rel);
       vm._pc = pc + rel;
@@ -776,37 +1174,36 @@ bytecode_vm(VirtualMachine& vm, T_O** literals, T_O** closed, Closure_O* closure
       TagbodyDynEnv_sp tde = gc::As_assert<TagbodyDynEnv_sp>(ttde);
       sjlj_unwind(tde, 1);
     }
-    case vm_entry_close: {
+    VM_CASE(vm_entry_close) {
       DBG_VM("entry-close\n");
-      // This sham return value just gets us out of the bytecode_vm call in
-      // vm_entry, above.
-      vm._pc = pc + 1;
-      vm._stackPointer = sp;
-      return gctools::return_type(nil<T_O>().raw_(), 0);
+      vm_pop_entry(vm);
+      pc++;
+      VM_NEXT();
     }
-    case vm_special_bind: {
+    VM_CASE(vm_special_bind) {
       uint8_t c = *(++pc);
       DBG_VM("special-bind %" PRIu8 "\n", c);
+      if (!landing) {
+        vm._pc = pc - 1;
+        vm._stackPointer = sp;
+        return bytecode_vm_landing(vm, literals, closed, closure, fp, lcc_nargs, lcc_args);
+      }
       T_sp value((gctools::Tagged)(vm.pop(sp)));
-      pc++;
       T_sp cell((gctools::Tagged)literals[c]);
-      vm._pc = pc;
-      call_with_cell_bound(gc::As_assert<VariableCell_sp>(cell), value,
-                           [&]() { return bytecode_vm(vm, literals, closed, closure, fp, sp, lcc_nargs, lcc_args); });
-      sp = vm._stackPointer;
-      pc = vm._pc;
-      break;
+      vm_push_binding(vm, gc::As_assert<VariableCell_sp>(cell), value);
+      pc++;
+      VM_NEXT();
     }
-    case vm_symbol_value: {
+    VM_CASE(vm_symbol_value) {
       uint8_t c = *(++pc);
       DBG_VM("symbol-value %" PRIu8 "\n", c);
       T_sp cell_sp((gctools::Tagged)literals[c]);
       VariableCell_sp cell = gc::As_assert<VariableCell_sp>(cell_sp);
       vm.push(sp, cell->value().raw_());
       pc++;
-      break;
+      VM_NEXT();
     }
-    case vm_symbol_value_set: {
+    VM_CASE(vm_symbol_value_set) {
       uint8_t c = *(++pc);
       DBG_VM("symbol-value-set %" PRIu8 "\n", c);
       T_sp cell_sp((gctools::Tagged)literals[c]);
@@ -814,17 +1211,15 @@ bytecode_vm(VirtualMachine& vm, T_O** literals, T_O** closed, Closure_O* closure
       T_sp value((gctools::Tagged)(vm.pop(sp)));
       cell->set_value(value);
       pc++;
-      break;
+      VM_NEXT();
     }
-    case vm_unbind: {
+    VM_CASE(vm_unbind) {
       DBG_VM("unbind\n");
-      vm._pc = pc + 1;
-      vm._stackPointer = sp;
-      // This return value is not actually used - we're just returning from
-      // a bytecode_vm recursively invoked by vm_special_bind above.
-      return gctools::return_type(nil<T_O>().raw_(), 0);
+      vm_pop_binding(vm);
+      pc++;
+      VM_NEXT();
     }
-    case vm_fdefinition: {
+    VM_CASE(vm_fdefinition) {
       // We have function cells in the literals vector. While these are
       // themselves callable, we have to resolve the cell because we
       // use vm_fdefinition for lookup of #'foo.
@@ -835,35 +1230,35 @@ bytecode_vm(VirtualMachine& vm, T_O** literals, T_O** closed, Closure_O* closure
       vm.push(sp, fun.raw_());
       VM_RECORD_PLAYBACK(fun.raw_(), "fdefinition");
       pc++;
-      break;
+      VM_NEXT();
     }
-    case vm_nil:
+    VM_CASE(vm_nil)
       DBG_VM("nil\n");
       vm.push(sp, nil<T_O>().raw_());
       pc++;
-      break;
-    case vm_push: {
+      VM_NEXT();
+    VM_CASE(vm_push) {
       DBG_VM1("push\n");
       vm.push(sp, multipleValues.valueGet(0, multipleValues.getSize()).raw_());
       pc++;
-      break;
+      VM_NEXT();
     }
-    case vm_pop: {
+    VM_CASE(vm_pop) {
       DBG_VM1("pop\n");
       T_sp obj((gctools::Tagged)vm.pop(sp));
       multipleValues.set1(obj);
       pc++;
-      break;
+      VM_NEXT();
     }
-    case vm_dup: {
+    VM_CASE(vm_dup) {
       DBG_VM1("dup\n");
       T_O* obj = vm.pop(sp);
       vm.push(sp, obj);
       vm.push(sp, obj);
       pc++;
-      break;
+      VM_NEXT();
     }
-    case vm_fdesignator: {
+    VM_CASE(vm_fdesignator) {
       uint8_t c = *(++pc); // ignored environment parameter
       DBG_VM1("fdesignator" % PRIu8 % "\n", c);
       T_sp desig((gctools::Tagged)vm.pop(sp));
@@ -871,9 +1266,9 @@ bytecode_vm(VirtualMachine& vm, T_O** literals, T_O** closed, Closure_O* closure
       vm.push(sp, fun.raw_());
       VM_RECORD_PLAYBACK(run.raw_(), "fdesignator");
       pc++;
-      break;
+      VM_NEXT();
     }
-    case vm_called_fdefinition: {
+    VM_CASE(vm_called_fdefinition) {
       // This is like FDEFINITION except that we know the result will
       // just be called. So, we can just use the cell directly
       // without checking fboundedness, and this is just like const.
@@ -885,39 +1280,138 @@ bytecode_vm(VirtualMachine& vm, T_O** literals, T_O** closed, Closure_O* closure
       vm.push(sp, fun);
       VM_RECORD_PLAYBACK(fun, "called-fdefinition");
       pc++;
-      break;
+      VM_NEXT();
     }
-    case vm_encell: {
+    VM_CASE(vm_encell) {
       // abbreviation for ref N; make-cell; set N
       uint8_t n = *(++pc);
       DBG_VM1("encell %" PRIu8 "\n", n);
       T_sp val((gctools::Tagged)(*(vm.reg(fp, n))));
       vm.setreg(fp, n, Cons_O::create(val, nil<T_O>()).raw_());
       pc++;
-      break;
+      VM_NEXT();
+    }
+    VM_CASE(vm_ref_ref) {
+      uint8_t n = *(++pc);
+      uint8_t m = *(++pc);
+      DBG_VM1("ref-ref %" PRIu8 " %" PRIu8 "\n", n, m);
+      vm.push(sp, *(vm.reg(fp, n)));
+      vm.push(sp, *(vm.reg(fp, m)));
+      pc++;
+      VM_NEXT();
+    }
+    VM_CASE(vm_ref_ref_call_receive_one) {
+      uint8_t n = *(++pc);
+      uint8_t m = *(++pc);
+      DBG_VM1("ref-ref-call-receive-one %" PRIu8 " %" PRIu8 "\n", n, m);
+      T_sp tfunc((gctools::Tagged)(*(vm.stackref(sp, 0))));
+      Function_sp func = gc::As_assert<Function_sp>(tfunc);
+      vm.push(sp, *(vm.reg(fp, n)));
+      vm.push(sp, *(vm.reg(fp, m)));
+      T_O** args = vm.stackref(sp, 1);
+      vm.push(sp, (T_O*)pc);
+      vm._pc = pc;
+      vm._stackPointer = sp;
+      T_sp res = vm_call_cached(vm, pc, func.raw_(), 2, args);
+      vm.drop(sp, 4);
+      vm.push(sp, res.raw_());
+      pc++;
+      VM_NEXT();
     }
-    case vm_long: {
+    VM_CASE(vm_eq) {
+      DBG_VM1("eq\n");
+      T_O* y = vm.pop(sp);
+      T_O* x = vm.pop(sp);
+      vm.push(sp, vm_boolean(x == y));
+      pc++;
+      VM_NEXT();
+    }
+#define VM_PRIMITIVE(opcode, name, arity, fast)                                                                                    \
+  VM_CASE(opcode) {                                                                                                                \
+    uint8_t c = *(++pc);                                                                                                           \
+    DBG_VM1(name " %" PRIu8 "\n", c);                                                                                              \
+    vm_primitive##arity(vm, pc, sp, literals[c], fast);                                                                            \
+    pc++;                                                                                                                          \
+    VM_NEXT();                                                                                                                     \
+  }
+    VM_PRIMITIVE(vm_add, "add", 2, vm_fast_add)
+    VM_PRIMITIVE(vm_sub, "sub", 2, vm_fast_sub)
+    VM_PRIMITIVE(vm_lt, "lt", 2, vm_fast_lt)
+    VM_PRIMITIVE(vm_le, "le", 2, vm_fast_le)
+    VM_PRIMITIVE(vm_gt, "gt", 2, vm_fast_gt)
+    VM_PRIMITIVE(vm_ge, "ge", 2, vm_fast_ge)
+    VM_PRIMITIVE(vm_num_eq, "num-eq", 2, vm_fast_num_eq)
+    VM_PRIMITIVE(vm_car, "car", 1, vm_fast_car)
+    VM_PRIMITIVE(vm_cdr, "cdr", 1, vm_fast_cdr)
+    VM_PRIMITIVE(vm_svref, "svref", 2, vm_fast_svref)
+    VM_PRIMITIVE(vm_aref, "aref", 2, vm_fast_svref)
+#undef VM_PRIMITIVE
+    VM_CASE(vm_long) {
       // In a separate function to facilitate better icache utilization
       // by bytecode_vm (hopefully)
       pc++;
+      if (!landing && (*pc == vm_entry || *pc == vm_special_bind)) {
+        vm._pc = pc - 1;
+        vm._stackPointer = sp;
+        return bytecode_vm_landing(vm, literals, closed, closure, fp, lcc_nargs, lcc_args);
+      }
       // FIXME: This is a stupid way of returning two values.
-      pc = long_dispatch(vm, pc, multipleValues, literals, closed, closure, fp, sp, lcc_nargs, lcc_args, *pc);
+      pc = long_dispatch(vm, pc, multipleValues, literals, closed, closure, fp, sp, lcc_nargs, lcc_args, landing, *pc);
       sp = vm._stackPointer;
-      break;
-    }
-    default:
+      VM_NEXT();
+    }
+#if VM_THREADED_DISPATCH
+    // Opcodes that are defined but not generated by the compiler, and
+    // bytes that are not opcodes at all.
+    op_vm_catch_8:
+    op_vm_catch_16:
+    op_vm_throw:
+    op_vm_catch_close:
+    op_vm_progv:
+    op_vm_unknown:
+#endif
+    default: {
       SimpleFun_sp ep = closure->entryPoint();
       BytecodeModule_sp bcm = gc::As<BytecodeSimpleFun_sp>(ep)->code();
       unsigned char* codeStart = (unsigned char*)gc::As<Array_sp>(bcm->_Bytecode)->rowMajorAddressOfElement_(0);
       unsigned char* codeEnd = codeStart + gc::As<Array_sp>(bcm->_Bytecode)->arrayTotalSize();
       SIMPLE_ERROR("Unknown opcode {} pc: {}  module: {} - {}", *pc, (void*)pc, (void*)codeStart, (void*)codeEnd);
+    }
     };
   }
 }
 
+// The landing pad for nonlocal exits to the entries of a function
+// activation, and the place its bindings are undone if C++ unwinding
+// passes through it. The rest of the activation runs in a bytecode_vm
+// called from here.
+__attribute__((noinline)) static gctools::return_type bytecode_vm_landing(VirtualMachine& vm, T_O** literals, T_O** closed,
+                                                                          Closure_O* closure, core::T_O** fp, size_t lcc_nargs,
+                                                                          core::T_O** lcc_args) {
+  VMLanding landing(my_thread->dynEnvStackGet());
+  core::T_O** sp = vm._stackPointer;
+  if (setjmp(landing.target)) {
+    // sjlj_unwind_proceed has already undone the dynamic environment and
+    // stored the exit's PC in vm._pc.
+    sp = vm_land(vm, gc::As_unsafe<TagbodyDynEnv_sp>(my_thread->_UnwindDest)->frame);
+  }
+  while (true) {
+    try {
+      return bytecode_vm(vm, literals, closed, closure, fp, sp, lcc_nargs, lcc_args, &landing);
+    } catch (Unwind& uw) {
+      if (!landing.unwind(uw.getFrame()))
+        throw;
+      sp = vm_land(vm, uw.getFrame());
+    } catch (...) {
+      landing.unwind(nullptr);
+      throw;
+    }
+  }
+}
+
 static unsigned char* long_dispatch(VirtualMachine& vm, unsigned char* pc, MultipleValues& multipleValues, T_O** literals,
                                     T_O** closed, Closure_O* closure, core::T_O** fp, core::T_O** sp, size_t lcc_nargs,
-                                    core::T_O** lcc_args, uint8_t sub_opcode) {
+                                    core::T_O** lcc_args, VMLanding* landing, uint8_t sub_opcode) {
   switch (sub_opcode) {
   case vm_ref: {
     uint8_t low = *(pc + 1);
@@ -1252,27 +1746,8 @@ static unsigned char* long_dispatch(VirtualMachine& vm, unsigned char* pc, Multi
     uint8_t low = *(++pc);
     uint16_t n = low + (*(++pc) << 8);
     DBG_VM("long entry %" PRIu16 "\n", n);
+    vm_push_entry(vm, sp, fp, n, landing);
     pc++;
-    jmp_buf target;
-    void* frame = __builtin_frame_address(0);
-    vm._pc = pc;
-    TagbodyDynEnv_sp env = TagbodyDynEnv_O::create(frame, &target);
-    vm.setreg(fp, n, env.raw_());
-    gctools::StackAllocate<Cons_O> sa_ec(env, my_thread->dynEnvStackGet());
-    DynEnvPusher dep(my_thread, sa_ec.asSmartPtr());
-    setjmp(target);
-  again:
-    try {
-      bytecode_vm(vm, literals, closed, closure, fp, sp, lcc_nargs, lcc_args);
-      sp = vm._stackPointer;
-      pc = vm._pc;
-    } catch (Unwind& uw) {
-      if (uw.getFrame() == frame) {
-        my_thread->dynEnvStackGet() = sa_ec.asSmartPtr();
-        goto again;
-      } else
-        throw;
-    }
     break;
   }
   case vm_special_bind: {
@@ -1280,13 +1755,9 @@ static unsigned char* long_dispatch(VirtualMachine& vm, unsigned char* pc, Multi
     uint16_t c = low + (*(pc + 2) << 8);
     DBG_VM("long special-bind %" PRIu16 "\n", c);
     T_sp value((gctools::Tagged)(vm.pop(sp)));
-    pc += 3;
     T_sp cell((gctools::Tagged)literals[c]);
-    vm._pc = pc;
-    call_with_cell_bound(gc::As_assert<VariableCell_sp>(cell), value,
-                         [&]() { return bytecode_vm(vm, literals, closed, closure, fp, sp, lcc_nargs, lcc_args); });
-    pc = vm._pc;
-    sp = vm._stackPointer;
+    vm_push_binding(vm, gc::As_assert<VariableCell_sp>(cell), value);
+    pc += 3;
     break;
   }
   case vm_symbol_value: {
@@ -1339,6 +1810,27 @@ static unsigned char* long_dispatch(VirtualMachine& vm, unsigned char* pc, Multi
     pc++;
     break;
   }
+#define VM_LONG_PRIMITIVE(opcode, name, arity, fast)                                                                               \
+  case opcode: {                                                                                                                   \
+    uint8_t low = *(++pc);                                                                                                         \
+    uint16_t c = low + (*(++pc) << 8);                                                                                             \
+    DBG_VM1("long " name " %" PRIu16 "\n", c);                                                                                     \
+    vm_primitive##arity(vm, pc, sp, literals[c], fast);                                                                            \
+    pc++;                                                                                                                          \
+    break;                                                                                                                         \
+  }
+    VM_LONG_PRIMITIVE(vm_add, "add", 2, vm_fast_add)
+    VM_LONG_PRIMITIVE(vm_sub, "sub", 2, vm_fast_sub)
+    VM_LONG_PRIMITIVE(vm_lt, "lt", 2, vm_fast_lt)
+    VM_LONG_PRIMITIVE(vm_le, "le", 2, vm_fast_le)
+    VM_LONG_PRIMITIVE(vm_gt, "gt", 2, vm_fast_gt)
+    VM_LONG_PRIMITIVE(vm_ge, "ge", 2, vm_fast_ge)
+    VM_LONG_PRIMITIVE(vm_num_eq, "num-eq", 2, vm_fast_num_eq)
+    VM_LONG_PRIMITIVE(vm_car, "car", 1, vm_fast_car)
+    VM_LONG_PRIMITIVE(vm_cdr, "cdr", 1, vm_fast_cdr)
+    VM_LONG_PRIMITIVE(vm_svref, "svref", 2, vm_fast_svref)
+    VM_LONG_PRIMITIVE(vm_aref, "aref", 2, vm_fast_svref)
+#undef VM_LONG_PRIMITIVE
   default:
     SIMPLE_ERROR("Unknown LONG sub_opcode %hu", sub_opcode);
   }
@@ -1350,28 +1842,22 @@ void VMFrameDynEnv_O::proceed() {
   VirtualMachine& vm = my_thread->_VM;
   vm._stackPointer = this->old_sp;
   vm._framePointer = this->old_fp;
+  vm._recordPointer = this->old_rp;
 }
 
 }; // namespace core
 
 extern "C" {
 
-#define BYTECODE_COMPILE_THRESHOLD 65535
-
 gctools::return_type bytecode_call(unsigned char* pc, core::T_O* lcc_closure, size_t lcc_nargs, core::T_O** lcc_args) {
   core::Closure_O* closure = gctools::untag_general<core::Closure_O*>((core::Closure_O*)lcc_closure);
   ASSERT(gc::IsA<core::BytecodeSimpleFun_sp>(closure->entryPoint()));
   auto entry = closure->entryPoint();
   core::BytecodeSimpleFun_sp entryPoint = gctools::As_assert<core::BytecodeSimpleFun_sp>(entry);
   // Maybe compile this function, if it's been called a lot.
-  entryPoint->countCall();
-  if (entryPoint->callCount() >= BYTECODE_COMPILE_THRESHOLD && comp::_sym_STARautocompile_hookSTAR->boundP() &&
-      comp::_sym_STARautocompile_hookSTAR->symbolValue().notnilp()) {
-    core::T_sp nat = core::eval::funcall(comp::_sym_STARautocompile_hookSTAR->symbolValue(), entry, nil<core::T_O>());
-    entryPoint->setSimpleFun(gc::As_assert<core::SimpleFun_sp>(nat));
-    // Since in practice the hook doesn't replace the simple fun
-    // immediately, we just continue as we were.
-  }
+  // Since in practice the hook doesn't replace the simple fun
+  // immediately, we just continue as we were.
+  core::bytecode_count_call(entryPoint);
   // Proceed with the bytecode call.
   DBG_printf("%s:%d:%s This is where we evaluate bytecode functions pc: %p\n", __FILE__, __LINE__, __FUNCTION__, pc);
   size_t nlocals = entryPoint->_LocalsFrameSize;
@@ -1396,10 +1882,10 @@ gctools::return_type bytecode_call(unsigned char* pc, core::T_O* lcc_closure, si
   core::T_O** fp = vm._framePointer = vm._stackPointer;
   core::T_O** sp = vm.push_frame(fp, nlocals);
   try {
-    gctools::StackAllocate<core::VMFrameDynEnv_O> frame(old_sp, old_fp);
+    gctools::StackAllocate<core::VMFrameDynEnv_O> frame(old_sp, old_fp, vm._recordPointer);
     gctools::StackAllocate<core::Cons_O> sa_ec(frame.asSmartPtr(), my_thread->dynEnvStackGet());
     core::DynEnvPusher dep(my_thread, sa_ec.asSmartPtr());
-    gctools::return_type res = bytecode_vm(vm, literals, closed, closure, fp, sp, lcc_nargs, lcc_args);
+    gctools::return_type res = bytecode_vm(vm, literals, closed, closure, fp, sp, lcc_nargs, lcc_args, nullptr);
     vm._pc = old_pc;
     return res;
   } catch (core::VM_error& err) {
@@ -637,6 +637,13 @@ void Context::emit_call(size_t argcount) const {
   }
 }
 
+// Push two local variables, which must have frame indices below 256,
+// and if CALLP, call the function below them on the stack with them
+// as arguments and one value received.
+void Context::emit_ref_ref(LexicalVarInfo_sp info1, LexicalVarInfo_sp info2, bool callp) const {
+  RefRefFixup_O::make(info1->lex(), info2->lex(), callp ? vm_ref_ref_call_receive_one : vm_ref_ref)->contextualize(*this);
+}
+
 void Context::emit_mv_call() const {
   switch (this->receiving()) {
   case 1:
@@ -766,6 +773,35 @@ void LexRefFixup_O::emit(size_t position, SimpleVector_byte8_t_sp code) {
 
 size_t LexRefFixup_O::resize() { return this->lex()->indirectLexicalP() ? 1 : 0; }
 
+void RefRefFixup_O::emit(size_t position, SimpleVector_byte8_t_sp code) {
+  LexicalInfo_sp lex1 = this->lex1(), lex2 = this->lex2();
+  if (this->size() == 3) {
+    (*code)[position] = this->opcode();
+    (*code)[position + 1] = lex1->frameIndex();
+    (*code)[position + 2] = lex2->frameIndex();
+    return;
+  }
+  (*code)[position++] = vm_ref;
+  (*code)[position++] = lex1->frameIndex();
+  if (lex1->indirectLexicalP())
+    (*code)[position++] = vm_cell_ref;
+  (*code)[position++] = vm_ref;
+  (*code)[position++] = lex2->frameIndex();
+  if (lex2->indirectLexicalP())
+    (*code)[position++] = vm_cell_ref;
+  if (this->opcode() == vm_ref_ref_call_receive_one) {
+    (*code)[position++] = vm_call_receive_one;
+    (*code)[position++] = 2;
+  }
+}
+
+size_t RefRefFixup_O::resize() {
+  bool ind1 = this->lex1()->indirectLexicalP(), ind2 = this->lex2()->indirectLexicalP();
+  if (!ind1 && !ind2)
+    return 3;
+  return 4 + ind1 + ind2 + ((this->opcode() == vm_ref_ref_call_receive_one) ? 2 : 0);
+}
+
 void EncageFixup_O::emit(size_t position, SimpleVector_byte8_t_sp code) {
   size_t size = this->size();
   size_t index = this->lex()->frameIndex();
@@ -2480,18 +2516,145 @@ void compile_multiple_value_prog1(T_sp fform, List_sp forms, Lexenv_sp env, cons
     ctxt.assemble0(vm_pop_values);
 }
 
-// Compile a call, where the function is already on the stack.
-static void compile_call(T_sp args, Lexenv_sp env, const Context context) {
-  // Compile the arguments.
+// If FORM is a variable that can be pushed with a plain ref instruction,
+// i.e. it is a lexical variable of the function being compiled, return
+// its info, otherwise NIL. As with compile_symbol, the variable is noted
+// as read, so only call this if it will be.
+static T_sp local_variable_ref_info(T_sp form, Lexenv_sp env, const Context context) {
+  if (!gc::IsA<Symbol_sp>(form) || code_walking_p())
+    return nil<T_O>();
+  VarInfoV info = var_info_v(gc::As_unsafe<Symbol_sp>(form), env);
+  if (!std::holds_alternative<LexicalVarInfoV>(info))
+    return nil<T_O>();
+  LexicalVarInfo_sp lvinfo = std::get<LexicalVarInfoV>(info).info();
+  if (lvinfo->funct() != context.cfunction() || lvinfo->frameIndex() >= (1 << 8))
+    return nil<T_O>();
+  return lvinfo;
+}
+
+static void note_local_variable_read(T_sp sym, LexicalVarInfo_sp lvinfo, const Context context) {
+  lvinfo->lex()->setReadP(true);
+  maybe_warn_used(sym, lvinfo->lex(), context.source_info(), false);
+}
+
+// Compile arguments, pushing one value for each. Adjacent local variable
+// references are pushed together by the ref-ref superinstruction.
+// Returns the number of arguments.
+static size_t compile_arguments(T_sp args, Lexenv_sp env, const Context context) {
   size_t argcount = 0;
-  for (auto cur : gc::As<List_sp>(args)) {
+  List_sp cur = gc::As<List_sp>(args);
+  while (cur.consp()) {
+    T_sp arg = oCar(cur);
+    List_sp next = gc::As<List_sp>(oCdr(cur));
+    if (next.consp()) {
+      T_sp info1 = local_variable_ref_info(arg, env, context);
+      T_sp info2 = info1.notnilp() ? local_variable_ref_info(oCar(next), env, context) : nil<T_O>();
+      if (info2.notnilp()) {
+        note_local_variable_read(arg, gc::As_unsafe<LexicalVarInfo_sp>(info1), context);
+        note_local_variable_read(oCar(next), gc::As_unsafe<LexicalVarInfo_sp>(info2), context);
+        context.emit_ref_ref(gc::As_unsafe<LexicalVarInfo_sp>(info1), gc::As_unsafe<LexicalVarInfo_sp>(info2), false);
+        argcount += 2;
+        cur = gc::As<List_sp>(oCdr(next));
+        continue;
+      }
+    }
+    compile_form(arg, env, context.sub_receiving(1));
     ++argcount;
-    compile_form(oCar(cur), env, context.sub_receiving(1));
+    cur = next;
   }
+  return argcount;
+}
+
+// Compile a call, where the function is already on the stack.
+static void compile_call(T_sp args, Lexenv_sp env, const Context context) {
+  // A call with two local variables as arguments, wanting one value,
+  // is common enough to have its own superinstruction.
+  if (context.receiving() == 1 && args.consp() && oCdr(args).consp() && oCddr(args).nilp()) {
+    T_sp info1 = local_variable_ref_info(oCar(args), env, context);
+    T_sp info2 = info1.notnilp() ? local_variable_ref_info(oCadr(args), env, context) : nil<T_O>();
+    if (info2.notnilp()) {
+      note_local_variable_read(oCar(args), gc::As_unsafe<LexicalVarInfo_sp>(info1), context);
+      note_local_variable_read(oCadr(args), gc::As_unsafe<LexicalVarInfo_sp>(info2), context);
+      context.emit_ref_ref(gc::As_unsafe<LexicalVarInfo_sp>(info1), gc::As_unsafe<LexicalVarInfo_sp>(info2), true);
+      return;
+    }
+  }
+  // Compile the arguments.
+  size_t argcount = compile_arguments(args, env, context);
   // generate the call
   context.emit_call(argcount);
 }
 
+SYMBOL_EXPORT_SC_(CorePkg, two_arg__PLUS_);
+SYMBOL_EXPORT_SC_(CorePkg, two_arg__MINUS_);
+SYMBOL_EXPORT_SC_(CorePkg, two_arg__LT_);
+SYMBOL_EXPORT_SC_(CorePkg, two_arg__LE_);
+SYMBOL_EXPORT_SC_(CorePkg, two_arg__GT_);
+SYMBOL_EXPORT_SC_(CorePkg, two_arg__GE_);
+SYMBOL_EXPORT_SC_(CorePkg, two_arg__EQ_);
+SYMBOL_EXPORT_SC_(ClPkg, svref);
+
+// Some functions have their own instructions, with inline fast paths
+// for common cases (e.g. fixnums) that otherwise call the function.
+// Return the opcode for a call to FNAME with NARGS arguments, or 0 if
+// there is none. Note that + etc. reach us as the two-arg functions
+// after compiler macroexpansion.
+static uint8_t primitive_opcode(T_sp fname, size_t nargs) {
+  if (nargs == 1) {
+    if (fname == cl::_sym_car)
+      return vm_car;
+    else if (fname == cl::_sym_cdr)
+      return vm_cdr;
+  } else if (nargs == 2) {
+    if (fname == core::_sym_two_arg__PLUS_)
+      return vm_add;
+    else if (fname == core::_sym_two_arg__MINUS_)
+      return vm_sub;
+    else if (fname == core::_sym_two_arg__LT_)
+      return vm_lt;
+    else if (fname == core::_sym_two_arg__LE_)
+      return vm_le;
+    else if (fname == core::_sym_two_arg__GT_)
+      return vm_gt;
+    else if (fname == core::_sym_two_arg__GE_)
+      return vm_ge;
+    else if (fname == core::_sym_two_arg__EQ_)
+      return vm_num_eq;
+    else if (fname == cl::_sym_eq)
+      return vm_eq;
+    else if (fname == cl::_sym_svref)
+      return vm_svref;
+    else if (fname == cl::_sym_aref)
+      return vm_aref;
+  }
+  return 0;
+}
+
+// Compile a call to FNAME as a primitive instruction if possible.
+// Returns true if it did so.
+static bool compile_primitive_call(T_sp fname, T_sp args, Lexenv_sp env, const Context context) {
+  // The instructions push one value, so don't bother otherwise.
+  if (context.receiving() != 1 && context.receiving() != -1)
+    return false;
+  size_t nargs = 0;
+  T_sp cur = args;
+  for (; cur.consp(); cur = oCdr(cur))
+    ++nargs;
+  if (cur.notnilp())
+    return false;
+  uint8_t opcode = primitive_opcode(fname, nargs);
+  if (opcode == 0)
+    return false;
+  compile_arguments(args, env, context);
+  if (opcode == vm_eq)
+    context.assemble0(vm_eq);
+  else
+    context.assemble1(opcode, context.fcell_index(fname));
+  if (context.receiving() == -1)
+    context.assemble0(vm_pop);
+  return true;
+}
+
 void compile_load_time_value(T_sp form, T_sp tread_only_p, Lexenv_sp env, const Context context) {
   // load-time-value forms are compiled by putting their information into
   // a slot in the cmodule. This is so that (this part of) the compiler can
@@ -2662,12 +2825,13 @@ void compile_combination(T_sp head, T_sp rest, Lexenv_sp env, const Context cont
   else if (head == cleavirPrimop::_sym_funcall)
     compile_primop_funcall(oCar(rest), oCdr(rest), env, context);
   else if (head == cleavirPrimop::_sym_eq) {
-    // KLUDGE: Compile a call to EQ.
-    // Better would be to use the EQ opcode. Better than that would be
-    // eliminating the special operator entirely and working with the
-    // function instead.
-    compile_called_function(cl::_sym_eq, env, context);
-    compile_call(rest, env, context);
+    // KLUDGE: Compile as EQ, using the EQ opcode if we can.
+    // Better would be eliminating the special operator entirely and
+    // working with the function instead.
+    if (!compile_primitive_call(cl::_sym_eq, rest, env, context)) {
+      compile_called_function(cl::_sym_eq, env, context);
+      compile_call(rest, env, context);
+    }
   }
   // not a special form
   else {
@@ -2699,6 +2863,8 @@ void compile_combination(T_sp head, T_sp rest, Lexenv_sp env, const Context cont
             return;
           }
         } // no compiler macro, or expansion declined: call
+        if (!env->notinlinep(head) && compile_primitive_call(head, rest, env, context))
+          return;
         compile_called_function(head, env, context);
         compile_call(rest, env, context);
       } else if (std::holds_alternative<LocalFunInfoV>(info) || std::holds_alternative<NoFunInfoV>(info)) {
@@ -64,6 +64,7 @@
            #~"wrappedPointer.cc"
            #~"readtable.cc"
            #~"float_to_digits.cc"
+           #~"parse_number.cc"
            #~"pathname.cc"
            #~"commandLineOptions.cc"
            #~"exceptions.cc"
@@ -79,6 +80,7 @@
            #~"keywordPackage.cc"
            #~"extensionPackage.cc"
            #~"array.cc"
+           #~"sort.cc"
            #~"string.cc"
            #~"array_bit.cc"
            #~"grayPackage.cc"
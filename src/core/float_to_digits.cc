@@ -63,26 +63,76 @@ typedef struct {
 
 Real_sp times2(Real_sp x) { return gc::As<Real_sp>(clasp_plus(x, x)); }
 
+// Decode a finite float into a significand F and exponent E, so that its
+// absolute value is F*2^E. Unlike integer-decode-float this leaves
+// denormals alone, so that the neighbours of the float are always 2^E
+// away, except that the one below is only 2^(E-1) away for powers of two
+// above the denormals; return whether that's the case.
+static bool decode_float(float x, uint64_t& f, int& e) {
+  union {
+    float f;
+    uint32_t i;
+  } converter;
+  converter.f = x;
+  int biased = (converter.i >> (FLT_MANT_DIG - 1)) & 0xff;
+  f = converter.i & ((UINT32_C(1) << (FLT_MANT_DIG - 1)) - 1);
+  if (biased == 0) {
+    // Zero decodes as in integer-decode-float.
+    e = (f == 0) ? 0 : FLT_MIN_EXP - FLT_MANT_DIG;
+    return false;
+  }
+  e = biased - (FLT_MAX_EXP - 1) - (FLT_MANT_DIG - 1);
+  bool lower_closer = (f == 0) && (biased > 1);
+  f |= UINT64_C(1) << (FLT_MANT_DIG - 1);
+  return lower_closer;
+}
+
+static bool decode_float(double x, uint64_t& f, int& e) {
+  union {
+    double d;
+    uint64_t i;
+  } converter;
+  converter.d = x;
+  int biased = (converter.i >> (DBL_MANT_DIG - 1)) & 0x7ff;
+  f = converter.i & ((UINT64_C(1) << (DBL_MANT_DIG - 1)) - 1);
+  if (biased == 0) {
+    e = (f == 0) ? 0 : DBL_MIN_EXP - DBL_MANT_DIG;
+    return false;
+  }
+  e = biased - (DBL_MAX_EXP - 1) - (DBL_MANT_DIG - 1);
+  bool lower_closer = (f == 0) && (biased > 1);
+  f |= UINT64_C(1) << (DBL_MANT_DIG - 1);
+  return lower_closer;
+}
+
 static float_approx* setup(Float_sp number, float_approx* approx) {
-  Real_mv mv_f = cl__integer_decode_float(number);
-  Integer_sp f = gc::As<Integer_sp>(mv_f);
-  MultipleValues& mvn = core::lisp_multipleValues();
-  Fixnum_sp fne = gc::As<Fixnum_sp>(mvn.valueGet(1, mv_f.number_of_values()));
-  Fixnum e = fne.unsafe_fixnum(), min_e;
+  Integer_sp f;
+  Fixnum e;
   bool limit_f = 0;
   switch (clasp_t_of(number)) {
   case number_SingleFloat:
-    min_e = FLT_MIN_EXP;
-    limit_f = (unbox_single_float(gc::As<SingleFloat_sp>(number)) == ldexpf(FLT_RADIX, FLT_MANT_DIG - 1));
-    break;
-  case number_DoubleFloat:
-    min_e = DBL_MIN_EXP;
-    limit_f = (gc::As<DoubleFloat_sp>(number)->get() == ldexp(FLT_RADIX, DBL_MANT_DIG - 1));
+  case number_DoubleFloat: {
+    uint64_t uf;
+    int ie;
+    if (clasp_float_nan_p(number) || clasp_float_infinity_p(number))
+      SIMPLE_ERROR("Can't decode NaN or infinity {}", _rep_(number));
+    if (number.single_floatp())
+      limit_f = decode_float(unbox_single_float(gc::As<SingleFloat_sp>(number)), uf, ie);
+    else
+      limit_f = decode_float(gc::As<DoubleFloat_sp>(number)->get(), uf, ie);
+    f = Integer_O::create(uf);
+    e = ie;
     break;
+  }
 #ifdef CLASP_LONG_FLOAT
-  case number_LongFloat:
-    min_e = LDBL_MIN_EXP;
+  case number_LongFloat: {
+    Real_mv mv_f = cl__integer_decode_float(number);
+    f = gc::As<Integer_sp>(mv_f);
+    MultipleValues& mvn = core::lisp_multipleValues();
+    e = gc::As<Fixnum_sp>(mvn.valueGet(1, mv_f.number_of_values())).unsafe_fixnum();
     limit_f = (number.as<LongFloat_O>()->get() == ldexpl(FLT_RADIX, LDBL_MANT_DIG - 1));
+    break;
+  }
 #endif
   default:
     SIMPLE_ERROR("Illegal type");
@@ -102,13 +152,13 @@ static float_approx* setup(Float_sp number, float_approx* approx) {
       approx->mm = be;
       approx->mp = be;
     }
-  } else if (!limit_f || (e == min_e)) {
+  } else if (!limit_f) {
     approx->r = times2(f);
     approx->s = times2(EXPT_RADIX(-e));
     approx->mp = clasp_make_fixnum(1);
     approx->mm = clasp_make_fixnum(1);
   } else {
-    approx->r = times2(clasp_make_fixnum(FLT_RADIX));
+    approx->r = times2(gc::As<Real_sp>(clasp_times(f, clasp_make_fixnum(FLT_RADIX))));
     approx->s = times2(EXPT_RADIX(1 - e));
     approx->mp = clasp_make_fixnum(FLT_RADIX);
     approx->mm = clasp_make_fixnum(1);
@@ -219,6 +269,254 @@ static void change_precision(float_approx* approx, T_sp tposition, T_sp relative
   }
 }
 
+/**********************************************************************
+ * SHORTEST DIGITS WITHOUT BIGNUMS
+ *
+ * Grisu3, from Florian Loitsch, "Printing Floating-Point Numbers Quickly
+ * and Accurately with Integers" (PLDI 2010). The float and the boundaries
+ * of its rounding interval are scaled by a cached power of ten into 64 bit
+ * fixed point numbers, and the digits are generated from those. Scaling
+ * is inexact, so Grisu3 keeps track of the error and gives up when it
+ * can't be sure the digits are the shortest correctly rounded ones. That
+ * happens for about half a percent of doubles; those, and requests for a
+ * particular precision, go through the bignum algorithm above.
+ */
+
+struct diy_fp {
+  uint64_t f;
+  int e;
+};
+
+struct cached_power {
+  uint64_t f;
+  int16_t e; // binary exponent
+  int16_t k; // decimal exponent
+};
+
+// 10^k for k = -348, -340, ..., 340, as normalized diy_fps rounded to
+// nearest.
+static const cached_power cached_powers[] = {
+    {0xfa8fd5a0081c0288, -1220, -348},
+    {0xbaaee17fa23ebf76, -1193, -340},
+    {0x8b16fb203055ac76, -1166, -332},
+    {0xcf42894a5dce35ea, -1140, -324},
+    {0x9a6bb0aa55653b2d, -1113, -316},
+    {0xe61acf033d1a45df, -1087, -308},
+    {0xab70fe17c79ac6ca, -1060, -300},
+    {0xff77b1fcbebcdc4f, -1034, -292},
+    {0xbe5691ef416bd60c, -1007, -284},
+    {0x8dd01fad907ffc3c, -980, -276},
+    {0xd3515c2831559a83, -954, -268},
+    {0x9d71ac8fada6c9b5, -927, -260},
+    {0xea9c227723ee8bcb, -901, -252},
+    {0xaecc49914078536d, -874, -244},
+    {0x823c12795db6ce57, -847, -236},
+    {0xc21094364dfb5637, -821, -228},
+    {0x9096ea6f3848984f, -794, -220},
+    {0xd77485cb25823ac7, -768, -212},
+    {0xa086cfcd97bf97f4, -741, -204},
+    {0xef340a98172aace5, -715, -196},
+    {0xb23867fb2a35b28e, -688, -188},
+    {0x84c8d4dfd2c63f3b, -661, -180},
+    {0xc5dd44271ad3cdba, -635, -172},
+    {0x936b9fcebb25c996, -608, -164},
+    {0xdbac6c247d62a584, -582, -156},
+    {0xa3ab66580d5fdaf6, -555, -148},
+    {0xf3e2f893dec3f126, -529, -140},
+    {0xb5b5ada8aaff80b8, -502, -132},
+    {0x87625f056c7c4a8b, -475, -124},
+    {0xc9bcff6034c13053, -449, -116},
+    {0x964e858c91ba2655, -422, -108},
+    {0xdff9772470297ebd, -396, -100},
+    {0xa6dfbd9fb8e5b88f, -369, -92},
+    {0xf8a95fcf88747d94, -343, -84},
+    {0xb94470938fa89bcf, -316, -76},
+    {0x8a08f0f8bf0f156b, -289, -68},
+    {0xcdb02555653131b6, -263, -60},
+    {0x993fe2c6d07b7fac, -236, -52},
+    {0xe45c10c42a2b3b06, -210, -44},
+    {0xaa242499697392d3, -183, -36},
+    {0xfd87b5f28300ca0e, -157, -28},
+    {0xbce5086492111aeb, -130, -20},
+    {0x8cbccc096f5088cc, -103, -12},
+    {0xd1b71758e219652c, -77, -4},
+    {0x9c40000000000000, -50, 4},
+    {0xe8d4a51000000000, -24, 12},
+    {0xad78ebc5ac620000, 3, 20},
+    {0x813f3978f8940984, 30, 28},
+    {0xc097ce7bc90715b3, 56, 36},
+    {0x8f7e32ce7bea5c70, 83, 44},
+    {0xd5d238a4abe98068, 109, 52},
+    {0x9f4f2726179a2245, 136, 60},
+    {0xed63a231d4c4fb27, 162, 68},
+    {0xb0de65388cc8ada8, 189, 76},
+    {0x83c7088e1aab65db, 216, 84},
+    {0xc45d1df942711d9a, 242, 92},
+    {0x924d692ca61be758, 269, 100},
+    {0xda01ee641a708dea, 295, 108},
+    {0xa26da3999aef774a, 322, 116},
+    {0xf209787bb47d6b85, 348, 124},
+    {0xb454e4a179dd1877, 375, 132},
+    {0x865b86925b9bc5c2, 402, 140},
+    {0xc83553c5c8965d3d, 428, 148},
+    {0x952ab45cfa97a0b3, 455, 156},
+    {0xde469fbd99a05fe3, 481, 164},
+    {0xa59bc234db398c25, 508, 172},
+    {0xf6c69a72a3989f5c, 534, 180},
+    {0xb7dcbf5354e9bece, 561, 188},
+    {0x88fcf317f22241e2, 588, 196},
+    {0xcc20ce9bd35c78a5, 614, 204},
+    {0x98165af37b2153df, 641, 212},
+    {0xe2a0b5dc971f303a, 667, 220},
+    {0xa8d9d1535ce3b396, 694, 228},
+    {0xfb9b7cd9a4a7443c, 720, 236},
+    {0xbb764c4ca7a44410, 747, 244},
+    {0x8bab8eefb6409c1a, 774, 252},
+    {0xd01fef10a657842c, 800, 260},
+    {0x9b10a4e5e9913129, 827, 268},
+    {0xe7109bfba19c0c9d, 853, 276},
+    {0xac2820d9623bf429, 880, 284},
+    {0x80444b5e7aa7cf85, 907, 292},
+    {0xbf21e44003acdd2d, 933, 300},
+    {0x8e679c2f5e44ff8f, 960, 308},
+    {0xd433179d9c8cb841, 986, 316},
+    {0x9e19db92b4e31ba9, 1013, 324},
+    {0xeb96bf6ebadf77d9, 1039, 332},
+    {0xaf87023b9bf0ee6b, 1066, 340},
+};
+
+static constexpr int cached_powers_min_k = -348;
+static constexpr int cached_powers_step = 8;
+// Scaled values have their binary exponent in this range, so that their
+// integral part fits in 32 bits and there's room to multiply by ten.
+static constexpr int grisu_min_target_e = -60;
+static constexpr int grisu_max_target_e = -32;
+
+static inline diy_fp diy_normalize(diy_fp x) {
+  int shift = __builtin_clzll(x.f);
+  return {x.f << shift, x.e - shift};
+}
+
+// The product, rounded to 64 bits.
+static inline diy_fp diy_times(diy_fp x, diy_fp y) {
+  unsigned __int128 p = (unsigned __int128)x.f * y.f;
+  uint64_t f = (uint64_t)(p >> 64) + (((uint64_t)p >> 63) & 1);
+  return {f, x.e + y.e + 64};
+}
+
+// The cached power that scales a normalized diy_fp with exponent E into
+// the target range.
+static inline const cached_power& grisu_cached_power(int e) {
+  int min_e = grisu_min_target_e - (e + 64);
+  int k = (int)ceil((min_e + 63) * 0.30102999566398114); // log10(2)
+  const cached_power& c = cached_powers[(k - cached_powers_min_k - 1) / cached_powers_step + 1];
+  ASSERT(grisu_min_target_e <= e + c.e + 64 && e + c.e + 64 <= grisu_max_target_e);
+  return c;
+}
+
+// Move the last digit of BUFFER toward w, the scaled float, while that
+// stays within the rounding interval, and check that the result is
+// certainly the closest of the shortest digit strings. DISTANCE is from
+// w to the upper end of the interval, and REST from the digits to it,
+// both in units of the last digit's 10^kappa. UNIT is the error bound.
+static bool grisu_round_weed(char* buffer, int length, uint64_t distance, uint64_t unsafe_interval, uint64_t rest,
+                             uint64_t ten_kappa, uint64_t unit) {
+  uint64_t small_distance = distance - unit;
+  uint64_t big_distance = distance + unit;
+  while (rest < small_distance && unsafe_interval - rest >= ten_kappa &&
+         (rest + ten_kappa < small_distance || small_distance - rest >= rest + ten_kappa - small_distance)) {
+    buffer[length - 1]--;
+    rest += ten_kappa;
+  }
+  if (rest < big_distance && unsafe_interval - rest >= ten_kappa &&
+      (rest + ten_kappa < big_distance || big_distance - rest > rest + ten_kappa - big_distance))
+    return false;
+  return 2 * unit <= rest && rest <= unsafe_interval - 4 * unit;
+}
+
+// Generate the shortest digits for W within (LOW, HIGH), all scaled into
+// the target range. The digits mean DIGITS * 10^KAPPA.
+static bool grisu_digit_gen(diy_fp low, diy_fp w, diy_fp high, char* buffer, int& length, int& kappa) {
+  uint64_t unit = 1;
+  diy_fp too_low = {low.f - unit, low.e};
+  diy_fp too_high = {high.f + unit, high.e};
+  uint64_t unsafe_interval = too_high.f - too_low.f;
+  int shift = -w.e;
+  uint64_t one = (uint64_t)1 << shift;
+  uint32_t integrals = (uint32_t)(too_high.f >> shift);
+  uint64_t fractionals = too_high.f & (one - 1);
+  uint32_t divisor = 1;
+  kappa = 0;
+  if (integrals > 0) {
+    kappa = 1;
+    while (integrals / divisor >= 10) {
+      divisor *= 10;
+      kappa++;
+    }
+  }
+  length = 0;
+  while (kappa > 0) {
+    buffer[length++] = '0' + integrals / divisor;
+    integrals %= divisor;
+    kappa--;
+    uint64_t rest = ((uint64_t)integrals << shift) + fractionals;
+    if (rest < unsafe_interval)
+      return grisu_round_weed(buffer, length, too_high.f - w.f, unsafe_interval, rest, (uint64_t)divisor << shift, unit);
+    divisor /= 10;
+  }
+  while (true) {
+    fractionals *= 10;
+    unit *= 10;
+    unsafe_interval *= 10;
+    buffer[length++] = '0' + (int)(fractionals >> shift);
+    fractionals &= one - 1;
+    kappa--;
+    if (fractionals < unsafe_interval)
+      return grisu_round_weed(buffer, length, (too_high.f - w.f) * unit, unsafe_interval, fractionals, one, unit);
+  }
+}
+
+// Find the shortest digits of the positive float F*2^E into BUFFER, which
+// must have room for 18 characters. Its neighbours are 2^E away, except
+// that the one below is 2^(E-1) away when LOWER_CLOSER. Return the number
+// of digits, and K such that the float is 0.DIGITS * 10^K, or return 0 if
+// Grisu3 can't be sure of the result.
+static int grisu3(uint64_t f, int e, bool lower_closer, char* buffer, Fixnum& k) {
+  diy_fp w = diy_normalize({f, e});
+  diy_fp high = diy_normalize({(f << 1) + 1, e - 1});
+  diy_fp low = lower_closer ? diy_fp{(f << 2) - 1, e - 2} : diy_fp{(f << 1) - 1, e - 1};
+  low.f <<= low.e - high.e;
+  low.e = high.e;
+  const cached_power& c = grisu_cached_power(w.e);
+  diy_fp ten_mk = {c.f, c.e};
+  int length, kappa;
+  if (!grisu_digit_gen(diy_times(low, ten_mk), diy_times(w, ten_mk), diy_times(high, ten_mk), buffer, length, kappa))
+    return 0;
+  k = length + kappa - c.k;
+  return length;
+}
+
+// Shortest digits of a single or double float, or 0 if the bignum
+// algorithm is needed.
+static int shortest_digits(Float_sp number, char* buffer, Fixnum& k) {
+  uint64_t f;
+  int e;
+  bool lower_closer;
+  if (number.single_floatp()) {
+    float x = unbox_single_float(gc::As<SingleFloat_sp>(number));
+    if (!std::isfinite(x))
+      return 0;
+    lower_closer = decode_float(x, f, e);
+  } else if (gc::IsA<DoubleFloat_sp>(number)) {
+    double x = gc::As_unsafe<DoubleFloat_sp>(number)->get();
+    if (!std::isfinite(x))
+      return 0;
+    lower_closer = decode_float(x, f, e);
+  } else
+    return 0;
+  return (f == 0) ? 0 : grisu3(f, e, lower_closer, buffer, k);
+}
+
 CL_LAMBDA(digits number position relativep);
 CL_DECLARE();
 CL_DOCSTRING(R"dx(float_to_digits)dx");
@@ -226,10 +524,6 @@ DOCGROUP(clasp);
 CL_DEFUN T_mv core__float_to_digits(T_sp tdigits, Float_sp number, T_sp position, T_sp relativep) {
   ASSERT(tdigits.nilp() || gc::IsA<Str8Ns_sp>(tdigits));
   gctools::Fixnum k;
-  float_approx approx[1];
-  setup(number, approx);
-  change_precision(approx, position, relativep);
-  k = scale(approx);
   StrNs_sp digits;
   if (tdigits.nilp()) {
     digits =
@@ -237,6 +531,18 @@ CL_DEFUN T_mv core__float_to_digits(T_sp tdigits, Float_sp number, T_sp position
   } else {
     digits = gc::As<StrNs_sp>(tdigits);
   }
+  if (position.nilp()) {
+    char buffer[18];
+    if (int length = shortest_digits(number, buffer, k)) {
+      for (int i = 0; i < length; ++i)
+        digits->vectorPushExtend(clasp_make_character(buffer[i]));
+      return Values(clasp_make_fixnum(k), digits);
+    }
+  }
+  float_approx approx[1];
+  setup(number, approx);
+  change_precision(approx, position, relativep);
+  k = scale(approx);
   generate(digits, approx);
   return Values(clasp_make_fixnum(k), digits);
 }
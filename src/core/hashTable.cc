@@ -97,6 +97,9 @@ THE SOFTWARE.
 #ifdef CLASP_THREADS
 #include <pthread.h>
 #endif
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 namespace core {
 
 std::atomic<size_t> global_next_hash_table_id;
@@ -180,15 +183,41 @@ struct HashTableWriteLock {
 };
 #endif
 
+#ifdef CLASP_THREADS
+// gethash on a thread-safe table does not take the read lock. It reads the
+// table optimistically and then checks that _Sequence did not change, so every
+// modification of what it reads is bracketed by a HashTableWriteSequence.
+// Writers already hold the write lock, so only one of them bumps the sequence at a time.
+// Bracketed sections must not nest.
+struct HashTableWriteSequence {
+  HashTable_O* _hashTable;
+  HashTableWriteSequence(HashTable_O* ht) : _hashTable(ht) {
+    size_t sequence = this->_hashTable->_Sequence.load(std::memory_order_relaxed);
+    this->_hashTable->_Sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+  }
+  ~HashTableWriteSequence() {
+    size_t sequence = this->_hashTable->_Sequence.load(std::memory_order_relaxed);
+    this->_hashTable->_Sequence.store(sequence + 1, std::memory_order_release);
+  }
+};
+#endif
+
 #ifdef CLASP_THREADS
 #define HT_READ_LOCK(me) HashTableReadLock _zzz(me)
 #define HT_WRITE_LOCK(me) HashTableWriteLock _zzz(me)
 #define HT_UPGRADE_WRITE_LOCK(me) HashTableWriteLock _zzz(me, true)
+#define HT_WRITE_SEQUENCE(me) HashTableWriteSequence _zzzseq(me)
 #else
 #define HT_READ_LOCK(me)
 #define HT_WRITE_LOCK(me)
+#define HT_WRITE_SEQUENCE(me)
 #endif
 
+// Number of times gethash retries a lock-free read that raced with a writer
+// before it gives up and takes the read lock.
+#define HASH_TABLE_OPTIMISTIC_READS 8
+
 DOCGROUP(clasp);
 CL_DEFUN Vector_sp core__hash_table_pairs(HashTableBase_sp hash_table_base) {
   if (gc::IsA<HashTable_sp>(hash_table_base)) {
@@ -252,29 +281,53 @@ void HashTable_O::set_thread_safe(bool thread_safe)
 }
 #endif
 
-CL_LAMBDA(&key (test (function eql)) (size 0) (rehash-size 2.0) (rehash-threshold 0.7) weakness debug (thread-safe t) hash-function);
+CL_LAMBDA(&key (test (function eql)) (size 0) (rehash-size 2.0) (rehash-threshold 0.7) weakness debug (thread-safe t) hash-function (cache-hashes :default));
 CL_DECLARE();
 CL_DOCSTRING(
-    R"dx(See CLHS for most behavior. As an extension, Clasp allows a TEST other than the four standard ones to be passed. In this case it must be a designator for a function of two arguments, and a :HASH-FUNCTION must be passed as well; this should be a designator of a function analogous to SXHASH, i.e. it accepts one argument, returns a nonnegative fixnum, and (TEST x y) implies (= (HASH x) (HASH y)).)dx");
+    R"dx(See CLHS for most behavior. As an extension, Clasp allows a TEST other than the four standard ones to be passed. In this case it must be a designator for a function of two arguments, and a :HASH-FUNCTION must be passed as well; this should be a designator of a function analogous to SXHASH, i.e. it accepts one argument, returns a nonnegative fixnum, and (TEST x y) implies (= (HASH x) (HASH y)).
+As another extension, :CACHE-HASHES controls whether the table keeps the full hash of each key, plus a control byte per slot that is probed sixteen slots at a time. Lookups then call the test only on keys whose hash matches, and rehashing never recomputes hashes. NIL disables this, :DEFAULT (the default) enables it for EQUAL and EQUALP tables, and any other value enables it.
+:WEAKNESS may be :KEY, :VALUE, :KEY-AND-VALUE or :KEY-OR-VALUE for tables with any of the four standard tests. An entry is dropped once the garbage collector reclaims a weakly held key or value, which makes such tables usable as memory-bounded caches. :KEY-OR-VALUE tables currently hold both keys and values strongly.)dx");
 DOCGROUP(clasp);
 CL_DEFUN T_sp cl__make_hash_table(T_sp test, Fixnum_sp size, Number_sp rehash_size, Real_sp orehash_threshold, Symbol_sp weakness,
-                                  T_sp debug, T_sp thread_safe, T_sp hashf) {
+                                  T_sp debug, T_sp thread_safe, T_sp hashf, T_sp cache_hashes) {
   SYMBOL_EXPORT_SC_(KeywordPkg, key);
+  double rehash_threshold = maybeFixRehashThreshold(clasp_to_double(orehash_threshold));
   if (weakness.notnilp()) {
-    if (weakness == INTERN_(kw, key)) {
-      // We use fboundp because we actually make hash
-      // tables before eq etc. are bound, so symbolFunction would
-      // signal an error.
-      if (test == cl::_sym_eq || (cl::_sym_eq->fboundp() && test == cl::_sym_eq->symbolFunction())) {
-        return core__make_weak_key_hash_table(size);
-      } else {
-        SIMPLE_ERROR("Weak hash tables non-EQ tests are not yet supported");
-      }
-    }
-    SIMPLE_ERROR("Only :weakness :key (weak-key hash tables) are currently supported");
+    gctools::WeakHashTableWeakness weak_kind;
+    if (weakness == kw::_sym_key)
+      weak_kind = gctools::WeakHashTableWeakness::key;
+    else if (weakness == kw::_sym_value)
+      weak_kind = gctools::WeakHashTableWeakness::value;
+    else if (weakness == kw::_sym_key_and_value)
+      weak_kind = gctools::WeakHashTableWeakness::key_and_value;
+    else if (weakness == kw::_sym_key_or_value)
+      weak_kind = gctools::WeakHashTableWeakness::key_or_value;
+    else
+      SIMPLE_ERROR("The :weakness of a hash table must be one of NIL, :KEY, :VALUE, :KEY-AND-VALUE or :KEY-OR-VALUE - got {}",
+                   _rep_(weakness));
+    // We use fboundp because we actually make hash
+    // tables before eq etc. are bound, so symbolFunction would
+    // signal an error.
+    gctools::WeakHashTableTest weak_test;
+    if (test == cl::_sym_eq || (cl::_sym_eq->fboundp() && test == cl::_sym_eq->symbolFunction()))
+      weak_test = gctools::WeakHashTableTest::eq;
+    else if (test == cl::_sym_eql || (cl::_sym_eql->fboundp() && test == cl::_sym_eql->symbolFunction()))
+      weak_test = gctools::WeakHashTableTest::eql;
+    else if (test == cl::_sym_equal || (cl::_sym_equal->fboundp() && test == cl::_sym_equal->symbolFunction()))
+      weak_test = gctools::WeakHashTableTest::equal;
+    else if (test == cl::_sym_equalp || (cl::_sym_equalp->fboundp() && test == cl::_sym_equalp->symbolFunction()))
+      weak_test = gctools::WeakHashTableTest::equalp;
+    else
+      SIMPLE_ERROR("Weak hash tables only support the tests EQ, EQL, EQUAL and EQUALP - got {}", _rep_(test));
+    size_t wsize = clasp_to_int(size);
+    WeakKeyHashTable_sp table =
+        WeakKeyHashTable_O::create(wsize == 0 ? 16 : wsize, rehash_size, rehash_threshold, weak_test, weak_kind);
+    if (thread_safe.notnilp())
+      table->_HashTable.setupThreadSafeHashTable();
+    return table;
   }
-  double rehash_threshold = maybeFixRehashThreshold(clasp_to_double(orehash_threshold));
   HashTable_sp table = nil<HashTable_O>();
+  bool cache_hashes_by_default = false;
   size_t isize = clasp_to_int(size);
   if (isize == 0)
     isize = 16;
@@ -288,13 +341,18 @@ CL_DEFUN T_sp cl__make_hash_table(T_sp test, Fixnum_sp size, Number_sp rehash_si
     table = HashTableEql_O::create(isize, rehash_size, rehash_threshold);
   } else if (test == cl::_sym_equal || (cl::_sym_equal->fboundp() && test == cl::_sym_equal->symbolFunction())) {
     table = HashTableEqual_O::create(isize, rehash_size, rehash_threshold);
+    cache_hashes_by_default = true;
   } else if (test == cl::_sym_equalp || (cl::_sym_equalp->fboundp() && test == cl::_sym_equalp->symbolFunction())) {
     table = HashTableEqualp_O::create(isize, rehash_size, rehash_threshold);
+    cache_hashes_by_default = true;
   } else {
     Function_sp comparator = coerce::functionDesignator(test);
     Function_sp hasher = coerce::functionDesignator(hashf);
     table = HashTableCustom_O::create(isize, rehash_size, rehash_threshold, comparator, hasher);
   }
+  if (cache_hashes == kw::_sym_default ? cache_hashes_by_default : cache_hashes.notnilp()) {
+    table->setupHashCache();
+  }
   if (thread_safe.notnilp()) {
     table->setupThreadSafeHashTable();
   }
@@ -317,13 +375,132 @@ void HashTable_O::setupDebug() {
 #endif
 }
 
+// ----------------------------------------------------------------------
+// Hash caching
+//
+// A table that caches hashes keeps a control byte per slot in _Control and
+// the full hash of each key in _Hashes. The high bit of a control byte is set
+// for empty and deleted slots; a full slot stores seven bits of its key's hash.
+// Probing compares a whole group of control bytes at once, and only slots whose
+// control byte and full hash both match have their key passed to keyTest.
+// Slots are still claimed in the same linear probe order as the plain table,
+// and _Table keys are still marked with no_key/deleted, so iteration and
+// searchTable_no_read_lock work on either representation.
+
+static constexpr uint8_t hash_control_empty = 0x80;
+static constexpr uint8_t hash_control_deleted = 0xFE;
+
+static inline uint8_t hash_control_full(uint64_t hash) { return (hash >> 54) & 0x7F; }
+
+// Bit I of the result is set if control byte I of the group starting at CONTROL is equal to C.
+static inline uint32_t hash_control_group_match(const uint8_t* control, uint8_t c) {
+#if defined(__SSE2__)
+  __m128i group = _mm_loadu_si128(reinterpret_cast<const __m128i*>(control));
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(static_cast<char>(c))));
+#else
+  uint32_t mask = 0;
+  for (size_t i = 0; i < HASH_TABLE_GROUP_WIDTH; ++i)
+    mask |= static_cast<uint32_t>(control[i] == c) << i;
+  return mask;
+#endif
+}
+
+// Bit I of the result is set if slot I of the group starting at CONTROL is empty or deleted.
+static inline uint32_t hash_control_group_match_free(const uint8_t* control) {
+#if defined(__SSE2__)
+  return _mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(control)));
+#else
+  uint32_t mask = 0;
+  for (size_t i = 0; i < HASH_TABLE_GROUP_WIDTH; ++i)
+    mask |= static_cast<uint32_t>(control[i] >> 7) << i;
+  return mask;
+#endif
+}
+
+static void hash_control_set(uint8_t* controls, size_t size, size_t slot, uint8_t control) {
+  controls[slot] = control;
+  if (slot < HASH_TABLE_GROUP_WIDTH)
+    controls[size + slot] = control;
+}
+
+// Return the first empty or deleted slot at or after INDEX in probe order, or SIZE if there is none.
+static size_t hash_control_find_free(const uint8_t* controls, size_t size, cl_index index) {
+  for (size_t group = index, probed = 0; probed < size; probed += HASH_TABLE_GROUP_WIDTH) {
+    uint32_t match = hash_control_group_match_free(controls + group);
+    if (match != 0) {
+      size_t slot = group + __builtin_ctz(match);
+      return (slot >= size) ? slot - size : slot;
+    }
+    group += HASH_TABLE_GROUP_WIDTH;
+    if (group >= size)
+      group -= size;
+  }
+  return size;
+}
+
+// Search ENTRIES, a table of SIZE slots with the given CONTROLS and HASHES, for KEY.
+static KeyValuePair* hash_table_search_cached(const HashTable_O* ht, KeyValuePair* entries, size_t size, const uint8_t* controls,
+                                              const uint64_t* hashes, T_sp key, cl_index index, uint64_t hash) {
+  uint8_t full = hash_control_full(hash);
+  for (size_t group = index, probed = 0; probed < size; probed += HASH_TABLE_GROUP_WIDTH) {
+    const uint8_t* control = controls + group;
+    for (uint32_t match = hash_control_group_match(control, full); match != 0; match &= match - 1) {
+      size_t slot = group + __builtin_ctz(match);
+      if (slot >= size)
+        slot -= size;
+      if (hashes[slot] == hash && ht->keyTest(entries[slot]._Key, key))
+        return &entries[slot];
+    }
+    if (hash_control_group_match(control, hash_control_empty) != 0)
+      return nullptr;
+    group += HASH_TABLE_GROUP_WIDTH;
+    if (group >= size)
+      group -= size;
+  }
+  return nullptr;
+}
+
+void HashTable_O::setupHashCache() {
+  HT_WRITE_LOCK(this);
+  if (this->_HashTableCount != 0)
+    SIMPLE_ERROR("Hash caching can only be set up on an empty hash table");
+  this->resetHashCache_no_lock();
+}
+
+void HashTable_O::resetHashCache_no_lock() {
+  size_t size = this->_Table.size();
+  this->_Control = SimpleVector_byte8_t_O::make(size + HASH_TABLE_GROUP_WIDTH, hash_control_empty, true);
+  this->_Hashes = SimpleVector_byte64_t_O::make(size, 0, true);
+}
+
+void HashTable_O::setControl_no_lock(size_t slot, uint8_t control) {
+  hash_control_set(&(*this->_Control)[0], this->_Table.size(), slot, control);
+}
+
+KeyValuePair* HashTable_O::searchCached_no_read_lock(T_sp key, cl_index index, uint64_t hash) {
+  return hash_table_search_cached(this, &this->_Table[0], this->_Table.size(), &(*this->_Control)[0], &(*this->_Hashes)[0], key,
+                                  index, hash);
+}
+
+size_t HashTable_O::findFreeCached_no_read_lock(cl_index index) const {
+  return hash_control_find_free(&(*this->_Control)[0], this->_Table.size(), index);
+}
+
+CL_LAMBDA(hash-table);
+CL_DECLARE();
+CL_DOCSTRING(R"dx(Return true if HASH-TABLE caches the hashes of its keys; see MAKE-HASH-TABLE.)dx");
+DOCGROUP(clasp);
+CL_DEFUN bool core__hash_table_caches_hashes_p(HashTableBase_sp hash_table) {
+  return gc::IsA<HashTable_sp>(hash_table) && gc::As_unsafe<HashTable_sp>(hash_table)->cachesHashes();
+}
+
 CL_LAMBDA(ht);
 CL_DECLARE();
 CL_DOCSTRING(R"dx(hash_table_weakness)dx");
 DOCGROUP(clasp);
 CL_DEFUN Symbol_sp core__hash_table_weakness(T_sp ht) {
   if (gc::IsA<WeakKeyHashTable_sp>(ht)) {
-    return kw::_sym_key;
+    return gc::As_unsafe<WeakKeyHashTable_sp>(ht)->hashTableWeakness();
   }
   return nil<Symbol_O>();
 }
@@ -452,9 +629,6 @@ CL_DEFUN bool cl__remhash(T_sp key, HashTableBase_sp ht) { return ht->remhash(ke
 
 T_sp HashTable_O::clrhash() {
   ASSERT(!clasp_zerop(this->_RehashSize));
-  this->_HashTableCount = 0;
-  T_sp no_key = ::no_key<T_O>();
-  this->_Table.resize(0, KeyValuePair(no_key, no_key));
   this->setup(16, this->_RehashSize, this->_RehashThreshold);
   VERIFY_HASH_TABLE(this);
   return this->asSmartPtr();
@@ -706,8 +880,14 @@ uint HashTable_O::resizeEmptyTable_no_lock(size_t sz) {
   if (sz < 16)
     sz = 16;
   T_sp no_key = ::no_key<T_O>();
+  // Build a new vector rather than resizing in place, since lock-free readers may still be using the old one.
+  gctools::Vec0<KeyValuePair> table;
+  table.resize(sz, KeyValuePair(no_key, no_key));
+  HT_WRITE_SEQUENCE(this);
   this->_HashTableCount = 0;
-  this->_Table.resize(sz, KeyValuePair(no_key, no_key));
+  this->_Table.swap(table);
+  if (this->cachesHashes())
+    this->resetHashCache_no_lock();
   return sz;
 }
 
@@ -812,13 +992,14 @@ NOT_FOUND:
   return nullptr;
 }
 
-KeyValuePair* HashTable_O::tableRef_no_read_lock(T_sp key, cl_index index) {
+KeyValuePair* HashTable_O::tableRef_no_read_lock(T_sp key, cl_index index, const HashGenerator& hg) {
   DEBUG_HASH_TABLE({
     core::clasp_write_string(fmt::format("{}:{}:{} key = {}  index = {}\n", __FILE__, __LINE__, __FUNCTION__, _rep_(key), index));
   });
   VERIFY_HASH_TABLE(this);
   BOUNDS_ASSERT(index < this->_Table.size());
-  KeyValuePair* result = this->searchTable_no_read_lock(key, index);
+  KeyValuePair* result = this->cachesHashes() ? this->searchCached_no_read_lock(key, index, hg.rawhash())
+                                              : this->searchTable_no_read_lock(key, index);
   VERIFY_HASH_TABLE(this);
   return result;
 }
@@ -832,8 +1013,67 @@ CL_DEFUN void core__hash_table_force_rehash(HashTable_sp ht) {
   ht->rehash_no_lock(false, no_key<T_O>());
 }
 
+#ifdef CLASP_THREADS
+bool HashTable_O::gethash_optimistic(T_sp key, uint64_t hash, T_sp& value, bool& found) const {
+  size_t sequence = this->_Sequence.load(std::memory_order_acquire);
+  if (sequence & 1)
+    return false;
+  // A published vector never changes size, so take the size from the vector itself.
+  gctools::tagged_pointer<gctools::GCVector_moveable<KeyValuePair>> table = this->_Table._Vector._Contents;
+  size_t size = table ? table->_End : 0;
+  if (size == 0)
+    return false;
+  KeyValuePair* entries = table->data();
+  cl_index index = hash % size;
+  KeyValuePair* entry = nullptr;
+  SimpleVector_byte8_t_sp control = this->_Control;
+  if (control.notnilp()) {
+    SimpleVector_byte64_t_sp hashes = this->_Hashes;
+    // The metadata may belong to a different table than ENTRIES if a rehash was just published.
+    if (control->length() != size + HASH_TABLE_GROUP_WIDTH || hashes.nilp() || hashes->length() != size)
+      return false;
+    entry = hash_table_search_cached(this, entries, size, &(*control)[0], &(*hashes)[0], key, index, hash);
+  } else {
+    for (size_t cur = index, probed = 0; probed < size; ++probed) {
+      T_sp entryKey = entries[cur]._Key;
+      if (entryKey.no_keyp())
+        break;
+      if (!entryKey.deletedp() && this->keyTest(entryKey, key)) {
+        entry = &entries[cur];
+        break;
+      }
+      if (++cur == size)
+        cur = 0;
+    }
+  }
+  T_sp entryValue = entry ? entry->_Value : no_key<T_O>();
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (this->_Sequence.load(std::memory_order_relaxed) != sequence)
+    return false;
+  found = !entryValue.no_keyp();
+  value = entryValue;
+  return true;
+}
+#endif
+
 T_mv HashTable_O::gethash(T_sp key, T_sp default_value) {
   LOG("gethash looking for key[{}]", _rep_(key));
+#ifdef CLASP_THREADS
+  if (this->_Mutex) {
+    HashGenerator hg;
+    uint64_t hash = this->sxhashKey(key, 0, hg);
+    for (size_t attempt = 0; attempt < HASH_TABLE_OPTIMISTIC_READS; ++attempt) {
+      T_sp value;
+      bool found;
+      if (this->gethash_optimistic(key, hash, value, found)) {
+        if (found)
+          return Values(value, _lisp->_true());
+        return Values(default_value, nil<T_O>());
+      }
+    }
+    // Writers kept changing the table under us, so wait for them with the read lock.
+  }
+#endif
   HT_READ_LOCK(this);
   VERIFY_HASH_TABLE(this);
   HashGenerator hg;
@@ -846,7 +1086,7 @@ T_mv HashTable_O::gethash(T_sp key, T_sp default_value) {
   }
   // #endif
   cl_index index = this->sxhashKey(key, sz, hg);
-  KeyValuePair* keyValuePair = this->tableRef_no_read_lock(key, index);
+  KeyValuePair* keyValuePair = this->tableRef_no_read_lock(key, index, hg);
   LOG("Found keyValueCons"); // % keyValueCons->__repr__() ); INFINITE-LOOP
   if (keyValuePair) {
     T_sp value = keyValuePair->_Value;
@@ -871,7 +1111,7 @@ KeyValuePair* HashTable_O::find(T_sp key) {
   HT_READ_LOCK(this);
   HashGenerator hg;
   cl_index index = this->sxhashKey(key, this->_Table.size(), hg);
-  KeyValuePair* keyValue = this->tableRef_no_read_lock(key, index);
+  KeyValuePair* keyValue = this->tableRef_no_read_lock(key, index, hg);
   if (!keyValue)
     return keyValue;
   if (keyValue->_Value.no_keyp())
@@ -889,9 +1129,12 @@ bool HashTable_O::remhash(T_sp key) {
   HT_WRITE_LOCK(this);
   HashGenerator hg;
   cl_index index = this->sxhashKey(key, this->_Table.size(), hg);
-  KeyValuePair* keyValuePair = this->tableRef_no_read_lock(key, index);
+  KeyValuePair* keyValuePair = this->tableRef_no_read_lock(key, index, hg);
   if (keyValuePair) {
+    HT_WRITE_SEQUENCE(this);
     keyValuePair->_Key = deleted<T_O>();
+    if (this->cachesHashes())
+      this->setControl_no_lock(keyValuePair - &this->_Table[0], hash_control_deleted);
     this->_HashTableCount--;
     VERIFY_HASH_TABLE(this);
     return true;
@@ -931,10 +1174,13 @@ T_sp HashTable_O::setf_gethash_no_write_lock(T_sp key, T_sp value) {
     core::clasp_write_string(fmt::format("{}:{}:{}   index = {}  this->_Table.size() = {}\n", __FILE__, __LINE__, __FUNCTION__,
                                          index, this->_Table.size()));
   });
-  KeyValuePair* keyValuePair = this->tableRef_no_read_lock(key, index);
+  KeyValuePair* keyValuePair = this->tableRef_no_read_lock(key, index, hg);
   if (keyValuePair) {
     // rewrite value
-    keyValuePair->_Value = value;
+    {
+      HT_WRITE_SEQUENCE(this);
+      keyValuePair->_Value = value;
+    }
     DEBUG_HASH_TABLE({
       core::clasp_write_string(fmt::format("{}:{} Found key/value pair: {},{}\n", __FILE__, __LINE__, _rep_(keyValuePair->_Key),
                                            _rep_(keyValuePair->_Value)));
@@ -952,9 +1198,17 @@ T_sp HashTable_O::setf_gethash_no_write_lock(T_sp key, T_sp value) {
   DEBUG_HASH_TABLE({
     core::clasp_write_string(fmt::format("{}:{}:{} Looking for empty slot index = {}\n", __FILE__, __LINE__, __FUNCTION__, index));
   });
-  KeyValuePair* entryP = &this->_Table[index];
+  KeyValuePair* entryP;
   size_t write;
   size_t curEnd = this->_Table.size();
+  if (this->cachesHashes()) {
+    write = this->findFreeCached_no_read_lock(index);
+    if (write == curEnd)
+      goto NO_ROOM;
+    entryP = &this->_Table[write];
+    goto ADD_KEY_VALUE;
+  }
+  entryP = &this->_Table[index];
   for (write = index; write < curEnd; ++write, ++entryP) {
     if (entryP->_Key.no_keyp() || entryP->_Key.deletedp())
       goto ADD_KEY_VALUE;
@@ -977,9 +1231,17 @@ ADD_KEY_VALUE:
       lisp_write(fmt::format("{} hg2 -> {}\n", CPP_SOURCE(), hg2.asString()));
     }
   });
-  entryP->_Key = key;
-  entryP->_Value = value;
-  this->_HashTableCount++;
+  {
+    HT_WRITE_SEQUENCE(this);
+    if (this->cachesHashes()) {
+      uint64_t hash = hg.rawhash();
+      this->setControl_no_lock(write, hash_control_full(hash));
+      (*this->_Hashes)[write] = hash;
+    }
+    entryP->_Key = key;
+    entryP->_Value = value;
+    this->_HashTableCount++;
+  }
   DEBUG_HASH_TABLE({ core::clasp_write_string(fmt::format("{}:{} Found empty slot at index = {}\n", __FILE__, __LINE__, write)); });
   VERIFY_HASH_TABLE_VA(this, write, key);
   if (this->_HashTableCount > this->_RehashThreshold * this->_Table.size()) {
@@ -1053,13 +1315,24 @@ KeyValuePair* HashTable_O::rehash_no_lock(bool expandTable, T_sp findKey) {
   } else {
     newSize = curSize;
   }
-  gc::Vec0<KeyValuePair> oldTable;
-  oldTable.swap(this->_Table);
-  newSize = this->resizeEmptyTable_no_lock(newSize);
+  if (newSize < 16)
+    newSize = 16;
   LOG("Resizing table to size: {}", newSize);
-  size_t oldSize = oldTable.size();
+  // The new table is built off to the side and then published all at once,
+  // so lock-free readers keep using the old table until the rehash is done.
+  T_sp no_key = ::no_key<T_O>();
+  gc::Vec0<KeyValuePair> newTable;
+  newTable.resize(newSize, KeyValuePair(no_key, no_key));
+  SimpleVector_byte8_t_sp newControl = nil<SimpleVector_byte8_t_O>();
+  SimpleVector_byte64_t_sp newHashes = nil<SimpleVector_byte64_t_O>();
+  if (this->cachesHashes()) {
+    newControl = SimpleVector_byte8_t_O::make(newSize + HASH_TABLE_GROUP_WIDTH, hash_control_empty, true);
+    newHashes = SimpleVector_byte64_t_O::make(newSize, 0, true);
+  }
+  size_t newCount = 0;
+  size_t oldSize = this->_Table.size();
   for (size_t it(0), itEnd(oldSize); it < itEnd; ++it) {
-    KeyValuePair& entry = oldTable[it];
+    KeyValuePair& entry = this->_Table[it];
     T_sp key = entry._Key;
     T_sp value = entry._Value;
     if (!key.no_keyp() && !key.deletedp()) {
@@ -1077,9 +1350,32 @@ KeyValuePair* HashTable_O::rehash_no_lock(bool expandTable, T_sp findKey) {
           foundKeyValuePair = &entry;
         }
       }
-      this->setf_gethash_no_write_lock(key, value);
+      size_t write;
+      if (newControl.notnilp()) {
+        // The cached hash is still good, so move the entry without rehashing its key.
+        uint64_t hash = (*this->_Hashes)[it];
+        write = hash_control_find_free(&(*newControl)[0], newSize, hash % newSize);
+        hash_control_set(&(*newControl)[0], newSize, write, hash_control_full(hash));
+        (*newHashes)[write] = hash;
+      } else {
+        HashGenerator hg;
+        write = this->sxhashKey(key, newSize, hg);
+        while (!newTable[write]._Key.no_keyp()) {
+          if (++write == (size_t)newSize)
+            write = 0;
+        }
+      }
+      newTable[write] = KeyValuePair(key, value);
+      ++newCount;
     }
   }
+  {
+    HT_WRITE_SEQUENCE(this);
+    this->_Table.swap(newTable);
+    this->_Control = newControl;
+    this->_Hashes = newHashes;
+    this->_HashTableCount = newCount;
+  }
 #ifdef DEBUG_REHASH_COUNT
   this->_RehashCount++;
   MONITOR(BF("Hash-table rehash id %lu initial-size %lu rehash-number %lu rehash-size %lu oldHashTableCount %lu _HashTableCount "
@@ -1100,7 +1396,7 @@ KeyValuePair* HashTable_O::rehash_no_lock(bool expandTable, T_sp findKey) {
     T_sp key = foundKeyValuePair->_Key;
     HashGenerator hg;
     cl_index index = this->sxhashKey(key, this->_Table.size(), hg);
-    foundKeyValuePair = this->tableRef_no_read_lock(foundKeyValuePair->_Key, index);
+    foundKeyValuePair = this->tableRef_no_read_lock(foundKeyValuePair->_Key, index, hg);
   }
   DEBUG_HASH_TABLE({
     if (foundKeyValuePair) {
@@ -1112,6 +1408,10 @@ KeyValuePair* HashTable_O::rehash_no_lock(bool expandTable, T_sp findKey) {
   return foundKeyValuePair;
 }
 
+// Readers of a thread-safe table only take the read lock when their lock-free
+// gethash keeps racing with writers, and rehash_no_lock does not disturb the
+// table they are reading until it publishes the new one, so holding the write
+// lock here does not stall gethash.
 KeyValuePair* HashTable_O::rehash_upgrade_write_lock(bool expandTable, T_sp findKey) {
   if (this->_Mutex) {
   tryAgain:
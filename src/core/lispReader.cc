@@ -37,6 +37,7 @@ THE SOFTWARE.
 #include <clasp/core/pathname.h>
 #include <clasp/core/bformat.h>
 #include <clasp/core/character.h>
+#include <clasp/core/parse_number.h>
 #include <clasp/core/symbolTable.h>
 #include <clasp/core/numbers.h>
 #include <clasp/core/arguments.h>
@@ -385,34 +386,6 @@ void make_str(StrNs_sp sout, List_sp cur_char) {
   }
 }
 
-string fix_exponent_char(const char* cur) {
-  stringstream ss;
-  while (*cur) {
-    if (alpha_char_p(*cur)) {
-      switch (*cur) {
-      case 'd':
-      case 'D':
-      case 'e':
-      case 'E':
-      case 'f':
-      case 'F':
-      case 'l':
-      case 'L':
-      case 's':
-      case 'S':
-        ss << "E";
-        break;
-      default:
-        SIMPLE_ERROR("Illegal exponent character[%c]", *cur);
-        break;
-      }
-    } else
-      ss << (*cur);
-    ++cur;
-  }
-  return ss.str();
-}
-
 typedef enum {
   tstart,
   tsyms,
@@ -496,8 +469,6 @@ template <typename Char> struct fmt::formatter<core::TokenState, Char> : fmt::fo
 
 namespace core {
 
-typedef enum { undefined_exp, double_float_exp, float_exp, single_float_exp, long_float_exp, short_float_exp } FloatExponentType;
-
 UnEscapedCase token_check_case(Token& token, size_t start, size_t end) {
   UnEscapedCase curcase = undefined;
   for (size_t i(start); i < end; ++i) {
@@ -605,34 +576,10 @@ T_sp interpret_token_or_throw_reader_error(T_sp sin, Token& token, bool only_dot
   const trait_chr_type* package_marker = start;
   const trait_chr_type* name_marker = start;
   TokenState state = tstart;
-  FloatExponentType exponent = undefined_exp;
 #define EXPTEST(c, x)                                                                                                              \
-  {                                                                                                                                \
-    if (CHR_TRAIT_MATCH_ANY(c, TRAIT_EXPONENTMARKER, 'D') || CHR_TRAIT_MATCH_ANY(c, TRAIT_EXPONENTMARKER, 'd')) {                  \
-      exponent = double_float_exp;                                                                                                 \
-      state = x;                                                                                                                   \
-      goto NEXT;                                                                                                                   \
-    }                                                                                                                              \
-    if (CHR_TRAIT_MATCH_ANY(c, TRAIT_EXPONENTMARKER, 'E') || CHR_TRAIT_MATCH_ANY(c, TRAIT_EXPONENTMARKER, 'e')) {                  \
-      exponent = float_exp;                                                                                                        \
-      state = x;                                                                                                                   \
-      goto NEXT;                                                                                                                   \
-    }                                                                                                                              \
-    if (CHR_TRAIT_MATCH_ANY(c, TRAIT_EXPONENTMARKER, 'F') || CHR_TRAIT_MATCH_ANY(c, TRAIT_EXPONENTMARKER, 'f')) {                  \
-      exponent = single_float_exp;                                                                                                 \
-      state = x;                                                                                                                   \
-      goto NEXT;                                                                                                                   \
-    }                                                                                                                              \
-    if (CHR_TRAIT_MATCH_ANY(c, TRAIT_EXPONENTMARKER, 'L') || CHR_TRAIT_MATCH_ANY(c, TRAIT_EXPONENTMARKER, 'l')) {                  \
-      exponent = long_float_exp;                                                                                                   \
-      state = x;                                                                                                                   \
-      goto NEXT;                                                                                                                   \
-    }                                                                                                                              \
-    if (CHR_TRAIT_MATCH_ANY(c, TRAIT_EXPONENTMARKER, 'S') || CHR_TRAIT_MATCH_ANY(c, TRAIT_EXPONENTMARKER, 's')) {                  \
-      exponent = short_float_exp;                                                                                                  \
-      state = x;                                                                                                                   \
-      goto NEXT;                                                                                                                   \
-    }                                                                                                                              \
+  if (TRAIT_MATCH_ANY(c, TRAIT_EXPONENTMARKER)) {                                                                                  \
+    state = x;                                                                                                                     \
+    goto NEXT;                                                                                                                     \
   }
 #define TEST(c, x)                                                                                                                 \
   if (c) {                                                                                                                         \
@@ -833,105 +780,20 @@ T_sp interpret_token_or_throw_reader_error(T_sp sin, Token& token, bool only_dot
     break;
   case tintt:
   case tintp:
-    // interpret ints
-    {
-      ASSERT(cl::_sym_STARread_baseSTAR->symbolValue().fixnump());
-      int read_base = cl::_sym_STARread_baseSTAR->symbolValue().unsafe_fixnum();
-      ASSERT(read_base >= 2 && read_base <= 36);
-      SimpleString_sp ssnum = tokenStr(sin, token, start - token.data());
-      string num = ssnum->get_std_string();
-      if (num[0] == '+')
-        num = num.substr(1, num.size());
-      try {
-        if (num[num.size() - 1] == '.') {
-          return Integer_O::create(num.substr(0, num.size() - 1));
-        } else {
-          return Integer_O::create(num, read_base);
-        }
-      } catch (std::invalid_argument& arg) {
-        SIMPLE_ERROR("Problem in mpz_class creation with {} error: {}", num, arg.what());
-      }
-      SIMPLE_ERROR("Problem while interpreting int from {} in reader", num);
-    }
-    break;
-  case tratio: {
-    // interpret ratio
-    SimpleString_sp sRatioStr = tokenStr(sin, token, start - token.data());
-    std::string ratioStr = sRatioStr->get_std_string();
-    if (ratioStr[0] == '+')
-      ratioStr = ratioStr.substr(1, ratioStr.size() - 1);
-    vector<string> parts = split(ratioStr.c_str(), "/");
-    ASSERT(parts.size() == 2);
-    Integer_sp num = Integer_O::create(parts[0]);
-    Integer_sp denom = Integer_O::create(parts[1]);
-    return Rational_O::create(num, denom);
-    break;
-  }
+  case tratio:
   case tfloat0:
   case tfloate:
   case tfloatp:
-    // interpret float
+    // interpret numbers
     {
-      switch (exponent) {
-      case undefined_exp: {
-        char* lastValid = NULL;
-        if (cl::_sym_STARreadDefaultFloatFormatSTAR->symbolValue() == cl::_sym_single_float) {
-          string numstr = tokenStr(sin, token, start - token.data())->get_std_string();
-          float f = ::strtof(numstr.c_str(), &lastValid);
-          return clasp_make_single_float(f);
-        } else if (cl::_sym_STARreadDefaultFloatFormatSTAR->symbolValue() == cl::_sym_DoubleFloat_O) {
-          string numstr = tokenStr(sin, token, start - token.data())->get_std_string();
-          double d = ::strtod(numstr.c_str(), &lastValid);
-          return DoubleFloat_O::create(d);
-        } else if (cl::_sym_STARreadDefaultFloatFormatSTAR->symbolValue() == cl::_sym_ShortFloat_O) {
-          string numstr = tokenStr(sin, token, start - token.data())->get_std_string();
-          float f = ::strtof(numstr.c_str(), &lastValid);
-          return clasp_make_single_float(f); // ShortFloat_O::create(f) crashes
-        } else if (cl::_sym_STARreadDefaultFloatFormatSTAR->symbolValue() == cl::_sym_LongFloat_O) {
-          string numstr = tokenStr(sin, token, start - token.data())->get_std_string();
-          LongFloat l = ::strtod(numstr.c_str(), &lastValid);
-          return LongFloat_O::create(l);
-        } else {
-          SIMPLE_ERROR("Handle *read-default-float-format* of {}", _rep_(cl::_sym_STARreadDefaultFloatFormatSTAR->symbolValue()));
-        }
-      }
-      case float_exp: {
-        char* lastValid = NULL;
-        string numstr = fix_exponent_char(tokenStr(sin, token, start - token.data())->get_std_string().c_str());
-        double d = ::strtod(numstr.c_str(), &lastValid);
-        return DoubleFloat_O::create(d);
-      }
-      case short_float_exp: {
-        char* lastValid = NULL;
-        string numstr = fix_exponent_char(tokenStr(sin, token, start - token.data())->get_std_string().c_str());
-        double d = ::strtod(numstr.c_str(), &lastValid);
-        return clasp_make_single_float(d);
-      }
-      case single_float_exp: {
-        char* lastValid = NULL;
-        string numstr = fix_exponent_char(tokenStr(sin, token, start - token.data())->get_std_string().c_str());
-        double d = ::strtod(numstr.c_str(), &lastValid);
-        return clasp_make_single_float(d);
-      }
-      case double_float_exp: {
-        char* lastValid = NULL;
-        string numstr = fix_exponent_char(tokenStr(sin, token, start - token.data())->get_std_string().c_str());
-        double d = ::strtod(numstr.c_str(), &lastValid);
-        return DoubleFloat_O::create(d);
-      }
-      case long_float_exp: {
-        char* lastValid = NULL;
-        string numstr = fix_exponent_char(tokenStr(sin, token, start - token.data())->get_std_string().c_str());
-#ifdef CLASP_LONG_FLOAT
-        LongFloat d = ::strtold(numstr.c_str(), &lastValid);
-        return LongFloat_O::create(d);
-#else
-        double d = ::strtod(numstr.c_str(), &lastValid);
-        return DoubleFloat_O::create(d);
-#endif
-      }
-      }
-      SIMPLE_ERROR("Shouldn't get here - unhandled exponent type");
+      ASSERT(cl::_sym_STARread_baseSTAR->symbolValue().fixnump());
+      int read_base = cl::_sym_STARread_baseSTAR->symbolValue().unsafe_fixnum();
+      ASSERT(read_base >= 2 && read_base <= 36);
+      T_sp number = parse_number(start, end, read_base, cl::_sym_STARreadDefaultFloatFormatSTAR->symbolValue());
+      if (number.unboundp())
+        READER_ERROR(SimpleBaseString_O::make("Could not interpret the number ~a"),
+                     Cons_O::createList(tokenStr(sin, token, start - token.data())), sin);
+      return number;
     }
   }
   LOG_READ(BF("Bad state %d") % state);
@@ -53,9 +53,13 @@ THE SOFTWARE.
 #include <fcntl.h>
 #include <unistd.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <sys/types.h>
 #include <unistd.h>
 #include <poll.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 #include <clasp/core/foundation.h>
 #include <clasp/core/common.h>
 #include <clasp/core/fileSystem.h>
@@ -207,7 +211,9 @@ T_sp stream_open(T_sp fn, StreamDirection direction, StreamIfExists if_exists, S
       }
     }
   }
-  if (flags & CLASP_STREAM_C_STREAM) {
+  if (flags & CLASP_STREAM_MMAP) {
+    output = MmapFileStream_O::make(fn, f, byte_size, flags, external_format);
+  } else if (flags & CLASP_STREAM_C_STREAM) {
     FILE* fp = NULL;
     switch (direction) {
     case StreamDirection::probe:
@@ -228,6 +234,7 @@ T_sp stream_open(T_sp fn, StreamDirection direction, StreamIfExists if_exists, S
     output.as_unsafe<CFileStream_O>()->set_buffering_mode(byte_size ? kw::_sym_full : kw::_sym_line);
   } else {
     output = PosixFileStream_O::make(fn, f, direction, byte_size, flags, external_format, temp_name, created);
+    output.as_unsafe<PosixFileStream_O>()->set_buffering_mode(byte_size ? kw::_sym_full : kw::_sym_line);
   }
   if (direction == StreamDirection::probe) {
     stream_close(output, nil<T_O>());
@@ -897,13 +904,16 @@ err:
   FEerror("Not a valid stream element type: ~A", 1, element_type.raw_());
 }
 
-CL_LAMBDA("filename &key (direction :input) (element-type 'base-char) (if-exists nil iesp) (if-does-not-exist nil idnesp) (external-format :default) (cstream T)");
+CL_LAMBDA("filename &key (direction :input) (element-type 'base-char) (if-exists nil iesp) (if-does-not-exist nil idnesp) (external-format :default) (cstream T) mmap");
 CL_DOCSTRING(R"dx(Creates, opens, and returns a file stream that is connected to the
 file specified by filespec. Filespec is the name of the file to be
 opened. If the filespec designator is a stream, that stream is not
-closed first or otherwise affected.)dx");
+closed first or otherwise affected. If MMAP is true the file, which
+must be opened for :INPUT, is read through a memory mapping; see
+EXT:MMAP-FILE-STREAM-OCTETS.)dx");
 CL_DEFUN T_sp cl__open(T_sp filename, core::StreamDirection direction, T_sp element_type, core::StreamIfExists if_exists, bool iesp,
-                       core::StreamIfDoesNotExist if_does_not_exist, bool idnesp, T_sp external_format, T_sp cstream) {
+                       core::StreamIfDoesNotExist if_does_not_exist, bool idnesp, T_sp external_format, T_sp cstream,
+                       T_sp mmap) {
   if (filename.nilp()) {
     TYPE_ERROR(filename, Cons_O::createList(cl::_sym_or, cl::_sym_string, cl::_sym_Pathname_O, cl::_sym_Stream_O));
   }
@@ -946,6 +956,11 @@ CL_DEFUN T_sp cl__open(T_sp filename, core::StreamDirection direction, T_sp elem
   if (!cstream.nilp()) {
     flags |= CLASP_STREAM_C_STREAM;
   }
+  if (mmap.notnilp()) {
+    if (direction != StreamDirection::input)
+      SIMPLE_ERROR("Only :INPUT file streams can be memory mapped, not {}", _rep_(filename));
+    flags |= CLASP_STREAM_MMAP;
+  }
   return stream_open(filename, direction, if_exists, if_does_not_exist, byte_size, flags, external_format);
 }
 
@@ -1557,11 +1572,14 @@ clasp_off_t clasp_integer_to_off_t(T_sp offset) {
   return output;
 }
 
-CL_LAMBDA(file_descriptor &key direction);
-CL_DOCSTRING(R"dx(Create a file from a file descriptor and direction)dx");
+CL_LAMBDA(file_descriptor &key direction buffering);
+CL_DOCSTRING(R"dx(Create a file from a file descriptor and direction. BUFFERING is NIL (the default), :LINE or :FULL)dx");
 CL_UNWIND_COOP(true);
-CL_DEFUN T_sp core__make_fd_stream(int fd, core::StreamDirection direction) {
-  return PosixFileStream_O::make(str_create("PosixFileStreamFromFD"), fd, direction);
+CL_DEFUN T_sp core__make_fd_stream(int fd, core::StreamDirection direction, T_sp buffering) {
+  PosixFileStream_sp stream = PosixFileStream_O::make(str_create("PosixFileStreamFromFD"), fd, direction);
+  if (buffering.notnilp())
+    stream->set_buffering_mode(buffering);
+  return stream;
 }
 
 CL_LAMBDA(strng &optional (istart 0) iend);
@@ -4263,6 +4281,148 @@ static int safe_fclose(FILE* stream) {
   return output;
 }
 
+/*
+ * Bulk transcoding. In the Latin-1, US-ASCII and UTF-8 formats every
+ * character below a limit is encoded as the single octet with the same
+ * code, so runs of such characters can be copied between strings and
+ * octet buffers without going through encode() and decode(). The run
+ * also stops at STOP, the character that line ending conversion has to
+ * see (-1 when there is none).
+ */
+
+static claspCharacter file_stream_octet_limit(int flags, int byte_size) {
+  if (byte_size != 8)
+    return 0;
+  switch (flags & (CLASP_STREAM_FORMAT | CLASP_STREAM_LITTLE_ENDIAN)) {
+#ifdef CLASP_UNICODE
+  case CLASP_STREAM_LATIN_1:
+    return 0x100;
+  case CLASP_STREAM_UTF_8:
+  case CLASP_STREAM_US_ASCII:
+    return 0x80;
+#else
+  case CLASP_STREAM_DEFAULT_FORMAT:
+    return 0x100;
+#endif
+  default:
+    return 0;
+  }
+}
+
+// Length of the initial run of the N octets at S that are below LIMIT and not STOP.
+static size_t octet_run_length(const unsigned char* s, size_t n, claspCharacter limit, int stop) {
+  size_t i = 0;
+#if defined(__SSE2__)
+  const __m128i stops = _mm_set1_epi8(static_cast<char>(stop));
+  for (; i + 16 <= n; i += 16) {
+    __m128i group = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+    uint32_t mask = (limit <= 0x80) ? _mm_movemask_epi8(group) : 0;
+    if (stop >= 0)
+      mask |= _mm_movemask_epi8(_mm_cmpeq_epi8(group, stops));
+    if (mask)
+      return i + __builtin_ctz(mask);
+  }
+#endif
+  for (; i < n; ++i)
+    if (s[i] >= limit || s[i] == stop)
+      break;
+  return i;
+}
+
+// Length of the initial run of the N characters at S that are below LIMIT and not STOP.
+static size_t octet_run_length(const claspCharacter* s, size_t n, claspCharacter limit, int stop) {
+  size_t i = 0;
+#if defined(__SSE2__)
+  const __m128i high = _mm_set1_epi32(~(limit - 1));
+  const __m128i stops = _mm_set1_epi32(stop);
+  const __m128i zero = _mm_setzero_si128();
+  for (; i + 4 <= n; i += 4) {
+    __m128i group = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+    __m128i low = _mm_cmpeq_epi32(_mm_and_si128(group, high), zero);
+    __m128i bad = _mm_or_si128(_mm_andnot_si128(low, _mm_set1_epi32(-1)), _mm_cmpeq_epi32(group, stops));
+    uint32_t mask = _mm_movemask_ps(_mm_castsi128_ps(bad));
+    if (mask)
+      return i + __builtin_ctz(mask);
+  }
+#endif
+  for (; i < n; ++i)
+    if (s[i] >= limit || (int)s[i] == stop)
+      break;
+  return i;
+}
+
+template <typename CharType> static void advance_output_cursor(StreamCursor& cursor, const CharType* chars, size_t n) {
+  if (n == 0)
+    return;
+  uint column = cursor.column(), line = cursor.line();
+  for (size_t i = 0; i + 1 < n; ++i) {
+    CharType c = chars[i];
+    if (c == CLASP_CHAR_CODE_NEWLINE) {
+      column = 0;
+      line++;
+    } else if (c == '\t')
+      column = (column & ~((size_t)07)) + 8;
+    else
+      column++;
+  }
+  cursor.column() = column;
+  cursor.line() = line;
+  cursor.update(chars[n - 1]);
+}
+
+// Encode the N characters at CHARS (claspChar or claspCharacter) and write them to STREAM.
+template <typename CharType> static void write_characters(FileStream_O* stream, const CharType* chars, size_t n) {
+  /* 1 extra byte for linefeed in crlf mode */
+  unsigned char buffer[VECTOR_ENCODING_BUFFER_SIZE + ENCODING_BUFFER_MAX_SIZE + 1];
+  size_t nbytes = 0;
+  int flags = stream->_flags;
+  claspCharacter limit = file_stream_octet_limit(flags, stream->_byte_size);
+  int stop = (flags & CLASP_STREAM_CR) ? CLASP_CHAR_CODE_NEWLINE : -1;
+  size_t i = 0;
+  while (i < n) {
+    if (limit) {
+      size_t run = octet_run_length(chars + i, std::min(n - i, (size_t)(VECTOR_ENCODING_BUFFER_SIZE - nbytes)), limit, stop);
+      if (run) {
+        unsigned char* out = buffer + nbytes;
+        for (size_t k = 0; k < run; ++k)
+          out[k] = (unsigned char)chars[i + k];
+        nbytes += run;
+        i += run;
+        if (nbytes >= VECTOR_ENCODING_BUFFER_SIZE) {
+          stream->write_byte8(buffer, nbytes);
+          nbytes = 0;
+        }
+        continue;
+      }
+    }
+    claspCharacter c = chars[i++];
+    if (c == CLASP_CHAR_CODE_NEWLINE) {
+      if ((flags & CLASP_STREAM_CR) && (flags & CLASP_STREAM_LF))
+        nbytes += stream->encode(buffer + nbytes, CLASP_CHAR_CODE_RETURN);
+      else if (flags & CLASP_STREAM_CR)
+        c = CLASP_CHAR_CODE_RETURN;
+    }
+    nbytes += stream->encode(buffer + nbytes, c);
+    if (nbytes >= VECTOR_ENCODING_BUFFER_SIZE) {
+      stream->write_byte8(buffer, nbytes);
+      nbytes = 0;
+    }
+  }
+  if (nbytes > 0)
+    stream->write_byte8(buffer, nbytes);
+  advance_output_cursor(stream->_output_cursor, chars, n);
+}
+
+void FileStream_O::write_string(String_sp data, cl_index start, cl_index end) {
+  check_output();
+  if (start >= end)
+    return;
+  if (data->element_type() == cl::_sym_base_char)
+    write_characters(this, (const claspChar*)data->rowMajorAddressOfElement_(start), end - start);
+  else
+    write_characters(this, (const claspCharacter*)data->rowMajorAddressOfElement_(start), end - start);
+}
+
 claspCharacter FileStream_O::decode_char_from_buffer(unsigned char* buffer, unsigned char** buffer_pos, unsigned char** buffer_end,
                                                      bool seekable, cl_index min_needed_bytes) {
   bool crlf = 0;
@@ -4358,8 +4518,29 @@ cl_index FileStream_O::read_sequence(T_sp data, cl_index start, cl_index end) {
        * read only as many bytes as we actually need. Otherwise, we read
        * more and later reposition the file offset. */
       bool seekable = position().notnilp();
+      bool wide = elementType == cl::_sym_character;
+      claspCharacter limit = file_stream_octet_limit(_flags, _byte_size);
+      int stop = (_flags & CLASP_STREAM_CR) ? CLASP_CHAR_CODE_RETURN : -1;
 
       while (start < end) {
+        if (limit && buffer_pos < buffer_end) {
+          /* Copy octets that decode to themselves straight into the vector */
+          size_t run = octet_run_length(buffer_pos, std::min((size_t)(buffer_end - buffer_pos), (size_t)(end - start)), limit, stop);
+          if (run) {
+            if (wide) {
+              claspCharacter* out = (claspCharacter*)vec->rowMajorAddressOfElement_(start);
+              for (size_t k = 0; k < run; ++k)
+                out[k] = buffer_pos[k];
+            } else {
+              memcpy(vec->rowMajorAddressOfElement_(start), buffer_pos, run);
+            }
+            _last_char = _last_code[0] = buffer_pos[run - 1];
+            _last_code[1] = EOF;
+            buffer_pos += run;
+            start += run;
+            continue;
+          }
+        }
         claspCharacter c = decode_char_from_buffer(buffer, &buffer_pos, &buffer_end, seekable, (end - start) * (_byte_size / 8));
         if (c == EOF)
           break;
@@ -4430,50 +4611,12 @@ void FileStream_O::write_sequence(T_sp data, cl_index start, cl_index end) {
         write_byte8(aux, bytes);
       }
     } else if (elementType == cl::_sym_base_char) {
-      /* 1 extra byte for linefeed in crlf mode */
-      unsigned char buffer[VECTOR_ENCODING_BUFFER_SIZE + ENCODING_BUFFER_MAX_SIZE + 1];
-      size_t nbytes = 0;
-      size_t i;
-      for (i = start; i < end; i++) {
-        char c = *(char*)(vec->rowMajorAddressOfElement_(i));
-        if (c == CLASP_CHAR_CODE_NEWLINE) {
-          if ((_flags & CLASP_STREAM_CR) && (_flags & CLASP_STREAM_LF))
-            nbytes += encode(buffer + nbytes, CLASP_CHAR_CODE_RETURN);
-          else if (_flags & CLASP_STREAM_CR)
-            c = CLASP_CHAR_CODE_RETURN;
-        }
-        nbytes += encode(buffer + nbytes, c);
-        update_output_cursor(c);
-        if (nbytes >= VECTOR_ENCODING_BUFFER_SIZE) {
-          write_byte8(buffer, nbytes);
-          nbytes = 0;
-        }
-      }
-      write_byte8(buffer, nbytes);
+      write_characters(this, (const claspChar*)vec->rowMajorAddressOfElement_(start), end - start);
       return;
     }
 #ifdef CLASP_UNICODE
     else if (elementType == cl::_sym_character) {
-      /* 1 extra byte for linefeed in crlf mode */
-      unsigned char buffer[VECTOR_ENCODING_BUFFER_SIZE + ENCODING_BUFFER_MAX_SIZE + 1];
-      cl_index nbytes = 0;
-      cl_index i;
-      for (i = start; i < end; i++) {
-        unsigned char c = *(unsigned char*)vec->rowMajorAddressOfElement_(i);
-        if (c == CLASP_CHAR_CODE_NEWLINE) {
-          if ((_flags & CLASP_STREAM_CR) && (_flags & CLASP_STREAM_LF))
-            nbytes += encode(buffer + nbytes, CLASP_CHAR_CODE_RETURN);
-          else if (_flags & CLASP_STREAM_CR)
-            c = CLASP_CHAR_CODE_RETURN;
-        }
-        nbytes += encode(buffer + nbytes, c);
-        update_output_cursor(c);
-        if (nbytes >= VECTOR_ENCODING_BUFFER_SIZE) {
-          write_byte8(buffer, nbytes);
-          nbytes = 0;
-        }
-      }
-      write_byte8(buffer, nbytes);
+      write_characters(this, (const claspCharacter*)vec->rowMajorAddressOfElement_(start), end - start);
       return;
     }
 #endif
@@ -4722,11 +4865,67 @@ PosixFileStream_sp PosixFileStream_O::make(T_sp fname, int fd, StreamDirection d
   return stream;
 }
 
+PosixFileStream_O::~PosixFileStream_O() { free_buffers(); }
+
+void PosixFileStream_O::free_buffers() {
+  gctools::clasp_dealloc((char*)_input_buffer);
+  gctools::clasp_dealloc((char*)_output_buffer);
+  _input_buffer = NULL;
+  _output_buffer = NULL;
+  _input_pos = _input_end = _output_fill = 0;
+}
+
+void PosixFileStream_O::fixupInternalsForSnapshotSaveLoad(snapshotSaveLoad::Fixup* fixup) {
+  if (snapshotSaveLoad::operation(fixup) == snapshotSaveLoad::LoadOp) {
+    // The buffers belonged to the process that saved the snapshot
+    _input_buffer = NULL;
+    _output_buffer = NULL;
+    _input_pos = _input_end = _output_fill = 0;
+  }
+}
+
+CL_LAMBDA(stream mode);
+CL_DOCSTRING(R"dx(set-buffering-mode)dx");
+CL_LISPIFY_NAME("set_buffering_mode")
+CL_DEFMETHOD
+void PosixFileStream_O::set_buffering_mode(T_sp mode) {
+  int bm;
+
+  if (mode == kw::_sym_none || mode.nilp())
+    bm = _IONBF;
+  else if (mode == kw::_sym_line || mode == kw::_sym_line_buffered)
+    bm = _IOLBF;
+  else if (mode == kw::_sym_full || mode == kw::_sym_fully_buffered)
+    bm = _IOFBF;
+  else
+    FEerror("Not a valid buffering mode: ~A", 1, mode.raw_());
+
+  if (_open) {
+    if (_output_fill > 0)
+      flush_output_buffer();
+    if (bm == _IONBF) {
+      drop_input_buffer();
+      /* Read ahead input that could not be given back to the file stays
+       * in the buffer until it has been consumed. */
+      if (_input_pos == _input_end) {
+        gctools::clasp_dealloc((char*)_input_buffer);
+        _input_buffer = NULL;
+      }
+      gctools::clasp_dealloc((char*)_output_buffer);
+      _output_buffer = NULL;
+    }
+  }
+  _buffering = bm;
+}
+
 T_sp PosixFileStream_O::close(T_sp abort) {
   if (_open) {
     int failed;
     unlikely_if(_file_descriptor == STDOUT_FILENO) FEerror("Cannot close the standard output", 0);
     unlikely_if(_file_descriptor == STDIN_FILENO) FEerror("Cannot close the standard input", 0);
+    if (_output_fill > 0 && abort.nilp())
+      flush_output_buffer();
+    free_buffers();
     failed = safe_close(_file_descriptor);
     unlikely_if(failed < 0) cannot_close(asSmartPtr());
     _file_descriptor = -1;
@@ -4736,12 +4935,7 @@ T_sp PosixFileStream_O::close(T_sp abort) {
   return _lisp->_true();
 }
 
-cl_index PosixFileStream_O::read_byte8(unsigned char* c, cl_index n) {
-  check_input();
-
-  if (_byte_stack.notnilp())
-    return consume_byte_stack(c, n);
-
+gctools::Fixnum PosixFileStream_O::read_fd(unsigned char* c, cl_index n) {
   gctools::Fixnum out = 0;
 
   clasp_disable_interrupts();
@@ -4753,6 +4947,86 @@ cl_index PosixFileStream_O::read_byte8(unsigned char* c, cl_index n) {
   return out;
 }
 
+gctools::Fixnum PosixFileStream_O::write_fd(unsigned char* c, cl_index n) {
+  gctools::Fixnum out;
+  clasp_disable_interrupts();
+  do {
+    out = write(_file_descriptor, c, sizeof(char) * n);
+  } while (out < 0 && restartable_io_error("write"));
+  clasp_enable_interrupts();
+  return out;
+}
+
+/* Write out everything in the output buffer. */
+void PosixFileStream_O::flush_output_buffer() {
+  size_t done = 0;
+  while (done < _output_fill) {
+    gctools::Fixnum out = write_fd(_output_buffer + done, _output_fill - done);
+    unlikely_if(out <= 0) {
+      _output_fill = 0;
+      io_error(asSmartPtr());
+    }
+    done += out;
+  }
+  _output_fill = 0;
+}
+
+/* Forget the input that has been read ahead, moving the file back to
+ * the first octet that has not been consumed. If the file can't seek
+ * (a pipe or a socket) the octets are kept, since the input and output
+ * directions are then independent. */
+void PosixFileStream_O::drop_input_buffer() {
+  if (_input_pos == _input_end)
+    return;
+  clasp_off_t ahead = _input_end - _input_pos;
+  clasp_disable_interrupts();
+  clasp_off_t ok = lseek(_file_descriptor, -ahead, SEEK_CUR);
+  clasp_enable_interrupts();
+  if (ok != (clasp_off_t)-1)
+    _input_pos = _input_end = 0;
+}
+
+cl_index PosixFileStream_O::read_byte8(unsigned char* c, cl_index n) {
+  check_input();
+
+  if (_byte_stack.notnilp())
+    return consume_byte_stack(c, n);
+
+  /* Output must reach the file before reading past it. */
+  if (_output_fill > 0)
+    flush_output_buffer();
+
+  if (_input_pos == _input_end && _buffering == _IONBF)
+    return read_fd(c, n);
+
+  cl_index out = 0;
+  while (out < n) {
+    if (_input_pos < _input_end) {
+      size_t count = std::min((size_t)(n - out), _input_end - _input_pos);
+      memcpy(c + out, _input_buffer + _input_pos, count);
+      _input_pos += count;
+      out += count;
+      continue;
+    }
+    if (_buffering == _IONBF || (n - out) >= _buffer_size) {
+      /* Large reads go straight into the caller's memory */
+      gctools::Fixnum count = read_fd(c + out, n - out);
+      if (count <= 0)
+        break;
+      out += count;
+      continue;
+    }
+    if (_input_buffer == NULL)
+      _input_buffer = (unsigned char*)gctools::clasp_alloc_atomic(_buffer_size);
+    gctools::Fixnum count = read_fd(_input_buffer, _buffer_size);
+    if (count <= 0)
+      break;
+    _input_pos = 0;
+    _input_end = count;
+  }
+  return out;
+}
+
 cl_index PosixFileStream_O::write_byte8(unsigned char* c, cl_index n) {
   check_output();
 
@@ -4764,22 +5038,40 @@ cl_index PosixFileStream_O::write_byte8(unsigned char* c, cl_index n) {
         stream_set_position(asSmartPtr(), aux);
       _byte_stack = nil<T_O>();
     }
+    drop_input_buffer();
   }
 
-  gctools::Fixnum out;
-  clasp_disable_interrupts();
-  do {
-    out = write(_file_descriptor, c, sizeof(char) * n);
-  } while (out < 0 && restartable_io_error("write"));
-  clasp_enable_interrupts();
-  return out;
+  if (_buffering == _IONBF)
+    return write_fd(c, n);
+
+  if (_output_fill + n > _buffer_size && _output_fill > 0)
+    flush_output_buffer();
+  if (n >= _buffer_size) {
+    cl_index done = 0;
+    while (done < n) {
+      gctools::Fixnum out = write_fd(c + done, n - done);
+      if (out <= 0)
+        return done;
+      done += out;
+    }
+  } else {
+    if (_output_buffer == NULL)
+      _output_buffer = (unsigned char*)gctools::clasp_alloc_atomic(_buffer_size);
+    memcpy(_output_buffer + _output_fill, c, n);
+    _output_fill += n;
+    if (_buffering == _IOLBF && memchr(c, '\n', n) != NULL)
+      flush_output_buffer();
+  }
+  return n;
 }
 
 ListenResult PosixFileStream_O::listen() {
   check_input();
 
-  if (_byte_stack.notnilp())
+  if (_byte_stack.notnilp() || _input_pos < _input_end)
     return listen_result_available;
+  if (_output_fill > 0)
+    flush_output_buffer();
   if (_flags & CLASP_STREAM_MIGHT_SEEK) {
     cl_env_ptr the_env = clasp_process_env();
     clasp_off_t disp, onew;
@@ -4803,6 +5095,7 @@ ListenResult PosixFileStream_O::listen() {
 
 void PosixFileStream_O::clear_input() {
   check_input();
+  _input_pos = _input_end = 0;
   while (_fd_listen(_file_descriptor) == listen_result_available) {
     claspCharacter c = read_char();
     if (c == EOF)
@@ -4810,17 +5103,26 @@ void PosixFileStream_O::clear_input() {
   }
 }
 
-void PosixFileStream_O::clear_output() { check_output(); }
+void PosixFileStream_O::clear_output() {
+  check_output();
+  _output_fill = 0;
+}
 
-void PosixFileStream_O::force_output() { check_output(); }
+void PosixFileStream_O::force_output() {
+  check_output();
+  if (_output_fill > 0)
+    flush_output_buffer();
+}
 
-void PosixFileStream_O::finish_output() { check_output(); }
+void PosixFileStream_O::finish_output() { force_output(); }
 
 bool PosixFileStream_O::interactive_p() const { return isatty(_file_descriptor); }
 
 T_sp FileStream_O::element_type() const { return _element_type; }
 
 T_sp PosixFileStream_O::length() {
+  if (_output_fill > 0)
+    flush_output_buffer();
   T_sp output = clasp_file_len(_file_descriptor); // NIL or Integer_sp
   if (_byte_size != 8 && output.notnilp()) {
     Real_mv output_mv = clasp_floor2(gc::As_unsafe<Integer_sp>(output), make_fixnum(_byte_size / 8));
@@ -4841,6 +5143,9 @@ T_sp PosixFileStream_O::position() {
   offset = lseek(_file_descriptor, 0, SEEK_CUR);
   clasp_enable_interrupts();
   unlikely_if(offset < 0) io_error(asSmartPtr());
+  /* The file is ahead of the stream by the input read into the buffer,
+   * and behind it by the output not yet written. */
+  offset += (clasp_off_t)_output_fill - (clasp_off_t)(_input_end - _input_pos);
   if (sizeof(clasp_off_t) == sizeof(long)) {
     output = Integer_O::create((gctools::Fixnum)offset);
   } else {
@@ -4874,6 +5179,10 @@ T_sp PosixFileStream_O::set_position(T_sp pos) {
     disp = clasp_integer_to_off_t(pos);
     mode = SEEK_SET;
   }
+  if (_output_fill > 0)
+    flush_output_buffer();
+  _input_pos = _input_end = 0;
+  _byte_stack = nil<T_O>();
   disp = lseek(_file_descriptor, disp, mode);
   return (disp == (clasp_off_t)-1) ? nil<T_O>() : _lisp->_true();
 }
@@ -4884,6 +5193,176 @@ int PosixFileStream_O::file_descriptor(StreamDirection direction) const {
 
 bool PosixFileStream_O::has_file_position() const { return clasp_has_file_position(_file_descriptor); }
 
+/**********************************************************************
+ * MEMORY MAPPED FILE STREAMS
+ */
+
+MmapFileStream_sp MmapFileStream_O::make(T_sp fname, int fd, gctools::Fixnum byte_size, int flags, T_sp external_format) {
+  struct stat info;
+  if (fstat(fd, &info) != 0) {
+    safe_close(fd);
+    FEcannot_open(fname);
+  }
+  void* map = NULL;
+  if (info.st_size > 0) {
+    clasp_disable_interrupts();
+    map = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    clasp_enable_interrupts();
+    if (map == MAP_FAILED) {
+      safe_close(fd);
+      FEcannot_open(fname);
+    }
+  }
+  MmapFileStream_sp stream = MmapFileStream_O::create();
+  stream->_direction = StreamDirection::input;
+  stream->_open = true;
+  stream->_byte_size = byte_size;
+  stream->_flags = flags;
+  stream->set_external_format(external_format);
+  stream->_filename = fname;
+  stream->_file_descriptor = fd;
+  stream->_map = (unsigned char*)map;
+  stream->_size = info.st_size;
+  stream->_position = 0;
+  stream->_last_op = 0;
+  return stream;
+}
+
+MmapFileStream_O::~MmapFileStream_O() {
+  unmap();
+  if (_file_descriptor >= 0)
+    ::close(_file_descriptor);
+}
+
+void MmapFileStream_O::unmap() {
+  if (_map)
+    munmap(_map, _size);
+  _map = NULL;
+  _size = _position = 0;
+}
+
+void MmapFileStream_O::fixupInternalsForSnapshotSaveLoad(snapshotSaveLoad::Fixup* fixup) {
+  if (snapshotSaveLoad::operation(fixup) == snapshotSaveLoad::LoadOp) {
+    // The mapping and the descriptor belonged to the process that saved the snapshot
+    _map = NULL;
+    _size = _position = 0;
+    _file_descriptor = -1;
+    _open = false;
+  }
+}
+
+T_sp MmapFileStream_O::close(T_sp abort) {
+  if (_open) {
+    unmap();
+    int failed = safe_close(_file_descriptor);
+    unlikely_if(failed < 0) cannot_close(asSmartPtr());
+    _file_descriptor = -1;
+    close_cleanup(abort);
+    _open = false;
+  }
+  return _lisp->_true();
+}
+
+cl_index MmapFileStream_O::read_byte8(unsigned char* c, cl_index n) {
+  check_input();
+
+  if (_byte_stack.notnilp())
+    return consume_byte_stack(c, n);
+
+  size_t count = std::min((size_t)n, _size - _position);
+  memcpy(c, _map + _position, count);
+  _position += count;
+  return count;
+}
+
+cl_index MmapFileStream_O::write_byte8(unsigned char* c, cl_index n) {
+  not_an_output_stream(asSmartPtr());
+  return 0;
+}
+
+ListenResult MmapFileStream_O::listen() {
+  check_input();
+  if (_byte_stack.notnilp() || _position < _size)
+    return listen_result_available;
+  return listen_result_eof;
+}
+
+void MmapFileStream_O::clear_input() { check_input(); }
+
+bool MmapFileStream_O::interactive_p() const { return false; }
+
+T_sp MmapFileStream_O::length() {
+  T_sp output = clasp_off_t_to_integer(_size);
+  if (_byte_size != 8) {
+    Real_mv output_mv = clasp_floor2(gc::As_unsafe<Integer_sp>(output), make_fixnum(_byte_size / 8));
+    output = output_mv;
+    MultipleValues& mvn = core::lisp_multipleValues();
+    Fixnum_sp fn1 = gc::As<Fixnum_sp>(mvn.valueGet(1, output_mv.number_of_values()));
+    unlikely_if(unbox_fixnum(fn1) != 0) { FEerror("File length is not on byte boundary", 0); }
+  }
+  return output;
+}
+
+T_sp MmapFileStream_O::position() {
+  T_sp output = clasp_off_t_to_integer(_position);
+  /* If there are unread octets, we return the position at which
+   * these bytes begin! */
+  for (T_sp l = _byte_stack; l.consp(); l = oCdr(l))
+    output = clasp_one_minus(gc::As<Number_sp>(output));
+  if (_byte_size != 8) {
+    output = clasp_floor2(gc::As<Real_sp>(output), make_fixnum(_byte_size / 8));
+  }
+  return output;
+}
+
+T_sp MmapFileStream_O::set_position(T_sp pos) {
+  clasp_off_t disp;
+  if (pos.nilp()) {
+    disp = _size;
+  } else {
+    if (_byte_size != 8) {
+      pos = clasp_times(gc::As<Number_sp>(pos), make_fixnum(_byte_size / 8));
+    }
+    disp = clasp_integer_to_off_t(pos);
+  }
+  if (disp < 0 || (size_t)disp > _size)
+    return nil<T_O>();
+  _byte_stack = nil<T_O>();
+  _position = disp;
+  return _lisp->_true();
+}
+
+int MmapFileStream_O::file_descriptor(StreamDirection direction) const {
+  return has_direction(_direction, direction) ? _file_descriptor : -1;
+}
+
+bool MmapFileStream_O::has_file_position() const { return true; }
+
+/* Return a fresh (unsigned-byte 8) vector with the contents of the file,
+ * copied out of the mapping in one go. Lisp vectors keep their elements
+ * inline, so there is no way to hand out the mapped pages themselves. */
+Array_sp MmapFileStream_O::copyOctets() {
+  check_input();
+  if (_size == 0)
+    return SimpleVector_byte8_t_O::make(0);
+  return SimpleVector_byte8_t_O::make(_size, 0, false, _size, _map);
+}
+
+CL_LAMBDA(stream);
+CL_DOCSTRING(R"dx(Return a fresh (unsigned-byte 8) vector holding a copy of the whole
+contents of the file read by STREAM, which must have been opened with :MMAP T.
+The copy is made straight from the mapped pages in one go, but it is a copy:
+it does not depend on STREAM staying open and writes to it never reach the
+file.)dx");
+DOCGROUP(clasp);
+CL_DEFUN Array_sp ext__mmap_file_stream_copy_octets(T_sp stream) {
+  if (!stream.isA<MmapFileStream_O>())
+    TYPE_ERROR(stream, core::_sym_MmapFileStream_O);
+  return stream.as_unsafe<MmapFileStream_O>()->copyOctets();
+}
+
+SYMBOL_EXPORT_SC_(ExtPkg, mmap_file_stream_copy_octets);
+
 /**********************************************************************
  * C STREAMS
  */
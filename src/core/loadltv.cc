@@ -71,7 +71,7 @@ namespace core {
 #define BC_HEADER_SIZE 16
 
 #define BC_VERSION_MAJOR 0
-#define BC_VERSION_MINOR 14
+#define BC_VERSION_MINOR 15
 
 // versions are std::arrays so that we can compare them.
 typedef std::array<uint16_t, 2> BCVersion;
@@ -112,14 +112,48 @@ static void ltv_header_encode(uint8_t* header, uint64_t instruction_count) {
 }
 
 struct loadltv {
-  Stream_sp _stream;
+  // Where we read from: either a stream, or, if _bytes is non-null, a
+  // buffer holding the entire FASL, e.g. an mmapped file. Decoding out
+  // of a buffer avoids going through the stream layer for every byte,
+  // and lets us copy bytecode and strings in bulk.
+  T_sp _stream;
+  const uint8_t* _bytes_begin = nullptr;
+  const uint8_t* _bytes = nullptr;
+  const uint8_t* _bytes_end = nullptr;
   gctools::Vec0<T_sp> _literals;
   uint8_t _index_bytes = 1;
   size_t _next_index = 0;
+  // While predecoding (see predecode()), set_ltv stores here instead.
+  T_sp* _predecode_slot = nullptr;
 
   loadltv(Stream_sp stream) : _stream(stream) {}
+  loadltv(const uint8_t* bytes, size_t len)
+      : _stream(nil<T_O>()), _bytes_begin(bytes), _bytes(bytes), _bytes_end(bytes + len) {}
 
-  inline uint8_t read_u8() { return stream_read_byte(_stream).unsafe_fixnum(); }
+  [[noreturn]] void eof_error() { SIMPLE_ERROR("Invalid FASL: unexpected end of file"); }
+
+  // Return a pointer to the next N bytes of the buffer, and advance past them.
+  inline const uint8_t* take_bytes(size_t n) {
+    if ((size_t)(_bytes_end - _bytes) < n)
+      eof_error();
+    const uint8_t* res = _bytes;
+    _bytes += n;
+    return res;
+  }
+
+  // Read N bytes into DEST.
+  void read_bytes(uint8_t* dest, size_t n) {
+    if (_bytes)
+      memcpy(dest, take_bytes(n), n);
+    else if (stream_read_byte8(_stream, dest, n) != n)
+      eof_error();
+  }
+
+  inline uint8_t read_u8() {
+    if (_bytes)
+      return *take_bytes(1);
+    return stream_read_byte(_stream).unsafe_fixnum();
+  }
 
   inline int8_t read_s8() {
     uint8_t byte = read_u8();
@@ -132,7 +166,10 @@ struct loadltv {
   }
 
   inline uint16_t read_u16() {
-    // Ideally we'd want to use something like read-sequence here.
+    if (_bytes) {
+      const uint8_t* b = take_bytes(2);
+      return ((uint16_t)b[0] << 8) | b[1];
+    }
     uint16_t high = read_u8();
     uint16_t low = read_u8();
     return (high << 8) | low;
@@ -149,6 +186,10 @@ struct loadltv {
   }
 
   inline uint32_t read_u32() {
+    if (_bytes) {
+      const uint8_t* b = take_bytes(4);
+      return ((uint32_t)b[0] << 24) | ((uint32_t)b[1] << 16) | ((uint32_t)b[2] << 8) | ((uint32_t)b[3] << 0);
+    }
     uint32_t b0 = read_u8();
     uint32_t b1 = read_u8();
     uint32_t b2 = read_u8();
@@ -167,6 +208,11 @@ struct loadltv {
   }
 
   inline uint64_t read_u64() {
+    if (_bytes) {
+      const uint8_t* b = take_bytes(8);
+      return ((uint64_t)b[0] << 56) | ((uint64_t)b[1] << 48) | ((uint64_t)b[2] << 40) | ((uint64_t)b[3] << 32) |
+             ((uint64_t)b[4] << 24) | ((uint64_t)b[5] << 16) | ((uint64_t)b[6] << 8) | ((uint64_t)b[7] << 0);
+    }
     uint64_t b0 = read_u8();
     uint64_t b1 = read_u8();
     uint64_t b2 = read_u8();
@@ -272,6 +318,10 @@ struct loadltv {
   }
 
   void set_ltv(T_sp value, size_t index) {
+    if (_predecode_slot) {
+      *_predecode_slot = value;
+      return;
+    }
     if (index >= _literals.size())
       SIMPLE_ERROR("Invalid FASL: Tried to set object #{:02d}, which is out of range", index);
     if (!_literals[index].unboundp())
@@ -414,7 +464,10 @@ struct loadltv {
     case UAETCode::nil:
       break;
     case UAETCode::base_char:
-      READ_ARRAY(SimpleBaseString_sp, read_u8(), clasp_make_character(read_u8()));
+      if (gc::IsA<SimpleBaseString_sp>(array))
+        read_bytes((uint8_t*)gc::As_unsafe<SimpleBaseString_sp>(array)->rowMajorAddressOfElement_(0), total_size);
+      else
+        READ_ARRAY(SimpleBaseString_sp, read_u8(), clasp_make_character(read_u8()));
       break;
     case UAETCode::character:
       READ_ARRAY(SimpleCharacterString_sp, read_utf8(), clasp_make_character(read_utf8()));
@@ -435,7 +488,10 @@ struct loadltv {
       fill_sub_byte(array, total_size, 4);
       break;
     case UAETCode::ub8:
-      READ_ARRAY(SimpleVector_byte8_t_sp, read_u8(), clasp_make_fixnum(read_u8()));
+      if (gc::IsA<SimpleVector_byte8_t_sp>(array))
+        read_bytes((uint8_t*)gc::As_unsafe<SimpleVector_byte8_t_sp>(array)->rowMajorAddressOfElement_(0), total_size);
+      else
+        READ_ARRAY(SimpleVector_byte8_t_sp, read_u8(), clasp_make_fixnum(read_u8()));
       break;
     case UAETCode::ub16:
       READ_ARRAY(SimpleVector_byte16_t_sp, read_u16(), clasp_make_fixnum(read_u16()));
@@ -627,7 +683,7 @@ struct loadltv {
     BytecodeModule_sp mod = BytecodeModule_O::make();
     SimpleVector_byte8_t_sp bytes = SimpleVector_byte8_t_O::make(len);
     mod->setf_bytecode(bytes);
-    cl__read_sequence(bytes, _stream, clasp_make_fixnum(0), nil<T_O>());
+    read_bytes((uint8_t*)bytes->rowMajorAddressOfElement_(0), len);
     set_ltv(mod, index);
   }
 
@@ -907,6 +963,12 @@ struct loadltv {
   void op_init_object_array() {
     check_initialization();
     uint64_t nobjs = read_u64();
+    set_index_bytes(nobjs);
+    _next_index = 0;
+    _literals.assign(nobjs, unbound<T_O>());
+  }
+
+  void set_index_bytes(uint64_t nobjs) {
     if (nobjs <= std::numeric_limits<uint8_t>::max()) {
       _index_bytes = 1;
     } else if (nobjs <= std::numeric_limits<uint16_t>::max()) {
@@ -916,8 +978,6 @@ struct loadltv {
     } else {
       _index_bytes = 8;
     }
-    _next_index = 0;
-    _literals.assign(nobjs, unbound<T_O>());
   }
 
   void load_instruction() {
@@ -1027,13 +1087,191 @@ struct loadltv {
 
   void load() {
     uint8_t header[BC_HEADER_SIZE];
-    stream_read_byte8(_stream, header, BC_HEADER_SIZE);
+    read_bytes(header, BC_HEADER_SIZE);
     uint64_t ninsts = ltv_header_decode(header);
     for (size_t i = 0; i < ninsts; ++i)
       load_instruction();
     // TODO: Check EOF
     check_initialization();
   }
+
+  // Parallel loading.
+  // A FASL is loaded in two passes. predecode() walks the instructions
+  // without executing them, and makes the objects that depend only on the
+  // instruction's operands: arrays (including strings), numbers,
+  // characters and bytecode modules. It doesn't touch any global state,
+  // so it can be run on many FASLs at once in worker threads. Then
+  // load_predecoded() runs the FASL as load() would, except that it uses
+  // the predecoded objects instead of decoding those instructions again,
+  // leaving only the order-sensitive work (interning, function cells,
+  // running top level forms, etc.) to the loading thread.
+
+  static bool predecodable_op_p(uint8_t opcode) {
+    switch (opcode) {
+    case LTV_OP_MAKE_ARRAY:
+    case LTV_OP_SB64:
+    case LTV_OP_BIGNUM:
+    case LTV_OP_FLOAT:
+    case LTV_OP_DOUBLE:
+    case LTV_OP_CHARACTER:
+    case LTV_OP_BCMOD:
+      return true;
+    default:
+      return false;
+    }
+  }
+
+  void skip_indices(size_t n) { take_bytes(n * _index_bytes); }
+
+  void skip_utf8() {
+    uint8_t head = read_u8();
+    if (head >> 7 == 0)
+      return;
+    else if (head >> 5 == 0b110)
+      take_bytes(1);
+    else if (head >> 4 == 0b1110)
+      take_bytes(2);
+    else if (head >> 3 == 0b11110)
+      take_bytes(3);
+    else SIMPLE_ERROR("Invalid UTF-8 in FASL: invalid header byte {:02x}", head);
+  }
+
+  // Skip the operands of an instruction we aren't predecoding.
+  void skip_instruction(uint8_t opcode) {
+    switch (opcode) {
+    case LTV_OP_NIL:
+    case LTV_OP_T:
+    case LTV_OP_CONS:
+    case LTV_OP_ENVIRONMENT:
+      break;
+    case LTV_OP_PACKAGE:
+    case LTV_OP_SYMBOL:
+    case LTV_OP_FDEF:
+    case LTV_OP_FCELL:
+    case LTV_OP_VCELL:
+    case LTV_OP_CLASS:
+      skip_indices(1);
+      break;
+    case LTV_OP_RPLACA:
+    case LTV_OP_RPLACD:
+    case LTV_OP_RATIO:
+    case LTV_OP_COMPLEX:
+    case LTV_OP_INTERN:
+      skip_indices(2);
+      break;
+    case LTV_OP_SHASH:
+      skip_indices(3);
+      break;
+    case LTV_OP_PATHNAME:
+      skip_indices(6);
+      break;
+    case LTV_OP_SRMA:
+      skip_indices(1);
+      take_bytes(2);
+      skip_indices(1);
+      break;
+    case LTV_OP_HASHT:
+      take_bytes(3);
+      break;
+    case LTV_OP_BCFUNC:
+      take_bytes(12);
+      skip_indices(1);
+      break;
+    case LTV_OP_SLITS: {
+      skip_indices(1);
+      skip_indices(read_u16());
+      break;
+    }
+    case LTV_OP_CREATE:
+    case LTV_OP_INIT: {
+      skip_indices(1);
+      skip_indices(read_u16());
+      break;
+    }
+    case LTV_OP_INIT_OBJECT_ARRAY:
+      set_index_bytes(read_u64());
+      break;
+    case LTV_OP_ATTR: {
+      skip_indices(1);
+      take_bytes(read_u32());
+      break;
+    }
+    default:
+      SIMPLE_ERROR("Unknown opcode {:02x}", opcode);
+    }
+  }
+
+  // Returns a vector of the predecoded objects, indexed by instruction
+  // (unbound for instructions that weren't predecoded), and a vector of
+  // the offsets at which each predecoded instruction ends.
+  std::pair<SimpleVector_sp, SimpleVector_byte64_t_sp> predecode() {
+    ASSERT(_bytes);
+    uint8_t header[BC_HEADER_SIZE];
+    read_bytes(header, BC_HEADER_SIZE);
+    uint64_t ninsts = ltv_header_decode(header);
+    SimpleVector_sp objects = SimpleVector_O::make(ninsts, unbound<T_O>());
+    SimpleVector_byte64_t_sp ends = SimpleVector_byte64_t_O::make(ninsts);
+    for (size_t i = 0; i < ninsts; ++i) {
+      uint8_t opcode = read_opcode();
+      if (predecodable_op_p(opcode)) {
+        T_sp object;
+        _predecode_slot = &object;
+        load_predecodable(opcode);
+        _predecode_slot = nullptr;
+        (*objects)[i] = object;
+        (*ends)[i] = _bytes - _bytes_begin;
+      } else
+        skip_instruction(opcode);
+    }
+    return std::make_pair(objects, ends);
+  }
+
+  void load_predecodable(uint8_t opcode) {
+    switch (opcode) {
+    case LTV_OP_MAKE_ARRAY:
+      op_array();
+      break;
+    case LTV_OP_SB64:
+      op_sb64();
+      break;
+    case LTV_OP_BIGNUM:
+      op_bignum();
+      break;
+    case LTV_OP_FLOAT:
+      op_float();
+      break;
+    case LTV_OP_DOUBLE:
+      op_double();
+      break;
+    case LTV_OP_CHARACTER:
+      op_character();
+      break;
+    case LTV_OP_BCMOD:
+      op_bcmod();
+      break;
+    default:
+      UNREACHABLE();
+    }
+  }
+
+  void load_predecoded(SimpleVector_sp objects, SimpleVector_byte64_t_sp ends) {
+    ASSERT(_bytes);
+    uint8_t header[BC_HEADER_SIZE];
+    read_bytes(header, BC_HEADER_SIZE);
+    uint64_t ninsts = ltv_header_decode(header);
+    if (objects->length() != ninsts)
+      SIMPLE_ERROR("Predecoded FASL does not match its bytes");
+    for (size_t i = 0; i < ninsts; ++i) {
+      T_sp object = (*objects)[i];
+      if (object.unboundp())
+        load_instruction();
+      else {
+        set_ltv(object, next_index());
+        _bytes = _bytes_begin + (*ends)[i];
+      }
+    }
+    check_initialization();
+  }
 };
 
 CL_DEFUN void load_bytecode_stream(Stream_sp stream) {
@@ -1041,7 +1279,93 @@ CL_DEFUN void load_bytecode_stream(Stream_sp stream) {
   loader.load();
 }
 
+// An mmapped FASL file, unmapped on scope exit (including nonlocal exit).
+struct ltv_MappedFile {
+  uint8_t* _Memory = nullptr;
+  size_t _Len = 0;
+  // Try to map FILENAME; on failure, _Memory stays null.
+  ltv_MappedFile(const std::string& filename) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+      return;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+      void* memory = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE | MAP_FILE, fd, 0);
+      if (memory != MAP_FAILED) {
+        madvise(memory, st.st_size, MADV_SEQUENTIAL);
+        _Memory = (uint8_t*)memory;
+        _Len = st.st_size;
+      }
+    }
+    close(fd);
+  }
+  ~ltv_MappedFile() {
+    if (_Memory)
+      munmap(_Memory, _Len);
+  }
+};
+
+CL_DOCSTRING(R"dx(Load the bytecode FASL in the vector of (unsigned-byte 8) BYTES.)dx");
+DOCGROUP(clasp);
+CL_DEFUN void core__load_bytecode_bytes(SimpleVector_byte8_t_sp bytes) {
+  loadltv loader((const uint8_t*)bytes->rowMajorAddressOfElement_(0), bytes->length());
+  loader.load();
+}
+
+CL_DOCSTRING(R"dx(Read the bytecode FASL FILENAME and do the parts of loading it that don't depend on
+global state, so that this can be done in parallel for several files. Returns an object to pass to
+core:load-predecoded-fasl, which finishes loading the file.)dx");
+DOCGROUP(clasp);
+CL_DEFUN SimpleVector_sp core__predecode_fasl(T_sp filename) {
+  std::string sfilename = core__coerce_to_filename(filename)->get_std_string();
+  int fd = open(sfilename.c_str(), O_RDONLY);
+  if (fd < 0)
+    SIMPLE_ERROR("Could not open {} because of {}", sfilename, strerror(errno));
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    SIMPLE_ERROR("Could not stat {} because of {}", sfilename, strerror(errno));
+  }
+  SimpleVector_byte8_t_sp bytes = SimpleVector_byte8_t_O::make(st.st_size);
+  uint8_t* data = (uint8_t*)bytes->rowMajorAddressOfElement_(0);
+  for (size_t done = 0; done < (size_t)st.st_size;) {
+    ssize_t nread = read(fd, data + done, st.st_size - done);
+    if (nread <= 0) {
+      close(fd);
+      SIMPLE_ERROR("Could not read {} because of {}", sfilename, (nread < 0) ? strerror(errno) : "early end of file");
+    }
+    done += nread;
+  }
+  close(fd);
+  loadltv loader(data, bytes->length());
+  auto [objects, ends] = loader.predecode();
+  SimpleVector_sp result = SimpleVector_O::make(3);
+  (*result)[0] = bytes;
+  (*result)[1] = objects;
+  (*result)[2] = ends;
+  return result;
+}
+
+CL_DOCSTRING(R"dx(Finish loading a FASL predecoded by core:predecode-fasl.)dx");
+DOCGROUP(clasp);
+CL_DEFUN void core__load_predecoded_fasl(SimpleVector_sp predecoded) {
+  SimpleVector_byte8_t_sp bytes = gc::As<SimpleVector_byte8_t_sp>((*predecoded)[0]);
+  loadltv loader((const uint8_t*)bytes->rowMajorAddressOfElement_(0), bytes->length());
+  loader.load_predecoded(gc::As<SimpleVector_sp>((*predecoded)[1]), gc::As<SimpleVector_byte64_t_sp>((*predecoded)[2]));
+}
+
 CL_DEFUN bool load_bytecode(T_sp filename, bool verbose, bool print, T_sp external_format) {
+  // Regular files are mapped into memory and decoded straight from there.
+  // Anything else, e.g. something we can't open or map, goes through the
+  // stream layer as usual.
+  {
+    ltv_MappedFile mapped(core__coerce_to_filename(filename)->get_std_string());
+    if (mapped._Memory) {
+      loadltv loader(mapped._Memory, mapped._Len);
+      loader.load();
+      return true;
+    }
+  }
   T_sp strm = cl__open(filename, StreamDirection::input, ext::_sym_byte8, StreamIfExists::nil, false, StreamIfDoesNotExist::nil,
                        false, external_format, nil<T_O>());
   if (strm.nilp())
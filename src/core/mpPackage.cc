@@ -730,6 +730,320 @@ string ConditionVariable_O::__repr__() const {
   return ss.str();
 }
 
+ConcurrentQueue_sp ConcurrentQueue_O::make_concurrent_queue(core::T_sp name, core::T_sp capacity) {
+  if (capacity.nilp()) {
+    auto queue = gctools::GC<ConcurrentQueue_O>::allocate(name, nil<core::T_O>(), 0);
+    core::Cons_sp dummy = core::Cons_O::create(nil<core::T_O>(), nil<core::T_O>());
+    queue->_Head.store(dummy);
+    queue->_Tail.store(dummy);
+    return queue;
+  }
+  if (!capacity.fixnump() || capacity.unsafe_fixnum() < 1)
+    TYPE_ERROR(capacity, core::Cons_O::createList(cl::_sym_integer, core::clasp_make_fixnum(1), core::clasp_make_fixnum(MOST_POSITIVE_FIXNUM)));
+  size_t size = 1;
+  while (size < (size_t)capacity.unsafe_fixnum())
+    size <<= 1;
+  core::SimpleVector_sp cells = core::SimpleVector_O::make(size);
+  for (size_t i = 0; i < size; ++i)
+    cells->rowMajorAset(i, core::Cons_O::create(core::clasp_make_fixnum(i), nil<core::T_O>()));
+  return gctools::GC<ConcurrentQueue_O>::allocate(name, cells, size - 1);
+}
+
+bool ConcurrentQueue_O::try_enqueue(core::T_sp object) {
+  if (this->boundedp()) {
+    core::SimpleVector_sp cells = gc::As_unsafe<core::SimpleVector_sp>(this->_Cells);
+    size_t pos = this->_EnqueuePos.load(std::memory_order_relaxed);
+    core::Cons_sp cell;
+    while (true) {
+      cell = gc::As_unsafe<core::Cons_sp>((*cells)[pos & this->_Mask]);
+      intptr_t diff = (intptr_t)cell->carAtomic(std::memory_order_acquire).unsafe_fixnum() - (intptr_t)pos;
+      if (diff == 0) {
+        if (this->_EnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+          break;
+      } else if (diff < 0) {
+        return false; // full
+      } else {
+        pos = this->_EnqueuePos.load(std::memory_order_relaxed);
+      }
+    }
+    cell->setCdrAtomic(object, std::memory_order_relaxed);
+    cell->setCarAtomic(core::clasp_make_fixnum(pos + 1), std::memory_order_release);
+  } else {
+    core::Cons_sp node = core::Cons_O::create(object, nil<core::T_O>());
+    while (true) {
+      core::T_sp tail = this->_Tail.load(std::memory_order_acquire);
+      core::Cons_sp tail_cons = gc::As_unsafe<core::Cons_sp>(tail);
+      core::T_sp next = tail_cons->cdrAtomic(std::memory_order_acquire);
+      if (next.nilp()) {
+        if (tail_cons->cdrCAS(next, node, std::memory_order_release).nilp()) {
+          this->_Tail.compare_exchange_strong(tail, node, std::memory_order_release, std::memory_order_relaxed);
+          break;
+        }
+      } else {
+        // Another producer linked a node but hasn't swung the tail yet; help it.
+        this->_Tail.compare_exchange_strong(tail, next, std::memory_order_release, std::memory_order_relaxed);
+      }
+    }
+  }
+  this->wake_waiters(1);
+  return true;
+}
+
+size_t ConcurrentQueue_O::try_enqueue_list(core::List_sp list) {
+  if (list.nilp())
+    return 0;
+  if (this->boundedp()) {
+    size_t enqueued = 0;
+    for (auto cur : list) {
+      if (!this->try_enqueue(core::oCar(cur)))
+        break;
+      ++enqueued;
+    }
+    return enqueued;
+  }
+  // Build a private chain of nodes and link all of them with one CAS.
+  core::Cons_sp first = core::Cons_O::create(core::oCar(list), nil<core::T_O>());
+  core::Cons_sp last = first;
+  size_t enqueued = 1;
+  for (auto cur : (core::List_sp)core::oCdr(list)) {
+    core::Cons_sp node = core::Cons_O::create(core::oCar(cur), nil<core::T_O>());
+    last->setCdr(node);
+    last = node;
+    ++enqueued;
+  }
+  while (true) {
+    core::T_sp tail = this->_Tail.load(std::memory_order_acquire);
+    core::Cons_sp tail_cons = gc::As_unsafe<core::Cons_sp>(tail);
+    core::T_sp next = tail_cons->cdrAtomic(std::memory_order_acquire);
+    if (next.nilp()) {
+      if (tail_cons->cdrCAS(next, first, std::memory_order_release).nilp()) {
+        this->_Tail.compare_exchange_strong(tail, last, std::memory_order_release, std::memory_order_relaxed);
+        break;
+      }
+    } else {
+      this->_Tail.compare_exchange_strong(tail, next, std::memory_order_release, std::memory_order_relaxed);
+    }
+  }
+  this->wake_waiters(enqueued);
+  return enqueued;
+}
+
+bool ConcurrentQueue_O::try_dequeue(core::T_sp& object) {
+  if (this->boundedp()) {
+    core::SimpleVector_sp cells = gc::As_unsafe<core::SimpleVector_sp>(this->_Cells);
+    size_t pos = this->_DequeuePos.load(std::memory_order_relaxed);
+    core::Cons_sp cell;
+    while (true) {
+      cell = gc::As_unsafe<core::Cons_sp>((*cells)[pos & this->_Mask]);
+      intptr_t diff = (intptr_t)cell->carAtomic(std::memory_order_acquire).unsafe_fixnum() - (intptr_t)(pos + 1);
+      if (diff == 0) {
+        if (this->_DequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+          break;
+      } else if (diff < 0) {
+        return false; // empty
+      } else {
+        pos = this->_DequeuePos.load(std::memory_order_relaxed);
+      }
+    }
+    object = cell->cdrAtomic(std::memory_order_relaxed);
+    cell->setCdrAtomic(nil<core::T_O>(), std::memory_order_relaxed);
+    cell->setCarAtomic(core::clasp_make_fixnum(pos + this->_Mask + 1), std::memory_order_release);
+    return true;
+  }
+  while (true) {
+    core::T_sp head = this->_Head.load(std::memory_order_acquire);
+    core::T_sp next = gc::As_unsafe<core::Cons_sp>(head)->cdrAtomic(std::memory_order_acquire);
+    if (next.nilp())
+      return false;
+    core::Cons_sp node = gc::As_unsafe<core::Cons_sp>(next);
+    core::T_sp value = node->carAtomic(std::memory_order_relaxed);
+    if (this->_Head.compare_exchange_weak(head, next, std::memory_order_acq_rel, std::memory_order_acquire)) {
+      // NODE is the new dummy; don't let it keep the object alive.
+      node->setCarAtomic(nil<core::T_O>(), std::memory_order_relaxed);
+      object = value;
+      return true;
+    }
+  }
+}
+
+core::List_sp ConcurrentQueue_O::try_dequeue_list(size_t max) {
+  if (max == 0)
+    return nil<core::T_O>();
+  if (this->boundedp()) {
+    ql::list result;
+    core::T_sp object;
+    for (size_t i = 0; i < max && this->try_dequeue(object); ++i)
+      result << object;
+    return result.result();
+  }
+  // Walk up to MAX nodes past the dummy and take them all with one CAS.
+  while (true) {
+    core::T_sp head = this->_Head.load(std::memory_order_acquire);
+    core::T_sp next = gc::As_unsafe<core::Cons_sp>(head)->cdrAtomic(std::memory_order_acquire);
+    if (next.nilp())
+      return nil<core::T_O>();
+    ql::list result;
+    core::Cons_sp last = gc::As_unsafe<core::Cons_sp>(next);
+    result << last->carAtomic(std::memory_order_relaxed);
+    for (size_t n = 1; n < max; ++n) {
+      core::T_sp following = last->cdrAtomic(std::memory_order_acquire);
+      if (following.nilp())
+        break;
+      last = gc::As_unsafe<core::Cons_sp>(following);
+      result << last->carAtomic(std::memory_order_relaxed);
+    }
+    if (this->_Head.compare_exchange_weak(head, last, std::memory_order_acq_rel, std::memory_order_acquire)) {
+      last->setCarAtomic(nil<core::T_O>(), std::memory_order_relaxed);
+      return result.result();
+    }
+  }
+}
+
+size_t ConcurrentQueue_O::count() const {
+  if (this->boundedp()) {
+    size_t dequeued = this->_DequeuePos.load(std::memory_order_acquire);
+    size_t enqueued = this->_EnqueuePos.load(std::memory_order_acquire);
+    return (enqueued > dequeued) ? std::min(enqueued - dequeued, this->capacity()) : 0;
+  }
+  size_t count = 0;
+  core::T_sp node = gc::As_unsafe<core::Cons_sp>(this->_Head.load(std::memory_order_acquire))->cdrAtomic(std::memory_order_acquire);
+  while (node.notnilp()) {
+    ++count;
+    node = gc::As_unsafe<core::Cons_sp>(node)->cdrAtomic(std::memory_order_acquire);
+  }
+  return count;
+}
+
+void ConcurrentQueue_O::wake_waiters(size_t enqueued) {
+  // Pairs with the fence in QueueWaiter: either we see the waiter, or the
+  // waiter sees what we just enqueued.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (this->_Waiters.load(std::memory_order_relaxed) == 0)
+    return;
+  this->_WaitMutex._value.lock();
+  if (enqueued == 1)
+    this->_NotEmpty._value.signal();
+  else
+    this->_NotEmpty._value.broadcast();
+  this->_WaitMutex._value.unlock();
+}
+
+/*! Registers a thread as sleeping on an empty queue for its extent, holding
+    the queue's wait mutex except while waiting on the condition variable. */
+struct QueueWaiter {
+  ConcurrentQueue_O* _Queue;
+  QueueWaiter(ConcurrentQueue_O* queue) : _Queue(queue) {
+    queue->_WaitMutex._value.lock();
+    queue->_Waiters.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+  }
+  ~QueueWaiter() {
+    this->_Queue->_Waiters.fetch_sub(1, std::memory_order_relaxed);
+    this->_Queue->_WaitMutex._value.unlock();
+  }
+};
+
+/*! Call ATTEMPT until it succeeds, sleeping while the queue is empty.
+    Give up after TIMEOUT seconds unless TIMEOUT is NIL. */
+template <typename Attempt> static bool queue_wait(ConcurrentQueue_O* queue, core::T_sp timeout, Attempt attempt) {
+  if (attempt())
+    return true;
+  double seconds = timeout.nilp() ? 0.0 : core::clasp_to_double(timeout);
+  if (timeout.notnilp() && seconds <= 0.0)
+    return false;
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double>(seconds);
+  QueueWaiter waiter(queue);
+  while (!attempt()) {
+    if (timeout.nilp()) {
+      queue->_NotEmpty._value.wait(queue->_WaitMutex._value);
+    } else {
+      double remaining = std::chrono::duration<double>(deadline - std::chrono::steady_clock::now()).count();
+      if (remaining <= 0.0)
+        return false;
+      queue->_NotEmpty._value.timed_wait(queue->_WaitMutex._value, remaining);
+    }
+  }
+  return true;
+}
+
+core::List_sp ConcurrentQueue_O::dequeue_list(size_t max, core::T_sp timeout) {
+  core::List_sp result = nil<core::T_O>();
+  if (max > 0)
+    queue_wait(this, timeout, [&]() { return (result = this->try_dequeue_list(max)).notnilp(); });
+  return result;
+}
+
+string ConcurrentQueue_O::__repr__() const {
+  stringstream ss;
+  ss << "#<CONCURRENT-QUEUE ";
+  ss << _rep_(this->_Name);
+  ss << ">";
+  return ss.str();
+}
+
+CL_LAMBDA(&key (name "Anonymous Queue") capacity);
+CL_DOCSTRING(R"dx(Make a new lock-free multi-producer/multi-consumer FIFO queue)dx");
+CL_DOCSTRING_LONG(R"dx(If CAPACITY is NIL the queue is unbounded. Otherwise it holds at most CAPACITY objects, rounded up to a power of two, and enqueueing onto a full queue fails instead of waiting. The NAME argument is stored with the queue for debugging purposes.)dx");
+DOCGROUP(clasp);
+CL_DEFUN ConcurrentQueue_sp mp__make_concurrent_queue(core::T_sp name, core::T_sp capacity) {
+  return ConcurrentQueue_O::make_concurrent_queue(name, capacity);
+}
+
+CL_DOCSTRING(R"dx(Return the name of the concurrent queue.)dx");
+DOCGROUP(clasp);
+CL_DEFUN core::T_sp mp__concurrent_queue_name(ConcurrentQueue_sp queue) { return queue->_Name; }
+
+CL_DOCSTRING(R"dx(Return the number of objects a bounded concurrent queue can hold, or NIL if it is unbounded.)dx");
+DOCGROUP(clasp);
+CL_DEFUN core::T_sp mp__concurrent_queue_capacity(ConcurrentQueue_sp queue) {
+  if (queue->boundedp())
+    return core::clasp_make_fixnum(queue->capacity());
+  return nil<core::T_O>();
+}
+
+CL_DOCSTRING(R"dx(Return the number of objects in the concurrent queue.)dx");
+CL_DOCSTRING_LONG(R"dx(The result may be out of date as soon as it is returned, if other threads are enqueueing or dequeueing.)dx");
+DOCGROUP(clasp);
+CL_DEFUN size_t mp__concurrent_queue_count(ConcurrentQueue_sp queue) { return queue->count(); }
+
+CL_DOCSTRING(R"dx(Return true if the concurrent queue is empty.)dx");
+CL_DOCSTRING_LONG(R"dx(The result may be out of date as soon as it is returned, if other threads are enqueueing or dequeueing.)dx");
+DOCGROUP(clasp);
+CL_DEFUN bool mp__concurrent_queue_empty_p(ConcurrentQueue_sp queue) {
+  if (queue->boundedp())
+    return queue->count() == 0;
+  return gc::As_unsafe<core::Cons_sp>(queue->_Head.load(std::memory_order_acquire))->cdrAtomic(std::memory_order_acquire).nilp();
+}
+
+CL_DOCSTRING(R"dx(Add OBJECT to the end of the concurrent queue, waking a thread waiting to dequeue if there is one)dx");
+CL_DOCSTRING_LONG(R"dx(Return true if OBJECT was enqueued, or false if the queue is bounded and full.)dx");
+DOCGROUP(clasp);
+CL_DEFUN bool mp__concurrent_enqueue(ConcurrentQueue_sp queue, core::T_sp object) { return queue->try_enqueue(object); }
+
+CL_DOCSTRING(R"dx(Add the elements of LIST to the end of the concurrent queue, in order)dx");
+CL_DOCSTRING_LONG(R"dx(On an unbounded queue the elements are all linked in with a single atomic operation, so other threads see them arrive together. On a bounded queue enqueueing stops when the queue is full. Return the number of elements enqueued.)dx");
+DOCGROUP(clasp);
+CL_DEFUN size_t mp__concurrent_enqueue_list(ConcurrentQueue_sp queue, core::List_sp list) { return queue->try_enqueue_list(list); }
+
+CL_LAMBDA(queue &optional timeout default);
+CL_DOCSTRING(R"dx(Remove and return the object at the front of the concurrent queue)dx");
+CL_DOCSTRING_LONG(R"dx(If the queue is empty, wait until another thread enqueues something, or until TIMEOUT seconds have passed if TIMEOUT is not NIL. A TIMEOUT of zero never waits. Return the object and true, or DEFAULT and false on timeout.)dx");
+DOCGROUP(clasp);
+CL_DEFUN core::T_mv mp__concurrent_dequeue(ConcurrentQueue_sp queue, core::T_sp timeout, core::T_sp defaultValue) {
+  core::T_sp object;
+  if (queue_wait(&*queue, timeout, [&]() { return queue->try_dequeue(object); }))
+    return core::Values(object, _lisp->_true());
+  return core::Values(defaultValue, nil<core::T_O>());
+}
+
+CL_LAMBDA(queue max &optional timeout);
+CL_DOCSTRING(R"dx(Remove up to MAX objects from the front of the concurrent queue and return them as a list, in order)dx");
+CL_DOCSTRING_LONG(R"dx(Only waits if the queue is empty, as for CONCURRENT-DEQUEUE; returns NIL on timeout. On an unbounded queue the objects are all taken with a single atomic operation.)dx");
+DOCGROUP(clasp);
+CL_DEFUN core::List_sp mp__concurrent_dequeue_list(ConcurrentQueue_sp queue, size_t max, core::T_sp timeout) {
+  return queue->dequeue_list(max, timeout);
+}
+
 DOCGROUP(clasp);
 CL_DEFUN void mp__push_default_special_binding(core::Symbol_sp symbol, core::T_sp form) {
   _lisp->push_default_special_binding(symbol, form);
@@ -0,0 +1,185 @@
+/*
+    File: sort.cc
+*/
+
+/*
+Copyright (c) 2014, Christian E. Schafmeister
+
+CLASP is free software; you can redistribute it and/or
+modify it under the terms of the GNU Library General Public
+License as published by the Free Software Foundation; either
+version 2 of the License, or (at your option) any later version.
+
+See directory 'clasp/licenses' for full details.
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+/* -^- */
+
+/*
+ * Native sorting kernels for SORT and STABLE-SORT on vectors specialized
+ * to a real element type, when the predicate is < or > and there is no key.
+ * Elements are mapped to unsigned radix keys that order the same way as
+ * the numbers, and sorted with a least significant digit radix sort
+ * a byte at a time, skipping the bytes on which all the keys agree. The
+ * sort is stable, and -0.0 and 0.0 get the same key, so it is also
+ * correct for STABLE-SORT. The parallel sort in tasks.lisp sorts pieces
+ * of a vector with these and then merges them with core:merge-vector-native.
+ */
+
+#include <vector>
+#include <algorithm>
+#include <type_traits>
+#include <cstring>
+#include <clasp/core/foundation.h>
+#include <clasp/core/object.h>
+#include <clasp/core/array.h>
+#include <clasp/core/wrappers.h>
+
+namespace core {
+
+template <typename T>
+using radix_key_t = std::conditional_t<
+    sizeof(T) == 8, uint64_t, std::conditional_t<sizeof(T) == 4, uint32_t, std::conditional_t<sizeof(T) == 2, uint16_t, uint8_t>>>;
+
+/*! An unsigned key that orders like X does under <, or under > if DESCENDING */
+template <typename T> static inline radix_key_t<T> sort_key(T x, bool descending) {
+  typedef radix_key_t<T> key_type;
+  const key_type sign = key_type(1) << (sizeof(key_type) * 8 - 1);
+  key_type key;
+  if constexpr (std::is_floating_point_v<T>) {
+    if (x == 0)
+      x = 0; // -0.0 and 0.0 are equal under <
+    key_type bits;
+    memcpy(&bits, &x, sizeof(bits));
+    // Negative floats order backwards by magnitude
+    key = (bits & sign) ? key_type(~bits) : key_type(bits | sign);
+  } else if constexpr (std::is_signed_v<T>) {
+    key = static_cast<key_type>(x) ^ sign;
+  } else {
+    key = x;
+  }
+  return descending ? key_type(~key) : key;
+}
+
+// Below this many elements the passes over the histograms cost more than they save
+static const size_t radix_sort_threshold = 64;
+
+template <typename T> static void insertion_sort(T* data, size_t length, bool descending) {
+  for (size_t i = 1; i < length; ++i) {
+    T x = data[i];
+    auto key = sort_key(x, descending);
+    size_t j = i;
+    for (; j > 0 && key < sort_key(data[j - 1], descending); --j)
+      data[j] = data[j - 1];
+    data[j] = x;
+  }
+}
+
+template <typename T> static void radix_sort(T* data, size_t length, bool descending) {
+  if (length < radix_sort_threshold) {
+    insertion_sort(data, length, descending);
+    return;
+  }
+  typedef radix_key_t<T> key_type;
+  const unsigned digit_bits = 8;
+  const unsigned radix = 1u << digit_bits;
+  const key_type mask = radix - 1;
+  const unsigned digits = (sizeof(key_type) * 8 + digit_bits - 1) / digit_bits;
+  std::vector<size_t> counts(digits * radix, 0);
+  for (size_t i = 0; i < length; ++i) {
+    key_type key = sort_key(data[i], descending);
+    for (unsigned d = 0; d < digits; ++d)
+      ++counts[d * radix + ((key >> (d * digit_bits)) & mask)];
+  }
+  std::vector<T> buffer(length);
+  T* from = data;
+  T* to = buffer.data();
+  for (unsigned d = 0; d < digits; ++d) {
+    size_t* count = &counts[d * radix];
+    unsigned shift = d * digit_bits;
+    // A digit that all the keys share doesn't reorder anything
+    if (count[(sort_key(data[0], descending) >> shift) & mask] == length)
+      continue;
+    size_t offset = 0;
+    for (unsigned b = 0; b < radix; ++b) {
+      size_t c = count[b];
+      count[b] = offset;
+      offset += c;
+    }
+    for (size_t i = 0; i < length; ++i) {
+      T x = from[i];
+      to[count[(sort_key(x, descending) >> shift) & mask]++] = x;
+    }
+    std::swap(from, to);
+  }
+  if (from != data)
+    std::copy(from, from + length, data);
+}
+
+template <typename T> static void merge_runs(T* data, size_t middle, size_t length, bool descending) {
+  std::vector<T> left(data, data + middle);
+  // std::merge takes from the first run on ties, which keeps it stable
+  std::merge(left.begin(), left.end(), data + middle, data + length, data,
+             [descending](T x, T y) { return sort_key(x, descending) < sort_key(y, descending); });
+}
+
+/*! Call FN with a pointer to element START of VECTOR's data and the
+    number of elements up to END, if the elements have a radix key */
+template <typename Fn> static bool with_native_sort_data(Array_sp vector, size_t start, size_t end, Fn fn) {
+  AbstractSimpleVector_sp sv;
+  size_t offset, offset_end;
+  vector->asAbstractSimpleVectorRange(sv, offset, offset_end);
+  if (start > end || end > offset_end - offset)
+    SIMPLE_ERROR("The range {} to {} is out of bounds for {}", start, end, _rep_(vector));
+#define NATIVE_SORT_DATA(_type_)                                                                                                   \
+  if (auto v = sv.asOrNull<_type_>()) {                                                                                            \
+    fn(&(*v)[offset + start], end - start);                                                                                        \
+    return true;                                                                                                                   \
+  }
+  NATIVE_SORT_DATA(SimpleVector_double_O);
+  NATIVE_SORT_DATA(SimpleVector_float_O);
+  NATIVE_SORT_DATA(SimpleVector_fixnum_O);
+  NATIVE_SORT_DATA(SimpleVector_byte8_t_O);
+  NATIVE_SORT_DATA(SimpleVector_byte16_t_O);
+  NATIVE_SORT_DATA(SimpleVector_byte32_t_O);
+  NATIVE_SORT_DATA(SimpleVector_byte64_t_O);
+  NATIVE_SORT_DATA(SimpleVector_int8_t_O);
+  NATIVE_SORT_DATA(SimpleVector_int16_t_O);
+  NATIVE_SORT_DATA(SimpleVector_int32_t_O);
+  NATIVE_SORT_DATA(SimpleVector_int64_t_O);
+#undef NATIVE_SORT_DATA
+  return false;
+}
+
+CL_LAMBDA(vector start end descending);
+CL_DECLARE();
+CL_DOCSTRING(R"dx(If VECTOR is specialized to a real type with a native sort, stably sort its elements from START to END
+by < (by > if DESCENDING is true) and return true. Otherwise leave VECTOR alone and return false.)dx");
+DOCGROUP(clasp);
+CL_DEFUN bool core__sort_vector_native(Array_sp vector, size_t start, size_t end, bool descending) {
+  return with_native_sort_data(vector, start, end, [descending](auto data, size_t length) { radix_sort(data, length, descending); });
+}
+
+CL_LAMBDA(vector start middle end descending);
+CL_DECLARE();
+CL_DOCSTRING(R"dx(Stably merge the sorted runs of VECTOR from START to MIDDLE and from MIDDLE to END, as for
+CORE:SORT-VECTOR-NATIVE. Return false, doing nothing, if VECTOR has no native sort.)dx");
+DOCGROUP(clasp);
+CL_DEFUN bool core__merge_vector_native(Array_sp vector, size_t start, size_t middle, size_t end, bool descending) {
+  if (middle < start || middle > end)
+    SIMPLE_ERROR("The middle {} is not between {} and {}", middle, start, end);
+  return with_native_sort_data(vector, start, end,
+                               [=](auto data, size_t length) { merge_runs(data, middle - start, length, descending); });
+}
+
+}; // namespace core
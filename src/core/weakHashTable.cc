@@ -37,6 +37,11 @@ namespace core {
 WeakKeyHashTable_O::WeakKeyHashTable_O() : _HashTable(16, core::make_single_float(2.0), 0.5){};
 
 void WeakKeyHashTable_O::initialize() { this->_HashTable.initialize(); }
+
+WeakKeyHashTable_sp WeakKeyHashTable_O::create(size_t sz, Number_sp rehashSize, double rehashThreshold,
+                                               gctools::WeakHashTableTest test, gctools::WeakHashTableWeakness weakness) {
+  return gctools::GC<WeakKeyHashTable_O>::allocate(sz, rehashSize, rehashThreshold, test, weakness);
+}
 }; // namespace core
 
 namespace core {
@@ -45,7 +50,36 @@ Number_sp WeakKeyHashTable_O::rehash_size() { return this->_HashTable._RehashSiz
 
 double WeakKeyHashTable_O::rehash_threshold() { return this->_HashTable._RehashThreshold; }
 
-T_sp WeakKeyHashTable_O::hash_table_test() { return cl::_sym_eq; }
+T_sp WeakKeyHashTable_O::hashTableTest() const {
+  switch (this->_HashTable._Test) {
+  case gctools::WeakHashTableTest::eql:
+    return cl::_sym_eql;
+  case gctools::WeakHashTableTest::equal:
+    return cl::_sym_equal;
+  case gctools::WeakHashTableTest::equalp:
+    return cl::_sym_equalp;
+  default:
+    return cl::_sym_eq;
+  }
+}
+
+T_sp WeakKeyHashTable_O::hash_table_test() { return this->hashTableTest(); }
+
+SYMBOL_EXPORT_SC_(KeywordPkg, key_and_value);
+SYMBOL_EXPORT_SC_(KeywordPkg, key_or_value);
+
+Symbol_sp WeakKeyHashTable_O::hashTableWeakness() const {
+  switch (this->_HashTable._Weakness) {
+  case gctools::WeakHashTableWeakness::value:
+    return kw::_sym_value;
+  case gctools::WeakHashTableWeakness::key_and_value:
+    return kw::_sym_key_and_value;
+  case gctools::WeakHashTableWeakness::key_or_value:
+    return kw::_sym_key_or_value;
+  default:
+    return kw::_sym_key;
+  }
+}
 
 void WeakKeyHashTable_O::describe(T_sp stream) {
   KeyBucketsType& keys = *this->_HashTable._Keys;
@@ -70,13 +104,17 @@ void WeakKeyHashTable_O::describe(T_sp stream) {
       sentry << "deleted";
     } else {
       // key.base_ref().nilp() ) {
-      T_sp okey = key;
+      T_sp okey = key.no_keyp() ? T_sp(make_fixnum(0)) : T_sp(key);
       sentry << _rep_(okey);
       sentry << "@" << (void*)(key.raw_());
       sentry << "   -->   ";
       value_type val = values[i];
       if (val.same_as_keyP()) {
         sentry << "same_as_key!!!";
+      } else if (!val) {
+        sentry << "splatted";
+      } else if (val.no_keyp()) {
+        sentry << _rep_(make_fixnum(0));
       } else {
         sentry << _rep_(val);
       }
@@ -176,9 +214,7 @@ CL_DEFUN void core__weak_rehash(WeakKeyHashTable_sp ht, T_sp sz) {
     newLength = unbox_fixnum(gc::As<Fixnum_sp>(sz));
     //	    newLength = unbox_fixnum(As<Fixnum_O>(sz));
   }
-  WeakKeyHashTable_O::value_type dummyKey;
-  size_t dummyPos;
-  ht->_HashTable.rehash(dummyKey, dummyPos);
+  ht->_HashTable.rehash();
 };
 }; // namespace core
 
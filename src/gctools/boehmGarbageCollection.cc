@@ -34,6 +34,7 @@ THE SOFTWARE.
 #ifdef USE_BOEHM // whole file #ifdef USE_BOEHM
 #include <clasp/gctools/boehmGarbageCollection.h>
 #include <clasp/gctools/gcFunctions.h>
+#include <clasp/gctools/profiler.h>
 #include <clasp/core/debugger.h>
 #include <clasp/core/compiler.h>
 #include <clasp/gctools/snapshotSaveLoad.h>
@@ -446,7 +447,12 @@ __attribute__((noinline)) void startupBoehm(gctools::ClaspInfo* claspInfo) {
 }
 
 void shutdownBoehm() {
-  GC_FREE(my_thread);
+  // The main thread's state is freed without running its destructor, so stop
+  // sampling it here first.
+  core::ThreadLocalState* state = my_thread;
+  cpuProfileDeregisterThread(my_thread_low_level);
+  my_thread = NULL;
+  GC_FREE(state);
 #if 0
   GC_unregister_my_thread();
 #endif
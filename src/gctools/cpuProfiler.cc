@@ -0,0 +1,593 @@
+/*
+    File: cpuProfiler.cc
+*/
+
+/*
+Copyright (c) 2014, Christian E. Schafmeister
+
+CLASP is free software; you can redistribute it and/or
+modify it under the terms of the GNU Library General Public
+License as published by the Free Software Foundation; either
+version 2 of the License, or (at your option) any later version.
+
+See directory 'clasp/licenses' for full details.
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+/* -^- */
+
+/*
+ * A sampling CPU profiler for Linux.
+ * Every thread with a ThreadLocalStateLowLevel registers itself here. While the
+ * profiler is on, a sampler thread wakes up once per period, reads the CPU clock of
+ * every registered thread and sends SIGPROF to each one that has used at least a
+ * period of CPU time since its last sample, with the number of periods in the
+ * signal's value. (A process-wide timer_create timer would be simpler, but the
+ * kernel is free to deliver its signals to any thread, and older kernels favor the
+ * main thread whether or not it was the one running.)
+ * The SIGPROF handler walks the native stack through the frame pointers, starting
+ * from the interrupted context, and copies the bytecode VM's pc chain, both into a
+ * preallocated slot; it doesn't allocate, take locks or look at Lisp objects. The
+ * sampler thread moves full slots into the profile table. Nothing is symbolized
+ * until cpu-profile-write, which names frames the same way the heap profiler does
+ * and writes folded stacks or a pprof profile.
+ * The handler stays installed once the profiler has been started, since a signal
+ * may still be pending when it's stopped; while the profiler is off it does nothing.
+ */
+
+#include <signal.h>
+#include <time.h>
+#include <ucontext.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <climits>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <clasp/core/foundation.h>
+#include <clasp/core/object.h>
+#include <clasp/core/lisp.h>
+#include <clasp/core/array.h>
+#include <clasp/core/pathname.h>
+#include <clasp/gctools/threadlocal.h>
+#include <clasp/gctools/gctoolsPackage.h>
+#include <clasp/gctools/profiler.h>
+
+namespace gctools {
+
+static const size_t CpuProfileMaxDepth = 128;
+// Enough for the sampler to keep up with a few hundred busy threads
+static const size_t CpuProfileSlotCount = 1024;
+
+enum CpuProfileSlotState { CpuProfileSlotEmpty, CpuProfileSlotWriting, CpuProfileSlotFull };
+
+// A sample as the SIGPROF handler records it: the native return addresses,
+// innermost first, followed by the bytecode pcs.
+struct CpuProfileSlot {
+  std::atomic<int> _State;
+  size_t _Periods;
+  size_t _NumNative;
+  size_t _NumBytecode;
+  uintptr_t _Pcs[2 * CpuProfileMaxDepth];
+};
+
+struct CpuProfileThread {
+  ThreadLocalStateLowLevel* _Thread;
+  pthread_t _PThread;
+  clockid_t _Clock;
+  int64_t _LastNanoseconds; // CPU time up to which the thread has been sampled
+};
+
+struct CpuProfileEntry {
+  size_t _Samples;
+  size_t _Periods;
+};
+
+// A key is the number of native return addresses, the native return addresses
+// and the bytecode pcs, innermost first.
+typedef std::unordered_map<std::vector<uintptr_t>, CpuProfileEntry, ProfileKeyHash> CpuProfileTable;
+
+std::atomic<bool> global_cpu_profile_on(false);
+std::atomic<size_t> global_cpu_profile_depth(64);
+std::atomic<size_t> global_cpu_profile_next_slot(0);
+std::atomic<size_t> global_cpu_profile_dropped(0);
+std::atomic<int> global_cpu_profile_in_handler(0);
+// Allocated by the first cpu-profile-start and never freed, since a late signal may still find it
+CpuProfileSlot* global_cpu_profile_slots = NULL;
+int64_t global_cpu_profile_period = 0; // nanoseconds
+
+std::mutex global_cpu_profile_threads_mutex;
+std::vector<CpuProfileThread> global_cpu_profile_threads;
+
+std::mutex global_cpu_profile_mutex;
+CpuProfileTable global_cpu_profile;
+int64_t global_cpu_profile_duration = 0; // nanoseconds profiled, not counting a running profile
+std::chrono::steady_clock::time_point global_cpu_profile_started;
+std::chrono::system_clock::time_point global_cpu_profile_first_start;
+
+// Serializes starting and stopping
+std::mutex global_cpu_profile_control_mutex;
+std::mutex global_cpu_profile_sampler_mutex;
+std::condition_variable global_cpu_profile_sampler_wakeup;
+std::thread global_cpu_profile_sampler;
+
+#if defined(_TARGET_OS_LINUX)
+
+// The SIGPROF handler that was installed before ours - clasp's own, normally.
+// Signals the sampler didn't send are passed on to it.
+struct sigaction global_cpu_profile_old_action;
+pid_t global_cpu_profile_pid = 0;
+
+static int64_t cpu_profile_clock_nanoseconds(clockid_t clock) {
+  struct timespec ts;
+  if (clock_gettime(clock, &ts) != 0)
+    return -1;
+  return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+void cpuProfileRegisterThread(ThreadLocalStateLowLevel* thread) {
+  CpuProfileThread entry;
+  entry._Thread = thread;
+  entry._PThread = pthread_self();
+  if (pthread_getcpuclockid(entry._PThread, &entry._Clock) != 0)
+    return;
+  entry._LastNanoseconds = cpu_profile_clock_nanoseconds(entry._Clock);
+  std::lock_guard<std::mutex> lock(global_cpu_profile_threads_mutex);
+  global_cpu_profile_threads.push_back(entry);
+}
+
+void cpuProfileDeregisterThread(ThreadLocalStateLowLevel* thread) {
+  // Called by the exiting thread itself. A SIGPROF the sampler has already
+  // queued stays pending from here on instead of running the handler while
+  // the thread's state is torn down, and once the entry is gone the sampler
+  // won't signal the thread again.
+  sigset_t prof;
+  sigemptyset(&prof);
+  sigaddset(&prof, SIGPROF);
+  pthread_sigmask(SIG_BLOCK, &prof, NULL);
+  std::lock_guard<std::mutex> lock(global_cpu_profile_threads_mutex);
+  for (auto it = global_cpu_profile_threads.begin(); it != global_cpu_profile_threads.end(); ++it) {
+    if (it->_Thread == thread) {
+      global_cpu_profile_threads.erase(it);
+      return;
+    }
+  }
+}
+
+// Walk the frame pointer chain of the interrupted context. Everything clasp
+// compiles keeps frame pointers; the walk stops at the first frame that doesn't
+// look like one, and never leaves the thread's stack.
+static size_t cpu_profile_native_pcs(ucontext_t* context, uintptr_t* pcs, size_t depth) {
+#if defined(__x86_64__)
+  uintptr_t pc = (uintptr_t)context->uc_mcontext.gregs[REG_RIP];
+  uintptr_t sp = (uintptr_t)context->uc_mcontext.gregs[REG_RSP];
+  uintptr_t fp = (uintptr_t)context->uc_mcontext.gregs[REG_RBP];
+#elif defined(__aarch64__)
+  uintptr_t pc = (uintptr_t)context->uc_mcontext.pc;
+  uintptr_t sp = (uintptr_t)context->uc_mcontext.sp;
+  uintptr_t fp = (uintptr_t)context->uc_mcontext.regs[29];
+#else
+  return 0;
+#endif
+  if (depth == 0)
+    return 0;
+  size_t num = 0;
+  // Symbolizing backs up from a return address into the call, so step past the
+  // interrupted instruction's first byte to name the function it's in.
+  pcs[num++] = pc + 1;
+  uintptr_t top = my_thread_low_level ? (uintptr_t)my_thread_low_level->_StackTop : 0;
+  while (num < depth && fp >= sp && fp + 2 * sizeof(uintptr_t) <= top && (fp % sizeof(uintptr_t)) == 0) {
+    uintptr_t* frame = (uintptr_t*)fp;
+    uintptr_t next = frame[0];
+    uintptr_t ret = frame[1];
+    if (ret == 0)
+      break;
+    pcs[num++] = ret;
+    if (next <= fp)
+      break;
+    fp = next;
+  }
+  return num;
+}
+
+static void cpu_profile_chain(int sig, siginfo_t* info, void* context) {
+  if (global_cpu_profile_old_action.sa_flags & SA_SIGINFO)
+    global_cpu_profile_old_action.sa_sigaction(sig, info, context);
+  else if (global_cpu_profile_old_action.sa_handler != SIG_DFL && global_cpu_profile_old_action.sa_handler != SIG_IGN)
+    global_cpu_profile_old_action.sa_handler(sig);
+}
+
+static void cpu_profile_handler(int sig, siginfo_t* info, void* context) {
+  // Only the sampler queues SIGPROF from inside this process. Anything else,
+  // e.g. an itimer, belongs to the previous handler; a late signal from the
+  // sampler after the profiler stopped is just dropped below.
+  if (info->si_code != SI_QUEUE || info->si_pid != global_cpu_profile_pid) {
+    cpu_profile_chain(sig, info, context);
+    return;
+  }
+  int saved_errno = errno;
+  // Announce ourselves before looking at the switch, so that cpu-profile-stop
+  // can wait for every handler that might still write a slot.
+  global_cpu_profile_in_handler.fetch_add(1);
+  if (global_cpu_profile_on.load() && global_cpu_profile_slots) {
+    size_t index = global_cpu_profile_next_slot.fetch_add(1, std::memory_order_relaxed) % CpuProfileSlotCount;
+    CpuProfileSlot& slot = global_cpu_profile_slots[index];
+    int expected = CpuProfileSlotEmpty;
+    if (slot._State.compare_exchange_strong(expected, CpuProfileSlotWriting, std::memory_order_acquire)) {
+      size_t depth = global_cpu_profile_depth.load(std::memory_order_relaxed);
+      slot._Periods = (info->si_value.sival_int > 0) ? info->si_value.sival_int : 1;
+      slot._NumNative = cpu_profile_native_pcs((ucontext_t*)context, slot._Pcs, depth);
+      slot._NumBytecode = profile_bytecode_pcs(slot._Pcs + slot._NumNative, depth);
+      slot._State.store(CpuProfileSlotFull, std::memory_order_release);
+    } else {
+      global_cpu_profile_dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+  global_cpu_profile_in_handler.fetch_sub(1);
+  errno = saved_errno;
+}
+
+// Move the full slots into the profile table.
+static void cpu_profile_drain() {
+  std::vector<uintptr_t> key;
+  std::lock_guard<std::mutex> lock(global_cpu_profile_mutex);
+  for (size_t i = 0; i < CpuProfileSlotCount; ++i) {
+    CpuProfileSlot& slot = global_cpu_profile_slots[i];
+    if (slot._State.load(std::memory_order_acquire) != CpuProfileSlotFull)
+      continue;
+    key.clear();
+    key.push_back(slot._NumNative);
+    key.insert(key.end(), slot._Pcs, slot._Pcs + slot._NumNative + slot._NumBytecode);
+    CpuProfileEntry& entry = global_cpu_profile[key];
+    entry._Samples++;
+    entry._Periods += slot._Periods;
+    slot._State.store(CpuProfileSlotEmpty, std::memory_order_release);
+  }
+}
+
+static void cpu_profile_sample_threads() {
+  std::lock_guard<std::mutex> lock(global_cpu_profile_threads_mutex);
+  for (auto& thread : global_cpu_profile_threads) {
+    int64_t now = cpu_profile_clock_nanoseconds(thread._Clock);
+    int64_t periods = (now - thread._LastNanoseconds) / global_cpu_profile_period;
+    if (periods <= 0)
+      continue;
+    thread._LastNanoseconds += periods * global_cpu_profile_period;
+    union sigval value;
+    value.sival_int = (int)std::min(periods, (int64_t)INT_MAX);
+    // Holding the lock keeps the thread from deregistering and exiting meanwhile
+    pthread_sigqueue(thread._PThread, SIGPROF, value);
+  }
+}
+
+static void cpu_profile_sampler_loop() {
+  // This thread is invisible to Lisp and the GC, and should stay out of the way of signals meant for Lisp threads
+  sigset_t all;
+  sigfillset(&all);
+  pthread_sigmask(SIG_BLOCK, &all, NULL);
+  auto period = std::chrono::nanoseconds(global_cpu_profile_period);
+  auto next = std::chrono::steady_clock::now();
+  std::unique_lock<std::mutex> lock(global_cpu_profile_sampler_mutex);
+  while (global_cpu_profile_on.load()) {
+    next += period;
+    global_cpu_profile_sampler_wakeup.wait_until(lock, next, [] { return !global_cpu_profile_on.load(); });
+    if (!global_cpu_profile_on.load())
+      break;
+    cpu_profile_sample_threads();
+    cpu_profile_drain();
+    // Don't try to catch up after falling behind, e.g. while the machine was suspended
+    auto now = std::chrono::steady_clock::now();
+    if (next < now)
+      next = now;
+  }
+}
+
+#else // !_TARGET_OS_LINUX
+
+void cpuProfileRegisterThread(ThreadLocalStateLowLevel* thread) {}
+void cpuProfileDeregisterThread(ThreadLocalStateLowLevel* thread) {}
+
+#endif
+
+CL_LAMBDA(&key (frequency 100) (depth 64));
+CL_DOCSTRING(R"dx(Start the sampling CPU profiler. Each thread is sampled about FREQUENCY
+times per second of CPU time it uses; a sample records up to DEPTH frames of
+the native and bytecode backtraces. Samples accumulate until CPU-PROFILE-RESET
+and are written out with CPU-PROFILE-WRITE. The profiler can be started and
+stopped at any time, from any thread, and covers threads started meanwhile.
+Profiled threads are interrupted by SIGPROF, which some system calls, such as
+sleeping or waiting for input, return early from. SIGPROF signals that don't
+come from the profiler still go to the handler installed before it. Only
+available on Linux.)dx");
+DOCGROUP(clasp);
+CL_DEFUN void gctools__cpu_profile_start(size_t frequency, size_t depth) {
+#if defined(_TARGET_OS_LINUX)
+  if (frequency == 0 || frequency > 10000)
+    SIMPLE_ERROR("The CPU profile frequency must be between 1 and 10000, not {}", frequency);
+  std::lock_guard<std::mutex> control(global_cpu_profile_control_mutex);
+  if (global_cpu_profile_on.load())
+    SIMPLE_ERROR("The CPU profiler is already running");
+  if (!global_cpu_profile_slots) {
+    global_cpu_profile_slots = new CpuProfileSlot[CpuProfileSlotCount];
+    for (size_t i = 0; i < CpuProfileSlotCount; ++i)
+      global_cpu_profile_slots[i]._State.store(CpuProfileSlotEmpty);
+    // The handler stays installed for good, since signals the sampler already
+    // queued may arrive after cpu-profile-stop, and they mustn't reach the old one
+    if (sigaction(SIGPROF, NULL, &global_cpu_profile_old_action) != 0)
+      SIMPLE_ERROR("Could not look up the SIGPROF handler: {}", strerror(errno));
+    global_cpu_profile_pid = getpid();
+    struct sigaction action;
+    action.sa_sigaction = cpu_profile_handler;
+    // Keep the old handler's mask and SA_NODEFER - clasp's may unwind out of the
+    // signal handler, which must not leave SIGPROF blocked
+    action.sa_mask = global_cpu_profile_old_action.sa_mask;
+    action.sa_flags = SA_SIGINFO | SA_RESTART | (global_cpu_profile_old_action.sa_flags & SA_NODEFER);
+    if (sigaction(SIGPROF, &action, NULL) != 0)
+      SIMPLE_ERROR("Could not install the SIGPROF handler: {}", strerror(errno));
+  }
+  global_cpu_profile_depth.store(std::min(depth, CpuProfileMaxDepth), std::memory_order_relaxed);
+  global_cpu_profile_period = 1000000000 / frequency;
+  {
+    // Only count CPU time used from now on
+    std::lock_guard<std::mutex> lock(global_cpu_profile_threads_mutex);
+    for (auto& thread : global_cpu_profile_threads)
+      thread._LastNanoseconds = cpu_profile_clock_nanoseconds(thread._Clock);
+  }
+  {
+    std::lock_guard<std::mutex> lock(global_cpu_profile_mutex);
+    global_cpu_profile_started = std::chrono::steady_clock::now();
+    if (global_cpu_profile.empty() && global_cpu_profile_duration == 0)
+      global_cpu_profile_first_start = std::chrono::system_clock::now();
+  }
+  global_cpu_profile_on.store(true);
+  global_cpu_profile_sampler = std::thread(cpu_profile_sampler_loop);
+#else
+  SIMPLE_ERROR("The CPU profiler is only available on Linux");
+#endif
+}
+
+CL_LAMBDA();
+CL_DOCSTRING(R"dx(Stop the CPU profiler if it's running. The samples taken so far are kept.)dx");
+DOCGROUP(clasp);
+CL_DEFUN void gctools__cpu_profile_stop() {
+#if defined(_TARGET_OS_LINUX)
+  std::lock_guard<std::mutex> control(global_cpu_profile_control_mutex);
+  if (!global_cpu_profile_on.load())
+    return;
+  {
+    std::lock_guard<std::mutex> lock(global_cpu_profile_sampler_mutex);
+    global_cpu_profile_on.store(false);
+  }
+  global_cpu_profile_sampler_wakeup.notify_all();
+  global_cpu_profile_sampler.join();
+  // No more signals are sent; wait out the handlers that saw the profiler on
+  while (global_cpu_profile_in_handler.load() != 0)
+    std::this_thread::yield();
+  cpu_profile_drain();
+  std::lock_guard<std::mutex> lock(global_cpu_profile_mutex);
+  global_cpu_profile_duration +=
+      std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - global_cpu_profile_started).count();
+#endif
+}
+
+CL_LAMBDA();
+CL_DOCSTRING(R"dx(Discard the CPU profile samples taken so far.)dx");
+DOCGROUP(clasp);
+CL_DEFUN void gctools__cpu_profile_reset() {
+  std::lock_guard<std::mutex> control(global_cpu_profile_control_mutex);
+  std::lock_guard<std::mutex> lock(global_cpu_profile_mutex);
+  global_cpu_profile.clear();
+  global_cpu_profile_dropped.store(0);
+  global_cpu_profile_duration = 0;
+  global_cpu_profile_started = std::chrono::steady_clock::now();
+  global_cpu_profile_first_start = std::chrono::system_clock::now();
+}
+
+CL_LAMBDA();
+CL_DOCSTRING(R"dx(Return the number of CPU profile samples taken so far, the sampling
+frequency or NIL if the profiler is off, and the number of samples lost
+because the sampler fell behind.)dx");
+DOCGROUP(clasp);
+CL_DEFUN core::T_mv gctools__cpu_profile_samples() {
+  size_t samples = 0;
+  {
+    std::lock_guard<std::mutex> lock(global_cpu_profile_mutex);
+    for (auto& it : global_cpu_profile)
+      samples += it.second._Samples;
+  }
+  core::T_sp frequency = nil<core::T_O>();
+  if (global_cpu_profile_on.load())
+    frequency = core::make_fixnum(1000000000 / global_cpu_profile_period);
+  return core::Values(core::make_fixnum(samples), frequency,
+                      core::make_fixnum(global_cpu_profile_dropped.load(std::memory_order_relaxed)));
+}
+
+// Just enough of the protocol buffer wire format to write a pprof profile
+// (see profile.proto in github.com/google/pprof).
+class ProtoWriter {
+  std::string _Buffer;
+
+public:
+  const std::string& str() const { return this->_Buffer; }
+  void varint(uint64_t value) {
+    while (value >= 0x80) {
+      this->_Buffer.push_back((char)(value | 0x80));
+      value >>= 7;
+    }
+    this->_Buffer.push_back((char)value);
+  }
+  void integer(int field, uint64_t value) {
+    this->varint((uint64_t)field << 3);
+    this->varint(value);
+  }
+  void bytes(int field, const std::string& value) {
+    this->varint(((uint64_t)field << 3) | 2);
+    this->varint(value.size());
+    this->_Buffer += value;
+  }
+  void packed(int field, const std::vector<uint64_t>& values) {
+    ProtoWriter inner;
+    for (uint64_t value : values)
+      inner.varint(value);
+    this->bytes(field, inner.str());
+  }
+};
+
+// pprof tables are numbered from one, strings from zero with "" first.
+struct PprofIndex {
+  std::unordered_map<std::string, uint64_t> _Strings;
+  std::vector<std::string> _StringTable;
+  std::unordered_map<std::string, uint64_t> _Functions;
+  std::unordered_map<uintptr_t, uint64_t> _Locations;
+  ProtoWriter _FunctionsOut;
+  ProtoWriter _LocationsOut;
+  PprofIndex() { this->string(""); }
+  uint64_t string(const std::string& value) {
+    auto found = this->_Strings.find(value);
+    if (found != this->_Strings.end())
+      return found->second;
+    uint64_t index = this->_StringTable.size();
+    this->_StringTable.push_back(value);
+    this->_Strings.emplace(value, index);
+    return index;
+  }
+  uint64_t function(const std::string& name) {
+    auto found = this->_Functions.find(name);
+    if (found != this->_Functions.end())
+      return found->second;
+    uint64_t id = this->_Functions.size() + 1;
+    this->_Functions.emplace(name, id);
+    ProtoWriter function;
+    function.integer(1, id);                   // id
+    function.integer(2, this->string(name));   // name
+    function.integer(3, this->string(name));   // system_name
+    this->_FunctionsOut.bytes(5, function.str());
+    return id;
+  }
+  uint64_t location(uintptr_t address, const std::string& name) {
+    auto found = this->_Locations.find(address);
+    if (found != this->_Locations.end())
+      return found->second;
+    uint64_t id = this->_Locations.size() + 1;
+    this->_Locations.emplace(address, id);
+    ProtoWriter line;
+    line.integer(1, this->function(name)); // function_id
+    ProtoWriter location;
+    location.integer(1, id);      // id
+    location.integer(3, address); // address
+    location.bytes(4, line.str()); // line
+    this->_LocationsOut.bytes(4, location.str());
+    return id;
+  }
+};
+
+static std::string pprof_value_type(PprofIndex& index, const char* type, const char* unit) {
+  ProtoWriter value_type;
+  value_type.integer(1, index.string(type));
+  value_type.integer(2, index.string(unit));
+  return value_type.str();
+}
+
+SYMBOL_EXPORT_SC_(KeywordPkg, folded);
+SYMBOL_EXPORT_SC_(KeywordPkg, pprof);
+
+CL_LAMBDA(pathname &key (format :folded));
+CL_DOCSTRING(R"dx(Write the CPU profile to the file at PATHNAME. If FORMAT is :FOLDED, write
+folded stacks, one line per distinct backtrace, outermost frame first,
+followed by the number of periods of CPU time spent there; flamegraph.pl and
+speedscope read this format. If FORMAT is :PPROF, write an uncompressed pprof
+profile with the sample counts and CPU time of every backtrace, named so that
+pprof doesn't have to symbolize it. The file is written under a temporary
+name and renamed. Returns the number of distinct backtraces written.)dx");
+DOCGROUP(clasp);
+CL_DEFUN size_t gctools__cpu_profile_write(core::T_sp pathname, core::Symbol_sp format) {
+  if (format != kw::_sym_folded && format != kw::_sym_pprof)
+    TYPE_ERROR(format, core::Cons_O::createList(cl::_sym_member, kw::_sym_folded, kw::_sym_pprof));
+  core::Pathname_sp physical = core::cl__translate_logical_pathname(pathname);
+  std::string filename = gc::As<core::String_sp>(core::cl__namestring(physical))->get_std_string();
+  CpuProfileTable profile;
+  int64_t duration;
+  std::chrono::system_clock::time_point first_start;
+  {
+    // Copy the table so that the sampler can keep going while we symbolize
+    std::lock_guard<std::mutex> lock(global_cpu_profile_mutex);
+    profile = global_cpu_profile;
+    duration = global_cpu_profile_duration;
+    if (global_cpu_profile_on.load())
+      duration +=
+          std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - global_cpu_profile_started).count();
+    first_start = global_cpu_profile_first_start;
+  }
+  int64_t period = global_cpu_profile_period ? global_cpu_profile_period : 10000000;
+  std::string temporary = filename + ".tmp";
+  FILE* fout = fopen(temporary.c_str(), "w");
+  if (!fout)
+    SIMPLE_ERROR("Could not open {} for writing the CPU profile: {}", temporary, strerror(errno));
+  ProfileSymbolizer symbolizer;
+  PprofIndex index;
+  ProtoWriter samples;
+  size_t written = 0;
+  for (auto& it : profile) {
+    const std::vector<uintptr_t>& key = it.first;
+    size_t num_native = key[0];
+    const uintptr_t* native = &key[1];
+    const uintptr_t* bytecode = &key[1 + num_native];
+    size_t num_bytecode = key.size() - 1 - num_native;
+    std::vector<std::string> frames; // innermost first
+    std::vector<uintptr_t> addresses;
+    symbolizer.frames(native, num_native, bytecode, num_bytecode, frames, &addresses);
+    if (format == kw::_sym_folded) {
+      std::string line;
+      for (auto frame = frames.rbegin(); frame != frames.rend(); ++frame) {
+        if (line.size())
+          line += ';';
+        line += profile_clean_name(*frame);
+      }
+      fprintf(fout, "%s %zu\n", line.c_str(), it.second._Periods);
+    } else {
+      std::vector<uint64_t> location_ids;
+      for (size_t i = 0; i < frames.size(); ++i)
+        location_ids.push_back(index.location(addresses[i], frames[i]));
+      ProtoWriter sample;
+      sample.packed(1, location_ids); // location_id, leaf first
+      sample.packed(2, {it.second._Samples, it.second._Periods * (uint64_t)period}); // value
+      samples.bytes(2, sample.str());
+    }
+    written++;
+  }
+  if (format == kw::_sym_pprof) {
+    ProtoWriter out;
+    out.bytes(1, pprof_value_type(index, "samples", "count")); // sample_type
+    out.bytes(1, pprof_value_type(index, "cpu", "nanoseconds"));
+    std::string period_type = pprof_value_type(index, "cpu", "nanoseconds");
+    std::string body = out.str() + samples.str() + index._LocationsOut.str() + index._FunctionsOut.str();
+    ProtoWriter tail;
+    for (auto& string : index._StringTable)
+      tail.bytes(6, string); // string_table
+    tail.integer(9, std::chrono::duration_cast<std::chrono::nanoseconds>(first_start.time_since_epoch()).count()); // time_nanos
+    tail.integer(10, duration); // duration_nanos
+    tail.bytes(11, period_type);
+    tail.integer(12, period); // period
+    body += tail.str();
+    fwrite(body.data(), 1, body.size(), fout);
+  }
+  fclose(fout);
+  if (rename(temporary.c_str(), filename.c_str()) != 0)
+    SIMPLE_ERROR("Could not rename {} to {}: {}", temporary, filename, strerror(errno));
+  return written;
+}
+
+}; // namespace gctools
@@ -17,6 +17,8 @@
            #~"gc_boot.cc"
            #~"interrupt.cc"
            #~"gcFunctions.cc"
+           #~"heapProfiler.cc"
+           #~"cpuProfiler.cc"
            #~"snapshotSaveLoad.cc"
            #~"gctoolsPackage.cc"
            #~"globals.cc"
@@ -868,6 +868,7 @@ void dumpBoehmLayoutTables(std::ostream& fout) {
   Init_class_kind(core::CxxObject_O);
   Init_class_kind(llvmo::MDBuilder_O);
   Init_class_kind(mp::ConditionVariable_O);
+  Init_class_kind(mp::ConcurrentQueue_O);
   Init_class_kind(core::NativeVector_int_O);
   Init_class_kind(llvmo::FunctionCallee_O);
   Init_class_kind(llvmo::DINodeArray_O);
@@ -1107,6 +1108,7 @@ void dumpBoehmLayoutTables(std::ostream& fout) {
   Init_class_kind(core::ConcatenatedStream_O);
   Init_class_kind(core::FileStream_O);
   Init_class_kind(core::PosixFileStream_O);
+  Init_class_kind(core::MmapFileStream_O);
   Init_class_kind(core::CFileStream_O);
   Init_class_kind(core::BroadcastStream_O);
   Init_class_kind(core::StringStream_O);
@@ -36,6 +36,8 @@ THE SOFTWARE.
 #include <clasp/gctools/gcweak.h>
 #include <clasp/core/object.h>
 #include <clasp/core/evaluator.h>
+#include <clasp/core/array.h>
+#include <clasp/core/hashTable.h>
 #include <clasp/core/mpPackage.h>
 #ifdef USE_MPS
 #include <clasp/mps/code/mps.h>
@@ -62,10 +64,16 @@ struct WeakKeyHashTableWriteLock {
   WeakKeyHashTableWriteLock(const WeakKeyHashTable* ht, bool upgrade = false) : _hashTable(ht) {
     if (this->_hashTable->_Mutex) {
       this->_hashTable->_Mutex->write_lock(upgrade);
+      // Make the sequence odd before touching the buckets so that lock-free readers retry
+      size_t seq = this->_hashTable->_Sequence.load(std::memory_order_relaxed);
+      this->_hashTable->_Sequence.store(seq + 1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
     }
   }
   ~WeakKeyHashTableWriteLock() {
     if (this->_hashTable->_Mutex) {
+      size_t seq = this->_hashTable->_Sequence.load(std::memory_order_relaxed);
+      this->_hashTable->_Sequence.store(seq + 1, std::memory_order_release);
       this->_hashTable->_Mutex->write_unlock();
     }
   }
@@ -82,6 +90,39 @@ struct WeakKeyHashTableWriteLock {
 #define HT_UPGRADE_WRITE_LOCK(me)
 #endif
 
+// How many times gethash tries to read without the lock before it takes it
+#define WEAK_HASH_TABLE_OPTIMISTIC_READS 8
+
+/*! Fixnum 0 is the NULL pointer, which is also what Boehm leaves behind when it
+    splats a disappearing link - so buckets hold it as the no-key marker instead. */
+static inline WeakKeyHashTable::value_type weak_bucket_encode(core::T_sp obj) {
+  if (obj.raw_() == NULL)
+    return WeakKeyHashTable::value_type(gctools::make_tagged_no_key<core::T_O>());
+  return WeakKeyHashTable::value_type(obj);
+}
+
+static inline core::T_sp weak_bucket_decode(const WeakKeyHashTable::value_type& bucket) {
+  if (bucket.no_keyp())
+    return core::make_fixnum(0);
+  return core::T_sp(bucket);
+}
+
+/*! Return true if bucket idx holds an entry that is still alive and decode it.
+    An entry is dead once the collector has splatted its key or its value. */
+static inline bool weak_live_entry(gctools::tagged_pointer<WeakKeyHashTable::KeyBucketsType> keys,
+                                   gctools::tagged_pointer<WeakKeyHashTable::ValueBucketsType> values, size_t idx,
+                                   core::T_sp& key, core::T_sp& value) {
+  WeakKeyHashTable::value_type k = (*keys)[idx];
+  if (!k.raw_() || k.unboundp() || k.deletedp())
+    return false;
+  WeakKeyHashTable::value_type v = (*values)[idx];
+  if (!v.raw_())
+    return false;
+  key = weak_bucket_decode(k);
+  value = v.same_as_keyP() ? key : weak_bucket_decode(v);
+  return true;
+}
+
 void WeakKeyHashTable::initialize() {
   int length = this->_Length;
   /* round up to next power of 2 */
@@ -90,8 +131,14 @@ void WeakKeyHashTable::initialize() {
   size_t l;
   for (l = 1; l < length; l *= 2)
     ;
-  this->_Keys = KeyBucketsAllocatorType::allocate(Header_s::BadgeStampWtagMtag(Header_s::WeakBucketKind), l);
-  this->_Values = ValueBucketsAllocatorType::allocate(Header_s::BadgeStampWtagMtag(Header_s::StrongBucketKind), l);
+  if (this->weakKeysp())
+    this->_Keys = WeakBucketsAllocatorType::allocate(Header_s::BadgeStampWtagMtag(Header_s::WeakBucketKind), l);
+  else
+    this->_Keys = StrongBucketsAllocatorType::allocate(Header_s::BadgeStampWtagMtag(Header_s::StrongBucketKind), l);
+  if (this->weakValuesp())
+    this->_Values = WeakBucketsAllocatorType::allocate(Header_s::BadgeStampWtagMtag(Header_s::WeakBucketKind), l);
+  else
+    this->_Values = StrongBucketsAllocatorType::allocate(Header_s::BadgeStampWtagMtag(Header_s::StrongBucketKind), l);
   this->_Keys->dependent = this->_Values;
   //  GCTOOLS_ASSERT((reinterpret_cast<uintptr_t>(this->_Keys->dependent) & 0x3) == 0);
   this->_Values->dependent = this->_Keys;
@@ -105,226 +152,229 @@ void WeakKeyHashTable::setupThreadSafeHashTable() {
 #endif
 }
 
-uint WeakKeyHashTable::sxhashKey(const value_type& key) {
-  GCWEAK_LOG(fmt::format("Calling lisp_hash for key: {}", (void*)lisp_badge(key)));
-  return core::lisp_hash(static_cast<uintptr_t>(gctools::lisp_badge(key)));
+uint64_t WeakKeyHashTable::sxhashKey(core::T_sp key) const {
+  core::HashGenerator hg;
+  switch (this->_Test) {
+  case WeakHashTableTest::eq:
+    core::HashTable_O::sxhash_eq(hg, key);
+    break;
+  case WeakHashTableTest::eql:
+    core::HashTable_O::sxhash_eql(hg, key);
+    break;
+  case WeakHashTableTest::equal:
+    core::HashTable_O::sxhash_equal(hg, key);
+    break;
+  case WeakHashTableTest::equalp:
+    core::HashTable_O::sxhash_equalp(hg, key);
+    break;
+  }
+  return hg.rawhash();
 }
 
-/*! Return 0 if there is no more room in the sequence of entries for the key
-          Return 1 if the element is found or an unbound or deleted entry is found.
-          Return the entry index in (b)
-        */
-size_t WeakKeyHashTable::find_no_lock(gctools::tagged_pointer<KeyBucketsType> keys, const value_type& key, size_t& b
-#ifdef DEBUG_FIND
-                                      ,
-                                      bool debugFind, stringstream* reportP
-#endif
-) {
-  unsigned long i, h, probe;
-  unsigned long l = keys->length() - 1;
-  int result = 0;
-  h = WeakKeyHashTable::sxhashKey(key);
-
-#ifdef DEBUG_FIND
-  if (debugFind) {
-    *reportP << __FILE__ << ":" << __LINE__ << " starting find key = " << (void*)(key.raw_()) << " h = " << h << " l = " << l
-             << std::endl;
+bool WeakKeyHashTable::keyTest(core::T_sp entryKey, core::T_sp searchKey) const {
+  if (entryKey == searchKey)
+    return true;
+  switch (this->_Test) {
+  case WeakHashTableTest::eq:
+    return false;
+  case WeakHashTableTest::eql:
+    return core::cl__eql(entryKey, searchKey);
+  case WeakHashTableTest::equal:
+    return core::cl__equal(entryKey, searchKey);
+  case WeakHashTableTest::equalp:
+    return core::cl__equalp(entryKey, searchKey);
   }
-#endif
-  probe = (h >> 8) | 1;
-  h &= l;
-  i = h;
-  do {
-    value_type& k = (*keys)[i];
-#ifdef DEBUG_FIND
-    if (debugFind) {
-      *reportP << "  i = " << i << "   k = " << (void*)(k.raw_()) << std::endl;
-    }
-#endif
-    if (k.unboundp() || k == key) {
+  return false;
+}
+
+/*! The buckets are only read under safeRun, but EQUAL and EQUALP may allocate and
+    so must not run there. For those tests each candidate key is copied out to the
+    stack, which keeps it alive, and compared once safeRun has returned; the walk
+    then picks up again at the next bucket. The caller's table lock keeps writers
+    out in between, so only the collector can change the buckets meanwhile. */
+size_t WeakKeyHashTable::find_no_lock(gctools::tagged_pointer<KeyBucketsType> keys,
+                                      gctools::tagged_pointer<ValueBucketsType> values, core::T_sp key, uint64_t hash,
+                                      size_t& b, bool reclaim) const {
+  bool compareOutside = this->_Test == WeakHashTableTest::equal || this->_Test == WeakHashTableTest::equalp;
+  size_t l = keys->length() - 1;
+  size_t probe = (hash >> 8) | 1;
+  size_t h = hash & l;
+  size_t i = h;
+  size_t result = 0;
+  bool candidate;
+  core::T_sp entryKey;
+  while (true) {
+    candidate = false;
+    safeRun<void()>([this, keys, values, key, reclaim, compareOutside, l, probe, h, &i, &b, &result, &candidate,
+                     &entryKey]() -> void {
+      do {
+        value_type& k = (*keys)[i];
+        if (k.unboundp()) {
+          // Reuse the first deleted entry we passed, if any
+          if (!result)
+            b = i;
+          result = 1;
+          return;
+        }
+        if (!k.deletedp()) {
+          if (k.raw_() && (*values)[i].raw_()) {
+            entryKey = weak_bucket_decode(k);
+            if (entryKey == key || (!compareOutside && this->keyTest(entryKey, key))) {
+              b = i;
+              result = 1;
+              return;
+            }
+            if (compareOutside) {
+              candidate = true;
+              return;
+            }
+          } else if (reclaim) {
+            // The collector splatted the key or the value - the entry is dead
+            keys->set(i, value_type(gctools::make_tagged_deleted<core::T_O*>()));
+            values->set(i, value_type(gctools::make_tagged_unbound<core::T_O*>()));
+            keys->setDeleted(keys->deleted() + 1);
+          }
+        }
+        if (result == 0 && (k.deletedp())) {
+          b = i;
+          result = 1;
+        }
+        i = (i + probe) & l;
+      } while (i != h);
+    });
+    if (!candidate)
+      return result;
+    if (this->keyTest(entryKey, key)) {
       b = i;
-#ifdef DEBUG_FIND
-      if (debugFind && k != key) {
-        *reportP << "find  returning 1 b= " << b << " k = " << k.raw_() << std::endl;
-      }
-#endif
       return 1;
     }
-#if defined(USE_BOEHM)
-    // Handle splatting
-    if (!k.raw_()) {
-      auto deleted = value_type(gctools::make_tagged_deleted<core::T_O*>());
-      keys->set(i, deleted);
-      ValueBucketsType* values = dynamic_cast<ValueBucketsType*>(&*keys->dependent);
-      (*values)[i] = value_type(gctools::make_tagged_unbound<core::T_O*>());
-    }
+    i = (i + probe) & l;
+    if (i == h)
+      return result;
+  }
+}
+
+/*! Only threaded builds have a _Mutex, and there safeRun takes no lock, so this
+    costs a strong table's optimistic read. The collector stops the world to splat
+    disappearing links, so every bucket load sees either the object - which the
+    stack copy then keeps alive - or the splat, and the sequence catches writers. */
+bool WeakKeyHashTable::gethash_optimistic(core::T_sp key, uint64_t hash, core::T_sp& value, bool& found) const {
+#ifdef CLASP_THREADS
+  size_t seq = this->_Sequence.load(std::memory_order_acquire);
+  if (seq & 1)
+    return false;
+  gctools::tagged_pointer<KeyBucketsType> keys = this->_Keys;
+  gctools::tagged_pointer<ValueBucketsType> values = this->_Values;
+  // A rehash may have swapped one set of buckets but not the other yet
+  if (keys->length() != values->length())
+    return false;
+  size_t b;
+  found = false;
+  if (this->find_no_lock(keys, values, key, hash, b, false)) {
+    safeRun<void()>([keys, values, b, &value, &found]() -> void {
+      core::T_sp entryKey;
+      found = weak_live_entry(keys, values, b, entryKey, value);
+    });
+  }
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return this->_Sequence.load(std::memory_order_relaxed) == seq;
 #else
-    MISSING_GC_SUPPORT();
+  return false;
 #endif
-    if (result == 0 && (k.deletedp())) {
-      b = i;
-      result = 1;
-    }
-    i = (i + probe) & l;
-  } while (i != h);
-  return result;
 }
-int WeakKeyHashTable::rehash_not_safe(const value_type& key, size_t& key_bucket) {
+
+/*! Build bigger (or compacted) buckets and swap them in. The live entries are
+    copied into a strong vector under safeRun - that keeps their keys alive while
+    the new buckets are allocated and the keys are hashed, neither of which may
+    happen under the allocation lock. The write lock is held throughout so that
+    no entry is lost between the copy and the swap. */
+void WeakKeyHashTable::rehash() {
   HT_WRITE_LOCK(this);
-  size_t newLength;
-  if (this->_RehashSize.fixnump()) {
-    newLength = this->_Keys->length() + this->_RehashSize.unsafe_fixnum();
-  } else if (gc::IsA<core::Float_sp>(this->_RehashSize)) {
-    double size = core::clasp_to_double(this->_RehashSize);
-    newLength = this->_Keys->length() * size;
-  } else {
-    SIMPLE_ERROR("Illegal rehash size {}", _rep_(this->_RehashSize));
+  size_t length = this->_Keys->length();
+  core::SimpleVector_sp entries = core::SimpleVector_O::make(2 * length);
+  size_t live = 0;
+  safeRun<void()>([this, length, entries, &live]() -> void {
+    core::T_sp key, value;
+    for (size_t i = 0; i < length; ++i) {
+      if (weak_live_entry(this->_Keys, this->_Values, i, key, value)) {
+        (*entries)[2 * live] = key;
+        (*entries)[2 * live + 1] = value;
+        ++live;
+      }
+    }
+  });
+  // If the collector emptied out most of the table just compact it in place
+  size_t newLength = length;
+  if (live >= this->_RehashThreshold * length / 2) {
+    if (this->_RehashSize.fixnump()) {
+      newLength = length + this->_RehashSize.unsafe_fixnum();
+    } else if (gc::IsA<core::Float_sp>(this->_RehashSize)) {
+      double size = core::clasp_to_double(this->_RehashSize);
+      newLength = length * size;
+    } else {
+      SIMPLE_ERROR("Illegal rehash size {}", _rep_(this->_RehashSize));
+    }
   }
-  int result;
   GCWEAK_LOG(fmt::format("entered rehash newLength = {}", newLength));
-  size_t i, length;
-  // buckets_t new_keys, new_values;
-  result = 0;
-  length = this->_Keys->length();
-  MyType newHashTable(newLength, this->_RehashSize, this->_RehashThreshold);
+  MyType newHashTable(newLength, this->_RehashSize, this->_RehashThreshold, this->_Test, this->_Weakness);
   newHashTable.initialize();
-  // new_keys = make_buckets(newLength, this->key_ap);
-  // new_values = make_buckets(newLength, this->value_ap);
-  // new_keys->dependent = new_values;
-  // new_values->dependent = new_keys;
-  for (i = 0; i < length; ++i) {
-    value_type& old_key = (*this->_Keys)[i];
-    if (!old_key.unboundp() && !old_key.deletedp() && old_key.raw_()) {
-      size_t found;
-      size_t b;
-      found = WeakKeyHashTable::find_no_lock(newHashTable._Keys, old_key, b);
-      GCTOOLS_ASSERT(found); // assert(found);            /* new table shouldn't be full */
-      if (!(*newHashTable._Keys)[b].unboundp()) {
-        printf("%s:%d About to copy key: %12p   at index %zu    to newHashTable at index: %zu\n", __FILE__, __LINE__,
-               old_key.raw_(), i, b);
-        printf("Key = %s\n", core::lisp_rep(old_key).c_str());
-        printf("    original value@%p = %s\n", (*this->_Values)[i].raw_(), core::lisp_rep((*this->_Values)[i]).c_str());
-        printf("newHashTable value@%p = %s\n", (*newHashTable._Values)[b].raw_(),
-               core::lisp_rep((*newHashTable._Values)[b]).c_str());
-        printf("--------- Original table\n");
-        printf("%s\n", this->dump("Original").c_str());
-        printf("--------- New table\n");
-        printf("%s\n", newHashTable.dump("Copy").c_str());
-      }
-      GCTOOLS_ASSERT((*newHashTable._Keys)[b].unboundp()); /* shouldn't be in new table */
-      newHashTable._Keys->set(b, old_key);
-      (*newHashTable._Values)[b] = (*this->_Values)[i];
-      if (key && old_key == key) {
-        key_bucket = b;
-        result = 1;
-      }
-      (*newHashTable._Keys).setUsed((*newHashTable._Keys).used() + 1); // TAG_COUNT(UNTAG_COUNT(new_keys->used) + 1);
-    }
+  size_t l = newHashTable._Keys->length() - 1;
+  for (size_t j = 0; j < live; ++j) {
+    core::T_sp key = (*entries)[2 * j];
+    core::T_sp value = (*entries)[2 * j + 1];
+    uint64_t hash = this->sxhashKey(key);
+    size_t probe = (hash >> 8) | 1;
+    size_t b = hash & l;
+    // Keys are unique so the first empty bucket is the one
+    while (!(*newHashTable._Keys)[b].unboundp())
+      b = (b + probe) & l;
+    newHashTable._Keys->set(b, weak_bucket_encode(key));
+    if (key == value)
+      newHashTable._Values->set(b, value_type(gctools::make_tagged_same_as_key<core::T_O>()));
+    else
+      newHashTable._Values->set(b, weak_bucket_encode(value));
+    (*newHashTable._Keys).setUsed((*newHashTable._Keys).used() + 1);
   }
-  GCTOOLS_ASSERT((*newHashTable._Keys).used() == (newHashTable.tableSize()));
-  // assert(UNTAG_COUNT(new_keys->used) == table_size(tbl));
-  this->swap(newHashTable);
-  return result;
-}
-
-int WeakKeyHashTable::rehash(const value_type& key, size_t& key_bucket) {
-  int result;
-  safeRun<void()>([&result, this, &key, &key_bucket]() -> void { result = this->rehash_not_safe(key, key_bucket); });
-  return result;
+  safeRun<void()>([this, &newHashTable]() -> void { this->swap(newHashTable); });
 }
 
-/*! trySet returns 0 only if there is no room in the hash-table */
-int WeakKeyHashTable::trySet(core::T_sp tkey, core::T_sp value) {
-  HT_WRITE_LOCK(this);
+/*! trySet returns 0 only if there is no room in the hash-table.
+    The caller holds the write lock. */
+int WeakKeyHashTable::trySet(core::T_sp tkey, core::T_sp value, uint64_t hash) {
   GCWEAK_LOG(fmt::format("Entered trySet with key {}", tkey.raw_()));
   size_t b;
-  if (tkey == value) {
-    value = gctools::make_tagged_same_as_key<core::T_O>();
-  }
-  value_type key(tkey);
-#ifdef DEBUG_TRYSET
-  stringstream report;
-  report << "About to trySet with the key " << tkey.raw_() << std::endl;
-  report << this->dump("trySet-incoming WeakKeyHashTable: ") << std::endl;
-  // Count the number of times the key is in the table
-  int alreadyThere = 0;
-  int firstOtherIndex = 0;
-  for (int i(0); i < (*this->_Keys).length(); ++i) {
-    if ((*this->_Keys)[i] == tkey) {
-      firstOtherIndex = i;
-      ++alreadyThere;
+  if (!this->find_no_lock(this->_Keys, this->_Values, tkey, hash, b, true))
+    return 0;
+  safeRun<void()>([this, tkey, value, b]() -> void {
+    if ((*this->_Keys)[b].unboundp()) {
+      GCWEAK_LOG(fmt::format("Writing key over unbound entry"));
+      this->_Keys->set(b, weak_bucket_encode(tkey));
+      (*this->_Keys).setUsed((*this->_Keys).used() + 1);
+    } else if ((*this->_Keys)[b].deletedp()) {
+      GCWEAK_LOG(fmt::format("Writing key over deleted entry"));
+      this->_Keys->set(b, weak_bucket_encode(tkey));
+      GCTOOLS_ASSERT((*this->_Keys).deleted() > 0);
+      (*this->_Keys).setDeleted((*this->_Keys).deleted() - 1);
+    } else if (!(*this->_Keys)[b].raw_()) {
+      // The EQUAL key we matched was collected after find_no_lock let go of it
+      this->_Keys->set(b, weak_bucket_encode(tkey));
     }
-  }
-#endif
-  size_t result = WeakKeyHashTable::find_no_lock(this->_Keys, key, b);
-  if ((!result || (*this->_Keys)[b] != key)) {
-    GCWEAK_LOG(fmt::format("then case - Returned from find with result = {}     (*this->_Keys)[b={}] = {}", result, b,
-                           (*this->_Keys)[b].raw_()));
-#ifdef DEBUG_TRYSET
-    if (alreadyThere) {
-      report << "Could not find the key @" << key.raw_() << std::endl;
-      if (!result) {
-        report << " because find return result = " << result
-               << " - which means that the hash table was searched and the key was not found before the hash list was exhausted"
-               << std::endl;
-      }
-      if ((*this->_Keys)[b] != key) {
-        report << " because find hit an empty (unbound or deleted) slot before it found the key" << std::endl;
-      }
-      report << " ...  about to check if mps_ld_isstale" << std::endl;
-    }
-#endif
-
-  } else {
-    GCWEAK_LOG(fmt::format("else case - Returned from find with result = {}     (*this->_Keys)[b={}] = {}", result, b,
-                           (*this->_Keys)[b].raw_()));
-    GCWEAK_LOG(fmt::format("Calling mps_ld_add for key: {}", (void*)key.raw_()));
-  }
-  if ((*this->_Keys)[b].unboundp()) {
-    GCWEAK_LOG(fmt::format("Writing key over unbound entry"));
-    this->_Keys->set(b, key);
-    (*this->_Keys).setUsed((*this->_Keys).used() + 1);
-#ifdef DEBUG_GCWEAK
-    printf("%s:%d key was unboundp at %zu  used = %d\n", __FILE__, __LINE__, b, this->_Keys->used());
-#endif
-  } else if ((*this->_Keys)[b].deletedp()) {
-    GCWEAK_LOG(fmt::format("Writing key over deleted entry"));
-    this->_Keys->set(b, key);
-    GCTOOLS_ASSERT((*this->_Keys).deleted() > 0);
-    (*this->_Keys).setDeleted((*this->_Keys).deleted() - 1);
-#ifdef DEBUG_GCWEAK
-    printf("%s:%d key was deletedp at %zu  deleted = %d\n", __FILE__, __LINE__, b, (*this->_Keys).deleted());
-#endif // DEBUG_GCWEAK
-  }
-  GCWEAK_LOG(fmt::format("Setting value at b = {}", b));
-  (*this->_Values).set(b, value_type(value));
-#ifdef DEBUG_TRYSET
-  // Count the number of times the key is in the table
-  int count = 0;
-  int otherIndex;
-  for (int i(0); i < (*this->_Keys).length(); ++i) {
-    if ((*this->_Keys)[i] == tkey) {
-      if (i != b) {
-        otherIndex = i;
-      }
-      ++count;
+    GCWEAK_LOG(fmt::format("Setting value at b = {}", b));
+    // A value that is the key itself must not keep the key alive
+    if (weak_bucket_decode((*this->_Keys)[b]) == value) {
+      this->_Values->set(b, value_type(gctools::make_tagged_same_as_key<core::T_O>()));
+    } else {
+      this->_Values->set(b, weak_bucket_encode(value));
     }
-  }
-  if (count > 1) {
-    printf("Found %d duplicate keys %p in hash table\n", count, tkey.raw_());
-    printf("Log of trySet action:\n%s\n", report.str().c_str());
-    printf("The new key is at %zu and another instance of the key is at %d\n", b, otherIndex);
-    printf("%s\n", this->dump("Final trySet table").c_str());
-  }
-#endif
+  });
   GCWEAK_LOG(fmt::format("Leaving trySet"));
   return 1;
 }
 
 string WeakKeyHashTable::dump(const string& prefix) {
   stringstream sout;
+  HT_READ_LOCK(this);
   safeRun<void()>([this, &prefix, &sout]() -> void {
-    HT_READ_LOCK(this);
     size_t i, length;
     length = this->_Keys->length();
     sout << "===== Dumping WeakKeyHashTable length = " << length << std::endl;
@@ -347,44 +397,54 @@ string WeakKeyHashTable::dump(const string& prefix) {
 // ----------------------------------------------------------------------
 
 core::T_mv WeakKeyHashTable::gethash(core::T_sp tkey, core::T_sp defaultValue) {
-  core::T_mv result_mv;
-  safeRun<void()>([&result_mv, this, tkey, defaultValue]() -> void {
-    HT_READ_LOCK(this);
-    value_type key(tkey);
-    size_t pos;
-    size_t result = gctools::WeakKeyHashTable::find_no_lock(this->_Keys, key, pos);
-    if (result) { // WeakKeyHashTable::find(this->_Keys,key,false,pos)) { //buckets_find(tbl, this->keys, key, NULL, &b)) {
-      value_type& k = (*this->_Keys)[pos];
-      GCWEAK_LOG(fmt::format("gethash find successful pos = {}  k= {} k.unboundp()={} k.base_ref().deletedp()={} k.NULLp()={}", pos,
-                             k.raw_(), k.unboundp(), k.deletedp(), (bool)k));
-      if (k.raw_() && !k.unboundp() && !k.deletedp()) {
-        GCWEAK_LOG(fmt::format("Returning success!"));
-        core::T_sp value = smart_ptr<core::T_O>((*this->_Values)[pos]);
-        if (value.same_as_keyP()) {
-          value = smart_ptr<core::T_O>(k);
-        }
-        result_mv = Values(value, core::lisp_true());
-        return;
+  // Hash outside of safeRun - hashing may allocate
+  uint64_t hash = this->sxhashKey(tkey);
+#ifdef CLASP_THREADS
+  if (this->_Mutex) {
+    core::T_sp value;
+    bool found;
+    for (size_t tries = 0; tries < WEAK_HASH_TABLE_OPTIMISTIC_READS; ++tries) {
+      if (this->gethash_optimistic(tkey, hash, value, found)) {
+        if (found)
+          return Values(value, core::lisp_true());
+        return Values(defaultValue, nil<core::T_O>());
       }
-      GCWEAK_LOG(fmt::format("Falling through"));
     }
-    result_mv = Values(defaultValue, nil<core::T_O>());
-    return;
-  });
-  return result_mv;
+  }
+#endif
+  HT_READ_LOCK(this);
+  size_t pos;
+  core::T_sp key, value;
+  bool found = false;
+  if (this->find_no_lock(this->_Keys, this->_Values, tkey, hash, pos, false)) {
+    safeRun<void()>([this, pos, &key, &value, &found]() -> void {
+      found = weak_live_entry(this->_Keys, this->_Values, pos, key, value);
+    });
+  }
+  if (found) {
+    GCWEAK_LOG(fmt::format("Returning success!"));
+    return Values(value, core::lisp_true());
+  }
+  return Values(defaultValue, nil<core::T_O>());
 }
 
 void WeakKeyHashTable::set(core::T_sp key, core::T_sp value) {
-  safeRun<void()>([key, value, this]() -> void {
-    if (this->fullp_not_safe() || !this->trySet(key, value)) {
-      int res;
-      value_type dummyKey;
-      size_t dummyPos;
-      this->rehash(dummyKey, dummyPos);
-      res = this->trySet(key, value);
-      GCTOOLS_ASSERT(res);
-    }
-  });
+  uint64_t hash = this->sxhashKey(key);
+  {
+    HT_WRITE_LOCK(this);
+    bool full;
+    safeRun<void()>([this, &full]() -> void { full = this->fullp_not_safe(); });
+    if (!full && this->trySet(key, value, hash))
+      return;
+  }
+  // rehash allocates so it runs outside of safeRun - and another thread may
+  // fill the new buckets before we get the write lock back, so go around until it fits
+  while (true) {
+    this->rehash();
+    HT_WRITE_LOCK(this);
+    if (this->trySet(key, value, hash))
+      return;
+  }
 }
 
 #define HASH_TABLE_ITER(table_type, tablep, key, value)                                                                            \
@@ -398,62 +458,55 @@ void WeakKeyHashTable::set(core::T_sp key, core::T_sp value) {
     iter_Values = tablep->_Values;                                                                                                 \
   }                                                                                                                                \
   for (size_t it(0), itEnd(iter_Keys->length()); it < itEnd; ++it) {                                                               \
+    bool iter_live;                                                                                                                \
     {                                                                                                                              \
       HT_READ_LOCK(tablep);                                                                                                        \
-      key = (*iter_Keys)[it];                                                                                                      \
-      value = (*iter_Values)[it];                                                                                                  \
+      safeRun<void()>([iter_Keys, iter_Values, it, &key, &value, &iter_live]() -> void {                                           \
+        iter_live = weak_live_entry(iter_Keys, iter_Values, it, key, value);                                                       \
+      });                                                                                                                          \
     }                                                                                                                              \
-    if (key.raw_() && !key.unboundp() && !key.deletedp())
+    if (iter_live)
 
 #define HASH_TABLE_ITER_END }
 
+// fn runs outside of safeRun - it can do anything, allocating included
 void WeakKeyHashTable::maphash(std::function<void(core::T_sp, core::T_sp)> const& fn) {
-  safeRun<void()>([fn, this]() -> void {
-    HASH_TABLE_ITER(WeakKeyHashTable, this, key, value) { fn(key, value); }
-    HASH_TABLE_ITER_END;
-  });
+  HASH_TABLE_ITER(WeakKeyHashTable, this, key, value) { fn(key, value); }
+  HASH_TABLE_ITER_END;
 }
 
 void WeakKeyHashTable::maphashFn(core::T_sp fn) {
-  safeRun<void()>([fn, this]() -> void {
-    HASH_TABLE_ITER(WeakKeyHashTable, this, key, value) { core::eval::funcall(fn, key, value); }
-    HASH_TABLE_ITER_END;
-  });
+  HASH_TABLE_ITER(WeakKeyHashTable, this, key, value) { core::eval::funcall(fn, key, value); }
+  HASH_TABLE_ITER_END;
 }
 
 bool WeakKeyHashTable::remhash(core::T_sp tkey) {
+  uint64_t hash = this->sxhashKey(tkey);
   bool bresult = false;
-  safeRun<void()>([this, tkey, &bresult]() -> void {
-    HT_WRITE_LOCK(this);
-    size_t b;
-    value_type key(tkey);
-    size_t result = gctools::WeakKeyHashTable::find_no_lock(this->_Keys, key, b);
-    if (!result || !((*this->_Keys)[b]).raw_() || (*this->_Keys)[b].unboundp() || (*this->_Keys)[b].deletedp()) {
-      if (!this->rehash(key, b)) {
-        bresult = false;
-        return;
-      }
-    }
-    if ((*this->_Keys)[b].raw_() && !(*this->_Keys)[b].unboundp() && !(*this->_Keys)[b].deletedp()) {
+  HT_WRITE_LOCK(this);
+  size_t b;
+  if (!this->find_no_lock(this->_Keys, this->_Values, tkey, hash, b, true))
+    return false;
+  safeRun<void()>([this, b, &bresult]() -> void {
+    core::T_sp key, value;
+    if (weak_live_entry(this->_Keys, this->_Values, b, key, value)) {
       auto deleted = value_type(gctools::make_tagged_deleted<core::T_O*>());
       this->_Keys->set(b, deleted);
       (*this->_Keys).setDeleted((*this->_Keys).deleted() + 1);
-      (*this->_Values)[b] = value_type(gctools::make_tagged_unbound<core::T_O*>());
+      this->_Values->set(b, value_type(gctools::make_tagged_unbound<core::T_O*>()));
       bresult = true;
-      return;
     }
-    bresult = false;
   });
   return bresult;
 }
 
 void WeakKeyHashTable::clrhash() {
+  HT_WRITE_LOCK(this);
   safeRun<void()>([this]() -> void {
-    HT_WRITE_LOCK(this);
     size_t len = (*this->_Keys).length();
     for (size_t i(0); i < len; ++i) {
-      this->_Keys->set(i, value_type(gctools::make_tagged_deleted<core::T_O*>()));
-      (*this->_Values)[i] = value_type(gctools::make_tagged_unbound<core::T_O*>());
+      this->_Keys->set(i, value_type(gctools::make_tagged_unbound<core::T_O*>()));
+      this->_Values->set(i, value_type(gctools::make_tagged_unbound<core::T_O*>()));
     }
     (*this->_Keys).setUsed(0);
     (*this->_Keys).setDeleted(0);
@@ -465,10 +518,11 @@ CL_DEFUN core::Vector_sp weak_key_hash_table_pairs(const gctools::WeakKeyHashTab
   size_t len = (*ht._Keys).length();
   core::ComplexVector_T_sp keyvalues = core::ComplexVector_T_O::make(len * 2, nil<core::T_O>(), core::make_fixnum(0));
   HT_READ_LOCK(&ht);
+  core::T_sp key, value;
   for (size_t i(0); i < len; ++i) {
-    if ((*ht._Keys)[i].raw_() && !(*ht._Keys)[i].unboundp() && !(*ht._Keys)[i].deletedp()) {
-      keyvalues->vectorPushExtend((*ht._Keys)[i], 16);
-      keyvalues->vectorPushExtend((*ht._Values)[i], 16);
+    if (weak_live_entry(ht._Keys, ht._Values, i, key, value)) {
+      keyvalues->vectorPushExtend(key, 16);
+      keyvalues->vectorPushExtend(value, 16);
     }
   }
   return keyvalues;
@@ -0,0 +1,332 @@
+/*
+    File: heapProfiler.cc
+*/
+
+/*
+Copyright (c) 2014, Christian E. Schafmeister
+
+CLASP is free software; you can redistribute it and/or
+modify it under the terms of the GNU Library General Public
+License as published by the Free Software Foundation; either
+version 2 of the License, or (at your option) any later version.
+
+See directory 'clasp/licenses' for full details.
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+/* -^- */
+
+/*
+ * A sampling heap profiler.
+ * Every thread counts down the bytes it allocates (see GlobalAllocationProfiler in
+ * threadlocal.fwd.h) and calls heapProfileSample when the count runs out. While the
+ * profiler is on, the distance to the next sample is drawn from an exponential
+ * distribution with the requested mean interval, so that every byte allocated is
+ * equally likely to be sampled. A sample records the stamp and size of the object
+ * being allocated and the return addresses of the native stack and the bytecode
+ * stack. Nothing is symbolized while sampling - that's left to heap-profile-write,
+ * which writes the samples as folded stacks that flamegraph.pl, speedscope and
+ * similar tools read, weighted by the estimated number of bytes (or objects) each
+ * stack allocated.
+ * When the profiler is off, a thread only looks at it once every few megabytes.
+ */
+
+#include <execinfo.h>
+#include <dlfcn.h>
+#include <stdio.h>
+#include <cmath>
+#include <mutex>
+#include <random>
+#include <unordered_map>
+#include <clasp/core/foundation.h>
+#include <clasp/core/object.h>
+#include <clasp/core/lisp.h>
+#include <clasp/core/array.h>
+#include <clasp/core/function.h>
+#include <clasp/core/bytecode.h>
+#include <clasp/core/pathname.h>
+#include <clasp/core/backtrace.h>
+#include <clasp/llvmo/debugInfoExpose.h>
+#include <clasp/llvmo/code.h>
+#include <clasp/gctools/threadlocal.h>
+#include <clasp/gctools/gctoolsPackage.h>
+#include <clasp/gctools/profiler.h>
+
+namespace gctools {
+
+// How often a thread looks at the profiler while it's off
+static const int64_t HeapProfileRecheckBytes = 4 * 1024 * 1024;
+static const size_t HeapProfileMaxDepth = 128;
+
+std::atomic<size_t> global_heap_profile_interval(0); // zero means off
+std::atomic<size_t> global_heap_profile_depth(32);
+
+struct HeapProfileEntry {
+  size_t _Samples;
+  double _Objects;
+  double _Bytes;
+};
+
+// A key is the stamp, the number of native return addresses, the native return
+// addresses and the bytecode pcs, innermost first.
+typedef std::unordered_map<std::vector<uintptr_t>, HeapProfileEntry, ProfileKeyHash> HeapProfileTable;
+
+std::mutex global_heap_profile_mutex;
+HeapProfileTable global_heap_profile;
+
+static int64_t heap_profile_next_countdown(size_t interval) {
+  thread_local std::minstd_rand engine(std::random_device{}());
+  std::exponential_distribution<double> distribution(1.0 / (double)interval);
+  double next = distribution(engine);
+  return (next < 1.0) ? 1 : (int64_t)next;
+}
+
+size_t profile_bytecode_pcs(uintptr_t* pcs, size_t depth) {
+  if (!my_thread)
+    return 0;
+  core::VirtualMachine& vm = my_thread->_VM;
+  unsigned char* pc = vm._pc;
+  core::T_O** fp = vm._framePointer;
+  size_t num = 0;
+  while (pc && num < depth) {
+    pcs[num++] = (uintptr_t)pc;
+    // Same frame layout that make_bytecode_frame walks in backtrace.cc
+    if (!fp || fp <= vm._stackBottom || fp > vm._stackTop)
+      break;
+    pc = (unsigned char*)(*(fp - 1));
+    fp = (core::T_O**)(*fp);
+  }
+  return num;
+}
+
+void heapProfileSample(stamp_t stamp, size_t size, int64_t& countdown) {
+  size_t interval = global_heap_profile_interval.load(std::memory_order_relaxed);
+  if (interval == 0) {
+    countdown = HeapProfileRecheckBytes;
+    return;
+  }
+  countdown = heap_profile_next_countdown(interval);
+  size_t depth = std::min(global_heap_profile_depth.load(std::memory_order_relaxed), HeapProfileMaxDepth);
+  void* native[HeapProfileMaxDepth + 1];
+  // Skip this frame
+  int num_native = backtrace(native, depth + 1) - 1;
+  if (num_native < 0)
+    num_native = 0;
+  uintptr_t bytecode[HeapProfileMaxDepth];
+  size_t num_bytecode = profile_bytecode_pcs(bytecode, depth);
+  std::vector<uintptr_t> key;
+  key.reserve(2 + num_native + num_bytecode);
+  key.push_back(stamp);
+  key.push_back(num_native);
+  for (int i = 0; i < num_native; ++i)
+    key.push_back((uintptr_t)native[i + 1]);
+  for (size_t i = 0; i < num_bytecode; ++i)
+    key.push_back(bytecode[i]);
+  // An object of SIZE bytes is sampled with probability 1-exp(-SIZE/INTERVAL),
+  // so each sample stands for 1/that many objects like it.
+  double scale = 1.0 / (1.0 - exp(-(double)size / (double)interval));
+  std::lock_guard<std::mutex> lock(global_heap_profile_mutex);
+  HeapProfileEntry& entry = global_heap_profile[key];
+  entry._Samples++;
+  entry._Objects += scale;
+  entry._Bytes += scale * (double)size;
+}
+
+std::string profile_clean_name(const std::string& name) {
+  std::string clean = name;
+  for (char& c : clean)
+    if (c == ';' || c == '\n' || c == '\r')
+      c = '_';
+  return clean;
+}
+
+static std::string profile_bytecode_name(uintptr_t pc) {
+  core::List_sp modules = _lisp->_Roots._AllBytecodeModules.load(std::memory_order_relaxed);
+  for (auto mods : modules) {
+    core::BytecodeModule_sp mod = gc::As_assert<core::BytecodeModule_sp>(oCar(mods));
+    if (core::bytecode_module_contains_address_p(mod, (void*)pc)) {
+      core::T_sp fun = core::bytecode_function_for_pc(mod, (void*)pc);
+      if (gc::IsA<core::BytecodeSimpleFun_sp>(fun))
+        return _rep_(gc::As_unsafe<core::BytecodeSimpleFun_sp>(fun)->functionName());
+    }
+  }
+  return "bytecode";
+}
+
+// Name the function a native return address is in. Lisp functions are named from
+// their object file, like make_lisp_frame does in backtrace.cc; everything else
+// through the dynamic symbol table.
+static std::string profile_native_name(uintptr_t address, bool& bytecode_callp) {
+  bytecode_callp = false;
+  // Back up into the call instruction
+  void* ip = (void*)(address - 1);
+  core::T_sp of = llvmo::only_object_file_for_instruction_pointer(ip);
+  if (of.notnilp()) {
+    llvmo::ObjectFile_sp ofi = gc::As_unsafe<llvmo::ObjectFile_sp>(of);
+    llvmo::SectionedAddress_sp sa = llvmo::object_file_sectioned_address(ip, ofi, false);
+    llvmo::DWARFContext_sp dcontext = llvmo::DWARFContext_O::createDWARFContext(ofi);
+    void* codeStart;
+    void* functionStartAddress;
+    bool XEPp = false;
+    int arityCode;
+    core::T_sp ep = core::dwarf_ep(0, ofi, dcontext, sa, codeStart, functionStartAddress, XEPp, arityCode);
+    core::T_sp fdesc = nil<core::T_O>();
+    if (gc::IsA<core::CoreFun_sp>(ep))
+      fdesc = gc::As_unsafe<core::CoreFun_sp>(ep)->functionDescription();
+    else if (gc::IsA<core::SimpleFun_sp>(ep))
+      fdesc = gc::As_unsafe<core::SimpleFun_sp>(ep)->functionDescription();
+    if (gc::IsA<core::FunctionDescription_sp>(fdesc))
+      return _rep_(gc::As_unsafe<core::FunctionDescription_sp>(fdesc)->functionName());
+  }
+  Dl_info info;
+  if (dladdr(ip, &info) && info.dli_sname) {
+    std::string linkname(info.dli_sname);
+    if (linkname == "bytecode_call")
+      bytecode_callp = true;
+    std::string name;
+    if (core::maybe_demangle(linkname, name))
+      return name;
+    return linkname;
+  }
+  char buffer[32];
+  snprintf(buffer, sizeof(buffer), "%p", ip);
+  return buffer;
+}
+
+void ProfileSymbolizer::frames(const uintptr_t* native, size_t num_native, const uintptr_t* bytecode, size_t num_bytecode,
+                               std::vector<std::string>& frames, std::vector<uintptr_t>* addresses) {
+  size_t next_bytecode = 0;
+  for (size_t i = 0; i < num_native; ++i) {
+    auto found = this->_NativeNames.find(native[i]);
+    if (found == this->_NativeNames.end()) {
+      bool bytecode_callp;
+      std::string name = profile_native_name(native[i], bytecode_callp);
+      found = this->_NativeNames.emplace(native[i], std::make_pair(name, bytecode_callp)).first;
+    }
+    // Each bytecode_call frame is running the next bytecode function on the VM stack
+    if (found->second.second && next_bytecode < num_bytecode) {
+      uintptr_t pc = bytecode[next_bytecode++];
+      auto bfound = this->_BytecodeNames.find(pc);
+      if (bfound == this->_BytecodeNames.end())
+        bfound = this->_BytecodeNames.emplace(pc, profile_bytecode_name(pc)).first;
+      frames.push_back(bfound->second);
+      if (addresses)
+        addresses->push_back(pc);
+    } else {
+      frames.push_back(found->second.first);
+      if (addresses)
+        addresses->push_back(native[i]);
+    }
+  }
+}
+
+SYMBOL_EXPORT_SC_(KeywordPkg, bytes);
+SYMBOL_EXPORT_SC_(KeywordPkg, objects);
+
+CL_LAMBDA(&key (interval 524288) (depth 32));
+CL_DOCSTRING(R"dx(Start the sampling heap profiler. On average one allocation is sampled
+for every INTERVAL bytes that a thread allocates; a sample records the stamp
+and size of the object and up to DEPTH frames of the native and bytecode
+backtraces. Samples accumulate until HEAP-PROFILE-RESET and are written out
+with HEAP-PROFILE-WRITE. Threads that are already running notice within a few
+megabytes of allocation.)dx");
+DOCGROUP(clasp);
+CL_DEFUN void gctools__heap_profile_start(size_t interval, size_t depth) {
+  if (interval == 0)
+    SIMPLE_ERROR("The heap profile interval must be positive");
+  global_heap_profile_depth.store(std::min(depth, HeapProfileMaxDepth), std::memory_order_relaxed);
+  global_heap_profile_interval.store(interval, std::memory_order_relaxed);
+  // Start this thread right away
+  my_thread_low_level->_Allocations._HeapProfileCountdown = heap_profile_next_countdown(interval);
+}
+
+CL_LAMBDA();
+CL_DOCSTRING(R"dx(Stop taking heap profile samples. The samples taken so far are kept.)dx");
+DOCGROUP(clasp);
+CL_DEFUN void gctools__heap_profile_stop() { global_heap_profile_interval.store(0, std::memory_order_relaxed); }
+
+CL_LAMBDA();
+CL_DOCSTRING(R"dx(Discard the heap profile samples taken so far.)dx");
+DOCGROUP(clasp);
+CL_DEFUN void gctools__heap_profile_reset() {
+  std::lock_guard<std::mutex> lock(global_heap_profile_mutex);
+  global_heap_profile.clear();
+}
+
+CL_LAMBDA();
+CL_DOCSTRING(R"dx(Return the number of heap profile samples taken so far, and as a second
+value the sampling interval in bytes or NIL if the profiler is off.)dx");
+DOCGROUP(clasp);
+CL_DEFUN core::T_mv gctools__heap_profile_samples() {
+  size_t samples = 0;
+  {
+    std::lock_guard<std::mutex> lock(global_heap_profile_mutex);
+    for (auto& it : global_heap_profile)
+      samples += it.second._Samples;
+  }
+  size_t interval = global_heap_profile_interval.load(std::memory_order_relaxed);
+  return core::Values(core::make_fixnum(samples), interval ? (core::T_sp)core::make_fixnum(interval) : nil<core::T_O>());
+}
+
+CL_LAMBDA(pathname &key (value :bytes));
+CL_DOCSTRING(R"dx(Write the heap profile to the file at PATHNAME as folded stacks, one line
+per distinct backtrace and stamp, outermost frame first and the stamp of the
+allocated object as the leaf, followed by the estimated number of bytes
+allocated there (or objects, if VALUE is :OBJECTS). flamegraph.pl and
+speedscope read this format. The file is written under a temporary name and
+renamed, so it can be rewritten periodically while other tools read it.
+Returns the number of stacks written.)dx");
+DOCGROUP(clasp);
+CL_DEFUN size_t gctools__heap_profile_write(core::T_sp pathname, core::Symbol_sp value) {
+  if (value != kw::_sym_bytes && value != kw::_sym_objects)
+    TYPE_ERROR(value, core::Cons_O::createList(cl::_sym_member, kw::_sym_bytes, kw::_sym_objects));
+  core::Pathname_sp physical = core::cl__translate_logical_pathname(pathname);
+  std::string filename = gc::As<core::String_sp>(core::cl__namestring(physical))->get_std_string();
+  HeapProfileTable profile;
+  {
+    // Copy the table so that threads can keep sampling while we symbolize
+    std::lock_guard<std::mutex> lock(global_heap_profile_mutex);
+    profile = global_heap_profile;
+  }
+  std::string temporary = filename + ".tmp";
+  FILE* fout = fopen(temporary.c_str(), "w");
+  if (!fout)
+    SIMPLE_ERROR("Could not open {} for writing the heap profile: {}", temporary, strerror(errno));
+  ProfileSymbolizer symbolizer;
+  size_t written = 0;
+  for (auto& it : profile) {
+    const std::vector<uintptr_t>& key = it.first;
+    size_t num_native = key[1];
+    const uintptr_t* native = &key[2];
+    const uintptr_t* bytecode = &key[2 + num_native];
+    size_t num_bytecode = key.size() - 2 - num_native;
+    std::vector<std::string> frames; // innermost first
+    symbolizer.frames(native, num_native, bytecode, num_bytecode, frames);
+    std::string line;
+    for (auto frame = frames.rbegin(); frame != frames.rend(); ++frame) {
+      line += profile_clean_name(*frame);
+      line += ';';
+    }
+    line += "[";
+    line += profile_clean_name(obj_name(Header_s::StampWtagMtag::make_nowhere_stamp(key[0])));
+    line += "]";
+    double weight = (value == kw::_sym_objects) ? it.second._Objects : it.second._Bytes;
+    fprintf(fout, "%s %.0f\n", line.c_str(), weight);
+    written++;
+  }
+  fclose(fout);
+  if (rename(temporary.c_str(), filename.c_str()) != 0)
+    SIMPLE_ERROR("Could not rename {} to {}: {}", temporary, filename, strerror(errno));
+  return written;
+}
+
+}; // namespace gctools
@@ -18,6 +18,7 @@
 #include <clasp/llvmo/code.h>
 #include <clasp/core/unwind.h>                    // DynEnv stuff
 #include <clasp/gctools/boehmGarbageCollection.h> // DynEnv stuff
+#include <clasp/gctools/profiler.h>
 #include <clasp/external/thread-pool/thread_pool.h>
 
 THREAD_LOCAL gctools::ThreadLocalStateLowLevel* my_thread_low_level;
@@ -112,10 +113,22 @@ ThreadLocalStateLowLevel::ThreadLocalStateLowLevel(void* stack_top)
       ,
       _RecursiveAllocationCounter(0)
 #endif
+{
+#ifdef USE_BOEHM
+  // GC_MALLOC_UNCOLLECTABLE returns cleared memory, so every free list starts out empty
+  this->_AllocationCache = (BoehmAllocationCache*)GC_MALLOC_UNCOLLECTABLE(sizeof(BoehmAllocationCache));
+#endif
+  cpuProfileRegisterThread(this);
+};
 
-          {};
-
-ThreadLocalStateLowLevel::~ThreadLocalStateLowLevel(){};
+ThreadLocalStateLowLevel::~ThreadLocalStateLowLevel() {
+  cpuProfileDeregisterThread(this);
+#ifdef USE_BOEHM
+  // Whatever is left on the free lists is reclaimed by the next collection
+  GC_FREE(this->_AllocationCache);
+  this->_AllocationCache = NULL;
+#endif
+};
 
 }; // namespace gctools
 namespace core {
@@ -145,6 +158,9 @@ void VirtualMachine::startup() {
   this->enable_guards();
   this->_stackPointer = this->_stackBottom;
   (*this->_stackPointer) = NULL;
+  this->_recordBottom = (T_O**)gctools::RootClassAllocator<T_O>::allocateRootsAndZero(VirtualMachine::MaxRecordWords);
+  this->_recordTop = this->_recordBottom + VirtualMachine::MaxRecordWords - 1;
+  this->_recordPointer = this->_recordBottom;
 }
 
 void VirtualMachine::enable_guards() {
@@ -173,6 +189,7 @@ VirtualMachine::~VirtualMachine() {
   this->disable_guards();
 #endif
   gctools::RootClassAllocator<T_O>::freeRoots(this->_stackBottom);
+  gctools::RootClassAllocator<T_O>::freeRoots(this->_recordBottom);
 }
 
 // For main thread initialization - it happens too early and _Nil is undefined
@@ -379,7 +396,14 @@ void ThreadLocalState::popObjectFile() {
 
 void ThreadLocalState::startUpVM() { this->_VM.startup(); }
 
-ThreadLocalState::~ThreadLocalState() {}
+ThreadLocalState::~ThreadLocalState() {
+  // Stop being sampled before the VM's stacks are freed, and don't let
+  // anything running on this thread later see the dead state.
+  if (my_thread == this) {
+    gctools::cpuProfileDeregisterThread(my_thread_low_level);
+    my_thread = NULL;
+  }
+}
 
 void thread_local_register_cleanup(const std::function<void(void)>& cleanup) {
   CleanupFunctionNode* node = new CleanupFunctionNode(cleanup, my_thread->_CleanupFunctions);
@@ -151,8 +151,12 @@
              #~"kernel/stage/base/2-begin.lisp"  
              :clasp-cleavir
              #~"kernel/lsp/queue.lisp" ;; cclasp sources
+             #~"kernel/lsp/tasks.lisp"
+             #~"kernel/lsp/heap-profile.lisp"
+             #~"kernel/lsp/cpu-profile.lisp"
              #~"kernel/lsp/generated-encodings.lisp"
              #~"kernel/lsp/process.lisp"
+             #~"kernel/lsp/load-parallel.lisp"
              #~"kernel/lsp/encodings.lisp"
              #~"kernel/lsp/cltl2.lisp"
              #~"kernel/lsp/xref.lisp"
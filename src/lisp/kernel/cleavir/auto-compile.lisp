@@ -48,32 +48,45 @@
 (defun clear-autocompilation-log ()
   (setf (mp:atomic (symbol-value '*autocompilation-log*) :order :relaxed) nil))
 
+(defmacro autocompilation-note (thing)
+  `(when (mp:atomic (symbol-value '*autocompilation-logging*)
+                    :order :relaxed)
+     (mp:atomic-push-explicit ,thing
+                              ((symbol-value '*autocompilation-log*)
+                               :order :relaxed))))
+
+;;; The number of calls and loop iterations after which a bytecode
+;;; function is queued for compilation.
+(defun ext:autocompilation-threshold ()
+  (core:bytecode-compile-threshold))
+(defun (setf ext:autocompilation-threshold) (threshold)
+  (setf (core:bytecode-compile-threshold) threshold))
+
 ;;; Value of *autocompile-hook*.
 ;;; We don't queue anything until start-autocompilation is run.
 ;;; Afterwards we queue even if the worker is not going - more work for later.
 (defun queue-autocompilation (definition environment)
-  (when (global-definition-p definition)
+  (when (autocompilable-p definition)
+    (autocompilation-note
+     `(:queue ,definition
+              ,(core:bytecode-simple-fun/call-count definition)))
     (autocompilation-enqueue  (cons definition environment)))
   definition)
 
-;;; The BTB compiler currently is only safe for non-closures. FIXME.
-;;; I think all we have to do is make sure we replace outer functions
-;;; before inner functions, so that outer bytecode functions never have
-;;; inner native functions.
-(defun global-definition-p (definition)
-  (let ((name (core:function-name definition)))
-    (and (or (symbolp name)
-             (typep name '(cons (eql setf) (cons symbol null))))
-         (fboundp name)
-         (eq definition (fdefinition name)))))
+;;; Closures are compiled too. A native simple fun installed for a
+;;; closure is called with closures made by the bytecode, so the
+;;; native code has to agree with the bytecode about the closure
+;;; layout; the BTB compiler checks this, and refuses if it does not
+;;; (see check-closure-compatibility), in which case we just log the
+;;; error and keep using the bytecode.
+;;; Functions that already have native code are skipped, since their
+;;; counts keep wrapping around while a frame is still running bytecode.
+(defun autocompilable-p (definition)
+  (and (typep definition 'core:bytecode-simple-fun)
+       (eq (core:entry-point definition) definition)))
 
 (defun autocompile-worker ()
-  (macrolet ((log (thing)
-               `(when (mp:atomic (symbol-value '*autocompilation-logging*)
-                                 :order :relaxed)
-                  (mp:atomic-push-explicit ,thing
-                                           ((symbol-value '*autocompilation-log*)
-                                            :order :relaxed)))))
+  (macrolet ((log (thing) `(autocompilation-note ,thing)))
     (loop for item = (autocompilation-dequeue)
           when (eq item :quit)
             do (log item)
@@ -123,6 +123,7 @@
     (when disassemble
       (cleavir-bir-disassembler:display module))
     (clasp-cleavir::bir-transformations module system)
+    (check-closure-compatibility (find-bcfun function funmap))
     (let ((cleavir-cst-to-ast:*compiler* 'cl:compile)
           ;; necessary for bir->function debug info to work. KLUDGE
           (*load-pathname* (core:function-source-pos function))
@@ -144,6 +145,30 @@
                            collect thing)
         collect (cons ir clos)))
 
+;;; If FUNCTION is a closure, the native function we make is going to be
+;;; installed in place of its bytecode and called with closures made by
+;;; bytecode, so fixed-closures-map alone isn't enough: it has to treat
+;;; each slot the same way the bytecode does. That is, a slot holds a
+;;; cell exactly when the bytecode put one there, and the native code
+;;; can't close over nonlocal exit points, since the VM represents them
+;;; differently. If the optimizer has changed things so that this isn't
+;;; true, signal an error so that the bytecode is kept.
+(defun check-closure-compatibility (finfo)
+  (loop with irfun = (finfo-irfun finfo)
+        with env = (bir:environment irfun)
+        for thing in (finfo-closure finfo)
+        for var = (if (consp thing) (car thing) thing)
+        when (and (set:presentp var env)
+                  (etypecase thing
+                    (bir:come-from t)
+                    ((cons bir:variable (eql t))
+                     (or (bir:immutablep var)
+                         (not (eq (bir:extent var) :indefinite))))
+                    ((cons bir:variable (eql nil))
+                     (not (bir:immutablep var)))))
+          do (error "Cannot compile the closure ~a: its native closure layout for ~a does not match the bytecode's"
+                    (finfo-bcfun finfo) var)))
+
 ;;; Given a bytecode function, compile it into the given IR module.
 ;;; that is, this does NOT finish the compilation process.
 ;;; the BIR:FUNCTION is returned.
@@ -382,6 +407,19 @@
          (bir:argument var)) ; happens from e.g. encelled parameters.)
        context))))
 
+(defmethod compile-instruction ((mnemonic (eql :ref-ref))
+                                inserter context &rest args)
+  (destructuring-bind (varindex1 varindex2) args
+    (compile-instruction :ref inserter context varindex1)
+    (compile-instruction :ref inserter context varindex2)))
+
+(defmethod compile-instruction ((mnemonic (eql :ref-ref-call-receive-one))
+                                inserter context &rest args)
+  (destructuring-bind (varindex1 varindex2) args
+    (compile-instruction :ref inserter context varindex1)
+    (compile-instruction :ref inserter context varindex2)
+    (compile-instruction :call-receive-one inserter context 2)))
+
 (defun read-variable (variable inserter context)
   (let ((ctype (declared-ctype (bir:name variable) context)))
     (compile-type-decl :variable ctype
@@ -1052,19 +1090,56 @@
 
 ;; Identical to the above, but BIR should maybe have a
 ;; CONSTANT-CALLED-FDEFINITION for this.
+(defun compile-called-fdefinition (fname inserter)
+  (let* ((const (build:fcell inserter fname))
+         (attributes (clasp-cleavir::function-attributes fname))
+         (ftype (ctype:single-value (clasp-cleavir::global-ftype fname)
+                                    clasp-cleavir::*clasp-system*))
+         (fdef-out (make-instance 'bir:output
+                     :name fname :asserted-type ftype :attributes attributes)))
+    (build:insert inserter 'bir:constant-fdefinition
+                  :inputs (list const) :outputs (list fdef-out))
+    fdef-out))
+
 (defmethod compile-instruction ((mnemonic (eql :called-fdefinition))
                                 inserter context &rest args)
   (destructuring-bind ((fcell)) args
-    (let* ((fname (core:function-name fcell))
-           (const (build:fcell inserter fname))
-           (attributes (clasp-cleavir::function-attributes fname))
-           (ftype (ctype:single-value (clasp-cleavir::global-ftype fname)
-                                      clasp-cleavir::*clasp-system*))
-           (fdef-out (make-instance 'bir:output
-                       :name fname :asserted-type ftype :attributes attributes)))
-      (build:insert inserter 'bir:constant-fdefinition
-                    :inputs (list const) :outputs (list fdef-out))
-      (stack-push fdef-out context))))
+    (stack-push (compile-called-fdefinition (core:function-name fcell)
+                                            inserter)
+                context)))
+
+;;; The primitive instructions are just calls as far as we're concerned;
+;;; Cleavir's own transforms will take care of inlining them.
+(defun compile-primitive-call (fname nargs inserter context)
+  (let ((args (gather context nargs)))
+    (stack-push (compile-called-fdefinition fname inserter) context)
+    (dolist (arg args)
+      (stack-push arg context))
+    (setf (mvals context) nil) ; invalidate for self-consistency checks
+    (stack-push (compile-call nargs inserter context) context)))
+
+(macrolet ((defprimitive (mnemonic nargs)
+             `(defmethod compile-instruction ((mnemonic (eql ,mnemonic))
+                                              inserter context &rest args)
+                (destructuring-bind ((fcell)) args
+                  (compile-primitive-call (core:function-name fcell) ,nargs
+                                          inserter context)))))
+  (defprimitive :add 2)
+  (defprimitive :sub 2)
+  (defprimitive :lt 2)
+  (defprimitive :le 2)
+  (defprimitive :gt 2)
+  (defprimitive :ge 2)
+  (defprimitive :num-eq 2)
+  (defprimitive :car 1)
+  (defprimitive :cdr 1)
+  (defprimitive :svref 2)
+  (defprimitive :aref 2))
+
+(defmethod compile-instruction ((mnemonic (eql :eq))
+                                inserter context &rest args)
+  (destructuring-bind () args
+    (compile-primitive-call 'eq 2 inserter context)))
 
 (defmethod compile-instruction ((mnemonic (eql :fdesignator))
                                 inserter context &rest args)
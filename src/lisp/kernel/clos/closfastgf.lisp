@@ -620,6 +620,87 @@ FIXME!!!! This code will have problems with multithreading if a generic function
   (union-entries old-call-history
                  (dispatch-miss-info generic-function old-call-history arguments)))
 
+;;; Per generic function counters for dispatch misses and discriminator
+;;; rebuilds, and the state used to limit how often a discriminator is
+;;; rebuilt. This is an unnamed vector so that the counters can be
+;;; updated atomically through SVREF.
+(defstruct (dispatch-statistics (:type vector))
+  (misses 0) (miss-seconds 0d0)
+  (rebuilds 0) (rebuild-seconds 0d0)
+  (deferred-rebuilds 0)
+  (last-rebuild nil) (pending-rebuild nil))
+
+(defmacro dispatch-statistic (statistics name)
+  `(svref ,statistics
+          ,(position name '(misses miss-seconds rebuilds rebuild-seconds
+                            deferred-rebuilds last-rebuild pending-rebuild))))
+
+(defvar *dispatch-statistics* (make-hash-table :test #'eq :weakness :key))
+(defparameter *dispatch-statistics-lock* (mp:make-lock :name 'dispatch-statistics))
+
+(defun dispatch-statistics (generic-function)
+  (or (gethash generic-function *dispatch-statistics*)
+      (mp:with-lock (*dispatch-statistics-lock*)
+        (or (gethash generic-function *dispatch-statistics*)
+            (setf (gethash generic-function *dispatch-statistics*)
+                  (make-dispatch-statistics))))))
+
+(defun generic-function-dispatch-statistics (generic-function)
+  "Return a plist describing the dispatch misses of GENERIC-FUNCTION and the
+rebuilds of its discriminating function since the last reset."
+  (let ((statistics (dispatch-statistics generic-function)))
+    (list :misses (dispatch-statistic statistics misses)
+          :miss-seconds (dispatch-statistic statistics miss-seconds)
+          :rebuilds (dispatch-statistic statistics rebuilds)
+          :rebuild-seconds (dispatch-statistic statistics rebuild-seconds)
+          :deferred-rebuilds (dispatch-statistic statistics deferred-rebuilds))))
+
+(defun reset-dispatch-statistics (&optional (generic-function nil generic-function-p))
+  "Discard the dispatch statistics of GENERIC-FUNCTION, or of every generic
+function if it is not supplied."
+  (mp:with-lock (*dispatch-statistics-lock*)
+    (if generic-function-p
+        (remhash generic-function *dispatch-statistics*)
+        (clrhash *dispatch-statistics*))))
+
+(export '(generic-function-dispatch-statistics reset-dispatch-statistics))
+
+(defun elapsed-seconds (start)
+  (/ (float (- (get-internal-real-time) start) 1d0)
+     internal-time-units-per-second))
+
+;;; The maximum number of times per second that a dispatch miss may rebuild
+;;; the discriminating function of a generic function, or NIL for no limit.
+;;; A rate of 0 allows no rebuild after the first one.
+;;; Misses past that rate still extend the call history; the rebuild is
+;;; deferred until a later miss finds that enough time has passed. Since
+;;; the stale discriminator misses on every entry it doesn't know about yet,
+;;; a deferred rebuild always happens as soon as it's needed again.
+(defvar *dispatch-rebuild-rate* 100)
+(export '*dispatch-rebuild-rate*)
+
+(defun rebuild-allowed-p (statistics)
+  (let ((rate *dispatch-rebuild-rate*)
+        (last (dispatch-statistic statistics last-rebuild)))
+    (or (null rate) (null last)
+        (and (plusp rate)
+             (>= (- (get-internal-real-time) last)
+                 (/ internal-time-units-per-second rate))))))
+
+;;; While a rebuild is pending, misses on entries that are already in the
+;;; call history can take their outcome from it without computing the
+;;; applicable methods again. This is only valid without EQL specializers,
+;;; for which a class key doesn't determine the outcome.
+(defun memoized-outcome (generic-function arguments)
+  (let ((specializer-profile (safe-gf-specializer-profile generic-function)))
+    (when (and specializer-profile
+               (notany #'consp specializer-profile))
+      (let* ((key (map 'simple-vector #'class-of
+                       (subseq arguments 0 (length specializer-profile))))
+             (entry (find key (mp:atomic (safe-gf-call-history generic-function))
+                          :key #'car :test #'specializer-key-match)))
+        (and entry (cdr entry))))))
+
 (defun dispatch-miss (generic-function &rest arguments)
   (#+debug-fastgf unwind-protect #-debug-fastgf multiple-value-prog1
    (progn
@@ -640,8 +721,8 @@ FIXME!!!! This code will have problems with multithreading if a generic function
                    (with-early-accessors (+standard-generic-function-slots+)
                      (mp:atomic (%generic-function-tracy generic-function)))))
             (report (and tracy (eq (car tracy) :profile-ongoing)))
-            (dispatch-miss-start-time
-              (when tracy (get-internal-real-time)))
+            (statistics (dispatch-statistics generic-function))
+            (dispatch-miss-start-time (get-internal-real-time))
             #+debug-fastgf
             (*dispatch-miss-start-time* (get-internal-real-time))
             ;; We have to recompute the new entries in the CAS loop because we need to
@@ -655,17 +736,29 @@ FIXME!!!! This code will have problems with multithreading if a generic function
                  (core:low-level-standard-generic-function-name generic-function)
                  arguments))
        ;; Do the miss.
-       (mp:atomic-update (safe-gf-call-history generic-function)
-                         (lambda (call-history)
-                           (multiple-value-bind (noutcome new-entries)
-                               (dispatch-miss-info generic-function call-history arguments)
-                             (setf outcome noutcome)
-                             (cond ((null new-entries)
-                                    (setf updatedp nil)
-                                    call-history)
-                                   (t (setf updatedp t)
-                                      (union-entries call-history new-entries))))))
-       (when updatedp (force-dispatcher generic-function))
+       (mp:atomic-incf (dispatch-statistic statistics misses))
+       (setf outcome (and (dispatch-statistic statistics pending-rebuild)
+                          (memoized-outcome generic-function arguments)))
+       (unless outcome
+         (mp:atomic-update (safe-gf-call-history generic-function)
+                           (lambda (call-history)
+                             (multiple-value-bind (noutcome new-entries)
+                                 (dispatch-miss-info generic-function call-history arguments)
+                               (setf outcome noutcome)
+                               (cond ((null new-entries)
+                                      (setf updatedp nil)
+                                      call-history)
+                                     (t (setf updatedp t)
+                                        (union-entries call-history new-entries)))))))
+       (when (or updatedp (dispatch-statistic statistics pending-rebuild))
+         (cond ((rebuild-allowed-p statistics)
+                (force-dispatcher generic-function))
+               (t
+                (setf (dispatch-statistic statistics pending-rebuild) t)
+                (when updatedp
+                  (mp:atomic-incf (dispatch-statistic statistics deferred-rebuilds))))))
+       (mp:atomic-incf (dispatch-statistic statistics miss-seconds)
+                       (elapsed-seconds dispatch-miss-start-time))
        (gf-log "Performing outcome {}%N" outcome)
        (when report
          (format *trace-output*
@@ -712,7 +805,9 @@ FIXME!!!! This code will have problems with multithreading if a generic function
       (invalidated-discriminating-function-closure generic-function)))
 
 (defun force-dispatcher (generic-function)
-  (let (log-output)
+  (let ((statistics (dispatch-statistics generic-function))
+        (rebuild-start-time (get-internal-real-time))
+        log-output)
     #-debug-fastgf (declare (ignore log-output))
     #+debug-fastgf
     (progn
@@ -722,9 +817,16 @@ FIXME!!!! This code will have problems with multithreading if a generic function
             (gf-log "Writing dispatcher to {}%N" log-output))
           (setf log-output (log-cmpgf-filename (generic-function-name generic-function) "func" "ll")))
       (incf-debug-fastgf-didx))
+    ;; Clear the pending flag first, so that a miss that extends the call
+    ;; history while we compute is deferred to a later rebuild, not lost.
+    (setf (dispatch-statistic statistics pending-rebuild) nil
+          (dispatch-statistic statistics last-rebuild) rebuild-start-time)
     (set-funcallable-instance-function generic-function
                                        (calculate-fastgf-dispatch-function
-                                        generic-function))))
+                                        generic-function))
+    (mp:atomic-incf (dispatch-statistic statistics rebuilds))
+    (mp:atomic-incf (dispatch-statistic statistics rebuild-seconds)
+                    (elapsed-seconds rebuild-start-time))))
 
 ;;; Used by interpret-dtree-program.
 (defun compile-discriminating-function (generic-function)
@@ -122,16 +122,18 @@
         (t
          (error "BUG in BC-ADD-ENTRY: Not a node: ~a" node))))))
 
+(defun bc-specializer-indices (specializer-profile)
+  (loop for spec across specializer-profile
+        for index from 0
+        when spec collect index))
+
 (defun bc-basic-tree (call-history specializer-profile)
   (assert (not (null call-history)))
   (dtree-log "Entered bc-basic-tree call-history: ~a specializer-profile: ~a~%" (core:safe-repr call-history) (core::safe-repr specializer-profile))
   (let ((last-specialized (position nil specializer-profile :from-end t :test-not #'eq))
         (first-specialized (position-if #'identity specializer-profile)))
     (dtree-log "A first-specialized ~a last-specialized ~a~%" first-specialized last-specialized)
-    (let ((specializer-indices (when (and (integerp first-specialized) (integerp last-specialized))
-                                 (loop for index from first-specialized to last-specialized
-                                     when (elt specializer-profile index)
-                                       collect index))))
+    (let ((specializer-indices (bc-specializer-indices specializer-profile)))
       (dtree-log "B specializer-indices ~s~%" specializer-indices)
       (when (null last-specialized)
         ;; no specialization - we go immediately to the outcome
@@ -145,6 +147,60 @@
             do (bc-add-entry result specializers outcome specializer-indices)
             finally (return (values result specialized-length))))))
 
+;;; Basic trees are kept between discriminator compilations. A dispatch
+;;; miss only pushes new entries onto the front of the call history, so
+;;; if the history a tree was built from is still a tail of the current
+;;; one, the new entries can be inserted with BC-ADD-ENTRY rather than
+;;; rebuilding the tree from every entry. Anything else (erasure, entries
+;;; dropped by class redefinition, a changed specializer profile) starts
+;;; over from scratch.
+
+(defstruct (dispatch-tree (:type vector) :named)
+  call-history specializer-indices tree specialized-length)
+
+(defvar *dispatch-trees* (make-hash-table :test #'eq :weakness :key))
+(defparameter *dispatch-trees-lock* (mp:make-lock :name 'dispatch-trees))
+
+;;; A tree is removed from the table while it's being extended, so two
+;;; threads compiling the same generic function never share one; the
+;;; second just builds its own.
+(defun take-dispatch-tree (generic-function)
+  (mp:with-lock (*dispatch-trees-lock*)
+    (let ((dispatch-tree (gethash generic-function *dispatch-trees*)))
+      (when dispatch-tree (remhash generic-function *dispatch-trees*))
+      dispatch-tree)))
+
+(defun keep-dispatch-tree (generic-function dispatch-tree)
+  (mp:with-lock (*dispatch-trees-lock*)
+    (setf (gethash generic-function *dispatch-trees*) dispatch-tree)))
+
+(defun forget-dispatch-tree (generic-function)
+  (mp:with-lock (*dispatch-trees-lock*)
+    (remhash generic-function *dispatch-trees*)))
+
+(defun incremental-basic-tree (generic-function call-history specializer-profile)
+  (let ((old (take-dispatch-tree generic-function))
+        (specializer-indices (bc-specializer-indices specializer-profile)))
+    (multiple-value-bind (basic specialized-length)
+        (if (and old
+                 (equal (dispatch-tree-specializer-indices old) specializer-indices)
+                 (tailp (dispatch-tree-call-history old) call-history))
+            (let ((tree (dispatch-tree-tree old)))
+              (loop for (specializers . outcome)
+                      in (ldiff call-history (dispatch-tree-call-history old))
+                    do (bc-add-entry tree specializers outcome specializer-indices))
+              (values tree (dispatch-tree-specialized-length old)))
+            (bc-basic-tree call-history specializer-profile))
+      ;; With nothing specialized the "tree" is just an outcome.
+      (when (test-p basic)
+        (keep-dispatch-tree generic-function
+                            (make-dispatch-tree
+                             :call-history call-history
+                             :specializer-indices specializer-indices
+                             :tree basic
+                             :specialized-length specialized-length)))
+      (values basic specialized-length))))
+
 ;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
 ;;;
 ;;; 
@@ -663,7 +719,8 @@
 
 (defun dtree-compile (generic-function)
   (multiple-value-bind (basic specialized-length)
-      (bc-basic-tree
+      (incremental-basic-tree
+       generic-function
        (safe-gf-call-history generic-function)
        (safe-gf-specializer-profile generic-function))
     (values (compile-tree-top basic) specialized-length)))
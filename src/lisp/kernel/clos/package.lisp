@@ -141,6 +141,7 @@
 #+clasp
 (export '(satiate
           satiate-initialization
+          write-dispatch-state
           apply-method
           ))
 
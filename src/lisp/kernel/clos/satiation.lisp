@@ -458,6 +458,113 @@ a list (EQL object) - just like DEFMETHOD."
                              collect `(,classd null)))))
       form))
 
+;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
+;;;
+;;; RECORDED DISPATCH STATE
+;;;
+;;; A long running application accumulates call histories that a fresh image
+;;; has to rediscover one dispatch miss at a time. WRITE-DISPATCH-STATE records
+;;; the call histories of named generic functions as a file of
+;;; %SATIATE-AT-LOAD forms. Compiling that file computes the effective methods
+;;; once, and loading the FASL installs the histories and discriminators built
+;;; from them, so the loading image dispatches at full speed from the start.
+
+;;; Like %SATIATE, but the discriminator is always computed when the form is
+;;; loaded. The stamps of application classes depend on the order in which
+;;; they were defined, so unlike those of system classes they can't be assumed
+;;; to agree between the compiling and the loading image.
+(defmacro %satiate-at-load (generic-function-name &rest lists-of-specializer-names)
+  (let* ((generic-function (fdefinition generic-function-name))
+         (call-history (apply #'compile-time-call-history
+                              generic-function lists-of-specializer-names)))
+    `(let ((gf (fdefinition ',generic-function-name)))
+       (append-generic-function-call-history
+        gf
+        ,(call-history-producer call-history (gf-arg-info generic-function)))
+       (set-funcallable-instance-function
+        gf (calculate-fastgf-dispatch-function gf)))))
+
+;;; Return a specializer designator that reads back as SPECIALIZER in another
+;;; image, or NIL if there isn't one.
+(defun recordable-specializer-designator (specializer)
+  (cond ((safe-eql-specializer-p specializer)
+         (let ((object (safe-eql-specializer-object specializer)))
+           (when (typecase object
+                   (symbol (symbol-package object))
+                   ((or number character) t))
+             `(eql ,object))))
+        ((classp specializer)
+         (let ((name (class-name specializer)))
+           (when (and name (symbolp name) (symbol-package name)
+                      (eq (find-class name nil) specializer))
+             name)))))
+
+(defun recordable-call-history (generic-function)
+  (loop for (key . nil) in (mp:atomic (safe-gf-call-history generic-function))
+        for designators = (map 'list #'recordable-specializer-designator key)
+        unless (member nil designators)
+          collect designators))
+
+(defun recordable-generic-function-names ()
+  (let ((names nil))
+    (flet ((consider (name)
+             (when (fboundp name)
+               (let ((function (fdefinition name)))
+                 (when (and (eq (class-of function)
+                                (find-class 'standard-generic-function))
+                            (mp:atomic (safe-gf-call-history function)))
+                   (push name names))))))
+      (do-all-symbols (symbol)
+        (consider symbol)
+        (consider `(setf ,symbol))))
+    (remove-duplicates names :test #'equal)))
+
+(defun write-dispatch-state (pathname
+                             &key (generic-function-names
+                                   (recordable-generic-function-names))
+                               compile)
+  "Write the call histories of the generic functions named by
+GENERIC-FUNCTION-NAMES, by default every named standard generic function that
+has been called, to PATHNAME as Lisp source. Compiling and loading that file
+in another image reinstalls the histories and their discriminating functions,
+so that calls with the recorded classes don't take dispatch misses. Entries
+involving anonymous classes or unreadable EQL specializer objects are left
+out. If COMPILE is true the file is compiled too, and the FASL's pathname is
+returned instead of PATHNAME."
+  (with-open-file (stream pathname :direction :output :if-exists :supersede)
+    (with-standard-io-syntax
+      (let ((*package* (find-package "KEYWORD")))
+        (format stream ";;; Dispatch state written by CLOS:WRITE-DISPATCH-STATE.~%~
+                        ;;; Compile this file and load the result to reinstall it.~%")
+        (dolist (name generic-function-names)
+          (let* ((generic-function (fdefinition name))
+                 (lists (recordable-call-history generic-function)))
+            ;; Leave out anything %SATIATE-AT-LOAD would fail to compile,
+            ;; so that one odd generic function doesn't spoil the file.
+            (when (and lists
+                       (ignore-errors
+                        (apply #'compile-time-call-history generic-function lists)
+                        t))
+              (print `(%satiate-at-load ,name ,@lists) stream)
+              (terpri stream)))))))
+  (if compile
+      (compile-file pathname)
+      pathname))
+
+;;; Rebuilds that dispatch misses deferred (see *DISPATCH-REBUILD-RATE*) are
+;;; done before a snapshot is saved, so that it starts out with discriminators
+;;; covering the whole of each call history.
+(defun finish-deferred-dispatch-rebuilds ()
+  (let ((pending nil))
+    (maphash (lambda (generic-function statistics)
+               (when (dispatch-statistic statistics pending-rebuild)
+                 (push generic-function pending)))
+             *dispatch-statistics*)
+    (mapc #'force-dispatcher pending)))
+
+(eval-when (:load-toplevel :execute)
+  (cmp:register-save-hook 'finish-deferred-dispatch-rebuilds))
+
 ;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
 ;;;
 ;;; SATIATION OF SPECIFIC CLOS FUNCTIONS
@@ -770,19 +770,11 @@
 ;;; "the default method on SORT behaves as if it constructs a vector with the
 ;;;  same elements as sequence, calls SORT on that vector, then replaces the
 ;;;  elements of sequence with the elements of the sorted vector."
-;;; I don't understand the rationale for this requirement - specifically, how
-;;; could one possibly know that that's what's happening? SORT on a vector
-;;; is nothing the user can specialize. If what it's supposed to mean is that
-;;; the same sequence is returned, this implementation does fine there.
-;;; Incidentally, it could be sped up if we could grab a sequence class's
-;;;  particular ELT.
-;;; Oh, and this will be terrible for a list-like sequence. Maybe the
-;;; requirement is supposed to indicate that list-like sequences shouldn't get
-;;; such terrible performance...?
+;;; We do exactly that: sorting in place through ELT is quadratic for a
+;;; list-like sequence, and copying lets the vector sort do the work.
 (defmethod sequence:sort ((sequence sequence) predicate &key key)
   (core::with-key (key)
-    (core::quick-sort sequence 0 (1- (length sequence))
-                      (core:coerce-fdesignator predicate) key)))
+    (replace sequence (sort (coerce sequence 'vector) predicate :key key))))
 
 (defgeneric sequence:stable-sort (sequence predicate &key key)
   (:method ((sequence t) predicate &rest kwargs)
@@ -94,7 +94,25 @@
     ("dup" 58)
     ("fdesignator" 59 ((constant-arg 1)) ((constant-arg 2)))
     ("called-fdefinition" 60 ((constant-arg 1)) ((constant-arg 2)))
+    ;; Superinstructions: ref-ref is ref N; ref M, and
+    ;; ref-ref-call-receive-one is that followed by call-receive-one 2.
+    ("ref-ref" 61 (1 1))
+    ("ref-ref-call-receive-one" 62 (1 1))
     ("encell" 63 (1) (2))
+    ;; Calls to primitive functions. These have inline fast paths for the
+    ;; common cases (e.g. fixnum arithmetic), and otherwise call the
+    ;; function in the constant function cell on the stack arguments.
+    ("add" 64 ((constant-arg 1)) ((constant-arg 2)))
+    ("sub" 65 ((constant-arg 1)) ((constant-arg 2)))
+    ("lt" 66 ((constant-arg 1)) ((constant-arg 2)))
+    ("le" 67 ((constant-arg 1)) ((constant-arg 2)))
+    ("gt" 68 ((constant-arg 1)) ((constant-arg 2)))
+    ("ge" 69 ((constant-arg 1)) ((constant-arg 2)))
+    ("num-eq" 70 ((constant-arg 1)) ((constant-arg 2)))
+    ("car" 71 ((constant-arg 1)) ((constant-arg 2)))
+    ("cdr" 72 ((constant-arg 1)) ((constant-arg 2)))
+    ("svref" 73 ((constant-arg 1)) ((constant-arg 2)))
+    ("aref" 74 ((constant-arg 1)) ((constant-arg 2)))
     ("long" 255)))
 
 (defun pythonify-arguments (args)
@@ -297,6 +315,16 @@
   (terpri fout)
   (write-line "#endif // VM_CODES" fout))
 
+;;; The threaded dispatch table for bytecode_vm. This is included inside the
+;;; body of bytecode_vm, so each entry is the address of a label there named
+;;; op_vm_<opcode>. Bytes that are not opcodes go to op_vm_unknown.
+(defun generate-vm-dispatch-table (fout)
+  (write-line "#ifdef VM_DISPATCH_TABLE" fout)
+  (dotimes (opcode 256)
+    (let ((item (find opcode *full-codes* :key #'second)))
+      (format fout "  &&op_vm_~a,~%" (if item (c++ify (first item)) "unknown"))))
+  (write-line "#endif // VM_DISPATCH_TABLE" fout))
+
 ;;; load time values machine
 
 (defstruct (ltv-info (:type vector) :named) type c++-type suffix gcroots)
@@ -385,6 +413,7 @@
 
 (defun generate-virtual-machine-header (fout)
   (generate-vm-codes fout)
+  (generate-vm-dispatch-table fout)
   (generate-python-bytecode-table fout)
   (clos:dump-gf-bytecode-virtual-machine fout)
   (clos:dump-gf-bytecode-virtual-machine-macro-names fout)
@@ -46,3 +46,14 @@
 (defmethod eclector.reader:wrap-in-unquote-splicing
     ((client clasp-eclector-client-mixin) form)
   (list 'core::unquote-splice form))
+
+;;; Numbers are most of the tokens in data files, so let the C++
+;;; number parser have the first try at a token. It works on the token
+;;; string in place rather than accumulating digits generically, and
+;;; leaves symbols, and floats too large to represent, to Eclector.
+(defmethod eclector.reader:interpret-token
+    ((client clasp-eclector-client-mixin) input-stream token escape-ranges)
+  (or (and (null escape-ranges)
+           (not *read-suppress*)
+           (core:parse-number-token token *read-base*))
+      (call-next-method)))
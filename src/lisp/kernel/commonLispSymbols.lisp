@@ -192,7 +192,7 @@
 	  search-generic 
 	  sort 
 	  list-merge-sort 
-	  quick-sort 
+	  pdqsort 
 	  stable-sort 
 	  merge 
 	  complement 
@@ -0,0 +1,23 @@
+;;;;  cpu-profile.lisp -- Profiling a form with the sampling CPU profiler.
+;;;;
+;;;; The profiler itself lives in cpuProfiler.cc: CPU-PROFILE-START turns on
+;;;; sampling for every thread and CPU-PROFILE-WRITE writes the samples taken
+;;;; so far as folded stacks or a pprof profile. WITH-CPU-PROFILE wraps the
+;;;; usual sequence of resetting, starting, running, stopping and writing.
+
+(in-package "GCTOOLS")
+
+(export '(with-cpu-profile))
+
+(defmacro with-cpu-profile ((pathname &key (format :folded) (frequency 100) (depth 64))
+                            &body body)
+  "Profile the CPU use of every thread while BODY runs, then write the
+profile to PATHNAME in FORMAT (see CPU-PROFILE-WRITE) and return the values
+of BODY. Samples taken before are discarded."
+  (let ((path (gensym "PATHNAME")))
+    `(let ((,path ,pathname))
+       (cpu-profile-reset)
+       (cpu-profile-start :frequency ,frequency :depth ,depth)
+       (unwind-protect (progn ,@body)
+         (cpu-profile-stop)
+         (cpu-profile-write ,path :format ,format)))))
@@ -0,0 +1,36 @@
+;;;;  heap-profile.lisp -- Periodic output from the sampling heap profiler.
+;;;;
+;;;; The profiler itself lives in heapProfiler.cc: HEAP-PROFILE-START turns on
+;;;; sampling and HEAP-PROFILE-WRITE writes the samples taken so far as folded
+;;;; stacks. A long running program can leave the profiler on and have a
+;;;; writer process rewrite the profile every so often, so that the latest
+;;;; profile is always on disk when the program starts to bloat.
+
+(in-package "GCTOOLS")
+
+(export '(start-heap-profile-writer stop-heap-profile-writer))
+
+(defvar *heap-profile-writer* nil)
+
+(defun stop-heap-profile-writer ()
+  "Stop the process started by START-HEAP-PROFILE-WRITER, if there is one.
+The profiler keeps sampling."
+  (let ((writer *heap-profile-writer*))
+    (when writer
+      (setf *heap-profile-writer* nil)
+      (mp:process-kill writer)
+      (mp:process-join writer)
+      t)))
+
+(defun start-heap-profile-writer (pathname &key (period 60) (value :bytes))
+  "Start a process that writes the heap profile to PATHNAME (see
+HEAP-PROFILE-WRITE) every PERIOD seconds, replacing any earlier writer. The
+profiler has to be started separately with HEAP-PROFILE-START."
+  (check-type period (real (0)))
+  (stop-heap-profile-writer)
+  (setf *heap-profile-writer*
+        (mp:process-run-function
+         "heap-profile-writer"
+         (lambda ()
+           (loop (sleep period)
+                 (heap-profile-write pathname :value value))))))
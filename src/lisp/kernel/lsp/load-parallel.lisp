@@ -0,0 +1,64 @@
+;;;;  load-parallel.lisp -- Loading many FASLs using several threads.
+
+(in-package "EXT")
+
+(export '(load-fasls-in-parallel) :ext)
+
+;;; Load the bytecode FASLs in FILES, in order, as LOAD would.
+;;; Reading each file and decoding its constants and bytecode (see
+;;; core:predecode-fasl) is done by NTHREADS worker threads, running
+;;; ahead of the calling thread, which does the rest of the loading
+;;; (interning, defining functions, running top level forms) in order.
+;;; If predecoding a file fails, the error is signaled when that file
+;;; is reached, so earlier files are still loaded first.
+(defun load-fasls-in-parallel (files &key (nthreads (core:num-logical-processors))
+                                          verbose)
+  (let* ((files (coerce files 'vector))
+         (nfiles (length files))
+         ;; Each element is NIL until its file has been predecoded,
+         ;; and then (:ok . predecoded) or (:error . condition).
+         (results (make-array nfiles :initial-element nil))
+         (next 0)
+         (lock (mp:make-lock :name "load-fasls-in-parallel"))
+         (cv (mp:make-condition-variable :name "load-fasls-in-parallel"))
+         (workers
+           (loop for n below (max 1 (min nthreads nfiles))
+                 collect (mp:process-run-function
+                          (format nil "fasl-predecoder-~d" n)
+                          (lambda ()
+                            (loop for i = (mp:with-lock (lock)
+                                            (when (< next nfiles)
+                                              (prog1 next (incf next))))
+                                  while i
+                                  do (let ((result
+                                             (handler-case
+                                                 (cons :ok (core:predecode-fasl
+                                                            (aref files i)))
+                                               (serious-condition (c)
+                                                 (cons :error c)))))
+                                       (mp:with-lock (lock)
+                                         (setf (aref results i) result)
+                                         (mp:condition-variable-broadcast cv)))))))))
+    (unwind-protect
+         (loop for i below nfiles
+               for file = (aref files i)
+               for result = (mp:with-lock (lock)
+                              (loop until (aref results i)
+                                    do (mp:condition-variable-wait cv lock))
+                              ;; Let the predecoded data be collected
+                              ;; once we're done with it.
+                              (shiftf (aref results i) t))
+               do (when verbose
+                    (format t "~&; Loading ~s~%" file))
+                  (ecase (car result)
+                    (:ok
+                     (let ((*package* *package*)
+                           (*readtable* *readtable*)
+                           (*load-pathname* (pathname file))
+                           (*load-truename* (truename file)))
+                       (core:load-predecoded-fasl (cdr result))))
+                    (:error (error (cdr result)))))
+      ;; If we're exiting early, stop the workers from starting new files.
+      (mp:with-lock (lock) (setf next nfiles))
+      (mapc #'mp:process-join workers))
+    t))
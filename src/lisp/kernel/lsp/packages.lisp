@@ -252,5 +252,6 @@
             with-current-source-form
             start-autocompilation
             stop-autocompilation
+            autocompilation-threshold
             ;; Misc
             printing-char-p)))
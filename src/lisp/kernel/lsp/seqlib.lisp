@@ -873,9 +873,11 @@ elements X and Y is arbitrary if both
 evaluates to NIL.  See STABLE-SORT."
   (setf key (if key (coerce-fdesignator key) #'identity)
 	predicate (coerce-fdesignator predicate))
-  (if (listp sequence)
-      (list-merge-sort sequence predicate key)
-      (quick-sort sequence 0 (the fixnum (1- (length sequence))) predicate key)))
+  (cond ((listp sequence)
+         (list-merge-sort sequence predicate key))
+        ((vectorp sequence)
+         (sort-vector sequence predicate key nil))
+        (t (sequence:sort sequence predicate :key key))))
 
 
 (defun list-merge-sort (l predicate key)
@@ -931,46 +933,226 @@ evaluates to NIL.  See STABLE-SORT."
      (setq key-right (funcall key (car right)))
      (go loop)))
 
-#-clasp-min
-(defun quick-sort (seq start end pred key)
-  (declare (fixnum start end)
-           (function pred key)
-           (optimize (safety 0)))
-  (if (< start end)
-      (let* ((j (1+ end)))
-        (declare (fixnum j))
-        (let* ((i start)
-               (l (- end start))
-               (l-half (ash l -1))
-               (p (+ start l-half))
-               (d (elt seq p))
-               (kd (funcall key d)))
-          (declare (fixnum i p l l-half))
-          (rotatef (elt seq p) (elt seq start))
-          (block outer-loop
-            (loop
-               (loop 
-                  (unless (> (decf j) i) (return-from outer-loop))
-                  (when (funcall pred 
-                                 (funcall key (elt seq j)) kd)
-                    (return)))
-               (loop 
-              (unless (< (incf i) j) (return-from outer-loop))
-                  (unless (funcall pred
-                                   (funcall key (elt seq i)) kd)
-                    (return)))
-               (rotatef (elt seq i) (elt seq j))))
-          (setf (elt seq start) (elt seq j)
-                (elt seq j) d))
-        (if (< (the fixnum (- j start))
-               (the fixnum (- end j)))
-            (progn
-              (quick-sort seq start (1- j) pred key)
-              (quick-sort seq (1+ j) end pred key))
-            (progn
-              (quick-sort seq (1+ j) end pred key)
-              (quick-sort seq start (1- j) pred key))))
-      seq))
+;;; SORT on a general vector uses pattern-defeating quicksort (Orson
+;;; Peters, "Pattern-defeating Quicksort", 2021). Pivots are the median of
+;;; three elements, or of nine in long ranges, and short ranges are
+;;; insertion sorted. A partition that needed no swaps is finished with an
+;;; insertion sort that gives up after a few moves, which makes sorted and
+;;; reversed input linear. Badly unbalanced partitions shuffle some
+;;; elements to break up patterns, and after too many of them the range is
+;;; heapsorted, so the worst case is O(n log n). Every scan is bounds
+;;; checked, so a predicate that isn't a strict order gives an unspecified
+;;; order rather than running off the end of the vector.
+(defmacro define-pdqsort (name vector-type accessor)
+  `(defun ,name (vector start end predicate key)
+     (declare (type ,vector-type vector)
+              (fixnum start end)
+              (function predicate)
+              (type (or null function) key)
+              (optimize speed (safety 0)))
+     (macrolet ((ref (index) `(,',accessor vector ,index))
+                (less (x y)
+                  `(if key
+                       (funcall predicate (funcall key ,x) (funcall key ,y))
+                       (funcall predicate ,x ,y))))
+       (labels ((swap (i j)
+                  (declare (fixnum i j))
+                  (rotatef (ref i) (ref j)))
+                (sort2 (i j)
+                  (declare (fixnum i j))
+                  (when (less (ref j) (ref i)) (swap i j)))
+                (sort3 (i j k)
+                  (declare (fixnum i j k))
+                  (sort2 i j) (sort2 j k) (sort2 i j))
+                (insertion-sort (begin end limit)
+                  ;; Return NIL as soon as more than LIMIT elements have
+                  ;; been moved, leaving the range partly sorted.
+                  (declare (fixnum begin end limit))
+                  (let ((moved 0))
+                    (declare (fixnum moved))
+                    (loop for i of-type fixnum from (1+ begin) below end
+                          do (let ((x (ref i))
+                                   (j i))
+                               (declare (fixnum j))
+                               (loop while (and (> j begin) (less x (ref (1- j))))
+                                     do (setf (ref j) (ref (1- j)))
+                                        (decf j))
+                               (setf (ref j) x)
+                               (incf moved (- i j))
+                               (when (> moved limit)
+                                 (return-from insertion-sort nil))))
+                    t))
+                (sift-down (begin root size)
+                  (declare (fixnum begin root size))
+                  (let ((x (ref (+ begin root))))
+                    (loop (let ((child (1+ (* 2 root))))
+                            (declare (fixnum child))
+                            (when (>= child size) (return))
+                            (when (and (< (1+ child) size)
+                                       (less (ref (+ begin child)) (ref (+ begin child 1))))
+                              (incf child))
+                            (unless (less x (ref (+ begin child))) (return))
+                            (setf (ref (+ begin root)) (ref (+ begin child))
+                                  root child)))
+                    (setf (ref (+ begin root)) x)))
+                (heapsort (begin end)
+                  (declare (fixnum begin end))
+                  (let ((size (- end begin)))
+                    (declare (fixnum size))
+                    (loop for root of-type fixnum from (1- (floor size 2)) downto 0
+                          do (sift-down begin root size))
+                    (loop for last of-type fixnum from (1- size) above 0
+                          do (swap begin (+ begin last))
+                             (sift-down begin 0 last))))
+                (partition-right (begin end)
+                  ;; Partition around the pivot at BEGIN, with the elements
+                  ;; equal to it on the right. Return the pivot's new index,
+                  ;; and whether the range was already partitioned.
+                  (declare (fixnum begin end))
+                  (let ((pivot (ref begin))
+                        (first begin)
+                        (last end))
+                    (declare (fixnum first last))
+                    (loop do (incf first)
+                          while (and (< first end) (less (ref first) pivot)))
+                    (if (= (1- first) begin)
+                        (loop while (and (< first last)
+                                         (progn (decf last)
+                                                (not (less (ref last) pivot)))))
+                        (loop do (decf last)
+                              while (and (> last begin) (not (less (ref last) pivot)))))
+                    (let ((already-partitioned (>= first last)))
+                      (loop while (< first last)
+                            do (swap first last)
+                               (loop do (incf first)
+                                     while (and (< first end) (less (ref first) pivot)))
+                               (loop do (decf last)
+                                     while (and (> last begin) (not (less (ref last) pivot)))))
+                      (let ((pivot-index (1- first)))
+                        (setf (ref begin) (ref pivot-index)
+                              (ref pivot-index) pivot)
+                        (values pivot-index already-partitioned)))))
+                (partition-left (begin end)
+                  ;; Partition with the elements equal to the pivot on the
+                  ;; left. Used when the pivot equals the element before the
+                  ;; range, so that runs of equal elements take linear time.
+                  (declare (fixnum begin end))
+                  (let ((pivot (ref begin))
+                        (first begin)
+                        (last end))
+                    (declare (fixnum first last))
+                    (loop do (decf last)
+                          while (and (> last begin) (less pivot (ref last))))
+                    (if (= (1+ last) end)
+                        (loop while (and (< first last)
+                                         (progn (incf first)
+                                                (not (less pivot (ref first))))))
+                        (loop do (incf first)
+                              while (and (< first end) (not (less pivot (ref first))))))
+                    (loop while (< first last)
+                          do (swap first last)
+                             (loop do (decf last)
+                                   while (and (> last begin) (less pivot (ref last))))
+                             (loop do (incf first)
+                                   while (and (< first end) (not (less pivot (ref first))))))
+                    (setf (ref begin) (ref last)
+                          (ref last) pivot)
+                    last))
+                (pdqsort-loop (begin end bad-allowed leftmost)
+                  (declare (fixnum begin end bad-allowed))
+                  (loop
+                    (let ((size (- end begin)))
+                      (declare (fixnum size))
+                      (when (< size 24)
+                        (insertion-sort begin end most-positive-fixnum)
+                        (return))
+                      (let ((half (floor size 2)))
+                        (declare (fixnum half))
+                        (cond ((> size 128)
+                               (sort3 begin (+ begin half) (- end 1))
+                               (sort3 (+ begin 1) (+ begin half -1) (- end 2))
+                               (sort3 (+ begin 2) (+ begin half 1) (- end 3))
+                               (sort3 (+ begin half -1) (+ begin half) (+ begin half 1))
+                               (swap begin (+ begin half)))
+                              (t (sort3 (+ begin half) begin (- end 1)))))
+                      (if (and (not leftmost) (not (less (ref (1- begin)) (ref begin))))
+                          (setf begin (1+ (partition-left begin end)))
+                          (multiple-value-bind (pivot already-partitioned)
+                              (partition-right begin end)
+                            (declare (fixnum pivot))
+                            (let ((left-size (- pivot begin))
+                                  (right-size (- end pivot 1)))
+                              (declare (fixnum left-size right-size))
+                              (cond ((or (< left-size (floor size 8))
+                                         (< right-size (floor size 8)))
+                                     (when (zerop (decf bad-allowed))
+                                       (heapsort begin end)
+                                       (return))
+                                     (when (>= left-size 24)
+                                       (let ((quarter (floor left-size 4)))
+                                         (declare (fixnum quarter))
+                                         (swap begin (+ begin quarter))
+                                         (swap (- pivot 1) (- pivot quarter))
+                                         (when (> left-size 128)
+                                           (swap (+ begin 1) (+ begin quarter 1))
+                                           (swap (+ begin 2) (+ begin quarter 2))
+                                           (swap (- pivot 2) (- pivot quarter 1))
+                                           (swap (- pivot 3) (- pivot quarter 2)))))
+                                     (when (>= right-size 24)
+                                       (let ((quarter (floor right-size 4)))
+                                         (declare (fixnum quarter))
+                                         (swap (+ pivot 1) (+ pivot 1 quarter))
+                                         (swap (- end 1) (- end quarter))
+                                         (when (> right-size 128)
+                                           (swap (+ pivot 2) (+ pivot 2 quarter))
+                                           (swap (+ pivot 3) (+ pivot 3 quarter))
+                                           (swap (- end 2) (- end quarter 1))
+                                           (swap (- end 3) (- end quarter 2))))))
+                                    ((and already-partitioned
+                                          (insertion-sort begin pivot 8)
+                                          (insertion-sort (1+ pivot) end 8))
+                                     (return)))
+                              (pdqsort-loop begin pivot bad-allowed leftmost)
+                              (setf begin (1+ pivot)
+                                    leftmost nil))))))))
+         (pdqsort-loop start end (integer-length (- end start)) t)
+         vector))))
+
+(define-pdqsort pdqsort-simple-vector simple-vector svref)
+(define-pdqsort pdqsort-vector vector aref)
+
+(defun pdqsort (vector start end predicate key)
+  (if (simple-vector-p vector)
+      (pdqsort-simple-vector vector start end predicate key)
+      (pdqsort-vector vector start end predicate key)))
+
+(defvar *parallel-sort-threshold* 1000000
+  "Vectors at least this long that SORT and STABLE-SORT can sort natively
+are sorted in parallel on the current task pool. NIL means never.")
+
+(defun native-sort-direction (predicate key)
+  "If vectors specialized to a real type can be sorted by PREDICATE and KEY
+with CORE:SORT-VECTOR-NATIVE, return :ASCENDING or :DESCENDING."
+  (when (or (null key) (eq key #'identity))
+    (cond ((eq predicate #'<) :ascending)
+          ((eq predicate #'>) :descending))))
+
+(defun sort-vector (vector predicate key stable)
+  (let* ((length (length vector))
+         (direction (native-sort-direction predicate key))
+         (descending (eq direction :descending))
+         (key (if (eq key #'identity) nil key)))
+    (cond ((not (and direction (core:sort-vector-native vector 0 0 descending)))
+           (if stable
+               (vector-merge-sort vector predicate key)
+               (pdqsort vector 0 length predicate key)))
+          ((and *parallel-sort-threshold*
+                (>= length *parallel-sort-threshold*)
+                (> (core:num-logical-processors) 1)
+                (fboundp 'mp::parallel-sort))
+           (mp::parallel-sort vector predicate :stable stable))
+          (t (core:sort-vector-native vector 0 length descending)
+             vector))))
 
 
 (defun stable-sort-merge-vectors (source target start-1
@@ -1078,7 +1260,7 @@ SEQUENCE.  See SORT."
         ((or (stringp sequence) (bit-vector-p sequence))
          (sort sequence predicate :key key))
         ((vectorp sequence)
-         (vector-merge-sort sequence predicate key))
+         (sort-vector sequence predicate key t))
         (t (apply #'sequence:stable-sort sequence predicate args))))
 
 (defun merge (result-type sequence1 sequence2 predicate &key key
@@ -0,0 +1,445 @@
+;;;;  tasks.lisp -- A work-stealing fork/join task pool.
+;;;;
+;;;; A task pool keeps a fixed set of long-lived worker processes, so that
+;;;; running a task costs a few atomic operations rather than the creation
+;;;; of a thread with its own stacks and binding tables.
+;;;;
+;;;; Each worker owns a Chase-Lev deque of futures. FORK from inside a worker
+;;;; pushes onto the bottom of its own deque, and the worker pops from the
+;;;; bottom, so nested fork/join runs depth first on one thread. Idle workers
+;;;; steal from the top of other workers' deques, taking the oldest and
+;;;; therefore usually largest piece of work. Tasks forked from outside the
+;;;; pool go through the pool's MP:CONCURRENT-QUEUE, which is also where idle
+;;;; workers sleep.
+;;;;
+;;;; JOIN never blocks a worker of the joined future's pool: it runs the
+;;;; joined task itself if nobody has claimed it yet, and otherwise runs other
+;;;; tasks until it completes. Any other thread sleeps until the future is
+;;;; settled, so tasks only ever run on the workers of their pool.
+;;;; Tasks run with the worker's dynamic environment, not the forking
+;;;; thread's, so special bindings made by the caller are not visible in them.
+
+(in-package "MP")
+
+(export '(task-pool task-pool-p make-task-pool task-pool-worker-count
+          shutdown-task-pool default-task-pool *task-pool*
+          future futurep future-done-p fork join
+          make-promise fulfill-promise fail-promise
+          parallel-map parallel-reduce parallel-sort))
+
+;;; Deques
+
+(defstruct (work-deque (:constructor make-work-deque ())
+                       (:copier nil) (:predicate nil))
+  ;; Tasks live at indices [top, bottom) of the circular buffer.
+  (top 0 :type fixnum)
+  (bottom 0 :type fixnum)
+  (buffer (make-array 64 :initial-element nil) :type simple-vector))
+
+(defun work-deque-push (deque task)
+  "Push TASK onto the bottom of DEQUE. Only the owner of DEQUE may call this."
+  (let* ((bottom (atomic (work-deque-bottom deque) :order :relaxed))
+         (top (atomic (work-deque-top deque) :order :acquire))
+         (buffer (atomic (work-deque-buffer deque) :order :relaxed)))
+    (when (>= (- bottom top) (length buffer))
+      ;; Full: copy the live tasks into a buffer twice the size. Thieves
+      ;; still reading the old buffer find the same tasks in it.
+      (let ((new (make-array (* 2 (length buffer)) :initial-element nil)))
+        (loop for i from top below bottom
+              do (setf (svref new (mod i (length new)))
+                       (svref buffer (mod i (length buffer)))))
+        (setf (atomic (work-deque-buffer deque) :order :release) new
+              buffer new)))
+    (setf (svref buffer (mod bottom (length buffer))) task)
+    (setf (atomic (work-deque-bottom deque) :order :release) (1+ bottom))
+    task))
+
+(defun work-deque-take (deque)
+  "Pop the most recently pushed task from DEQUE, or return NIL if it is
+empty. Only the owner of DEQUE may call this."
+  (let ((bottom (1- (atomic (work-deque-bottom deque) :order :relaxed)))
+        (buffer (atomic (work-deque-buffer deque) :order :relaxed)))
+    (setf (atomic (work-deque-bottom deque) :order :relaxed) bottom)
+    (fence :sequentially-consistent)
+    (let ((top (atomic (work-deque-top deque) :order :relaxed)))
+      (cond ((< bottom top)
+             (setf (atomic (work-deque-bottom deque) :order :relaxed) top)
+             nil)
+            ((= bottom top)
+             ;; The last task; thieves may be after it too.
+             (let ((task (svref buffer (mod bottom (length buffer))))
+                   (won (eql (cas (work-deque-top deque) top (1+ top)) top)))
+               (setf (atomic (work-deque-bottom deque) :order :relaxed) (1+ bottom))
+               (and won task)))
+            (t
+             (let ((index (mod bottom (length buffer))))
+               (prog1 (svref buffer index)
+                 (setf (svref buffer index) nil))))))))
+
+(defun work-deque-steal (deque)
+  "Take the oldest task from DEQUE. Return NIL if it is empty or another
+thread took the task first."
+  (let ((top (atomic (work-deque-top deque) :order :acquire)))
+    (fence :sequentially-consistent)
+    (let ((bottom (atomic (work-deque-bottom deque) :order :acquire)))
+      (when (< top bottom)
+        (let* ((buffer (atomic (work-deque-buffer deque) :order :acquire))
+               (task (svref buffer (mod top (length buffer)))))
+          (when (eql (cas (work-deque-top deque) top (1+ top)) top)
+            task))))))
+
+;;; Futures
+
+(defstruct (future (:constructor %make-future (function state &optional pool))
+                   (:predicate futurep) (:copier nil))
+  ;; NIL once run, and always for promises.
+  function
+  ;; The pool whose workers run the task, or NIL for promises.
+  (pool nil :read-only t)
+  ;; :PENDING (forked, not yet claimed), :PROMISED, :RUNNING, :DONE or
+  ;; :FAILED. Whoever moves a future out of :PENDING or :PROMISED settles it.
+  (state :pending)
+  ;; The list of values, or the condition of a failed future.
+  (result nil))
+
+;;; Threads that are not workers sleep here until a future settles.
+(defvar *future-lock* (make-lock :name "future-lock"))
+(defvar *future-settled* (make-condition-variable :name "future-settled"))
+(defvar *future-waiters* (list 0))
+
+(defun future-done-p (future)
+  "Return true if FUTURE has a value or has failed."
+  (member (atomic (future-state future)) '(:done :failed)))
+
+(defun settle-future (future state result)
+  (setf (future-result future) result
+        (future-function future) nil
+        (atomic (future-state future)) state)
+  (when (plusp (atomic (car *future-waiters*)))
+    (with-lock (*future-lock*)
+      (condition-variable-broadcast *future-settled*))))
+
+(defun run-claimed-future (future)
+  (handler-case (multiple-value-list (funcall (future-function future)))
+    (serious-condition (condition)
+      (settle-future future :failed condition))
+    (:no-error (values)
+      (settle-future future :done values))))
+
+(defun claim-future (future)
+  (eq (cas (future-state future) :pending :running) :pending))
+
+(defun run-future (future)
+  "Run FUTURE unless another thread has claimed it already."
+  (when (claim-future future)
+    (run-claimed-future future)))
+
+(defun make-promise ()
+  "Return a future that is settled by FULFILL-PROMISE or FAIL-PROMISE rather
+than by running a task."
+  (%make-future nil :promised))
+
+(defun claim-promise (promise)
+  (unless (eq (cas (future-state promise) :promised :running) :promised)
+    (error "~s has already been settled." promise)))
+
+(defun fulfill-promise (promise &rest values)
+  "Settle PROMISE with VALUES, waking up any threads joining it."
+  (claim-promise promise)
+  (settle-future promise :done values)
+  promise)
+
+(defun fail-promise (promise condition)
+  "Settle PROMISE so that joining it signals CONDITION."
+  (claim-promise promise)
+  (settle-future promise :failed condition)
+  promise)
+
+;;; Pools
+
+(defstruct (task-pool (:constructor %make-task-pool (name queue))
+                      (:copier nil))
+  name
+  ;; Tasks forked from outside the pool, and :WAKE and :SHUTDOWN tokens.
+  queue
+  (workers #() :type simple-vector)
+  ;; The number of workers sleeping on QUEUE.
+  (idle 0 :type fixnum))
+
+(defstruct (worker (:constructor make-worker (pool index))
+                   (:copier nil) (:predicate nil))
+  pool
+  index
+  (deque (make-work-deque))
+  ;; Where to start looking for a victim next time.
+  (victim 0 :type fixnum)
+  process)
+
+(defvar *current-worker* nil
+  "The worker structure of the current thread, if it is a task pool worker.")
+
+(defvar *task-pool* nil
+  "The pool used by FORK, PARALLEL-MAP and PARALLEL-REDUCE when no pool is
+given. If NIL, DEFAULT-TASK-POOL creates it on first use.")
+
+(defun task-pool-worker-count (pool)
+  (length (task-pool-workers pool)))
+
+(defun steal-task (worker)
+  (let* ((workers (task-pool-workers (worker-pool worker)))
+         (count (length workers)))
+    (loop repeat count
+          for victim = (svref workers (setf (worker-victim worker)
+                                            (mod (1+ (worker-victim worker)) count)))
+          unless (eq victim worker)
+            do (let ((task (work-deque-steal (worker-deque victim))))
+                 (when task (return task))))))
+
+(defun next-task (worker)
+  "Return a task for WORKER from its own deque, the pool's queue or another
+worker's deque, or :SHUTDOWN, or NIL if there is nothing to do."
+  (or (work-deque-take (worker-deque worker))
+      (loop with queue = (task-pool-queue (worker-pool worker))
+            for item = (concurrent-dequeue queue 0 nil)
+            while item
+            unless (eq item :wake)
+              return item)
+      (steal-task worker)))
+
+(defun worker-loop (worker)
+  (let* ((*current-worker* worker)
+         (pool (worker-pool worker))
+         (queue (task-pool-queue pool)))
+    (loop
+      (let ((task (next-task worker)))
+        (when (null task)
+          ;; Announce that we are going to sleep, then look once more so
+          ;; that a task forked in the meantime isn't left waiting.
+          (atomic-incf (task-pool-idle pool))
+          ;; Pairs with the fence in FORK: either it sees us idle or we see
+          ;; its task.
+          (fence :sequentially-consistent)
+          (setf task (or (next-task worker) (concurrent-dequeue queue)))
+          (atomic-decf (task-pool-idle pool)))
+        (case task
+          (:shutdown (return))
+          (:wake)
+          (t (run-future task)))))))
+
+(defun make-task-pool (&key (name "task-pool")
+                            (workers (core:num-logical-processors)))
+  "Make a pool of WORKERS worker processes that run forked tasks."
+  (let ((pool (%make-task-pool name (make-concurrent-queue :name name))))
+    (setf (task-pool-workers pool)
+          (coerce (loop for index below workers
+                        collect (make-worker pool index))
+                  'simple-vector))
+    (loop for worker across (task-pool-workers pool)
+          do (let ((worker worker))
+               (setf (worker-process worker)
+                     (process-run-function
+                      (format nil "~a-~d" name (worker-index worker))
+                      (lambda () (worker-loop worker))))))
+    pool))
+
+(defvar *default-task-pool-lock* (make-lock :name "default-task-pool"))
+
+(defun default-task-pool ()
+  "Return *TASK-POOL*, creating a pool with one worker per logical processor
+if it is NIL."
+  (or *task-pool*
+      (with-lock (*default-task-pool-lock*)
+        (or *task-pool*
+            (setf *task-pool* (make-task-pool :name "default-task-pool"))))))
+
+(defun shutdown-task-pool (pool)
+  "Stop the workers of POOL once they have finished their current tasks, and
+wait for them to exit. Tasks that have not started yet are never run."
+  (when (eq pool *task-pool*)
+    (setf *task-pool* nil))
+  (loop repeat (task-pool-worker-count pool)
+        do (concurrent-enqueue (task-pool-queue pool) :shutdown))
+  (loop for worker across (task-pool-workers pool)
+        do (process-join (worker-process worker)))
+  pool)
+
+;;; Fork and join
+
+(defun current-pool ()
+  (if *current-worker*
+      (worker-pool *current-worker*)
+      (default-task-pool)))
+
+(defun fork (function &optional (pool (current-pool)))
+  "Arrange for POOL to call FUNCTION with no arguments and return a future
+for its values."
+  (let ((future (%make-future function :pending pool)))
+    (cond ((and *current-worker* (eq (worker-pool *current-worker*) pool))
+           (work-deque-push (worker-deque *current-worker*) future)
+           ;; Order the push before reading IDLE, see WORKER-LOOP.
+           (fence :sequentially-consistent)
+           (when (plusp (atomic (task-pool-idle pool)))
+             (concurrent-enqueue (task-pool-queue pool) :wake)))
+          (t (concurrent-enqueue (task-pool-queue pool) future)))
+    future))
+
+(defun wait-for-future (future)
+  (with-lock (*future-lock*)
+    (atomic-incf (car *future-waiters*))
+    (unwind-protect
+         (loop until (future-done-p future)
+               do (condition-variable-wait *future-settled* *future-lock*))
+      (atomic-decf (car *future-waiters*)))))
+
+(defun join (future)
+  "Wait for FUTURE to settle and return its values, or signal the condition
+it failed with. A worker of FUTURE's pool runs FUTURE itself if it has not
+started yet, and other tasks while it waits."
+  (let ((worker (and *current-worker*
+                     (member (future-pool future) (list nil (worker-pool *current-worker*)))
+                     *current-worker*)))
+    (loop until (future-done-p future)
+          do (cond ((null worker)
+                    (wait-for-future future))
+                   ((claim-future future)
+                    (run-claimed-future future))
+                   (t
+                    (let ((task (next-task worker)))
+                      (case task
+                        ((nil) (process-yield))
+                        (:shutdown
+                         (concurrent-enqueue (task-pool-queue (worker-pool worker)) :shutdown)
+                         (process-yield))
+                        (t (run-future task))))))))
+  (if (eq (atomic (future-state future)) :failed)
+      (error (future-result future))
+      (values-list (future-result future))))
+
+(defun call-in-pool (pool function)
+  "Call FUNCTION on a worker of POOL and return its values."
+  (if (and *current-worker* (eq (worker-pool *current-worker*) pool))
+      (funcall function)
+      (join (fork function pool))))
+
+;;; Parallel sequence functions
+
+(defun default-grain-size (length pool)
+  ;; Enough pieces to balance the load without drowning in tasks
+  (max 1 (ceiling length (* 8 (task-pool-worker-count pool)))))
+
+(defun parallel-range (start end grain-size function pool)
+  "Call FUNCTION on consecutive subranges of [START, END), each no longer
+than GRAIN-SIZE, in parallel."
+  (if (<= (- end start) grain-size)
+      (funcall function start end)
+      (let* ((middle (floor (+ start end) 2))
+             (right (fork (lambda ()
+                            (parallel-range middle end grain-size function pool))
+                          pool)))
+        (parallel-range start middle grain-size function pool)
+        (join right))))
+
+(defun parallel-map (result-type function vector
+                     &key (pool (current-pool)) grain-size)
+  "Like MAP with a single vector, but calls FUNCTION on the elements of
+VECTOR in parallel on the workers of POOL. GRAIN-SIZE is the number of
+consecutive elements handled by one task. If RESULT-TYPE is NIL, returns NIL."
+  (let* ((length (length vector))
+         (grain-size (or grain-size (default-grain-size length pool)))
+         ;; Elements narrower than a word can't be stored from several
+         ;; threads at once, so collect the results in a simple-vector.
+         (results (and result-type (make-array length))))
+    (when (plusp length)
+      (call-in-pool
+       pool
+       (lambda ()
+         (parallel-range 0 length grain-size
+                         (lambda (start end)
+                           (loop for index from start below end
+                                 for value = (funcall function (aref vector index))
+                                 when results
+                                   do (setf (svref results index) value)))
+                         pool))))
+    (cond ((null result-type) nil)
+          ((subtypep result-type 'simple-vector) results)
+          (t (coerce results result-type)))))
+
+(defun parallel-reduce (function vector
+                        &key (pool (current-pool)) key grain-size
+                          (initial-value nil initial-value-p))
+  "Like REDUCE on VECTOR, but reduces pieces of VECTOR in parallel on the
+workers of POOL and then combines their results. FUNCTION must be
+associative. GRAIN-SIZE is the number of consecutive elements reduced by
+one task."
+  (let* ((length (length vector))
+         (grain-size (or grain-size (default-grain-size length pool))))
+    (if (zerop length)
+        (if initial-value-p initial-value (funcall function))
+        (let ((value
+                (call-in-pool
+                 pool
+                 (lambda ()
+                   (labels ((reduce-range (start end)
+                              (if (<= (- end start) grain-size)
+                                  (reduce function vector :start start :end end :key key)
+                                  (let* ((middle (floor (+ start end) 2))
+                                         (right (fork (lambda () (reduce-range middle end))
+                                                      pool))
+                                         (left (reduce-range start middle)))
+                                    (funcall function left (join right))))))
+                     (reduce-range 0 length))))))
+          (if initial-value-p
+              (funcall function initial-value value)
+              value)))))
+
+(defun parallel-sort (vector predicate &key key (pool (current-pool)) stable grain-size)
+  "Like SORT on VECTOR, or STABLE-SORT if STABLE is true, but sorts pieces of
+VECTOR in parallel on the workers of POOL and then merges them. GRAIN-SIZE is
+the number of consecutive elements sorted by one task. PREDICATE and KEY are
+called on the workers, so they must not depend on special bindings made by
+the caller. Vectors that are neither simple-vectors nor sortable by
+CORE:SORT-VECTOR-NATIVE are sorted sequentially."
+  (let* ((predicate (core:coerce-fdesignator predicate))
+         (key (and key (core:coerce-fdesignator key)))
+         (key (if (eq key #'identity) nil key))
+         (length (length vector))
+         (direction (core::native-sort-direction predicate key))
+         (descending (eq direction :descending))
+         (native (and direction (core:sort-vector-native vector 0 0 descending)))
+         ;; Pieces shorter than this are sorted faster than they are forked.
+         (grain-size (or grain-size (max 8192 (default-grain-size length pool))))
+         (temp (and (not native) (make-array length))))
+    (flet ((sort-piece (start end)
+             (cond (native (core:sort-vector-native vector start end descending))
+                   (stable (replace vector
+                                    (core::vector-merge-sort (subseq vector start end)
+                                                             predicate key)
+                                    :start1 start))
+                   (t (core::pdqsort vector start end predicate key))))
+           (merge-pieces (start middle end)
+             (cond (native (core:merge-vector-native vector start middle end descending))
+                   (t (core::stable-sort-merge-vectors vector temp start middle end
+                                                       predicate key)
+                      (replace vector temp :start1 start :end1 end :start2 start)))))
+      (cond ((not (or native (simple-vector-p vector)))
+             (if stable
+                 (stable-sort vector predicate :key key)
+                 (sort vector predicate :key key)))
+            ((<= length grain-size)
+             (sort-piece 0 length)
+             vector)
+            (t
+             (call-in-pool
+              pool
+              (lambda ()
+                (labels ((sort-range (start end)
+                           (if (<= (- end start) grain-size)
+                               (sort-piece start end)
+                               (let* ((middle (floor (+ start end) 2))
+                                      (right (fork (lambda () (sort-range middle end))
+                                                   pool)))
+                                 (sort-range start middle)
+                                 (join right)
+                                 (merge-pieces start middle end)))))
+                  (sort-range 0 length))))
+             vector)))))
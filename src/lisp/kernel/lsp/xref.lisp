@@ -41,11 +41,11 @@
         nil)))
 
 ;;; Iterate through a module's instructions and return xrefs for all
-;;; IPs for which the instruction is MNEMONIC, and which have a single
-;;; constant argument that is the cell.
+;;; IPs for which the instruction is one of MNEMONICS, and which have a
+;;; single constant argument that is the cell.
 ;;; (all of the instructions we're interested in for xref have this
 ;;;  format, so it works out ok to be specific)
-(defun module-find-by-mnemonic (mnemonic cell module)
+(defun module-find-by-mnemonic (mnemonics cell module)
   (let ((results nil)
         ;; do-module-instructions has something like (:CONSTANT . n)
         ;; where n is a literal index, so get that index ahead of time.
@@ -53,21 +53,28 @@
           (position cell (core:bytecode-module/literals module))))
     (do-module-instructions (mnem args opip ip)
         (module)
-      (when (eql mnem mnemonic)
+      (when (member mnem mnemonics)
         (let ((arg (first args)))
           (when (eql (cdr arg) cell-pos)
             (let ((xref (xref-at-ip opip module)))
               (when xref (push xref results)))))))
     results))
 
+;;; Instructions that call the function in their constant function cell.
+;;; Besides called-fdefinition, these are the primitive instructions that
+;;; the compiler uses for CAR, fixnum arithmetic, etc.
+(defparameter *call-mnemonics*
+  '(:called-fdefinition :add :sub :lt :le :gt :ge :num-eq
+    :car :cdr :svref :aref))
+
 (defun module-callers (fcell module)
-  (module-find-by-mnemonic :called-fdefinition fcell module))
+  (module-find-by-mnemonic *call-mnemonics* fcell module))
 (defun module-binders (vcell module)
-  (module-find-by-mnemonic :special-bind vcell module))
+  (module-find-by-mnemonic '(:special-bind) vcell module))
 (defun module-referencers (vcell module)
-  (module-find-by-mnemonic :symbol-value vcell module))
+  (module-find-by-mnemonic '(:symbol-value) vcell module))
 (defun module-setters (vcell module)
-  (module-find-by-mnemonic :symbol-value-set vcell module))
+  (module-find-by-mnemonic '(:symbol-value-set) vcell module))
 
 ;;; If the cell is NIL, return NIL. Otherwise accumulate results.
 ;;; Search through all modules to find ones that reference the cell.
@@ -123,7 +130,7 @@ Returns an alist. Each CAR is name of the function using the macro, and the CDR
          (end (core:bytecode-debug-info/end fun))
          (result nil))
     (do-module-instructions (mnem args opip ip) (module)
-      (when (and (<= start opip end) (eql mnem :called-fdefinition))
+      (when (and (<= start opip end) (member mnem *call-mnemonics*))
         (let* ((arg (first args))
                (pos (cdr arg))
                (cell (aref literals pos))
@@ -34,28 +34,50 @@
 ;;
 ;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
 
+;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
+;;
+;; Two backends are provided, see *SERVE-EVENT-BACKEND*. :SELECT works
+;; everywhere but is limited to FD_SETSIZE descriptors and rescans
+;; every handler on each call. :EPOLL (Linux) keeps the interest set
+;; in the kernel, so a wakeup costs O(ready descriptors), and it also
+;; supports edge-triggered handlers. Timers (ADD-TIMER) work with both.
+;;
+;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
+
 (defpackage "SERVE-EVENT"
   (:use "CL" #-clasp "UFFI" #+clasp "SERVE-EVENT-INTERNAL")
   (:export "WITH-FD-HANDLER" "ADD-FD-HANDLER" "REMOVE-FD-HANDLER"
-           "SERVE-EVENT" "SERVE-ALL-EVENTS"))
+           "INVALIDATE-DESCRIPTOR" "ADD-TIMER" "REMOVE-TIMER"
+           "*SERVE-EVENT-BACKEND*" "SERVE-EVENT" "SERVE-ALL-EVENTS"))
 (in-package "SERVE-EVENT")
 
 
 (defstruct (handler
-             (:constructor make-handler (descriptor direction function))
+             (:constructor make-handler (descriptor direction function
+                                         &optional (trigger :level)))
              (:copier nil))
   ;; Reading or writing...
   (direction nil :type (member :input :output))
   ;; File descriptor this handler is tied to.
-  ;; FIXME: Should be based on FD_SETSIZE
   (descriptor 0)
   ;; Function to call.
-  (function nil :type function))
+  (function nil :type function)
+  ;; :LEVEL handlers are called while the descriptor is usable, :EDGE
+  ;; handlers only when it becomes usable (:EPOLL backend only).
+  (trigger :level :type (member :level :edge))
+  ;; Cleared by REMOVE-FD-HANDLER so that an event that is already being
+  ;; dispatched doesn't call a handler that was just removed.
+  (active t))
 
 
-(defvar *descriptor-handlers* nil
+(defvar *descriptor-handlers* (make-hash-table)
   ;;  #!+sb-doc
-  "List of all the currently active handlers for file descriptors")
+  "Map from file descriptor to the list of its currently active handlers")
+
+(defvar *serve-event-backend*
+  (if (ll-epoll-available-p) :epoll :select)
+  "The mechanism SERVE-EVENT waits with: :EPOLL where available, otherwise
+:SELECT. :EDGE triggered handlers behave like :LEVEL ones under :SELECT.")
 
 (defun coerce-to-descriptor (stream-or-fd direction)
   (if (typep stream-or-fd 'fixnum)
@@ -63,45 +85,133 @@
       (gray:stream-file-descriptor stream-or-fd direction)))
 
 ;;; Add a new handler to *descriptor-handlers*.
-(defun add-fd-handler (stream-or-fd direction function)
+(defun add-fd-handler (stream-or-fd direction function &key (trigger :level))
   "Arrange to call FUNCTION whenever the fd designated by STREAM-OR-FD
-  is usable. DIRECTION should be either :INPUT or :OUTPUT. The value
-  returned should be passed to SYSTEM:REMOVE-FD-HANDLER when it is no
-  longer needed."
+  is usable. DIRECTION should be either :INPUT or :OUTPUT. TRIGGER is
+  :LEVEL (the default) to call FUNCTION for as long as the fd is usable,
+  or :EDGE to call it only when the fd becomes usable, in which case
+  FUNCTION must consume everything available. The value returned should
+  be passed to SYSTEM:REMOVE-FD-HANDLER when it is no longer needed."
   (unless (member direction '(:input :output))
     (error 'simple-type-error
            :format-control "Invalid direction ~S, must be either :INPUT or :OUTPUT."
            :format-arguments (list direction)
            :datum direction
            :expected-type '(member :input :output)))
-  (let ((handler (make-handler (coerce-to-descriptor stream-or-fd direction)
-                               direction
-                               function)))
-    (push handler *descriptor-handlers*)
+  (unless (member trigger '(:level :edge))
+    (error 'simple-type-error
+           :format-control "Invalid trigger ~S, must be either :LEVEL or :EDGE."
+           :format-arguments (list trigger)
+           :datum trigger
+           :expected-type '(member :level :edge)))
+  (let* ((fd (coerce-to-descriptor stream-or-fd direction))
+         (handler (make-handler fd direction function trigger)))
+    (push handler (gethash fd *descriptor-handlers*))
+    (epoll-note-change fd)
     handler))
 
 ;;; Remove an old handler from *descriptor-handlers*.
 (defun remove-fd-handler (handler)
   ;;  #!+sb-doc
   "Removes HANDLER from the list of active handlers."
-  (setf *descriptor-handlers*
-        (delete handler *descriptor-handlers*)))
+  (let* ((fd (handler-descriptor handler))
+         (handlers (delete handler (gethash fd *descriptor-handlers*))))
+    (setf (handler-active handler) nil)
+    (if handlers
+        (setf (gethash fd *descriptor-handlers*) handlers)
+        (remhash fd *descriptor-handlers*))
+    (epoll-note-change fd)))
+
+(defun invalidate-descriptor (fd)
+  "Remove all handlers for FD. Call this before closing FD."
+  (dolist (handler (gethash fd *descriptor-handlers*))
+    (setf (handler-active handler) nil))
+  (remhash fd *descriptor-handlers*)
+  (epoll-note-change fd))
 
 ;;; Add the handler to *descriptor-handlers* for the duration of BODY.
-(defmacro with-fd-handler ((fd direction function) &rest body)
+(defmacro with-fd-handler ((fd direction function &rest options) &rest body)
   "Establish a handler with SYSTEM:ADD-FD-HANDLER for the duration of BODY.
    DIRECTION should be either :INPUT or :OUTPUT, FD is the file descriptor to
-   use, and FUNCTION is the function to call whenever FD is usable."
+   use, and FUNCTION is the function to call whenever FD is usable. OPTIONS
+   are passed on to ADD-FD-HANDLER."
   (let ((handler (gensym)))
     `(let (,handler)
        (unwind-protect
             (progn
-              (setf ,handler (add-fd-handler ,fd ,direction ,function))
+              (setf ,handler (add-fd-handler ,fd ,direction ,function ,@options))
               ,@body)
          (when ,handler
            (remove-fd-handler ,handler))))))
 
 
+;;; Timers
+
+(defstruct (timer
+             (:constructor make-timer (expiry interval function))
+             (:copier nil))
+  ;; INTERNAL-REAL-TIME at which the timer fires.
+  (expiry 0)
+  ;; Internal time units between repetitions, or NIL for a one-shot timer.
+  (interval nil)
+  ;; Function to call, with no arguments.
+  (function nil :type function))
+
+(defvar *timers* nil
+  "Pending timers, soonest first")
+
+(defun seconds-to-internal-time (seconds)
+  (values (ceiling (* seconds internal-time-units-per-second))))
+
+(defun schedule-timer (timer)
+  (setf *timers* (merge 'list (list timer) *timers* #'< :key #'timer-expiry))
+  timer)
+
+(defun add-timer (seconds function &key repeat)
+  "Arrange for SERVE-EVENT to call FUNCTION, with no arguments, once SECONDS
+  have passed. If REPEAT is true FUNCTION is called again every SECONDS (or
+  every REPEAT seconds, if REPEAT is a number) until the timer is removed.
+  Return the timer, to be passed to REMOVE-TIMER."
+  (let ((interval (cond ((realp repeat) (seconds-to-internal-time repeat))
+                        (repeat (seconds-to-internal-time seconds)))))
+    (when (and interval (not (plusp interval)))
+      (error "The repeat interval of a timer must be positive, not ~s" repeat))
+    (schedule-timer (make-timer (+ (get-internal-real-time)
+                                   (seconds-to-internal-time seconds))
+                                interval
+                                (coerce function 'function)))))
+
+(defun remove-timer (timer)
+  "Cancel TIMER."
+  (setf *timers* (delete timer *timers*))
+  nil)
+
+(defun wait-timeout (seconds)
+  "How long to wait for descriptors given a timeout of SECONDS (NIL meaning
+forever) and the pending timers."
+  (if (null *timers*)
+      seconds
+      (let ((until-timer (max 0 (/ (- (timer-expiry (first *timers*))
+                                      (get-internal-real-time))
+                                   internal-time-units-per-second))))
+        (if seconds (min seconds until-timer) until-timer))))
+
+(defun run-expired-timers ()
+  "Call the functions of all timers that are due. Return T if any was."
+  (let ((now (get-internal-real-time))
+        (ran nil))
+    (loop while (and *timers* (<= (timer-expiry (first *timers*)) now))
+          do (let ((timer (pop *timers*)))
+               (when (timer-interval timer)
+                 (setf (timer-expiry timer) (+ now (timer-interval timer)))
+                 (schedule-timer timer))
+               (setf ran t)
+               (funcall (timer-function timer))))
+    ran))
+
+
+;;; select backend
+
 (defmacro fd-zero(fdset)
   `(ll-fd-zero ,fdset))
 
@@ -112,16 +222,10 @@
   `(ll-fd-isset ,fd ,fdset))
 
 (defun fdset-size ()
-  `(ll-fdset-size))
-
+  (ll-fdset-size))
 
-(defun serve-event (&optional (seconds nil))
-  "Receive pending events on all FD-STREAMS and dispatch to the appropriate
-   handler functions. If timeout is specified, server will wait the specified
-   time (in seconds) and then return, otherwise it will wait until something
-   happens. Server returns T if something happened and NIL otherwise. Timeout
-   0 means polling without waiting."
 
+(defun serve-event-select (seconds)
   ;; fd_set is an opaque typedef, so we can't declare it locally.
   ;; However we can fine out its size and allocate a char array of
   ;; the same size which can be used in its place.
@@ -132,13 +236,16 @@
       (fd-zero wfd)
       (let ((maxfd 0))
         ;; Load the descriptors into the relevant set
-        (dolist (handler *descriptor-handlers*)
-          (let ((fd (handler-descriptor handler)))
-            (ecase (handler-direction handler)
-              (:input (fd-set fd rfd))
-              (:output (fd-set fd wfd)))
-            (when (> fd maxfd)
-              (setf maxfd fd))))
+        (maphash (lambda (fd handlers)
+                   (when (>= fd (* 8 fsize))
+                     (error "File descriptor ~d can't be served with select - use the :epoll backend" fd))
+                   (dolist (handler handlers)
+                     (ecase (handler-direction handler)
+                       (:input (fd-set fd rfd))
+                       (:output (fd-set fd wfd))))
+                   (when (> fd maxfd)
+                     (setf maxfd fd)))
+                 *descriptor-handlers*)
 
         (multiple-value-bind (retval errno)
 	    (if (null seconds)
@@ -154,17 +261,118 @@
 		     nil
 		     ;; otherwise error
 		     (error "Error during select retval:~A errno:~A" retval errno)))
-		((plusp retval)  
-		 (dolist (handler *descriptor-handlers*)
-		   (let ((fd (handler-descriptor handler)))
-		     (if (plusp (ecase (handler-direction handler)
-				  (:input (fd-isset fd rfd))
-				  (:output (fd-isset fd wfd))))
-			 (funcall (handler-function handler) 
-				  (handler-descriptor handler)))))
+		((plusp retval)
+                 ;; Handlers may add or remove handlers, so find the ready
+                 ;; ones before calling any of them
+                 (let ((ready nil))
+                   (maphash (lambda (fd handlers)
+                              (dolist (handler handlers)
+                                (when (plusp (ecase (handler-direction handler)
+                                               (:input (fd-isset fd rfd))
+                                               (:output (fd-isset fd wfd))))
+                                  (push handler ready))))
+                            *descriptor-handlers*)
+                   (dolist (handler ready)
+                     (when (handler-active handler)
+                       (funcall (handler-function handler)
+                                (handler-descriptor handler)))))
 		 t)))))))
 
 
+;;; epoll backend
+;;;
+;;; Changes to the handlers are only noted when they are made and passed
+;;; to the kernel the next time we wait, so that adding and removing
+;;; handlers costs no system calls unless the :EPOLL backend is in use.
+
+(defvar *epoll-descriptor* nil
+  "The epoll instance, created on first use")
+(defvar *epoll-pid* nil
+  "The process that created *EPOLL-DESCRIPTOR* - a forked child or a
+restarted snapshot needs a new instance")
+(defvar *epoll-changed* (make-hash-table)
+  "Descriptors whose handlers changed since the epoll instance was updated")
+(defparameter *epoll-max-events* 256
+  "The most events collected by one wait")
+
+(defun epoll-note-change (fd)
+  (setf (gethash fd *epoll-changed*) t))
+
+(defun epoll-descriptor ()
+  (unless (and *epoll-descriptor* (eql *epoll-pid* (core:getpid)))
+    (multiple-value-bind (epfd errno) (ll-epoll-create)
+      (when (minusp epfd)
+        (error "Could not create an epoll instance errno:~A" errno))
+      (setf *epoll-descriptor* epfd
+            *epoll-pid* (core:getpid))
+      ;; A fresh instance watches nothing
+      (maphash (lambda (fd handlers)
+                 (declare (ignore handlers))
+                 (epoll-note-change fd))
+               *descriptor-handlers*)))
+  *epoll-descriptor*)
+
+(defun epoll-update (epfd)
+  (maphash (lambda (fd changed)
+             (declare (ignore changed))
+             (let ((input nil) (output nil) (edge t))
+               (dolist (handler (gethash fd *descriptor-handlers*))
+                 (ecase (handler-direction handler)
+                   (:input (setf input t))
+                   (:output (setf output t)))
+                 ;; One epoll registration serves all the handlers of an
+                 ;; fd, so it is edge triggered only if they all are
+                 (when (eq (handler-trigger handler) :level)
+                   (setf edge nil)))
+               (multiple-value-bind (retval errno)
+                   (ll-epoll-update epfd fd input output edge)
+                 (when (minusp retval)
+                   (error "Error during epoll_ctl fd:~A errno:~A" fd errno)))))
+           *epoll-changed*)
+  (clrhash *epoll-changed*))
+
+(defun serve-event-epoll (seconds)
+  (let ((epfd (epoll-descriptor)))
+    (epoll-update epfd)
+    (clasp-ffi:with-foreign-objects
+        ((events `(:array :unsigned-byte ,(* *epoll-max-events* (ll-epoll-event-size)))))
+      (multiple-value-bind (retval errno)
+          (ll-epoll-wait epfd events *epoll-max-events* seconds)
+        (cond ((zerop retval)
+               nil)
+              ((minusp retval)
+               (if (= errno +eintr+)
+                   ;; suppress EINTR
+                   nil
+                   ;; otherwise error
+                   (error "Error during epoll_wait retval:~A errno:~A" retval errno)))
+              (t
+               (dotimes (index retval)
+                 (multiple-value-bind (fd input output)
+                     (ll-epoll-event events index)
+                   (dolist (handler (copy-list (gethash fd *descriptor-handlers*)))
+                     (when (and (handler-active handler)
+                                (ecase (handler-direction handler)
+                                  (:input input)
+                                  (:output output)))
+                       (funcall (handler-function handler) fd)))))
+               t))))))
+
+
+(defun serve-event (&optional (seconds nil))
+  "Receive pending events on all FD-STREAMS and dispatch to the appropriate
+   handler functions. If timeout is specified, server will wait the specified
+   time (in seconds) and then return, otherwise it will wait until something
+   happens. Due timers are run as well. Server returns T if something happened
+   and NIL otherwise. Timeout 0 means polling without waiting."
+  (let* ((wait (wait-timeout seconds))
+         (served (ecase *serve-event-backend*
+                   (:epoll (serve-event-epoll wait))
+                   (:select (serve-event-select wait))))
+         (timers (run-expired-timers)))
+    (or served timers)))
+
+
 ;;; Wait for up to timeout seconds for an event to happen. Make sure all
 ;;; pending events are processed before returning.
 (defun serve-all-events (&optional (timeout nil))
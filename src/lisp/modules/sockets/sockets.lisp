@@ -27,7 +27,8 @@
           NETDB-SUCCESS-ERROR NETDB-INTERNAL-ERROR
           HOST-NOT-FOUND-ERROR TRY-AGAIN-ERROR NO-RECOVERY-ERROR
           ;;; but aren't
-          HOST-ENT-ADDRESSES HOST-ENT HOST-ENT-ADDRESS SOCKET-SEND))
+          HOST-ENT-ADDRESSES HOST-ENT HOST-ENT-ADDRESS SOCKET-SEND
+          SOCKET-SEND-FILE SOCKET-SPLICE COPY-STREAM-OCTETS))
 
 
 
@@ -210,6 +211,19 @@ depends on the socket type (for example for inet domain sockets it would be a
 list of an ip address and a port). If no socket address is provided, send(2) 
 will be called instead. Returns the number of octets written."))
 
+(defgeneric socket-send-file (socket file &key start end)
+  (:documentation "Send the octets of FILE from START to END (by default, the end of the file)
+into SOCKET. FILE is a pathname designator or a binary file stream, whose own
+position is neither used nor changed. Uses sendfile(2) where available, so the
+data does not pass through Lisp; otherwise copies it through a buffer. Returns
+the number of octets sent."))
+
+(defgeneric socket-splice (from to &key count)
+  (:documentation "Move COUNT octets (by default, everything until end of file) received on the
+socket FROM into the socket TO. Uses splice(2) where available, so the data does
+not pass through Lisp; otherwise copies it through a buffer. Returns the number
+of octets moved."))
+
 
 (defgeneric socket-close (socket &key abort)
   (:documentation "Close SOCKET.  May throw any kind of error that write(2) would have
@@ -413,6 +427,36 @@ Examples:
           (socket-error "send")
           len-sent)))))
 
+(defmethod socket-send-file ((socket socket) file &key (start 0) end)
+  (flet ((send (stream)
+           (let* ((end (or end (file-length stream)))
+                  (len-sent (ll-sendfile (socket-file-descriptor socket)
+                                         (ext:file-stream-file-descriptor stream)
+                                         start (max 0 (- end start)))))
+             (if (= len-sent -1)
+                 (socket-error "sendfile")
+                 len-sent))))
+    (if (streamp file)
+        (send file)
+        (with-open-file (stream file :element-type '(unsigned-byte 8))
+          (send stream)))))
+
+(defmethod socket-splice ((from socket) (to socket) &key count)
+  (let ((len-moved (ll-splice (socket-file-descriptor from)
+                              (socket-file-descriptor to)
+                              (or count most-positive-fixnum))))
+    (if (= len-moved -1)
+        (socket-error "splice")
+        len-moved)))
+
+(defun copy-stream-octets (input output &optional count)
+  "Copy COUNT octets (by default, everything until end of file) from the binary
+stream INPUT to the binary stream OUTPUT, and return the number copied. When
+both are octet file streams, such as a file and a socket stream, the kernel
+copies the data with sendfile(2) or splice(2); otherwise it goes through a
+buffer."
+  (ll-copy-stream-octets input output count))
+
 ;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
 ;;;
 ;;; UNIX SOCKETS
@@ -121,3 +121,73 @@
           (funcall cc) (funcall cc)
           (values (funcall c) warningsp failurep)))
       (3 nil nil))
+
+;;; The primitive instructions (add, car, etc.) and the ref-ref
+;;; superinstructions, including the non-fixnum and error cases that
+;;; fall back to calling the function, in both the VM and native code.
+(test btb.primitives-1
+      (let* ((c (cmp:bytecompile
+                 '(lambda (x y v l)
+                   (list (+ x y) (- x y) (< x y) (<= x y) (> x y) (>= x y)
+                    (= x y) (eq x y) (car l) (cdr l) (svref v 1) (aref v 0)
+                    (cons x y)))))
+             (args (list most-positive-fixnum 1.5d0
+                         (vector 'a 'b) (list 1 2)))
+             (r (apply c args)))
+        (multiple-value-bind (cc warningsp failurep) (compile nil c)
+          (values (equal r (apply cc args))
+                  (first r) (second r) (subseq r 2 13)
+                  warningsp failurep)))
+      (t #.(+ most-positive-fixnum 1.5d0) #.(- most-positive-fixnum 1.5d0)
+       (nil nil t t nil nil 1 (2) b a (#.most-positive-fixnum . 1.5d0))
+       nil nil))
+
+(test-expect-error btb.primitives-2
+                   (funcall (cmp:bytecompile '(lambda (x) (car x))) 7)
+                   :type type-error)
+(test-expect-error btb.primitives-3
+                   (funcall (cmp:bytecompile '(lambda (v i) (svref v i)))
+                            (make-array 2 :adjustable t) 0)
+                   :type type-error)
+
+;;; Calls from bytecode go through a per-thread call cache; make sure
+;;; redefining the callee after the cache has been filled is noticed.
+(test btb.call-cache-1
+      (progn
+        (setf (fdefinition 'btb-call-cache-target)
+              (cmp:bytecompile '(lambda (x) (list 'old x))))
+        (let ((c (cmp:bytecompile
+                  '(lambda () (btb-call-cache-target 1)))))
+          (let ((before (progn (funcall c) (funcall c))))
+            (setf (fdefinition 'btb-call-cache-target)
+                  (cmp:bytecompile '(lambda (x) (list 'new x))))
+            (let ((after (funcall c)))
+              (setf (fdefinition 'btb-call-cache-target)
+                    (lambda (&rest args) (cons 'rest args)))
+              (values before after (funcall c))))))
+      ((old 1) (new 1) (rest 1)))
+
+;;; Tier-up of closures: native code installed for the simple fun of a
+;;; closure is called with the bytecode's closures and cells.
+(test btb.closure-tier-up-1
+      (let* ((maker (cmp:bytecompile '(lambda (x) (lambda () (incf x)))))
+             (c (funcall maker 0))
+             (simple (core:entry-point c))
+             (before (funcall c)))
+        (core:set-simple-fun
+         simple (clasp-bytecode-to-bir:compile-function simple))
+        (values before (funcall c) (funcall c)
+                (funcall (funcall maker 10))
+                (eq (core:entry-point simple) simple)))
+      (1 2 3 11 nil))
+
+(test btb.autocompilation-threshold-1
+      (let ((old (ext:autocompilation-threshold)))
+        (unwind-protect
+             (progn (setf (ext:autocompilation-threshold) 100)
+                    (ext:autocompilation-threshold))
+          (setf (ext:autocompilation-threshold) old)))
+      (100))
+(test-expect-error btb.autocompilation-threshold-2
+                   (setf (core:bytecode-compile-threshold) 0)
+                   :type type-error)
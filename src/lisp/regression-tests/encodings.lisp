@@ -94,3 +94,43 @@
 ;;; clean-up
 (delete-package (find-package :asdf-test))
 (delete-package (find-package :encoding-test))
+
+;;; Strings longer than the encoding buffer, mixing runs of ASCII with
+;;; other characters and line breaks, must round trip through the bulk
+;;; transcoding paths of WRITE-STRING and READ-SEQUENCE.
+(defun %bulk-transcoding-round-trip (string external-format element-type)
+  (let ((name (core:mkstemp "bulk-transcoding")))
+    (unwind-protect
+         (progn
+           (with-open-file (stream name :direction :output :if-exists :supersede
+                                        :external-format external-format)
+             (write-string string stream))
+           (with-open-file (stream name :external-format external-format)
+             (let ((result (make-string (length string) :element-type element-type)))
+               (list (read-sequence result stream)
+                     (string= result string)))))
+      (delete-file name))))
+
+(defun %bulk-transcoding-string (&rest pieces)
+  (with-output-to-string (stream)
+    (dotimes (i 300)
+      (dolist (piece pieces)
+        (write-string piece stream)))))
+
+(test encoding-bulk-utf-8
+      (%bulk-transcoding-round-trip
+       (%bulk-transcoding-string "plain ascii text, " (string (code-char 955)) (string #\newline))
+       :utf-8 'character)
+      ((6000 t)))
+
+(test encoding-bulk-latin-1
+      (%bulk-transcoding-round-trip
+       (%bulk-transcoding-string "plain ascii text, " (string (code-char 233)) (string #\newline))
+       :latin-1 'character)
+      ((6000 t)))
+
+(test encoding-bulk-crlf
+      (%bulk-transcoding-round-trip
+       (%bulk-transcoding-string "plain ascii text" (string #\newline))
+       '(:utf-8 :crlf) 'base-char)
+      ((5100 t)))
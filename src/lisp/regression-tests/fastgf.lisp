@@ -5,3 +5,51 @@
 (defmethod fgf-foo ((x symbol)) :symbol)
 (test dispatch-symbol (fgf-foo :yadda) (:symbol))
 (test-expect-error dispatch-no-applicable-method (fgf-foo 1.2) :description "This should not dispatch")
+
+(defgeneric fgf-warmup (x))
+(defmethod fgf-warmup ((x t)) (class-name (class-of x)))
+(defmethod fgf-warmup ((x number)) (class-name (class-of x)))
+(test fgf-deferred-rebuilds
+      (let ((clos:*dispatch-rebuild-rate* 1)
+            (objects (list 1 "s" 'a 1.0 #\a (list 1) (vector 1) 1/2 1d0)))
+        (flet ((dispatched-correctly-p ()
+                 (equal (mapcar #'fgf-warmup objects)
+                        (mapcar (lambda (object) (class-name (class-of object))) objects))))
+          (values (dispatched-correctly-p)
+                  ;; Misses on a stale discriminator still find the right method
+                  (dispatched-correctly-p)
+                  (let ((statistics (clos:generic-function-dispatch-statistics #'fgf-warmup)))
+                    (and (>= (getf statistics :misses) (length objects))
+                         (plusp (getf statistics :deferred-rebuilds))
+                         (< (getf statistics :rebuilds) (length objects)))))))
+      (t t t))
+
+(defgeneric fgf-no-rebuilds (x))
+(defmethod fgf-no-rebuilds ((x t)) (class-name (class-of x)))
+(test fgf-rebuild-rate-zero
+      (let ((clos:*dispatch-rebuild-rate* 0)
+            (objects (list 1 "s" 'a 1.0 #\a)))
+        (values (equal (mapcar #'fgf-no-rebuilds objects)
+                       (mapcar (lambda (object) (class-name (class-of object))) objects))
+                (<= (getf (clos:generic-function-dispatch-statistics #'fgf-no-rebuilds) :rebuilds) 1)))
+      (t t))
+
+(test fgf-write-dispatch-state
+      (let* ((entries (length (clos::generic-function-call-history #'fgf-warmup)))
+             (source (core:mkstemp "fgf-dispatch-state"))
+             (fasl nil))
+        (unwind-protect
+             (progn
+               (setf fasl (clos:write-dispatch-state source
+                                                     :generic-function-names '(fgf-warmup)
+                                                     :compile t))
+               (clos::erase-generic-function-call-history #'fgf-warmup)
+               (clos::invalidate-discriminating-function #'fgf-warmup)
+               (load fasl)
+               (values (plusp entries)
+                       (= entries (length (clos::generic-function-call-history #'fgf-warmup)))
+                       (fgf-warmup 'a)))
+          (delete-file source)
+          (when (and fasl (probe-file fasl))
+            (delete-file fasl))))
+      (t t symbol))
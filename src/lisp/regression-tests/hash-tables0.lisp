@@ -113,6 +113,70 @@
                               (remhash :key (make-hash-table :test #'eq  :weakness :key))
                               t))
 
+;;weak tables: other tests and weaknesses
+(test weak-hash-table-weakness
+      (mapcar (lambda (weakness)
+                (core:hash-table-weakness
+                 (make-hash-table :test #'equalp :weakness weakness)))
+              '(:key :value :key-and-value :key-or-value))
+      ((:key :value :key-and-value :key-or-value)))
+
+(test weak-hash-table-equal-1
+      (let ((table (make-hash-table :test #'equal :weakness :key)))
+        (setf (gethash "abc" table) 1
+              (gethash (list 1 2) table) 2
+              (gethash 0 table) 3)
+        (values (gethash (copy-seq "abc") table)
+                (gethash (list 1 2) table)
+                (gethash 0 table)
+                (hash-table-test table)
+                (hash-table-count table)))
+      (1 2 3 equal 3))
+
+(test weak-hash-table-eql-1
+      (let ((table (make-hash-table :test #'eql :weakness :value)))
+        (setf (gethash (expt 2 100) table) :big
+              (gethash 1.5d0 table) :double
+              (gethash #\a table) 0)
+        (values (gethash (expt 2 100) table)
+                (gethash 1.5d0 table)
+                (gethash #\a table)))
+      (:big :double 0))
+
+(test weak-hash-table-equalp-1
+      (let ((table (make-hash-table :test #'equalp :weakness :key-and-value)))
+        (dotimes (i 1000)
+          (setf (gethash (format nil "KEY-~d" i) table) i))
+        (dotimes (i 500)
+          (remhash (format nil "key-~d" (* 2 i)) table))
+        (values (gethash "key-1" table)
+                (gethash "Key-2" table)
+                (hash-table-count table)))
+      (1 nil 500))
+
+(test weak-hash-table-live-entries
+      (let ((table (make-hash-table :test #'equal :weakness :key))
+            (key (list :live)))
+        ;; The value is only referenced by the table
+        (setf (gethash key table) (list :value))
+        (gctools:garbage-collect)
+        (gethash (list :live) table))
+      ((:value) t))
+
+(test-true weak-hash-table-garbage-collect
+           (let ((table (make-hash-table :test #'equal :weakness :key-and-value)))
+             (dotimes (i 1000)
+               (setf (gethash (format nil "~d" i) table) (list i)))
+             (gctools:garbage-collect)
+             (maphash (lambda (key value)
+                        (assert (equal key (format nil "~d" (first value)))))
+                      table)
+             (<= (hash-table-count table) 1000)))
+
+(test-expect-error weak-hash-table-bad-weakness
+                   (make-hash-table :weakness :neither)
+                   :type error)
+
 (test equalp-hash-table-1
       (let ((key-1 #\a)
             (key-2 #\A)
@@ -189,3 +253,40 @@
              (make-hash-table :size 128 :test #'eq :weakness :key)
              (gctools:garbage-collect)
              t))
+
+(test hash-table-caches-hashes-default
+      (values (core:hash-table-caches-hashes-p (make-hash-table :test #'eql))
+              (core:hash-table-caches-hashes-p (make-hash-table :test #'equal))
+              (core:hash-table-caches-hashes-p (make-hash-table :test #'equalp))
+              (core:hash-table-caches-hashes-p (make-hash-table :test #'equal :cache-hashes nil))
+              (core:hash-table-caches-hashes-p (make-hash-table :test #'eq :cache-hashes t)))
+      (nil t t nil t))
+
+;;; Grow through several rehashes and delete half the keys, then check
+;;; that every remaining key is found and every deleted key is not.
+(test-true hash-table-caches-hashes-1
+           (let ((ht (make-hash-table :test #'equal :cache-hashes t))
+                 (keys (loop for i below 2000
+                             collect (if (evenp i)
+                                         (format nil "key-~d" i)
+                                         (list i (format nil "~d" i))))))
+             (loop for key in keys for i from 0
+                   do (setf (gethash key ht) i))
+             (loop for key in keys for i from 0
+                   when (evenp (floor i 2)) do (remhash key ht))
+             (and (= (hash-table-count ht) 1000)
+                  (loop for key in keys for i from 0
+                        always (if (evenp (floor i 2))
+                                   (null (nth-value 1 (gethash (copy-tree key) ht)))
+                                   (eql (gethash (copy-tree key) ht) i))))))
+
+(test-true hash-table-caches-hashes-2
+           (let ((ht (make-hash-table :test #'equalp :cache-hashes t)))
+             (dotimes (i 100)
+               (setf (gethash (format nil "KEY-~d" i) ht) i))
+             (dotimes (i 100)
+               (remhash (format nil "key-~d" i) ht)
+               (setf (gethash (format nil "Key-~d" i) ht) (- i)))
+             (and (= (hash-table-count ht) 100)
+                  (loop for i below 100
+                        always (eql (gethash (format nil "kEY-~d" i) ht) (- i))))))
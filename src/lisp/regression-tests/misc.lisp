@@ -316,3 +316,82 @@
           (declare (ignorable #'macro-function-shadowing.f))
           (e (macro-function-shadowing.f))))
       ((macro-function-shadowing.f)))
+
+;;; The sampling heap profiler should see a program that does nothing but
+;;; cons, and write it out as folded stacks ending in an estimated count.
+(defun heap-profile-consing (n)
+  (let ((keep nil))
+    (dotimes (i n (length keep))
+      (push (make-list 8) keep)
+      (when (> (length keep) 100) (setf keep nil)))))
+
+(test-true heap-profile-samples
+           (let ((path (core:mkstemp "heap-profile")))
+             (unwind-protect
+                  (progn
+                    (gctools:heap-profile-reset)
+                    (gctools:heap-profile-start :interval 4096 :depth 16)
+                    (heap-profile-consing 100000)
+                    (gctools:heap-profile-stop)
+                    (and (plusp (gctools:heap-profile-samples))
+                         (plusp (gctools:heap-profile-write path :value :objects))
+                         (with-open-file (stream path)
+                           (loop for line = (read-line stream nil)
+                                 while line
+                                 always (digit-char-p
+                                         (char line (1- (length line))))))))
+               (gctools:heap-profile-stop)
+               (gctools:heap-profile-reset)
+               (delete-file path))))
+
+;;; The CPU profiler should sample a thread that does nothing but compute,
+;;; and write folded stacks ending in a count or a pprof profile.
+(defun cpu-profile-spin (seconds)
+  (let ((end (+ (get-internal-run-time) (* seconds internal-time-units-per-second)))
+        (sum 0))
+    (loop while (< (get-internal-run-time) end)
+          do (dotimes (i 10000) (setf sum (logand (+ sum i) most-positive-fixnum))))
+    sum))
+
+#+linux
+(test-true cpu-profile-samples
+           (let ((folded (core:mkstemp "cpu-profile-folded"))
+                 (pprof (core:mkstemp "cpu-profile-pprof")))
+             (unwind-protect
+                  (progn
+                    (gctools:cpu-profile-reset)
+                    (gctools:cpu-profile-start :frequency 1000 :depth 32)
+                    (cpu-profile-spin 0.3)
+                    (gctools:cpu-profile-stop)
+                    (and (plusp (gctools:cpu-profile-samples))
+                         (plusp (gctools:cpu-profile-write folded))
+                         (with-open-file (stream folded)
+                           (loop for line = (read-line stream nil)
+                                 while line
+                                 always (digit-char-p
+                                         (char line (1- (length line))))))
+                         (plusp (gctools:cpu-profile-write pprof :format :pprof))
+                         (with-open-file (stream pprof :element-type '(unsigned-byte 8))
+                           (plusp (file-length stream)))))
+               (gctools:cpu-profile-stop)
+               (gctools:cpu-profile-reset)
+               (delete-file folded)
+               (delete-file pprof))))
+
+;;; Starting and stopping while other threads are busy, and while threads
+;;; come and go, must not disturb them.
+#+linux
+(test cpu-profile-start-stop-threads
+      (let ((workers (loop for i below 4
+                           collect (mp:process-run-function
+                                    "cpu-profile-worker"
+                                    (lambda () (cpu-profile-spin 0.2) :done)))))
+        (unwind-protect
+             (dotimes (i 10)
+               (gctools:cpu-profile-start :frequency 1000)
+               (mp:process-join (mp:process-run-function "cpu-profile-short" (lambda () (cpu-profile-spin 0.01))))
+               (gctools:cpu-profile-stop))
+          (gctools:cpu-profile-stop)
+          (gctools:cpu-profile-reset))
+        (mapcar #'mp:process-join workers))
+      ((:done :done :done :done)))
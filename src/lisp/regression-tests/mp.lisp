@@ -253,3 +253,195 @@
         (spam-processes nthreads (lambda () (mp:atomic-push nil (car place))))
         (car place))
       ((nil nil nil nil nil nil nil)))
+
+;;; gethash on a thread-safe table reads without locking; check that
+;;; readers always find stable keys while a writer grows and rehashes
+;;; the table under them.
+(test hash-table-concurrent-gethash
+      (flet ((run (test make-key)
+               (let ((ht (make-hash-table :test test :thread-safe t))
+                     (done (list nil)))
+                 (dotimes (i 1000) (setf (gethash (funcall make-key i) ht) i))
+                 (let ((writer (mp:process-run-function
+                                nil
+                                (lambda ()
+                                  (loop for i from 1001 below 50000
+                                        do (setf (gethash (funcall make-key i) ht) i)
+                                           (when (evenp i)
+                                             (remhash (funcall make-key (1- i)) ht)))
+                                  (setf (mp:atomic (car done)) t))))
+                       (readers
+                         (loop repeat 4
+                               collect (mp:process-run-function
+                                        nil
+                                        (lambda ()
+                                          (loop until (mp:atomic (car done))
+                                                always (loop for i below 1000
+                                                             always (eql (gethash (funcall make-key i) ht) i))))))))
+                   (mp:process-join writer)
+                   (every #'mp:process-join readers)))))
+        (values (run 'eql #'identity)
+                (run 'equal (lambda (i) (format nil "key-~d" i)))))
+      (t t))
+
+(test-type concurrent-queue-1 (mp:make-concurrent-queue) mp:concurrent-queue)
+
+(test concurrent-queue-fifo
+      (let ((queue (mp:make-concurrent-queue)))
+        (dotimes (i 5) (mp:concurrent-enqueue queue i))
+        (values (mp:concurrent-queue-count queue)
+                (loop repeat 5 collect (mp:concurrent-dequeue queue))
+                (mp:concurrent-queue-empty-p queue)))
+      (5 (0 1 2 3 4) t))
+
+(test concurrent-queue-bounded
+      (let ((queue (mp:make-concurrent-queue :capacity 3)))
+        (values (mp:concurrent-queue-capacity queue)
+                (loop for i below 5 collect (mp:concurrent-enqueue queue i))
+                (mp:concurrent-dequeue-list queue 10)
+                (mp:concurrent-enqueue-list queue '(a b c d e f))
+                (mp:concurrent-dequeue-list queue 2)
+                (mp:concurrent-dequeue-list queue 10)))
+      (4 (t t t t nil) (0 1 2 3) 4 (a b) (c d)))
+
+(test concurrent-queue-batch
+      (let ((queue (mp:make-concurrent-queue)))
+        (values (mp:concurrent-enqueue-list queue '(a b c d e))
+                (mp:concurrent-dequeue-list queue 3)
+                (mp:concurrent-dequeue-list queue 3)))
+      (5 (a b c) (d e)))
+
+(test concurrent-queue-timeout
+      (let ((queue (mp:make-concurrent-queue)))
+        (values (multiple-value-list (mp:concurrent-dequeue queue 0 :empty))
+                (multiple-value-list (mp:concurrent-dequeue queue 0.01 :empty))
+                (mp:concurrent-dequeue-list queue 3 0.01)))
+      ((:empty nil) (:empty nil) nil))
+
+;;; Producers and consumers run at once; every object must come out
+;;; exactly once, and blocked consumers must be woken up.
+(test concurrent-queue-threads
+      (flet ((run (capacity batch)
+               (let* ((queue (mp:make-concurrent-queue :capacity capacity))
+                      (nproducers 4) (nconsumers 4) (per-producer 2000)
+                      (consumers
+                        (loop repeat nconsumers
+                              collect (mp:process-run-function
+                                       nil
+                                       (lambda ()
+                                         (loop with sum = 0
+                                               for objects = (if batch
+                                                                 (mp:concurrent-dequeue-list queue batch)
+                                                                 (list (mp:concurrent-dequeue queue)))
+                                               for done = (count :done objects)
+                                               do (incf sum (reduce #'+ (remove :done objects)))
+                                                  ;; Hand on any markers meant for other consumers
+                                               when (plusp done)
+                                                 do (loop repeat (1- done)
+                                                          do (mp:concurrent-enqueue queue :done))
+                                                    (return sum))))))
+                      (producers
+                        (loop for p below nproducers
+                              collect (let ((p p))
+                                        (mp:process-run-function
+                                         nil
+                                         (lambda ()
+                                           (loop for i from (* p per-producer)
+                                                   below (* (1+ p) per-producer)
+                                                 do (loop until (mp:concurrent-enqueue queue i)
+                                                          do (mp:process-yield)))))))))
+                 (mapc #'mp:process-join producers)
+                 (loop repeat nconsumers
+                       do (loop until (mp:concurrent-enqueue queue :done)
+                                do (mp:process-yield)))
+                 (= (reduce #'+ consumers :key #'mp:process-join)
+                    (let ((n (* nproducers per-producer))) (/ (* n (1- n)) 2))))))
+        (values (run nil nil) (run 16 nil) (run nil 8)))
+      (t t t))
+
+(defun call-with-task-pool (function)
+  (let ((pool (mp:make-task-pool :name "test-pool" :workers 4)))
+    (unwind-protect (funcall function pool)
+      (mp:shutdown-task-pool pool))))
+
+(test task-pool-fork-join
+      (call-with-task-pool
+       (lambda (pool)
+         (mp:join (mp:fork (lambda () (values 1 2 3)) pool))))
+      (1 2 3))
+
+(test task-pool-nested
+      (call-with-task-pool
+       (lambda (pool)
+         (labels ((fib (n)
+                    (if (< n 15)
+                        (if (< n 2) n (+ (fib (- n 1)) (fib (- n 2))))
+                        (let ((left (mp:fork (lambda () (fib (- n 1))) pool)))
+                          (+ (fib (- n 2)) (mp:join left))))))
+           (mp:join (mp:fork (lambda () (fib 22)) pool)))))
+      (17711))
+
+;;; Joining from outside the pool waits for a worker rather than running the
+;;; task on the joining thread.
+(test task-pool-runs-on-workers
+      (call-with-task-pool
+       (lambda (pool)
+         (let ((caller mp:*current-process*))
+           (values (eq (mp:join (mp:fork (lambda () mp:*current-process*) pool)) caller)
+                   (find caller (mp:parallel-map 'vector (lambda (x)
+                                                             (declare (ignore x))
+                                                             mp:*current-process*)
+                                                 #(1 2 3 4 5 6 7 8)
+                                                 :pool pool :grain-size 1))))))
+      (nil nil))
+
+(test-expect-error task-pool-error
+                   (call-with-task-pool
+                    (lambda (pool)
+                      (mp:join (mp:fork (lambda () (error 'type-error :datum 4 :expected-type 'cons))
+                                        pool))))
+                   :type type-error)
+
+(test task-pool-promise
+      (let ((promise (mp:make-promise)))
+        (mp:process-run-function nil (lambda () (mp:fulfill-promise promise :a :b)))
+        (values (multiple-value-list (mp:join promise))
+                (not (null (mp:future-done-p promise)))))
+      ((:a :b) t))
+
+(test task-pool-parallel-map
+      (call-with-task-pool
+       (lambda (pool)
+         (let ((vector (coerce (loop for i below 1000 collect i) 'vector)))
+           (values (equalp (mp:parallel-map 'vector #'1+ vector :pool pool :grain-size 7)
+                           (map 'vector #'1+ vector))
+                   (mp:parallel-map '(vector (unsigned-byte 8)) #'1+ #(1 2) :pool pool
+                                    :grain-size 1)
+                   (mp:parallel-map nil #'identity vector :pool pool)))))
+      (t #(2 3) nil))
+
+(test task-pool-parallel-reduce
+      (call-with-task-pool
+       (lambda (pool)
+         (let ((vector (coerce (loop for i below 1000 collect i) 'vector)))
+           (values (mp:parallel-reduce #'+ vector :pool pool :grain-size 10)
+                   (mp:parallel-reduce #'+ vector :pool pool :key #'1+ :initial-value 5)
+                   (mp:parallel-reduce #'+ #() :pool pool)
+                   (mp:parallel-reduce #'max #(3) :pool pool :initial-value 7)))))
+      (499500 500505 0 7))
+
+(test task-pool-parallel-sort
+      (call-with-task-pool
+       (lambda (pool)
+         (let* ((list (loop repeat 5000 collect (random 1000)))
+                (doubles (map '(vector double-float) #'float list))
+                (general (coerce list 'vector))
+                (pairs (map 'vector (lambda (x) (cons (mod x 10) x)) list)))
+           (values (equalp (mp:parallel-sort (copy-seq doubles) #'< :pool pool :grain-size 100)
+                           (sort (copy-seq doubles) #'<))
+                   (equalp (mp:parallel-sort (copy-seq general) #'> :pool pool :grain-size 100)
+                           (sort (copy-list list) #'>))
+                   (equalp (mp:parallel-sort (copy-seq pairs) #'< :key #'car :pool pool
+                                             :stable t :grain-size 100)
+                           (stable-sort (copy-seq pairs) #'< :key #'car))))))
+      (t t t))
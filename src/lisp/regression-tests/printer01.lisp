@@ -588,3 +588,24 @@ BBBBCCCC**DDDD"))
                        :pretty t)
       ("(A (CORE:UNQUOTE A) (CORE:UNQUOTE-SPLICE A) (CORE:UNQUOTE-NSPLICE A)
  . `(A ,@(A (CORE:UNQUOTE A)) ,.A . ,A))"))
+
+(test float-to-digits-shortest
+      (mapcar (lambda (x) (multiple-value-list (core:float-to-digits nil x nil nil)))
+              (list 0.1d0 1d23 (expt 2d0 -30) least-positive-double-float
+                    least-positive-normalized-double-float
+                    1f0 0.3f0 most-positive-single-float least-positive-single-float))
+      (((0 "1") (24 "1") (-9 "9313225746154785") (-323 "5")
+        (-307 "22250738585072014")
+        (1 "1") (0 "3") (39 "34028235") (-44 "1"))))
+
+(test-true float-print-round-trip
+      (flet ((round-trips-p (x)
+               (let ((*read-default-float-format* (type-of x)))
+                 (= x (read-from-string (prin1-to-string x))))))
+        (loop repeat 20000
+              for double = (random (ash 1 64))
+              for single = (random (ash 1 32))
+              always (or (= (ldb (byte 11 52) double) #x7ff)
+                         (round-trips-p (ext:bits-to-double-float double)))
+              always (or (= (ldb (byte 8 23) single) #xff)
+                         (round-trips-p (ext:bits-to-single-float single))))))
@@ -325,7 +325,8 @@
           (read stream t nil nil)))
       (16/17))
 
-;;; SYNTAX.NUMBER-TOKEN.ERROR.1 (READ-FROM-STRING "1/0") gives a division by 0, but that seems ok 
+(test-expect-error SYNTAX.NUMBER-TOKEN.ERROR.1 (READ-FROM-STRING "1/0")
+                   :type reader-error)
 
 (test-expect-error SYNTAX.DOT-ERROR.4 (READ-FROM-STRING "#( . 1)" )
                    :type reader-error)
@@ -534,3 +535,63 @@
         (eql (get-macro-character #\0) (get-macro-character #\`))))
 
 
+
+(test read-numbers
+      (let ((*read-default-float-format* 'single-float))
+        (mapcar #'read-from-string
+                '("123" "-0" "+7" "123." "-6/4" "+1/3" "4611686018427387904" "-4611686018427387905"
+                  "123456789012345678901234567890")))
+      ((123 0 7 123 -3/2 1/3 4611686018427387904 -4611686018427387905
+        123456789012345678901234567890)))
+
+(test read-numbers-base
+      (let ((*read-base* 16))
+        (mapcar #'read-from-string '("ff" "-1e5" "a/c" "10." "FFFFFFFFFFFFFFFFFFFF")))
+      ((255 -485 5/6 10 #xFFFFFFFFFFFFFFFFFFFF)))
+
+(test read-float-types
+      (let ((*read-default-float-format* 'single-float))
+        (mapcar (lambda (string) (type-of (read-from-string string)))
+                '("1.5" "1e5" "1.5f0" "1.5s0" "1.5d0" ".5" "-1.e-7")))
+      ((single-float single-float single-float single-float double-float
+        single-float single-float)))
+
+(test read-floats-exactly-rounded
+      (mapcar #'read-from-string
+              '("9007199254740993d0" "2.2250738585072011d-308" "4.9406564584124654d-324"
+                "1.7976931348623157d308" "0.1000000000000000055511151231257827d0"
+                "3.4028235f38" "1.4012985f-45" "16777217f0"))
+      ((9007199254740992d0 2.225073858507201d-308 4.9406564584124654d-324
+        1.7976931348623157d308 0.1d0 3.4028235f38 1.4012985f-45 16777216f0)))
+
+(test-true read-float-17-digits
+      (loop repeat 20000
+            for bits = (random (ash 1 64))
+            for x = (ext:bits-to-double-float bits)
+            always (or (= (ldb (byte 11 52) bits) #x7ff)
+                       (= x (read-from-string (format nil "~,16,,,,,'dE" x))))))
+
+(test parse-float
+      (mapcar (lambda (string)
+                (multiple-value-bind (x position) (ext:parse-float string)
+                  (list x (type-of x) position)))
+              '("1.25" "  -2.5d3  " "7" "1e2"))
+      (((1.25 single-float 4) (-2500d0 double-float 10) (7.0 single-float 1) (100.0 single-float 3))))
+
+(test parse-float-type
+      (multiple-value-list (ext:parse-float "x 0.1 y" :start 1 :end 5 :type 'double-float))
+      ((0.1d0 5)))
+
+(test parse-float-type-float
+      (multiple-value-list (ext:parse-float "2.5d0" :type 'float))
+      ((2.5d0 5)))
+
+(test-expect-error parse-float-type-error (ext:parse-float "1.5" :type 'integer)
+                   :type type-error)
+
+(test parse-float-junk
+      (list (multiple-value-list (ext:parse-float "1.5abc" :junk-allowed t))
+            (multiple-value-list (ext:parse-float "abc" :junk-allowed t)))
+      (((1.5 3) (nil 0))))
+
+(test-expect-error parse-float-error (ext:parse-float "1.5abc") :type parse-error)
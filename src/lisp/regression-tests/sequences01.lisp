@@ -505,3 +505,56 @@
 (test-type can-map-to-specialized-vectors-4
            (map (class-of (make-array 0 :displaced-to (make-array 3))) 'identity (list 1 2 3))
            (vector t))
+
+(defun sort-test-sorted-p (vector predicate &key (key #'identity))
+  (loop for i from 1 below (length vector)
+        never (funcall predicate (funcall key (aref vector i))
+                       (funcall key (aref vector (1- i))))))
+
+(test-true sort-specialized-vectors
+           (loop for type in '(double-float single-float fixnum (unsigned-byte 8)
+                               (signed-byte 16) (unsigned-byte 32) (signed-byte 64))
+                 for list = (loop repeat 1000
+                                  collect (coerce (- (random 200) 100)
+                                                  (if (subtypep type 'float) type 'integer)))
+                 for list* = (if (subtypep type 'unsigned-byte) (mapcar #'abs list) list)
+                 always (loop for predicate in (list #'< #'>)
+                              always (let ((vector (sort (make-array 1000 :element-type type
+                                                                          :initial-contents list*)
+                                                         predicate)))
+                                       (and (sort-test-sorted-p vector predicate)
+                                            (equal (sort (coerce vector 'list) predicate)
+                                                   (sort (copy-list list*) predicate)))))))
+
+(test sort-displaced-specialized-vector
+      (let ((vector (make-array 5 :element-type 'double-float
+                                  :initial-contents '(3d0 -1d0 2d0 -2d0 1d0))))
+        (sort (make-array 3 :element-type 'double-float
+                            :displaced-to vector :displaced-index-offset 1)
+              #'>)
+        vector)
+      (#(3d0 2d0 -1d0 -2d0 1d0)))
+
+(test stable-sort-signed-zeros
+      (map 'list (lambda (x) (float-sign x))
+           (stable-sort (make-array 6 :element-type 'double-float
+                                      :initial-contents '(0d0 1d0 -0d0 -1d0 0d0 -0d0))
+                        #'<))
+      ((-1d0 1d0 -1d0 1d0 -1d0 1d0)))
+
+(test-true sort-general-vector-patterns
+           (let ((n 2000))
+             (flet ((check (list)
+                      (let ((vector (sort (map 'vector #'list list) #'< :key #'first)))
+                        (and (sort-test-sorted-p vector #'< :key #'first)
+                             (equal (map 'list #'first vector) (sort (copy-list list) #'<))))))
+               (and (check (loop for i below n collect i))
+                    (check (loop for i below n collect (- n i)))
+                    (check (loop for i below n collect (min i (- n i))))
+                    (check (loop for i below n collect (mod i 3)))
+                    (check (loop repeat n collect (random 100)))))))
+
+(test-true sort-adjustable-vector
+           (let ((vector (make-array 500 :adjustable t :fill-pointer 300)))
+             (dotimes (i 500) (setf (aref vector i) (random 1000)))
+             (sort-test-sorted-p (sort vector #'<) #'<)))
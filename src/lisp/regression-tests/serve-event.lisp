@@ -0,0 +1,157 @@
+(in-package #:clasp-tests)
+
+(eval-when (:compile-toplevel :load-toplevel :execute)
+  (require :serve-event))
+
+;;; Call FUNCTION with the input and output octet streams of a fresh pipe
+;;; under BACKEND, closing both afterwards.
+(defun call-with-serve-event-pipe (backend function)
+  (multiple-value-bind (in out) (core:pipe)
+    (let ((serve-event:*serve-event-backend* backend)
+          (input (ext:make-stream-from-fd in :input :element-type '(unsigned-byte 8)))
+          (output (ext:make-stream-from-fd out :output :element-type '(unsigned-byte 8))))
+      (unwind-protect (funcall function in input output)
+        (serve-event:invalidate-descriptor in)
+        (close input)
+        (when (open-stream-p output)
+          (close output))))))
+
+(defun serve-event-backends ()
+  (if (serve-event-internal::ll-epoll-available-p)
+      '(:select :epoll)
+      '(:select)))
+
+(defun serve-event-on-backends (function)
+  "Call FUNCTION with each available backend. Return its value if all the
+backends agree on it, otherwise the list of values."
+  (let ((results (mapcar function (serve-event-backends))))
+    (if (every (lambda (result) (equal result (first results))) results)
+        (first results)
+        results)))
+
+(defun serve-event-write-octets (output &rest octets)
+  (dolist (octet octets)
+    (write-byte octet output))
+  (finish-output output))
+
+;;; Read what the handler was woken up for, stopping when nothing more is
+;;; available - a short read must not block.
+(defun serve-event-drain (input)
+  (loop while (listen input)
+        collect (read-byte input)))
+
+;;; Serve-event tests run on every available backend and expect all of them
+;;; to behave the same.
+
+(test serve-event-ready
+      (serve-event-on-backends
+       (lambda (backend)
+         (call-with-serve-event-pipe
+          backend
+          (lambda (fd input output)
+            (let ((read nil))
+              (serve-event:with-fd-handler
+                  (fd :input (lambda (fd)
+                               (declare (ignore fd))
+                               (setf read (append read (serve-event-drain input)))))
+                (let ((idle (serve-event:serve-event 0)))
+                  (serve-event-write-octets output 1 2 3)
+                  (list idle (serve-event:serve-event 1) read))))))))
+      ((nil t (1 2 3))))
+
+;;; Each wakeup sees only what has arrived since the last one.
+(test serve-event-partial-reads
+      (serve-event-on-backends
+       (lambda (backend)
+         (call-with-serve-event-pipe
+          backend
+          (lambda (fd input output)
+            (let ((reads nil))
+              (serve-event:with-fd-handler
+                  (fd :input (lambda (fd)
+                               (declare (ignore fd))
+                               (push (serve-event-drain input) reads)))
+                (serve-event-write-octets output 1 2 3)
+                (serve-event:serve-event 1)
+                (serve-event-write-octets output 4 5)
+                (serve-event:serve-event 1)
+                (reverse reads)))))))
+      (((1 2 3) (4 5))))
+
+(test serve-event-eof
+      (serve-event-on-backends
+       (lambda (backend)
+         (call-with-serve-event-pipe
+          backend
+          (lambda (fd input output)
+            (let ((read nil))
+              (serve-event:with-fd-handler
+                  (fd :input (lambda (fd)
+                               (declare (ignore fd))
+                               (setf read (read-byte input nil :eof))))
+                (serve-event-write-octets output 7)
+                (close output)
+                (serve-event:serve-event 1)
+                (let ((before-eof read))
+                  (serve-event:serve-event 1)
+                  (list before-eof read))))))))
+      ((7 :eof)))
+
+(test serve-event-remove-handler
+      (serve-event-on-backends
+       (lambda (backend)
+         (call-with-serve-event-pipe
+          backend
+          (lambda (fd input output)
+            (declare (ignore input))
+            (let* ((called nil)
+                   (handler (serve-event:add-fd-handler
+                             fd :input (lambda (fd)
+                                         (declare (ignore fd))
+                                         (setf called t)))))
+              (serve-event:remove-fd-handler handler)
+              (serve-event-write-octets output 1)
+              (list (serve-event:serve-event 0) called))))))
+      ((nil nil)))
+
+(test serve-event-timers
+      (serve-event-on-backends
+       (lambda (backend)
+         (let ((serve-event:*serve-event-backend* backend)
+               (once 0)
+               (repeated 0))
+           (serve-event:add-timer 0 (lambda () (incf once)))
+           (let ((timer (serve-event:add-timer 0 (lambda () (incf repeated))
+                                               :repeat 0.01)))
+             (unwind-protect
+                  (progn
+                    (serve-event:serve-event 0)
+                    (sleep 0.05)
+                    (serve-event:serve-event 0)
+                    (list once (> repeated 1) (serve-event:serve-event 0.01)))
+               (serve-event:remove-timer timer))))))
+      ((1 t t)))
+
+;;; An edge triggered handler that leaves the data unread is not called again
+;;; until more arrives, a level triggered one is.
+(test serve-event-epoll-edge-trigger
+      (if (serve-event-internal::ll-epoll-available-p)
+          (loop for trigger in '(:level :edge)
+                collect (call-with-serve-event-pipe
+                         :epoll
+                         (lambda (fd input output)
+                           (declare (ignore input))
+                           (let ((calls 0))
+                             (serve-event:with-fd-handler
+                                 (fd :input (lambda (fd)
+                                              (declare (ignore fd))
+                                              (incf calls))
+                                     :trigger trigger)
+                               (serve-event-write-octets output 1)
+                               (serve-event:serve-event 1)
+                               (serve-event:serve-event 0)
+                               (serve-event-write-octets output 2)
+                               (serve-event:serve-event 1)
+                               calls)))))
+          (list 3 2))
+      ((3 2)))
@@ -834,3 +834,213 @@ cd")))
    ((:utf-8 :lf) #\! #\newline
     (:utf-8 :crlf) #\! #\newline
     :ucs-2be #\trade_mark_sign (:ucs-2be :crlf))))
+
+(test posix-file-stream.buffering.01
+  (let ((name (core:mkstemp "posix-buffering")))
+    (unwind-protect
+         (with-open-file (stream name :direction :output :if-exists :overwrite
+                                      :cstream nil)
+           (core::set-buffering-mode stream :full)
+           (write-string "abc" stream)
+           (list (file-position stream)
+                 (with-open-file (in name) (file-length in))
+                 (progn (finish-output stream)
+                        (with-open-file (in name) (read-line in nil)))))
+      (delete-file name)))
+  ((3 0 "abc")))
+
+(test posix-file-stream.buffering.02
+  (let ((name (core:mkstemp "posix-buffering")))
+    (unwind-protect
+         (progn
+           (with-open-file (stream name :direction :output :if-exists :supersede
+                                        :cstream nil)
+             (dotimes (i 1000)
+               (format stream "line ~d~%" i)))
+           (with-open-file (stream name :cstream nil)
+             (let ((first (read-line stream))
+                   (char (read-char stream)))
+               (unread-char char stream)
+               (list first
+                     (file-position stream)
+                     (read-line stream)
+                     (progn (file-position stream 7)
+                            (read-line stream))
+                     (loop for line = (read-line stream nil)
+                           while line count t)))))
+      (delete-file name)))
+  (("line 0" 7 "line 1" "line 1" 998)))
+
+(test posix-file-stream.buffering.03
+  (let ((name (core:mkstemp "posix-buffering")))
+    (unwind-protect
+         (progn
+           (with-open-file (stream name :direction :output :if-exists :supersede
+                                        :cstream nil)
+             (write-string "0123456789" stream))
+           (with-open-file (stream name :direction :io :if-exists :overwrite
+                                        :cstream nil)
+             (read-char stream)
+             (read-char stream)
+             (write-string "ab" stream)
+             (file-position stream 0)
+             (read-line stream)))
+      (delete-file name)))
+  ("01ab456789"))
+
+(test mmap-file-stream.01
+  (let ((name (core:mkstemp "mmap-stream")))
+    (unwind-protect
+         (progn
+           (with-open-file (stream name :direction :output :if-exists :supersede)
+             (write-line "first" stream)
+             (write-line "second" stream))
+           (with-open-file (stream name :mmap t)
+             (let ((first (read-line stream))
+                   (char (read-char stream)))
+               (unread-char char stream)
+               (list first
+                     (file-position stream)
+                     (read-line stream)
+                     (read-line stream nil :eof)
+                     (progn (file-position stream 2)
+                            (read-char stream))
+                     (file-length stream)))))
+      (delete-file name)))
+  (("first" 6 "second" :eof #\r 13)))
+
+(test mmap-file-stream.02
+  (let ((name (core:mkstemp "mmap-stream"))
+        (octets (make-array 10000 :element-type '(unsigned-byte 8))))
+    (dotimes (i (length octets))
+      (setf (aref octets i) (mod (* i 7) 256)))
+    (unwind-protect
+         (progn
+           (with-open-file (stream name :direction :output :if-exists :supersede
+                                        :element-type '(unsigned-byte 8))
+             (write-sequence octets stream))
+           (let* ((stream (open name :element-type '(unsigned-byte 8) :mmap t))
+                  (read (make-array 10000 :element-type '(unsigned-byte 8)))
+                  (count (read-sequence read stream))
+                  (copy (ext:mmap-file-stream-copy-octets stream)))
+             (close stream)
+             (list count
+                   (equalp read octets)
+                   (length copy)
+                   (equalp copy octets)
+                   (subtypep (array-element-type copy) '(unsigned-byte 8)))))
+      (delete-file name)))
+  ((10000 t 10000 t t)))
+
+(test-expect-error mmap-file-stream.03
+  (let ((name (core:mkstemp "mmap-stream")))
+    (unwind-protect
+         (open name :direction :output :if-exists :supersede :mmap t)
+      (delete-file name)))
+  :type error)
+
+(eval-when (:compile-toplevel :load-toplevel :execute)
+  (require :sockets))
+
+(defun copy-stream-octets-test-octets (count)
+  (let ((octets (make-array count :element-type '(unsigned-byte 8))))
+    (dotimes (i count octets)
+      (setf (aref octets i) (mod (* i 13) 256)))))
+
+(defun copy-stream-octets-test-file (name octets)
+  (with-open-file (stream name :direction :output :if-exists :supersede
+                               :element-type '(unsigned-byte 8))
+    (write-sequence octets stream)))
+
+(defun copy-stream-octets-test-read (name)
+  (with-open-file (stream name :element-type '(unsigned-byte 8))
+    (let ((octets (make-array (file-length stream) :element-type '(unsigned-byte 8))))
+      (read-sequence octets stream)
+      octets)))
+
+;;; File to file goes through sendfile
+(test copy-stream-octets.01
+  (let ((from (core:mkstemp "copy-stream-octets"))
+        (to (core:mkstemp "copy-stream-octets"))
+        (octets (copy-stream-octets-test-octets 200000)))
+    (unwind-protect
+         (progn
+           (copy-stream-octets-test-file from octets)
+           (list (with-open-file (input from :element-type '(unsigned-byte 8))
+                   (with-open-file (output to :direction :output :if-exists :supersede
+                                              :element-type '(unsigned-byte 8))
+                     (sb-bsd-sockets:copy-stream-octets input output)))
+                 (equalp (copy-stream-octets-test-read to) octets)))
+      (delete-file from)
+      (delete-file to)))
+  ((200000 t)))
+
+;;; Partial copies start at the stream's position, which includes octets
+;;; already read through the Lisp buffer, and leave the stream after what
+;;; was copied. A COUNT past the end copies what is left and at EOF nothing.
+(test copy-stream-octets.02
+  (let ((from (core:mkstemp "copy-stream-octets"))
+        (to (core:mkstemp "copy-stream-octets"))
+        (octets (copy-stream-octets-test-octets 1000)))
+    (unwind-protect
+         (progn
+           (copy-stream-octets-test-file from octets)
+           (with-open-file (input from :element-type '(unsigned-byte 8))
+             (with-open-file (output to :direction :output :if-exists :supersede
+                                        :element-type '(unsigned-byte 8))
+               (let* ((first (read-byte input))
+                      (copied (sb-bsd-sockets:copy-stream-octets input output 100))
+                      (position (file-position input))
+                      (rest (sb-bsd-sockets:copy-stream-octets input output 5000))
+                      (at-eof (sb-bsd-sockets:copy-stream-octets input output)))
+                 (finish-output output)
+                 (list first copied position rest at-eof (read-byte input nil :eof)
+                       (equalp (copy-stream-octets-test-read to) (subseq octets 1)))))))
+      (delete-file from)
+      (delete-file to)))
+  ((0 100 101 899 0 :eof t)))
+
+;;; A pipe is read until its writer closes it, through splice or, for
+;;; streams the kernel can't copy from, through a buffer.
+(test copy-stream-octets.03
+  (let ((to (core:mkstemp "copy-stream-octets"))
+        (octets (copy-stream-octets-test-octets 5000)))
+    (unwind-protect
+         (multiple-value-bind (in out) (core:pipe)
+           (let ((input (ext:make-stream-from-fd in :input :element-type '(unsigned-byte 8)))
+                 (output (ext:make-stream-from-fd out :output :element-type '(unsigned-byte 8))))
+             (unwind-protect
+                  (progn
+                    (write-sequence octets output)
+                    (close output)
+                    (list (with-open-file (destination to :direction :output :if-exists :supersede
+                                                          :element-type '(unsigned-byte 8))
+                            (sb-bsd-sockets:copy-stream-octets input destination))
+                          (read-byte input nil :eof)
+                          (equalp (copy-stream-octets-test-read to) octets)))
+               (close input)
+               (when (open-stream-p output)
+                 (close output)))))
+      (delete-file to)))
+  ((5000 :eof t)))
+
+;;; Two-way and synonym streams are looked through
+(defvar *copy-stream-octets-input*)
+
+(test copy-stream-octets.04
+  (let ((from (core:mkstemp "copy-stream-octets"))
+        (to (core:mkstemp "copy-stream-octets"))
+        (octets (copy-stream-octets-test-octets 3000)))
+    (unwind-protect
+         (progn
+           (copy-stream-octets-test-file from octets)
+           (list (with-open-file (*copy-stream-octets-input* from :element-type '(unsigned-byte 8))
+                   (with-open-file (output to :direction :output :if-exists :supersede
+                                              :element-type '(unsigned-byte 8))
+                     (sb-bsd-sockets:copy-stream-octets
+                      (make-synonym-stream '*copy-stream-octets-input*)
+                      (make-two-way-stream *copy-stream-octets-input* output))))
+                 (equalp (copy-stream-octets-test-read to) octets)))
+      (delete-file from)
+      (delete-file to)))
+  ((3000 t)))
@@ -32,3 +32,33 @@
           (*standard-output*)
         (compile-file "sys:src;lisp;regression-tests;framework.lisp" :verbose nil :print nil))
       (""))
+
+(defvar *load-parallel-results* nil)
+
+(test load-fasls-in-parallel
+      (let* ((cmp:*default-output-type* :bytecode)
+             (directory (core:mkdtemp "load-parallel"))
+             (files (loop for i below 3
+                          collect (merge-pathnames (format nil "load-parallel-~d.lisp" i) directory)))
+             (fasls nil))
+        (unwind-protect
+             (progn
+               (loop for i from 0
+                     for file in files
+                     do (with-open-file (s file :direction :output :if-exists :supersede)
+                          (format s "(in-package #:clasp-tests)~%~
+                                     (push (list ~d \"string~d\" ~d ~d.5d0 #\\~d #(~d 2 3))~%~
+                                     ~6t*load-parallel-results*)~%"
+                                  i i (expt 10 (+ 30 i)) i i i))
+                        (push (compile-file file :verbose nil :print nil) fasls))
+               (setf *load-parallel-results* nil)
+               (ext:load-fasls-in-parallel (reverse fasls) :nthreads 2)
+               (equalp (reverse *load-parallel-results*)
+                       (loop for i below 3
+                             collect (list i (format nil "string~d" i) (expt 10 (+ 30 i))
+                                           (+ i 0.5d0) (digit-char i) (vector i 2 3)))))
+          (dolist (file (append files fasls))
+            (when (and file (probe-file file))
+              (delete-file file)))
+          (core:rmdir directory)))
+      (t))
@@ -0,0 +1,110 @@
+;;; Microbenchmarks for the bytecode VM's dispatch loop.
+;;; Each kernel is compiled with the bytecode compiler and run for a fixed
+;;; number of iterations. If the VM was built with VM_COUNT_INSTRUCTIONS,
+;;; instructions per second are reported as well as elapsed time; compare
+;;; the numbers between builds to evaluate changes to the dispatch code.
+;;; Autocompilation is disabled while the kernels run so that they stay in
+;;; the VM. The last few kernels bind special variables and make nonlocal
+;;; exits from closures, so that they measure how the VM handles dynamic
+;;; extent. Load this file and call (time-bytecode-vm).
+
+(defparameter *bytecode-vm-kernels*
+  '((fib
+     (lambda (n)
+       (labels ((fib (n) (if (< n 2) n (+ (fib (- n 1)) (fib (- n 2))))))
+         (fib n)))
+     25)
+    (tak
+     (lambda (n)
+       (labels ((tak (x y z)
+                  (if (not (< y x))
+                      z
+                      (tak (tak (1- x) y z) (tak (1- y) z x) (tak (1- z) x y)))))
+         (dotimes (i n) (tak 18 12 6))))
+     100)
+    (loop-sum
+     (lambda (n)
+       (let ((sum 0))
+         (dotimes (i n sum) (setq sum (+ sum i)))))
+     10000000)
+    (closure-counter
+     (lambda (n)
+       (let* ((count 0)
+              (incr (lambda () (setq count (1+ count)))))
+         (dotimes (i n count) (funcall incr))))
+     5000000)
+    (list-walk
+     (lambda (n)
+       (let ((list (make-list 1000)) (len 0))
+         (dotimes (i n len)
+           (do ((l list (cdr l))) ((null l)) (setq len (1+ len))))))
+     5000)
+    (block-return
+     (lambda (n)
+       (let ((count 0))
+         (dotimes (i n count)
+           (block nil
+             (when (evenp i) (return))
+             (setq count (1+ count))))))
+     2000000)
+    (special-bind
+     (lambda (n)
+       (let ((count 0))
+         (dotimes (i n count)
+           (let ((*print-base* 10) (*print-radix* nil))
+             (declare (special *print-base* *print-radix*))
+             (setq count (+ count (if *print-radix* 0 1)))))))
+     2000000)
+    (special-recurse
+     (lambda (n)
+       (labels ((deep (depth)
+                  (let ((*print-level* depth))
+                    (declare (special *print-level*))
+                    (if (zerop depth) *print-level* (deep (1- depth))))))
+         (dotimes (i n) (deep 100))))
+     20000)
+    (closure-return
+     (lambda (n)
+       (let ((list '(1 2 3 4 5 6 7 8)) (count 0))
+         (dotimes (i n count)
+           (setq count
+                 (+ count (block found
+                            (mapc (lambda (x) (when (= x 4) (return-from found x)))
+                                  list)
+                            0))))))
+     500000)
+    (closure-go
+     (lambda (n)
+       (let ((count 0))
+         (dotimes (i n count)
+           (let ((k 0))
+             (tagbody
+              again
+                (setq k (1+ k))
+                (funcall (lambda () (when (< k 4) (go again))))))
+           (setq count (1+ count)))))
+     500000)))
+
+(defun time-bytecode-kernel (name lambda-expression n)
+  (let ((fun (cmp:bytecompile lambda-expression))
+        (count-instructions-p (fboundp 'core::vm-instruction-count)))
+    (funcall fun 1)                     ; warm up
+    (when count-instructions-p (funcall 'core::vm-instruction-count t))
+    (let* ((start (get-internal-real-time))
+           (_ (funcall fun n))
+           (seconds (/ (float (- (get-internal-real-time) start) 1d0)
+                       internal-time-units-per-second)))
+      (declare (ignore _))
+      (if count-instructions-p
+          (let ((instructions (funcall 'core::vm-instruction-count t)))
+            (format t "~&~20a ~10,3f s ~14d instructions ~10,2e instructions/s~%"
+                    name seconds instructions
+                    (if (zerop seconds) 0 (/ instructions seconds))))
+          (format t "~&~20a ~10,3f s~%" name seconds))
+      seconds)))
+
+(defun time-bytecode-vm ()
+  (let ((cmp:*autocompile-hook* nil))
+    (loop for (name lambda-expression n) in *bytecode-vm-kernels*
+          sum (time-bytecode-kernel name lambda-expression n) into total
+          finally (format t "~&~20a ~10,3f s~%" "total" total))))
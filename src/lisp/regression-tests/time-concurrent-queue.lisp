@@ -0,0 +1,99 @@
+;;; Contention benchmark for MP's lock-free concurrent queue. For each
+;;; thread count, half the threads (at least one) enqueue a fixed total
+;;; number of messages and the other half dequeue them. :LOCKED is a queue
+;;; guarded by a mutex and a condition variable, as CORE:QUEUE used to be;
+;;; :UNBOUNDED and :BOUNDED are MP:CONCURRENT-QUEUEs; :BATCHED moves
+;;; messages with MP:CONCURRENT-ENQUEUE-LIST and MP:CONCURRENT-DEQUEUE-LIST.
+;;; Load this file and call (time-concurrent-queue).
+
+(defparameter *concurrent-queue-messages* 1000000)
+(defparameter *concurrent-queue-thread-counts* '(1 2 4 8 16 32 64))
+(defparameter *concurrent-queue-capacity* 1024)
+(defparameter *concurrent-queue-batch-size* 64)
+
+(defstruct (locked-queue (:constructor make-locked-queue ()))
+  (head nil) (tail nil)
+  (lock (mp:make-lock :name "LOCKED-QUEUE"))
+  (not-empty (mp:make-condition-variable :name "LOCKED-QUEUE-NOT-EMPTY")))
+
+(defun locked-enqueue (queue message)
+  (mp:with-lock ((locked-queue-lock queue))
+    (let ((cell (list message)))
+      (if (locked-queue-tail queue)
+          (setf (cdr (locked-queue-tail queue)) cell)
+          (setf (locked-queue-head queue) cell))
+      (setf (locked-queue-tail queue) cell))
+    (mp:condition-variable-signal (locked-queue-not-empty queue))))
+
+(defun locked-dequeue (queue)
+  (mp:with-lock ((locked-queue-lock queue))
+    (loop until (locked-queue-head queue)
+          do (mp:condition-variable-wait (locked-queue-not-empty queue)
+                                         (locked-queue-lock queue)))
+    (prog1 (pop (locked-queue-head queue))
+      (unless (locked-queue-head queue)
+        (setf (locked-queue-tail queue) nil)))))
+
+(defun concurrent-queue-operations (kind)
+  "Return a queue of KIND, a function to enqueue a list of messages on it
+and a function to dequeue at least one message from it as a list."
+  (ecase kind
+    (:locked
+     (let ((queue (make-locked-queue)))
+       (values (lambda (messages) (dolist (m messages) (locked-enqueue queue m)))
+               (lambda () (list (locked-dequeue queue))))))
+    ((:unbounded :bounded)
+     (let ((queue (mp:make-concurrent-queue
+                   :capacity (and (eq kind :bounded) *concurrent-queue-capacity*))))
+       (values (lambda (messages)
+                 (dolist (m messages)
+                   (loop until (mp:concurrent-enqueue queue m)
+                         do (mp:process-yield))))
+               (lambda () (list (mp:concurrent-dequeue queue))))))
+    (:batched
+     (let ((queue (mp:make-concurrent-queue)))
+       (values (lambda (messages) (mp:concurrent-enqueue-list queue messages))
+               (lambda () (mp:concurrent-dequeue-list queue *concurrent-queue-batch-size*)))))))
+
+(defun time-concurrent-queue-kernel (kind threads)
+  (multiple-value-bind (enqueue dequeue) (concurrent-queue-operations kind)
+    (let* ((nproducers (max 1 (floor threads 2)))
+           (nconsumers (max 1 (- threads nproducers)))
+           (per-producer (floor *concurrent-queue-messages* nproducers))
+           (batch (if (eq kind :batched) *concurrent-queue-batch-size* 1))
+           (start (get-internal-real-time))
+           (consumers
+             (loop repeat nconsumers
+                   collect (mp:process-run-function
+                            nil
+                            (lambda ()
+                              (loop for messages = (funcall dequeue)
+                                    for done = (count :done messages)
+                                    sum (- (length messages) done) into received
+                                    when (plusp done)
+                                      do (when (> done 1)
+                                           (funcall enqueue (make-list (1- done) :initial-element :done)))
+                                         (return received))))))
+           (producers
+             (loop repeat nproducers
+                   collect (mp:process-run-function
+                            nil
+                            (lambda ()
+                              (loop with message = (make-list batch :initial-element 1)
+                                    repeat (floor per-producer batch)
+                                    do (funcall enqueue (copy-list message))))))))
+      (mapc #'mp:process-join producers)
+      (funcall enqueue (make-list nconsumers :initial-element :done))
+      (let ((received (reduce #'+ consumers :key #'mp:process-join))
+            (seconds (/ (float (- (get-internal-real-time) start) 1d0)
+                        internal-time-units-per-second)))
+        (assert (= received (* nproducers batch (floor per-producer batch))))
+        (format t "~&~10a ~3d threads ~10,3f s ~10,2e messages/s~%"
+                kind threads seconds
+                (if (zerop seconds) 0 (/ received seconds)))
+        seconds))))
+
+(defun time-concurrent-queue ()
+  (dolist (threads *concurrent-queue-thread-counts*)
+    (dolist (kind '(:locked :unbounded :bounded :batched))
+      (time-concurrent-queue-kernel kind threads))))
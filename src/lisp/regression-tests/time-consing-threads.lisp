@@ -0,0 +1,50 @@
+;;; Scaling benchmark for allocation from many threads. Each thread
+;;; repeatedly builds and drops short lists and small structure instances,
+;;; so nearly all of its time is spent allocating conses and small fixed
+;;; size objects. The total amount of work is the same for every thread
+;;; count, so with allocation that doesn't serialize on a global lock the
+;;; elapsed time falls as threads are added, up to the number of cores.
+;;; The speedup column is relative to one thread. Load this file and call
+;;; (time-consing-threads).
+
+(defparameter *consing-allocations* 40000000)
+(defparameter *consing-list-length* 16)
+(defparameter *consing-thread-counts* '(1 2 4 8 16))
+
+(defstruct (consing-point (:constructor make-consing-point (x y z)))
+  x y z)
+
+(defun consing-kernel (allocations)
+  (declare (optimize speed) (fixnum allocations))
+  (let ((rounds (floor allocations (1+ *consing-list-length*)))
+        (length *consing-list-length*)
+        (checksum 0))
+    (declare (fixnum rounds length checksum))
+    (dotimes (i rounds checksum)
+      (let ((list (make-list length :initial-element i))
+            (point (make-consing-point i length nil)))
+        (setf checksum (logand most-positive-fixnum
+                               (+ checksum (length list) (consing-point-y point))))))))
+
+(defun time-consing-kernel (threads)
+  (gctools:garbage-collect)
+  (let* ((per-thread (floor *consing-allocations* threads))
+         (start (get-internal-real-time))
+         (workers (loop for i below threads
+                        collect (mp:process-run-function
+                                 (format nil "consing-~d" i)
+                                 (lambda () (consing-kernel per-thread))))))
+    (dolist (worker workers)
+      (mp:process-join worker))
+    (/ (float (- (get-internal-real-time) start) 1d0)
+       internal-time-units-per-second)))
+
+(defun time-consing-threads ()
+  (let ((baseline nil))
+    (dolist (threads *consing-thread-counts*)
+      (let ((seconds (time-consing-kernel threads)))
+        (unless baseline (setf baseline seconds))
+        (format t "~&~3d threads ~10,3f s ~10,1f Mallocs/s  speedup ~5,2f~%"
+                threads seconds
+                (/ *consing-allocations* seconds 1d6)
+                (/ baseline seconds))))))
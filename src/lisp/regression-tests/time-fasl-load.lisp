@@ -0,0 +1,36 @@
+;;; Startup benchmark for the bytecode FASL loader.
+;;; Loads the FASLs clasp builds for itself (by default its modules),
+;;; once by decoding through the stream layer, once through the
+;;; in-memory path that core:load-bytecode uses for regular files, and
+;;; once with ext:load-fasls-in-parallel, and reports the time for each. Loading redefines whatever the FASLs
+;;; define, so run this in a fresh clasp. Load this file and call
+;;; (time-fasl-load), or pass a list of FASL pathnames in load order.
+
+(defun fasl-load-via-stream (file)
+  (with-open-file (stream file :element-type '(unsigned-byte 8))
+    (core:load-bytecode-stream stream)))
+
+(defun fasl-load-via-buffer (file)
+  (core:load-bytecode file nil nil :default))
+
+(defun fasl-load-in-parallel (files)
+  (ext:load-fasls-in-parallel files))
+
+(defun time-fasl-load-pass (name files loader &optional all-at-once)
+  (let ((start (get-internal-real-time)))
+    (if all-at-once
+        (funcall loader files)
+        (dolist (file files) (funcall loader file)))
+    (let ((seconds (/ (float (- (get-internal-real-time) start) 1d0)
+                      internal-time-units-per-second)))
+      (format t "~&~10a ~5d files ~10,3f s~%" name (length files) seconds)
+      seconds)))
+
+(defun time-fasl-load (&optional (files (directory "SYS:LIB;MODULES;*.fasl")))
+  (let ((bytes (loop for file in files
+                     sum (with-open-file (s file :element-type '(unsigned-byte 8))
+                           (file-length s)))))
+    (format t "~&~d FASLs, ~d bytes~%" (length files) bytes)
+    (time-fasl-load-pass "stream" files #'fasl-load-via-stream)
+    (time-fasl-load-pass "buffer" files #'fasl-load-via-buffer)
+    (time-fasl-load-pass "parallel" files #'fasl-load-in-parallel t)))
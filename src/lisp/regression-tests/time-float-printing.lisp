@@ -0,0 +1,45 @@
+;;; Throughput benchmark for printing floats, as when writing JSON or CSV.
+;;; Each kernel writes the same random doubles or singles to a string
+;;; output stream, through PRIN1 or one of the FORMAT directives that
+;;; print the shortest digits that read back as the same float. Floats
+;;; per second and bytes consed per float are reported for each.
+;;; Load this file and call (time-float-printing).
+
+(defparameter *float-printing-count* 200000)
+
+(defun float-printing-samples (type)
+  (let ((samples (make-array *float-printing-count*)))
+    (dotimes (i (length samples) samples)
+      (setf (aref samples i)
+            ;; Spread the exponents out, as real data has both very
+            ;; large and very small magnitudes
+            (coerce (* (- (random 2d0) 1d0) (expt 10d0 (- (random 60) 30))) type)))))
+
+(defun time-float-printing-kernel (name samples printer)
+  (gctools:garbage-collect)
+  (let ((stream (make-string-output-stream))
+        (start (get-internal-real-time))
+        (consed (gctools:bytes-allocated)))
+    (loop for x across samples
+          do (funcall printer x stream)
+             (write-char #\, stream))
+    (let ((seconds (/ (float (- (get-internal-real-time) start) 1d0)
+                      internal-time-units-per-second))
+          (bytes (- (gctools:bytes-allocated) consed)))
+      (get-output-stream-string stream)
+      (format t "~&~24a ~10,3f s ~12,1f floats/s ~10,1f bytes/float~%"
+              name seconds (/ (length samples) seconds)
+              (/ bytes (float (length samples) 1d0)))
+      seconds)))
+
+(defun time-float-printing ()
+  (let ((*read-default-float-format* 'double-float))
+    (dolist (type '(double-float single-float))
+      (let ((samples (float-printing-samples type)))
+        (time-float-printing-kernel (format nil "~(~a~) prin1" type) samples #'prin1)
+        (time-float-printing-kernel (format nil "~(~a~) ~~F" type) samples
+                                    (lambda (x stream) (format stream "~F" x)))
+        (time-float-printing-kernel (format nil "~(~a~) ~~E" type) samples
+                                    (lambda (x stream) (format stream "~E" x)))
+        (time-float-printing-kernel (format nil "~(~a~) ~~G" type) samples
+                                    (lambda (x stream) (format stream "~G" x)))))))
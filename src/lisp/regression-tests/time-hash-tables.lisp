@@ -0,0 +1,42 @@
+;;; Benchmarks for EQUAL and EQUALP hash tables, comparing tables that
+;;; cache hashes (see :CACHE-HASHES in MAKE-HASH-TABLE) with plain ones.
+;;; Each kernel fills a table with string or list keys, then looks up every
+;;; key several times with a fresh copy, so that each hit has to compare the
+;;; keys with the table's test. Load this file and call (time-hash-tables).
+
+(defparameter *hash-table-key-count* 100000)
+(defparameter *hash-table-lookup-rounds* 10)
+
+(defun make-hash-table-keys (kind n)
+  (ecase kind
+    (:string (loop for i below n
+                   collect (format nil "a-fairly-long-common-prefix-~d" i)))
+    (:list (loop for i below n
+                 collect (list :key (mod i 17) (format nil "~d" i) i)))))
+
+(defun time-hash-table-kernel (test kind cache-hashes)
+  (let* ((keys (make-hash-table-keys kind *hash-table-key-count*))
+         (probes (mapcar (lambda (key)
+                           (if (stringp key) (copy-seq key) (copy-tree key)))
+                         keys))
+         (start (get-internal-real-time))
+         (ht (make-hash-table :test test :cache-hashes cache-hashes))
+         (hits 0))
+    (loop for key in keys for i from 0
+          do (setf (gethash key ht) i))
+    (dotimes (round *hash-table-lookup-rounds*)
+      (dolist (probe probes)
+        (when (nth-value 1 (gethash probe ht))
+          (incf hits))))
+    (let ((seconds (/ (float (- (get-internal-real-time) start) 1d0)
+                      internal-time-units-per-second)))
+      (assert (= hits (* *hash-table-key-count* *hash-table-lookup-rounds*)))
+      (format t "~&~8a ~8a ~15a ~10,3f s~%"
+              test kind (if cache-hashes "cached hashes" "plain") seconds)
+      seconds)))
+
+(defun time-hash-tables ()
+  (dolist (test '(equal equalp))
+    (dolist (kind '(:string :list))
+      (time-hash-table-kernel test kind nil)
+      (time-hash-table-kernel test kind t))))
@@ -0,0 +1,49 @@
+;;; Throughput benchmark for posix file streams (OPEN with :CSTREAM NIL)
+;;; under each buffering mode. The kernels write a file character by
+;;; character, line by line and byte by byte, then read it back the same
+;;; way; every unbuffered operation costs a system call. Load this file
+;;; and call (time-posix-streams).
+
+(defparameter *posix-stream-line-count* 20000)
+(defparameter *posix-stream-line*
+  (make-string 80 :initial-element #\x))
+
+(defun time-posix-stream-kernel (kind buffering)
+  (let ((name (core:mkstemp "time-posix-streams"))
+        (element-type (if (eq kind :byte) '(unsigned-byte 8) 'character))
+        (start (get-internal-real-time))
+        (count 0))
+    (unwind-protect
+         (progn
+           (with-open-file (stream name :direction :output :if-exists :supersede
+                                        :element-type element-type :cstream nil)
+             (core::set-buffering-mode stream buffering)
+             (dotimes (i *posix-stream-line-count*)
+               (ecase kind
+                 (:char (loop for char across *posix-stream-line*
+                              do (write-char char stream))
+                  (terpri stream))
+                 (:line (write-line *posix-stream-line* stream))
+                 (:byte (loop repeat (1+ (length *posix-stream-line*))
+                              do (write-byte 120 stream))))))
+           (with-open-file (stream name :element-type element-type :cstream nil)
+             (core::set-buffering-mode stream buffering)
+             (ecase kind
+               (:char (loop while (read-char stream nil) do (incf count)))
+               (:line (loop while (read-line stream nil) do (incf count)))
+               (:byte (loop while (read-byte stream nil) do (incf count))))))
+      (delete-file name))
+    (let ((seconds (/ (float (- (get-internal-real-time) start) 1d0)
+                      internal-time-units-per-second)))
+      (format t "~&~6a ~6a ~10,3f s ~10,2f MB/s~%"
+              kind buffering seconds
+              (if (zerop seconds)
+                  0
+                  (/ (* 2 *posix-stream-line-count* (1+ (length *posix-stream-line*)))
+                     seconds 1048576d0)))
+      seconds)))
+
+(defun time-posix-streams ()
+  (dolist (kind '(:char :line :byte))
+    (dolist (buffering '(:none :line :full))
+      (time-posix-stream-kernel kind buffering))))
@@ -0,0 +1,44 @@
+;;; Benchmark for READ on numeric data. The kernel writes a file of
+;;; numbers, one per line, then times reading them back with READ: first
+;;; fixnums, then short decimals as they appear in CSV exports, then
+;;; doubles printed with all 17 significant digits. The file is written
+;;; once per kind and deleted afterwards. Load this file and call
+;;; (time-read-numbers).
+
+(defparameter *read-numbers-count* 10000000)
+(defparameter *read-numbers-pathname* #p"/tmp/clasp-read-numbers.txt")
+
+(defun write-read-numbers-file (kind)
+  (with-open-file (stream *read-numbers-pathname* :direction :output
+                                                  :if-exists :supersede)
+    (let ((*read-default-float-format* 'double-float))
+      (dotimes (i *read-numbers-count*)
+        (ecase kind
+          (:fixnum (format stream "~d~%" (- (random 2000000000) 1000000000)))
+          (:decimal (format stream "~,3f~%" (- (random 20000d0) 10000d0)))
+          (:double (format stream "~,16,,,,,'eE~%"
+                           (* (- (random 2d0) 1d0) (expt 10d0 (- (random 40) 20))))))))))
+
+(defun time-read-numbers-kernel (kind)
+  (write-read-numbers-file kind)
+  (gctools:garbage-collect)
+  (with-open-file (stream *read-numbers-pathname*)
+    (let ((*read-default-float-format* 'double-float)
+          (start (get-internal-real-time))
+          (count 0))
+      (loop for number = (read stream nil nil)
+            while number
+            do (incf count))
+      (let ((seconds (/ (float (- (get-internal-real-time) start) 1d0)
+                        internal-time-units-per-second)))
+        (assert (= count *read-numbers-count*))
+        (format t "~&~8a ~10d numbers ~10,3f s ~10,3f Mnumbers/s~%"
+                kind count seconds (/ count seconds 1d6))
+        seconds))))
+
+(defun time-read-numbers ()
+  (unwind-protect
+       (dolist (kind '(:fixnum :decimal :double))
+         (time-read-numbers-kernel kind))
+    (when (probe-file *read-numbers-pathname*)
+      (delete-file *read-numbers-pathname*))))
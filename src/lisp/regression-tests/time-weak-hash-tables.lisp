@@ -0,0 +1,68 @@
+;;; Benchmark for weak hash tables used as memoization caches (see :WEAKNESS
+;;; in MAKE-HASH-TABLE). Each kernel looks up string keys drawn from a skewed
+;;; distribution in an EQUAL table and computes a large result on a miss. The
+;;; program holds on to its most recent results, as a real client would, so
+;;; tables with weak values keep the entries that are still in use while the
+;;; collector drops the rest. For each weakness the hit rate, the number of
+;;; entries left in the table and the resident set size are reported. The
+;;; resident set never shrinks, so the tables that hold the most run last.
+;;; Load this file and call (time-weak-hash-tables).
+
+(defparameter *weak-cache-requests* 200000)
+(defparameter *weak-cache-key-count* 20000)
+(defparameter *weak-cache-working-set* 1000)
+(defparameter *weak-cache-result-size* 512)
+(defparameter *weak-cache-gc-interval* 10000)
+
+(defun weak-cache-resident-bytes ()
+  "The resident set size of this process, or the size of the heap if /proc is unavailable."
+  (or (ignore-errors
+       (with-open-file (stream "/proc/self/statm")
+         (let ((*read-eval* nil))
+           (read stream)
+           (* (read stream) 4096))))
+      (core:dynamic-usage)))
+
+(defun weak-cache-key (n)
+  ;; Cubing a uniform random number favours small keys
+  (format nil "memoized-request-~d"
+          (floor (* n (expt (random 1d0) 3)))))
+
+(defun time-weak-cache-kernel (weakness)
+  (gctools:garbage-collect)
+  (let* ((cache (make-hash-table :test #'equal :weakness weakness))
+         (working-set (make-array *weak-cache-working-set* :initial-element nil))
+         (start (get-internal-real-time))
+         (hits 0))
+    (dotimes (i *weak-cache-requests*)
+      (let* ((key (weak-cache-key *weak-cache-key-count*))
+             (result (gethash key cache)))
+        (if result
+            (incf hits)
+            (setf result (make-array *weak-cache-result-size*
+                                     :element-type 'double-float
+                                     :initial-element (float i 1d0))
+                  (gethash key cache) result))
+        (setf (aref working-set (mod i *weak-cache-working-set*)) result))
+      (when (zerop (mod (1+ i) *weak-cache-gc-interval*))
+        (gctools:garbage-collect)))
+    (gctools:garbage-collect)
+    (let ((seconds (/ (float (- (get-internal-real-time) start) 1d0)
+                      internal-time-units-per-second)))
+      (format t "~&~15a ~8,3f s   hit rate ~6,2f%   ~7d entries   ~8,1f MB resident~%"
+              (or weakness "strong") seconds
+              (* 100d0 (/ hits *weak-cache-requests*))
+              ;; HASH-TABLE-COUNT includes entries the collector has
+              ;; splatted but that haven't been swept from the table yet
+              (let ((live 0))
+                (maphash (lambda (key value)
+                           (declare (ignore key value))
+                           (incf live))
+                         cache)
+                live)
+              (/ (weak-cache-resident-bytes) 1048576d0))
+      seconds)))
+
+(defun time-weak-hash-tables ()
+  (dolist (weakness '(:key :key-and-value :value :key-or-value nil))
+    (time-weak-cache-kernel weakness)))
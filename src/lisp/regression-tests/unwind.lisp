@@ -10,3 +10,43 @@
                                     :defaults (core:mkstemp "/tmp/predlib")))
         (- (gctools:thread-local-unwinds) unwinds))
       (0))
+
+;;; The bytecode VM keeps special bindings and block/tagbody entries on
+;;; its own stack, so check that values computed inside them are still
+;;; there when they end, and that unwinding undoes them.
+(defvar *unwind-special* 0)
+
+(test bytecode-dynamic-extent-values
+      (funcall (cmp:bytecompile
+                '(lambda ()
+                  (list 1
+                   (let ((*unwind-special* 8))
+                     (block found
+                       (mapc (lambda (x)
+                               (when (= x 2) (return-from found (* x *unwind-special*))))
+                             '(1 2 3))
+                       nil))
+                   *unwind-special*))))
+      ((1 16 0)))
+
+(test bytecode-dynamic-extent-error
+      (funcall (cmp:bytecompile
+                '(lambda ()
+                  (list (ignore-errors
+                         (let ((*unwind-special* 1))
+                           (let ((*unwind-special* 2))
+                             (error "unwind through ~d" *unwind-special*))))
+                   *unwind-special*))))
+      ((nil 0)))
+
+(test bytecode-dynamic-extent-go
+      (funcall (cmp:bytecompile
+                '(lambda ()
+                  (let ((n 0))
+                    (tagbody
+                     again
+                       (let ((*unwind-special* n))
+                         (setq n (1+ n))
+                         (funcall (lambda () (when (< *unwind-special* 4) (go again))))))
+                    (list n *unwind-special*)))))
+      ((5 0)))
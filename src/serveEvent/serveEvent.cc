@@ -26,9 +26,17 @@ THE SOFTWARE.
 /* -^- */
 
 #include <errno.h>
+#include <limits.h>
+#include <math.h>
+#include <unistd.h>
 #include <sys/select.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif
 #include <clasp/core/foundation.h>
 #include <clasp/core/object.h>
+#include <clasp/core/lisp.h>
+#include <clasp/core/numbers.h>
 #include <clasp/core/fli.h>
 #include <clasp/core/symbolTable.h>
 #include <clasp/serveEvent/serveEventPackage.h>
@@ -73,6 +81,114 @@ CL_DEFUN core::Integer_mv serve_event_internal__ll_serveEventWithTimeout(clasp_f
   return Values(Integer_O::create(selectRet), Integer_O::create((gc::Fixnum)errno));
 }
 
+// epoll backend - an epoll instance keeps the interest set in the kernel, so
+// waiting costs O(ready descriptors) rather than O(registered descriptors) and
+// there is no FD_SETSIZE limit. Elsewhere these report ENOSYS and the Lisp side
+// stays on select.
+
+CL_DOCSTRING(R"dx(Return true if the epoll backend is available on this platform.)dx");
+DOCGROUP(clasp);
+CL_DEFUN bool serve_event_internal__ll_epoll_available_p() {
+#ifdef __linux__
+  return true;
+#else
+  return false;
+#endif
+}
+
+CL_DOCSTRING(R"dx(Create an epoll instance. Return its descriptor (or -1) and errno.)dx");
+DOCGROUP(clasp);
+CL_DEFUN core::Integer_mv serve_event_internal__ll_epoll_create() {
+#ifdef __linux__
+  gc::Fixnum ret = epoll_create1(EPOLL_CLOEXEC);
+  return Values(Integer_O::create(ret), Integer_O::create((gc::Fixnum)errno));
+#else
+  return Values(Integer_O::create((gc::Fixnum)-1), Integer_O::create((gc::Fixnum)ENOSYS));
+#endif
+}
+
+CL_DOCSTRING(R"dx(Close an epoll instance.)dx");
+DOCGROUP(clasp);
+CL_DEFUN void serve_event_internal__ll_epoll_close(int epfd) { close(epfd); }
+
+CL_LAMBDA(epfd fd input output edge);
+CL_DOCSTRING(R"dx(Set the events that epoll instance EPFD watches for on FD. If neither INPUT nor OUTPUT
+is true FD is removed from the instance. EDGE selects edge rather than level triggering.
+Descriptors that were closed, and so silently dropped by the kernel, are handled.
+Return 0 or -1, and errno.)dx");
+DOCGROUP(clasp);
+CL_DEFUN core::Integer_mv serve_event_internal__ll_epoll_update(int epfd, int fd, bool input, bool output, bool edge) {
+#ifdef __linux__
+  int ret;
+  if (!input && !output) {
+    ret = epoll_ctl(epfd, EPOLL_CTL_DEL, fd, NULL);
+    if (ret < 0 && (errno == ENOENT || errno == EBADF))
+      ret = 0;
+  } else {
+    struct epoll_event event;
+    event.events = (input ? EPOLLIN : 0) | (output ? EPOLLOUT : 0) | (edge ? EPOLLET : 0);
+    event.data.u64 = 0;
+    event.data.fd = fd;
+    ret = epoll_ctl(epfd, EPOLL_CTL_MOD, fd, &event);
+    if (ret < 0 && errno == ENOENT)
+      ret = epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &event);
+  }
+  return Values(Integer_O::create((gc::Fixnum)ret), Integer_O::create((gc::Fixnum)errno));
+#else
+  return Values(Integer_O::create((gc::Fixnum)-1), Integer_O::create((gc::Fixnum)ENOSYS));
+#endif
+}
+
+CL_DOCSTRING(R"dx(The size in bytes of one event in the buffer passed to LL-EPOLL-WAIT.)dx");
+DOCGROUP(clasp);
+CL_DEFUN int serve_event_internal__ll_epoll_event_size() {
+#ifdef __linux__
+  return sizeof(struct epoll_event);
+#else
+  return 1;
+#endif
+}
+
+CL_LAMBDA(epfd events maxevents timeout);
+CL_DOCSTRING(R"dx(Wait for up to MAXEVENTS events on epoll instance EPFD and store them in the
+foreign buffer EVENTS. TIMEOUT is NIL to wait indefinitely or a number of seconds.
+Return the number of events (or -1) and errno.)dx");
+DOCGROUP(clasp);
+CL_DEFUN core::Integer_mv serve_event_internal__ll_epoll_wait(int epfd, clasp_ffi::ForeignData_sp events, int maxevents,
+                                                              T_sp timeout) {
+#ifdef __linux__
+  int millis = -1;
+  if (timeout.notnilp()) {
+    double seconds = clasp_to_double(gc::As<Real_sp>(timeout));
+    if (seconds < 0.0) {
+      SIMPLE_ERROR("Illegal timeout {} seconds", seconds);
+    }
+    // Round up so that short timeouts don't turn into busy polling
+    millis = (int)std::min(ceil(seconds * 1000.0), (double)INT_MAX);
+  }
+  gc::Fixnum ret = epoll_wait(epfd, events->data<struct epoll_event*>(), maxevents, millis);
+  return Values(Integer_O::create(ret), Integer_O::create((gc::Fixnum)errno));
+#else
+  return Values(Integer_O::create((gc::Fixnum)-1), Integer_O::create((gc::Fixnum)ENOSYS));
+#endif
+}
+
+CL_LAMBDA(events index);
+CL_DOCSTRING(R"dx(Decode event INDEX of a buffer filled by LL-EPOLL-WAIT.
+Return the descriptor, whether it is ready for input and whether it is ready for output.
+Errors and hangups count as both, so that handlers get to see them.)dx");
+DOCGROUP(clasp);
+CL_DEFUN core::T_mv serve_event_internal__ll_epoll_event(clasp_ffi::ForeignData_sp events, int index) {
+#ifdef __linux__
+  struct epoll_event& event = events->data<struct epoll_event*>()[index];
+  bool failed = (event.events & (EPOLLERR | EPOLLHUP)) != 0;
+  return Values(make_fixnum(event.data.fd), _lisp->_boolean((event.events & EPOLLIN) || failed),
+                _lisp->_boolean((event.events & EPOLLOUT) || failed));
+#else
+  SIMPLE_ERROR("epoll is not available on this platform");
+#endif
+}
+
 void initialize_serveEvent_globals() {
   SYMBOL_EXPORT_SC_(ServeEventPkg, _PLUS_EINTR_PLUS_);
   _sym__PLUS_EINTR_PLUS_->defconstant(Integer_O::create((gc::Fixnum)EINTR));
@@ -84,5 +200,12 @@ SYMBOL_EXPORT_SC_(ServeEventPkg, ll_fd_isset);
 SYMBOL_EXPORT_SC_(ServeEventPkg, ll_fdset_size);
 SYMBOL_EXPORT_SC_(ServeEventPkg, ll_serveEventNoTimeout);
 SYMBOL_EXPORT_SC_(ServeEventPkg, ll_serveEventWithTimeout);
+SYMBOL_EXPORT_SC_(ServeEventPkg, ll_epoll_available_p);
+SYMBOL_EXPORT_SC_(ServeEventPkg, ll_epoll_create);
+SYMBOL_EXPORT_SC_(ServeEventPkg, ll_epoll_close);
+SYMBOL_EXPORT_SC_(ServeEventPkg, ll_epoll_update);
+SYMBOL_EXPORT_SC_(ServeEventPkg, ll_epoll_event_size);
+SYMBOL_EXPORT_SC_(ServeEventPkg, ll_epoll_wait);
+SYMBOL_EXPORT_SC_(ServeEventPkg, ll_epoll_event);
 
 }; // namespace serveEvent
@@ -36,6 +36,10 @@ THE SOFTWARE.
 #include <netinet/tcp.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <poll.h>
+#if defined(__linux__)
+#include <sys/sendfile.h>
+#endif
 #ifndef MSG_CONFIRM
 #define MSG_CONFIRM 0
 #endif
@@ -639,6 +643,260 @@ CL_DOCSTRING(R"dx(ll_strerror_errno)dx");
 DOCGROUP(clasp);
 CL_DEFUN core::String_sp sockets_internal__ll_strerror_errno() { return core::SimpleBaseString_O::make(strerror(errno)); }
 
+// Kernel copies between file descriptors. sendfile(2) reads from a file at an
+// explicit offset; splice(2) moves data from a pipe or socket through a pipe
+// of our own. Where neither applies the octets are copied through a buffer.
+
+#define KERNEL_COPY_BUFFER_SIZE 65536
+#define KERNEL_COPY_CHUNK_SIZE ((size_t)1 << 30)
+
+// Block until FD is ready for EVENTS, for descriptors in non-blocking mode.
+static void kernel_copy_wait(int fd, short events) {
+  struct pollfd pfd;
+  pfd.fd = fd;
+  pfd.events = events;
+  pfd.revents = 0;
+  while (poll(&pfd, 1, -1) < 0 && errno == EINTR)
+    ;
+}
+
+// Write all N octets of BUFFER to FD. Return false on error.
+static bool kernel_copy_write_all(int fd, const unsigned char* buffer, size_t n) {
+  while (n > 0) {
+    ssize_t written = write(fd, buffer, n);
+    if (written < 0) {
+      if (errno == EINTR)
+        continue;
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        kernel_copy_wait(fd, POLLOUT);
+        continue;
+      }
+      return false;
+    }
+    buffer += written;
+    n -= written;
+  }
+  return true;
+}
+
+// Copy up to COUNT octets from IN_FD to OUT_FD through a buffer, reading at
+// *OFFSET (which is advanced) if OFFSET is not NULL. Return the number of
+// octets copied, or -1 if nothing was copied before an error.
+static ssize_t buffered_fd_copy(int in_fd, int out_fd, off_t* offset, size_t count) {
+  unsigned char buffer[KERNEL_COPY_BUFFER_SIZE];
+  size_t total = 0;
+  while (total < count) {
+    size_t chunk = std::min(count - total, (size_t)KERNEL_COPY_BUFFER_SIZE);
+    ssize_t nread = offset ? pread(in_fd, buffer, chunk, *offset) : read(in_fd, buffer, chunk);
+    if (nread < 0) {
+      if (errno == EINTR)
+        continue;
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        kernel_copy_wait(in_fd, POLLIN);
+        continue;
+      }
+      return total ? (ssize_t)total : -1;
+    }
+    if (nread == 0)
+      break;
+    if (!kernel_copy_write_all(out_fd, buffer, nread))
+      return total ? (ssize_t)total : -1;
+    if (offset)
+      *offset += nread;
+    total += nread;
+  }
+  return total;
+}
+
+// Copy up to COUNT octets of the file IN_FD, starting at *OFFSET, to OUT_FD
+// and advance *OFFSET. Falls back to a buffered copy if sendfile can't be used
+// for this pair of descriptors.
+static ssize_t sendfile_fd_copy(int out_fd, int in_fd, off_t* offset, size_t count) {
+#if defined(__linux__)
+  size_t total = 0;
+  while (total < count) {
+    ssize_t sent = sendfile(out_fd, in_fd, offset, std::min(count - total, KERNEL_COPY_CHUNK_SIZE));
+    if (sent < 0) {
+      if (errno == EINTR)
+        continue;
+      if (errno == EAGAIN) {
+        kernel_copy_wait(out_fd, POLLOUT);
+        continue;
+      }
+      if (total == 0 && (errno == EINVAL || errno == ENOSYS || errno == EOPNOTSUPP))
+        return buffered_fd_copy(in_fd, out_fd, offset, count);
+      return total ? (ssize_t)total : -1;
+    }
+    if (sent == 0)
+      break;
+    total += sent;
+  }
+  return total;
+#else
+  return buffered_fd_copy(in_fd, out_fd, offset, count);
+#endif
+}
+
+// Copy up to COUNT octets from IN_FD to OUT_FD, reading from the current
+// position of IN_FD, which is usually a pipe or socket. Falls back to a
+// buffered copy if splice can't be used for this pair of descriptors.
+static ssize_t splice_fd_copy(int in_fd, int out_fd, size_t count) {
+#if defined(__linux__)
+  int pipefds[2];
+  if (pipe2(pipefds, O_CLOEXEC) < 0)
+    return buffered_fd_copy(in_fd, out_fd, NULL, count);
+  size_t total = 0;
+  bool failed = false;
+  while (total < count) {
+    ssize_t filled = splice(in_fd, NULL, pipefds[1], NULL, std::min(count - total, KERNEL_COPY_CHUNK_SIZE),
+                            SPLICE_F_MOVE | SPLICE_F_MORE);
+    if (filled < 0) {
+      if (errno == EINTR)
+        continue;
+      if (errno == EAGAIN) {
+        kernel_copy_wait(in_fd, POLLIN);
+        continue;
+      }
+      failed = true;
+      break;
+    }
+    if (filled == 0)
+      break;
+    // Drain the pipe completely so that no octets are lost in it.
+    while (filled > 0) {
+      ssize_t drained = splice(pipefds[0], NULL, out_fd, NULL, filled, SPLICE_F_MOVE | SPLICE_F_MORE);
+      if (drained < 0) {
+        if (errno == EINTR)
+          continue;
+        if (errno == EAGAIN) {
+          kernel_copy_wait(out_fd, POLLOUT);
+          continue;
+        }
+        int saved_errno = errno;
+        close(pipefds[0]);
+        close(pipefds[1]);
+        errno = saved_errno;
+        return total ? (ssize_t)total : -1;
+      }
+      filled -= drained;
+      total += drained;
+    }
+  }
+  int saved_errno = errno;
+  close(pipefds[0]);
+  close(pipefds[1]);
+  errno = saved_errno;
+  if (failed && total == 0) {
+    if (errno == EINVAL || errno == ENOSYS)
+      return buffered_fd_copy(in_fd, out_fd, NULL, count);
+    return -1;
+  }
+  return total;
+#else
+  return buffered_fd_copy(in_fd, out_fd, NULL, count);
+#endif
+}
+
+CL_LAMBDA(out-fd in-fd offset count);
+CL_DECLARE();
+CL_DOCSTRING(R"dx(Copy up to COUNT octets of the file IN-FD, starting at OFFSET, to OUT-FD using sendfile(2) where possible.
+Return the number of octets copied, or -1 if an error occurred before anything was copied.)dx");
+DOCGROUP(clasp);
+CL_DEFUN core::Integer_sp sockets_internal__ll_sendfile(int out_fd, int in_fd, core::Integer_sp offset, core::Integer_sp count) {
+  off_t off = core::clasp_to_int64_t(offset);
+  return core::Integer_O::create((int64_t)sendfile_fd_copy(out_fd, in_fd, &off, core::clasp_to_size_t(count)));
+}
+
+CL_LAMBDA(in-fd out-fd count);
+CL_DECLARE();
+CL_DOCSTRING(R"dx(Copy up to COUNT octets from IN-FD to OUT-FD using splice(2) where possible.
+Return the number of octets copied, or -1 if an error occurred before anything was copied.)dx");
+DOCGROUP(clasp);
+CL_DEFUN core::Integer_sp sockets_internal__ll_splice(int in_fd, int out_fd, core::Integer_sp count) {
+  return core::Integer_O::create((int64_t)splice_fd_copy(in_fd, out_fd, core::clasp_to_size_t(count)));
+}
+
+// The file stream underlying STREAM in DIRECTION, looking through two-way
+// and synonym streams, or NIL.
+static core::T_sp underlying_file_stream(core::T_sp stream, core::StreamDirection direction) {
+  while (true) {
+    if (gc::IsA<core::FileStream_sp>(stream))
+      return stream;
+    if (core::TwoWayStream_sp two_way = stream.asOrNull<core::TwoWayStream_O>())
+      stream = (direction == core::StreamDirection::input) ? two_way->_input_stream : two_way->_output_stream;
+    else if (core::SynonymStream_sp synonym = stream.asOrNull<core::SynonymStream_O>())
+      stream = synonym->stream();
+    else
+      return nil<core::T_O>();
+  }
+}
+
+// True if the octets the kernel reads from STREAM's descriptor are exactly
+// those READ-BYTE would return: the stream is an octet stream with nothing
+// buffered on the Lisp side.
+static bool kernel_copy_stream_p(core::FileStream_sp stream) {
+  if ((stream->_flags & core::CLASP_STREAM_FORMAT) != core::CLASP_STREAM_BINARY || stream->_byte_size != 8)
+    return false;
+  return stream->_byte_stack.nilp();
+}
+
+CL_LAMBDA(input output &optional count);
+CL_DECLARE();
+CL_DOCSTRING(R"dx(Copy COUNT octets (by default, everything up to end of file) from the binary stream INPUT to the binary stream OUTPUT.
+When both are octet file streams, possibly inside two-way or synonym streams, the kernel copies the data
+with sendfile(2) or splice(2) without passing it through Lisp; otherwise it is copied through a buffer.
+Return the number of octets copied.)dx");
+DOCGROUP(clasp);
+CL_DEFUN core::Integer_sp sockets_internal__ll_copyStreamOctets(core::T_sp input, core::T_sp output, core::T_sp count) {
+  size_t limit = count.nilp() ? SIZE_MAX : core::clasp_to_size_t(count);
+  core::T_sp in_stream = underlying_file_stream(input, core::StreamDirection::input);
+  core::T_sp out_stream = underlying_file_stream(output, core::StreamDirection::output);
+  if (in_stream.notnilp() && out_stream.notnilp()) {
+    core::FileStream_sp fin = gc::As_unsafe<core::FileStream_sp>(in_stream);
+    core::FileStream_sp fout = gc::As_unsafe<core::FileStream_sp>(out_stream);
+    int in_fd = fin->file_descriptor(core::StreamDirection::input);
+    int out_fd = fout->file_descriptor(core::StreamDirection::output);
+    if (in_fd >= 0 && out_fd >= 0 && kernel_copy_stream_p(fin) && kernel_copy_stream_p(fout)) {
+      // Anything already written to OUTPUT must reach the descriptor first.
+      fout->force_output();
+      if (lseek(in_fd, 0, SEEK_CUR) >= 0) {
+        // A file: sendfile from the stream's own position, then move the
+        // stream past what was sent.
+        core::T_sp position = fin->position();
+        if (position.fixnump()) {
+          off_t offset = position.unsafe_fixnum();
+          ssize_t copied = sendfile_fd_copy(out_fd, in_fd, &offset, limit);
+          if (copied < 0)
+            SIMPLE_ERROR("Could not copy from {} to {}: {}", _rep_(input), _rep_(output), strerror(errno));
+          fin->set_position(core::Integer_O::create((int64_t)offset));
+          return core::Integer_O::create((int64_t)copied);
+        }
+      } else if (core::PosixFileStream_sp posix = fin.asOrNull<core::PosixFileStream_O>()) {
+        // A pipe or socket can only be read past the stream, if the stream
+        // has nothing of it buffered.
+        if (posix->_input_pos == posix->_input_end) {
+          ssize_t copied = splice_fd_copy(in_fd, out_fd, limit);
+          if (copied < 0)
+            SIMPLE_ERROR("Could not copy from {} to {}: {}", _rep_(input), _rep_(output), strerror(errno));
+          return core::Integer_O::create((int64_t)copied);
+        }
+      }
+    }
+  }
+  // Fall back to copying through a buffer.
+  unsigned char buffer[KERNEL_COPY_BUFFER_SIZE];
+  size_t total = 0;
+  while (total < limit) {
+    size_t chunk = std::min(limit - total, (size_t)KERNEL_COPY_BUFFER_SIZE);
+    size_t nread = core::stream_read_byte8(input, buffer, chunk);
+    if (nread == 0)
+      break;
+    core::stream_write_byte8(output, buffer, nread);
+    total += nread;
+  }
+  return core::Integer_O::create((uint64_t)total);
+}
+
 CL_LAMBDA(fd level constant);
 CL_DECLARE();
 CL_DOCSTRING(R"dx(ll_getSockoptInt)dx");
@@ -934,6 +1192,9 @@ SYMBOL_EXPORT_SC_(SocketsPkg, ll_makeStreamFromFd);
 SYMBOL_EXPORT_SC_(SocketsPkg, ll_autoCloseTwoWayStream);
 SYMBOL_EXPORT_SC_(SocketsPkg, ll_strerror);
 SYMBOL_EXPORT_SC_(SocketsPkg, ll_strerror_errno);
+SYMBOL_EXPORT_SC_(SocketsPkg, ll_sendfile);
+SYMBOL_EXPORT_SC_(SocketsPkg, ll_splice);
+SYMBOL_EXPORT_SC_(SocketsPkg, ll_copyStreamOctets);
 SYMBOL_EXPORT_SC_(SocketsPkg, ll_getSockoptInt);
 SYMBOL_EXPORT_SC_(SocketsPkg, ll_getSockoptBool);
 SYMBOL_EXPORT_SC_(SocketsPkg, ll_getSockoptTimeval);